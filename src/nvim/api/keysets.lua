@@ -236,4 +236,8 @@ return {
   { 'exec_opts', {
     "output";
   }};
+  { 'rpc_flow', {
+    "high";
+    "low";
+  }};
 }
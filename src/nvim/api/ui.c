@@ -101,13 +101,22 @@ static char *mpack_array_dyn16(char **buf)
 
 static void mpack_str(char **buf, const char *str)
 {
-  assert(sizeof(schar_T) - 1 < 0x20);
   size_t len = strlen(str);
+  assert(len < 0x20);
   mpack_w(buf, 0xa0 | len);
   memcpy(*buf, str, len);
   *buf += len;
 }
 
+/// Pack the text of a screen cell. Needs room for MAX_SCHAR_SIZE + 1 bytes.
+static void mpack_schar(char **buf, schar_T sc)
+{
+  assert(MAX_SCHAR_SIZE - 1 < 0x20);
+  size_t len = schar_get(*buf + 1, sc);
+  mpack_w(buf, 0xa0 | len);
+  *buf += len;
+}
+
 void remote_ui_disconnect(uint64_t channel_id)
 {
   UI *ui = pmap_get(uint64_t)(&connected_uis, channel_id);
@@ -116,7 +125,10 @@ void remote_ui_disconnect(uint64_t channel_id)
   }
   UIData *data = ui->data;
   kv_destroy(data->call_buf);
+  // Pending events might be shared with other UIs.
+  remote_ui_flush_buf(ui);
   pmap_del(uint64_t)(&connected_uis, channel_id);
+  remote_ui_regroup();
   ui_detach_impl(ui, channel_id);
 
   // Destroy `ui`.
@@ -185,7 +197,7 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height, Dictiona
     }
   }
 
-  if (ui->ui_ext[kUIHlState] || ui->ui_ext[kUIMultigrid]) {
+  if (ui->ui_ext[kUIHlState] || ui->ui_ext[kUIMultigrid] || ui->ui_ext[kUILineRuns]) {
     ui->ui_ext[kUILinegrid] = true;
   }
 
@@ -212,9 +224,66 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height, Dictiona
   data->wildmenu_active = false;
   data->call_buf = (Array)ARRAY_DICT_INIT;
   kv_ensure_space(data->call_buf, 16);
+  data->leader = NULL;
 
   pmap_put(uint64_t)(&connected_uis, channel_id, ui);
   ui_attach_impl(ui, channel_id);
+  remote_ui_regroup();
+}
+
+/// Whether `a` and `b` would pack every broadcast redraw event identically.
+static bool remote_ui_same_options(UI *a, UI *b)
+{
+  return a->rgb == b->rgb && a->composed == b->composed
+         && memcmp(a->ui_ext, b->ui_ext, sizeof(a->ui_ext)) == 0;
+}
+
+/// Groups attached UIs by their options, so that redraw events are packed
+/// once per group rather than once per UI.
+///
+/// Legacy (non-linegrid) UIs are never grouped, as the emulation of the old
+/// protocol keeps per-UI cursor and highlight state.
+void remote_ui_regroup(void)
+{
+  kvec_t(UI *) all = KV_INITIAL_VALUE;
+  UI *ui;
+  map_foreach_value(&connected_uis, ui, {
+    kv_push(all, ui);
+  });
+
+  // Send everything packed for the old groups.
+  for (size_t i = 0; i < kv_size(all); i++) {
+    remote_ui_flush_buf(kv_A(all, i));
+  }
+
+  for (size_t i = 0; i < kv_size(all); i++) {
+    ui = kv_A(all, i);
+    UIData *data = ui->data;
+    UI *leader = NULL;
+    for (size_t j = 0; j < i && ui->ui_ext[kUILinegrid]; j++) {
+      UI *other = kv_A(all, j);
+      if (!other->data->leader && remote_ui_same_options(ui, other)) {
+        leader = other;
+        break;
+      }
+    }
+    if (leader == data->leader) {
+      continue;
+    }
+    if (data->leader) {
+      // Take over the state of the old group (the old leader is still valid,
+      // when it is being disconnected).
+      data->flushed_events |= data->leader->data->flushed_events;
+      data->wildmenu_active = data->leader->data->wildmenu_active;
+    }
+    if (leader) {
+      // The "flush" event of the leader must reach this UI as well.
+      leader->data->flushed_events |= data->flushed_events;
+    }
+    data->leader = leader;
+  }
+
+  kv_destroy(all);
 }
 
 /// @deprecated
@@ -293,6 +362,7 @@ void nvim_ui_set_option(uint64_t channel_id, String name, Object value, Error *e
   UI *ui = pmap_get(uint64_t)(&connected_uis, channel_id);
 
   ui_set_option(ui, false, name, value, error);
+  remote_ui_regroup();
 }
 
 static void ui_set_option(UI *ui, bool init, String name, Object value, Error *err)
@@ -572,10 +642,21 @@ static bool prepare_call(UI *ui, const char *name)
   return false;
 }
 
+/// Called before an event is packed by a UI which shares the redraw stream of
+/// another UI. This only happens for events sent to just this UI, the shared
+/// events packed so far must be sent before it.
+static void flush_leader(UI *ui)
+{
+  if (ui->data->leader) {
+    remote_ui_flush_buf(ui->data->leader);
+  }
+}
+
 /// Pushes data into UI.UIData, to be consumed later by remote_ui_flush().
 static void push_call(UI *ui, const char *name, Array args)
 {
   UIData *data = ui->data;
+  flush_leader(ui);
   bool pending = data->nevents_pos;
   char *buf_pos_save = data->buf_wptr;
 
@@ -616,8 +697,7 @@ static void push_call(UI *ui, const char *name, Array args)
 
     if (data->temp_buf) {
       size_t size = (size_t)(data->buf_wptr - data->temp_buf);
-      WBuffer *buf = wstream_new_buffer(data->temp_buf, size, 1, xfree);
-      rpc_write_raw(data->channel_id, buf);
+      remote_ui_write(ui, data->temp_buf, size);
       data->temp_buf = NULL;
       data->buf_wptr = data->buf;
       data->nevents_pos = NULL;
@@ -803,12 +883,126 @@ void remote_ui_put(UI *ui, const char *cell)
   push_call(ui, "put", args);
 }
 
+/// Pack the text of a screen cell for "grid_line_runs": a single codepoint
+/// as is, NUL for an empty cell, otherwise 0x01 followed by the length.
+/// Needs room for MAX_SCHAR_SIZE + 1 bytes.
+static void mpack_run_cell(char **buf, schar_T sc)
+{
+  char cell[MAX_SCHAR_SIZE];
+  size_t len = schar_get(cell, sc);
+  uint8_t c0 = (uint8_t)cell[0];
+  if (len == 0) {
+    mpack_w(buf, NUL);
+    return;
+  } else if (c0 < 0x20 || len != (size_t)utf_ptr2len(cell) || (len == 1 && c0 >= 0x80)) {
+    mpack_w(buf, 0x01);
+    mpack_w(buf, len);
+  }
+  memcpy(*buf, cell, len);
+  *buf += len;
+}
+
+/// Start a "grid_line_runs" event. Returns the position of the text length.
+static char *start_line_runs(UI *ui, Integer grid, Integer row, Integer col)
+{
+  char **buf = &ui->data->buf_wptr;
+  prepare_call(ui, "grid_line_runs");
+  ui->data->ncalls++;
+  mpack_array(buf, 6);
+  mpack_uint(buf, (uint32_t)grid);
+  mpack_uint(buf, (uint32_t)row);
+  mpack_uint(buf, (uint32_t)col);
+  mpack_w(buf, 0xdb);  // str 32, length filled in by finish_line_runs()
+  char *lenpos = *buf;
+  *buf += 4;
+  return lenpos;
+}
+
+static void finish_line_runs(UI *ui, char *lenpos, const uint32_t *runs, size_t nruns, bool wrap)
+{
+  char **buf = &ui->data->buf_wptr;
+  mpack_w4(&lenpos, (uint32_t)(*buf - lenpos - 4));
+  mpack_array(buf, (uint32_t)nruns);
+  for (size_t i = 0; i < nruns; i++) {
+    mpack_uint(buf, runs[i]);
+  }
+  mpack_bool(buf, wrap);
+}
+
+/// "grid_line" encoding of the `ext_lineruns` extension: the text of the
+/// cells as a single string, with the highlights as separate runs.
+static void remote_ui_line_runs(UI *ui, Integer grid, Integer row, Integer startcol,
+                                Integer endcol, Integer clearcol, Integer clearattr,
+                                LineFlags flags, const schar_T *chunk, const sattr_T *attrs)
+{
+  UIData *data = ui->data;
+  char **buf = &data->buf_wptr;
+  // [hl_id, count] pairs, packed after the text
+  kvec_withinit_t(uint32_t, 64) runs = KV_INITIAL_VALUE;
+  kvi_init(runs);
+
+  char *lenpos = start_line_runs(ui, grid, row, startcol);
+  size_t ncells = (size_t)(endcol - startcol);
+  size_t i = 0;
+  while (i < ncells) {
+    size_t repeat = 1;
+    while (i + repeat < ncells && repeat < 0xff
+           && chunk[i + repeat] == chunk[i] && attrs[i + repeat] == attrs[i]) {
+      repeat++;
+    }
+
+    // Room for the cell, the runs packed so far and the final clear run.
+    size_t needed = 2 + 1 + MAX_SCHAR_SIZE + 5 * (kv_size(runs) + 4) + 1;
+    if (UI_BUF_SIZE - BUF_POS(data) < needed) {
+      // close to overflowing the redraw buffer. finish this event, flush,
+      // and start a new one at the current position.
+      finish_line_runs(ui, lenpos, runs.items, kv_size(runs), false);
+      remote_ui_flush_buf(ui);
+      kv_size(runs) = 0;
+      lenpos = start_line_runs(ui, grid, row, startcol + (Integer)i);
+    }
+
+    if (repeat > 2) {
+      mpack_w(buf, 0x02);
+      mpack_w(buf, repeat);
+    } else {
+      repeat = 1;
+    }
+    mpack_run_cell(buf, chunk[i]);
+
+    if (!kv_size(runs) || kv_A(runs, kv_size(runs) - 2) != (uint32_t)attrs[i]) {
+      kvi_push(runs, (uint32_t)attrs[i]);
+      kvi_push(runs, 0);
+    }
+    kv_A(runs, kv_size(runs) - 1) += (uint32_t)repeat;
+    data->ncells_pending += 1;
+    i += repeat;
+  }
+  if (endcol < clearcol) {
+    // counted past the end of the text: the rest is cleared
+    kvi_push(runs, (uint32_t)clearattr);
+    kvi_push(runs, (uint32_t)(clearcol - endcol));
+    data->ncells_pending += 1;
+  }
+  finish_line_runs(ui, lenpos, runs.items, kv_size(runs), flags & kLineFlagWrap);
+  kvi_destroy(runs);
+
+  if (data->ncells_pending > 500) {
+    // pass off cells to UI to let it start processing them
+    remote_ui_flush_buf(ui);
+  }
+}
+
 void remote_ui_raw_line(UI *ui, Integer grid, Integer row, Integer startcol, Integer endcol,
                         Integer clearcol, Integer clearattr, LineFlags flags, const schar_T *chunk,
                         const sattr_T *attrs)
 {
   UIData *data = ui->data;
-  if (ui->ui_ext[kUILinegrid]) {
+  flush_leader(ui);
+  if (ui->ui_ext[kUILineRuns]) {
+    remote_ui_line_runs(ui, grid, row, startcol, endcol, clearcol, clearattr, flags, chunk,
+                        attrs);
+  } else if (ui->ui_ext[kUILinegrid]) {
     prepare_call(ui, "grid_line");
     data->ncalls++;
 
@@ -826,8 +1020,8 @@ void remote_ui_raw_line(UI *ui, Integer grid, Integer row, Integer startcol, Int
     for (size_t i = 0; i < ncells; i++) {
       repeat++;
       if (i == ncells - 1 || attrs[i] != attrs[i + 1]
-          || strcmp(chunk[i], chunk[i + 1]) != 0) {
-        if (UI_BUF_SIZE - BUF_POS(data) < 2 * (1 + 2 + sizeof(schar_T) + 5 + 5) + 1) {
+          || chunk[i] != chunk[i + 1]) {
+        if (UI_BUF_SIZE - BUF_POS(data) < 2 * (1 + 2 + MAX_SCHAR_SIZE + 5 + 5) + 1) {
           // close to overflowing the redraw buffer. finish this event,
           // flush, and start a new "grid_line" event at the current position.
           // For simplicity leave place for the final "clear" element
@@ -851,7 +1045,7 @@ void remote_ui_raw_line(UI *ui, Integer grid, Integer row, Integer startcol, Int
         uint32_t csize = (repeat > 1) ? 3 : ((attrs[i] != last_hl) ? 2 : 1);
         nelem++;
         mpack_array(buf, csize);
-        mpack_str(buf, chunk[i]);
+        mpack_schar(buf, chunk[i]);
         if (csize >= 2) {
           mpack_uint(buf, (uint32_t)attrs[i]);
           if (csize >= 3) {
@@ -882,8 +1076,10 @@ void remote_ui_raw_line(UI *ui, Integer grid, Integer row, Integer startcol, Int
     for (int i = 0; i < endcol - startcol; i++) {
       remote_ui_cursor_goto(ui, row, startcol + i);
       remote_ui_highlight_set(ui, attrs[i]);
-      remote_ui_put(ui, chunk[i]);
-      if (utf_ambiguous_width(utf_ptr2char((char *)chunk[i]))) {
+      char sc_buf[MAX_SCHAR_SIZE];
+      schar_get(sc_buf, chunk[i]);
+      remote_ui_put(ui, sc_buf);
+      if (utf_ambiguous_width(utf_ptr2char(sc_buf))) {
         data->client_col = -1;  // force cursor update
       }
     }
@@ -923,8 +1119,7 @@ void remote_ui_flush_buf(UI *ui)
 
   // TODO(bfredl): elide copy by a length one free-list like the arena
   size_t size = BUF_POS(data);
-  WBuffer *buf = wstream_new_buffer(xmemdup(data->buf, size), size, 1, xfree);
-  rpc_write_raw(data->channel_id, buf);
+  remote_ui_write(ui, xmemdup(data->buf, size), size);
   data->buf_wptr = data->buf;
   // we have sent events to the client, but possibly not yet the final "flush"
   // event.
@@ -933,6 +1128,59 @@ void remote_ui_flush_buf(UI *ui)
   data->ncells_pending = 0;
 }
 
+/// Writes packed redraw events of `ui` to its channel, and to the channels of
+/// the UIs sharing its redraw stream. Takes ownership of `mem`.
+static void remote_ui_write(UI *ui, char *mem, size_t size)
+{
+  // Collect the channels first, a failed write might disconnect a UI.
+  kvec_withinit_t(uint64_t, 4) chans = KV_INITIAL_VALUE;
+  kvi_init(chans);
+  kvi_push(chans, ui->data->channel_id);
+  UI *other;
+  map_foreach_value(&connected_uis, other, {
+    if (other->data->leader == ui) {
+      kvi_push(chans, other->data->channel_id);
+    }
+  });
+
+  // Events packed only for a follower were queued before the shared ones.
+  for (size_t i = 1; i < kv_size(chans); i++) {
+    other = pmap_get(uint64_t)(&connected_uis, kv_A(chans, i));
+    if (other) {
+      remote_ui_flush_buf(other);
+    }
+  }
+
+  WBuffer *buf = wstream_new_buffer(mem, size, kv_size(chans), xfree);
+  for (size_t i = 0; i < kv_size(chans); i++) {
+    rpc_write_raw(kv_A(chans, i), buf);
+  }
+  kvi_destroy(chans);
+}
+
+/// Refreshes the UI of a channel in full, after redraw events to it were
+/// dropped because the client did not keep up with reading them.
+void remote_ui_resync(uint64_t channel_id)
+{
+  UI *ui = pmap_get(uint64_t)(&connected_uis, channel_id);
+  if (ui) {
+    ui_resync(ui);
+  }
+}
+
+/// Whether any UI sharing the redraw stream of `ui` has pending events of its own.
+static bool remote_ui_followers_pending(UI *ui)
+{
+  UI *other;
+  map_foreach_value(&connected_uis, other, {
+    if (other->data->leader == ui
+        && (other->data->nevents_pos || other->data->flushed_events)) {
+      return true;
+    }
+  });
+  return false;
+}
+
 /// An intentional flush (vsync) when Nvim is finished redrawing the screen
 ///
 /// Clients can know this happened by a final "flush" event at the end of the
@@ -940,13 +1188,19 @@ void remote_ui_flush_buf(UI *ui)
 void remote_ui_flush(UI *ui)
 {
   UIData *data = ui->data;
-  if (data->nevents > 0 || data->flushed_events) {
+  if (data->nevents > 0 || data->flushed_events || remote_ui_followers_pending(ui)) {
     if (!ui->ui_ext[kUILinegrid]) {
       remote_ui_cursor_goto(ui, data->cursor_row, data->cursor_col);
     }
     push_call(ui, "flush", (Array)ARRAY_DICT_INIT);
     remote_ui_flush_buf(ui);
     data->flushed_events = false;
+    UI *other;
+    map_foreach_value(&connected_uis, other, {
+      if (other->data->leader == ui) {
+        other->data->flushed_events = false;
+      }
+    });
   }
 }
 
@@ -50,6 +50,7 @@
 #include "nvim/move.h"
 #include "nvim/msgpack_rpc/channel.h"
 #include "nvim/msgpack_rpc/channel_defs.h"
+#include "nvim/msgpack_rpc/helpers.h"
 #include "nvim/msgpack_rpc/unpacker.h"
 #include "nvim/ops.h"
 #include "nvim/option.h"
@@ -985,6 +986,7 @@ Integer nvim_open_term(Buffer buffer, DictionaryOf(LuaRef) opts, Error *err)
   topts.write_cb = term_write;
   topts.resize_cb = term_resize;
   topts.close_cb = term_close;
+  topts.flow_cb = NULL;
   Terminal *term = terminal_open(buf, topts);
   terminal_check_size(term);
   chan->term = term;
@@ -1610,7 +1612,57 @@ Array nvim_call_atomic(uint64_t channel_id, Array calls, Arena *arena, Error *er
   Array results = arena_array(arena, calls.size);
   Error nested_error = ERROR_INIT;
 
-  size_t i;  // also used for freeing the variables
+  size_t i = call_atomic(channel_id, calls, arena, &results, NULL, &nested_error, err);
+  if (ERROR_SET(err)) {
+    goto theend;
+  }
+
+  ADD_C(rv, ARRAY_OBJ(results));
+  if (ERROR_SET(&nested_error)) {
+    Array errval = arena_array(arena, 3);
+    ADD_C(errval, INTEGER_OBJ((Integer)i));
+    ADD_C(errval, INTEGER_OBJ(nested_error.type));
+    ADD_C(errval, STRING_OBJ(copy_string(cstr_as_string(nested_error.msg), arena)));
+    ADD_C(rv, ARRAY_OBJ(errval));
+  } else {
+    ADD_C(rv, NIL);
+  }
+
+theend:
+  api_clear_error(&nested_error);
+  return rv;
+}
+
+/// Executes the calls of a nvim_call_atomic() request, packing their results
+/// with `pac` as soon as each call returns, instead of building the result
+/// array as Objects first. Used by the RPC layer to stream the response.
+///
+/// @param[out] nested_error Error of the call which failed, if any.
+/// @param[out] err Validation error details (malformed `calls` parameter).
+///             The packed results must be discarded in this case.
+/// @return Number of results packed, which is also the index of the call
+///         which failed, if any.
+size_t call_atomic_packed(uint64_t channel_id, Array calls, msgpack_packer *pac,
+                          Error *nested_error, Error *err)
+{
+  return call_atomic(channel_id, calls, NULL, NULL, pac, nested_error, err);
+}
+
+/// Executes the calls of nvim_call_atomic(). The results are either copied
+/// into `results`, allocated in `arena`, or packed with `pac` if not NULL.
+///
+/// @return Number of calls which succeeded.
+static size_t call_atomic(uint64_t channel_id, Array calls, Arena *arena, Array *results,
+                          msgpack_packer *pac, Error *nested_error, Error *err)
+{
+  // Batches mostly repeat the same few methods, so remember the last lookup.
+  String last_name = STRING_INIT;
+  MsgpackRpcRequestHandler handler = { 0 };
+  // Results which are packed right away only need to live until the next
+  // call, so a single arena is reset and reused across the calls.
+  Arena call_arena = ARENA_EMPTY;
+
+  size_t i;
   for (i = 0; i < calls.size; i++) {
     VALIDATE_T("'calls' item", kObjectTypeArray, calls.items[i].type, {
       goto theend;
@@ -1628,43 +1680,35 @@ Array nvim_call_atomic(uint64_t channel_id, Array calls, Arena *arena, Error *er
     });
     Array args = call.items[1].data.array;
 
-    MsgpackRpcRequestHandler handler =
-      msgpack_rpc_get_handler_for(name.data,
-                                  name.size,
-                                  &nested_error);
-
-    if (ERROR_SET(&nested_error)) {
-      break;
+    if (!last_name.data || name.size != last_name.size
+        || memcmp(name.data, last_name.data, name.size) != 0) {
+      handler = msgpack_rpc_get_handler_for(name.data, name.size, nested_error);
+      if (ERROR_SET(nested_error)) {
+        break;
+      }
+      last_name = name;
     }
 
-    Object result = handler.fn(channel_id, args, arena, &nested_error);
-    if (ERROR_SET(&nested_error)) {
-      // error handled after loop
+    Object result = handler.fn(channel_id, args, pac ? &call_arena : arena, nested_error);
+    if (ERROR_SET(nested_error)) {
+      // error handled by the caller
       break;
     }
-    // TODO(bfredl): wasteful copy. It could be avoided to encoding to msgpack
-    // directly here. But `result` might become invalid when next api function
-    // is called in the loop.
-    ADD_C(results, copy_object(result, arena));
+    if (pac) {
+      msgpack_rpc_from_object(result, pac);
+    } else {
+      // `result` might become invalid when the next api function is called.
+      ADD_C(*results, copy_object(result, arena));
+    }
     if (!handler.arena_return) {
       api_free_object(result);
     }
-  }
-
-  ADD_C(rv, ARRAY_OBJ(results));
-  if (ERROR_SET(&nested_error)) {
-    Array errval = arena_array(arena, 3);
-    ADD_C(errval, INTEGER_OBJ((Integer)i));
-    ADD_C(errval, INTEGER_OBJ(nested_error.type));
-    ADD_C(errval, STRING_OBJ(copy_string(cstr_as_string(nested_error.msg), arena)));
-    ADD_C(rv, ARRAY_OBJ(errval));
-  } else {
-    ADD_C(rv, NIL);
+    arena_reset(&call_arena);
   }
 
 theend:
-  api_clear_error(&nested_error);
-  return rv;
+  arena_mem_free(arena_finish(&call_arena));
+  return i;
 }
 
 /// Writes a message to vim output or error buffer. The string is split
@@ -1779,10 +1823,85 @@ Dictionary nvim__stats(void)
   PUT(rv, "log_skip", INTEGER_OBJ(g_stats.log_skip));
   PUT(rv, "lua_refcount", INTEGER_OBJ(nlua_get_global_ref_count()));
   PUT(rv, "redraw", INTEGER_OBJ(g_stats.redraw));
+  PUT(rv, "regprog_cache_hit", INTEGER_OBJ(g_stats.regprog_cache_hit));
+  PUT(rv, "regprog_cache_miss", INTEGER_OBJ(g_stats.regprog_cache_miss));
+  PUT(rv, "term_received", INTEGER_OBJ(g_stats.term_received));
+  PUT(rv, "term_paused", INTEGER_OBJ(g_stats.term_paused));
+  PUT(rv, "term_resumed", INTEGER_OBJ(g_stats.term_resumed));
   PUT(rv, "arena_alloc_count", INTEGER_OBJ((Integer)arena_alloc_count));
   return rv;
 }
 
+/// Gets per-method statistics of RPC requests and notifications handled by
+/// Nvim.
+///
+/// Latencies are in nanoseconds. "wait" is the time a request spent queued
+/// before its handler ran, "exec" the time spent running the handler. The
+/// histograms are arrays of call counts, where item 1 counts calls faster than
+/// 1 microsecond and item i (i > 1) those taking [2^(i-2), 2^(i-1)) us.
+///
+/// @param chan |channel-id|, or 0 for the sum over all channels.
+/// @param reset Reset the statistics after reading them.
+/// @param[out] err Error details, if any
+/// @return Map of method names to dictionaries with the keys "calls",
+///         "errors", "bytes_in", "bytes_out", "wait_total", "wait_max",
+///         "wait_hist", "exec_total", "exec_max" and "exec_hist".
+Dictionary nvim__rpc_stats(Integer chan, Boolean reset, Error *err)
+{
+  VALIDATE_INT((chan >= 0), "chan", chan, {
+    return (Dictionary)ARRAY_DICT_INIT;
+  });
+  return rpc_method_stats((uint64_t)chan, reset, err);
+}
+
+/// Gets the flow control state of an RPC channel, optionally changing its
+/// watermarks.
+///
+/// When more than "high" bytes are waiting to be written to a client, Nvim
+/// drops "redraw" batches and subscribed (broadcast) events to it, until the
+/// client has read enough to bring the queue below "low". The UI of the
+/// channel is then refreshed in full. Replies and targeted notifications are
+/// never dropped.
+///
+/// @param chan |channel-id|
+/// @param opts Optional parameters.
+///             - high: High watermark in bytes, 0 disables flow control.
+///             - low: Low watermark in bytes.
+/// @param[out] err Error details, if any
+/// @return Dictionary with the keys "high", "low", "queued" (bytes waiting to
+///         be written), "congested", "congestions" (times the channel became
+///         congested), "dropped_events" and "dropped_redraws".
+Dictionary nvim__rpc_flow(Integer chan, Dict(rpc_flow) *opts, Error *err)
+{
+  Dictionary rv = ARRAY_DICT_INIT;
+  VALIDATE_INT((chan > 0), "chan", chan, {
+    return rv;
+  });
+
+  Integer high = -1;
+  Integer low = -1;
+  if (HAS_KEY(opts->high)) {
+    VALIDATE_T("high", kObjectTypeInteger, opts->high.type, {
+      return rv;
+    });
+    high = opts->high.data.integer;
+    VALIDATE_INT((high >= 0), "high", high, {
+      return rv;
+    });
+  }
+  if (HAS_KEY(opts->low)) {
+    VALIDATE_T("low", kObjectTypeInteger, opts->low.type, {
+      return rv;
+    });
+    low = opts->low.data.integer;
+    VALIDATE_INT((low >= 0), "low", low, {
+      return rv;
+    });
+  }
+
+  return rpc_flow((uint64_t)chan, high, low, err);
+}
+
 /// Gets a list of dictionaries representing attached UIs.
 ///
 /// @return Array of UI dictionaries, each with these keys:
@@ -1927,7 +2046,9 @@ Array nvim__inspect_cell(Integer grid, Integer row, Integer col, Arena *arena, E
   }
   ret = arena_array(arena, 3);
   size_t off = g->line_offset[(size_t)row] + (size_t)col;
-  ADD_C(ret, STRING_OBJ(cstr_as_string((char *)g->chars[off])));
+  char *sc_buf = arena_alloc(arena, MAX_SCHAR_SIZE, false);
+  size_t sc_len = schar_get(sc_buf, g->chars[off]);
+  ADD_C(ret, STRING_OBJ(cbuf_as_string(sc_buf, sc_len)));
   int attr = g->attrs[off];
   ADD_C(ret, DICTIONARY_OBJ(hl_get_attr_by_id(attr, true, arena, err)));
   // will not work first time
@@ -1,6 +1,8 @@
 #ifndef NVIM_API_VIM_H
 #define NVIM_API_VIM_H
 
+#include <msgpack/pack.h>
+
 #include "nvim/api/private/defs.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
@@ -15,6 +15,7 @@
 #include "nvim/drawscreen.h"
 #include "nvim/extmark_defs.h"
 #include "nvim/globals.h"
+#include "nvim/grid.h"
 #include "nvim/grid_defs.h"
 #include "nvim/highlight_group.h"
 #include "nvim/macros.h"
@@ -275,7 +276,9 @@ Dictionary nvim_win_get_config(Window window, Error *err)
       for (size_t i = 0; i < 8; i++) {
         Array tuple = ARRAY_DICT_INIT;
 
-        String s = cstrn_to_string(config->border_chars[i], sizeof(schar_T));
+        char buf[MAX_SCHAR_SIZE];
+        size_t len = schar_get(buf, config->border_chars[i]);
+        String s = cbuf_to_string(buf, len);
 
         int hi_id = config->border_hl_ids[i];
         char *hi_name = syn_id2name(hi_id);
@@ -440,7 +443,7 @@ static void parse_border_style(Object style,  FloatConfig *fconfig, Error *err)
 {
   struct {
     const char *name;
-    schar_T chars[8];
+    const char *chars[8];
     bool shadow_color;
   } defaults[] = {
     { "double", { "╔", "═", "╗", "║", "╝", "═", "╚", "║" }, false },
@@ -448,7 +451,7 @@ static void parse_border_style(Object style,  FloatConfig *fconfig, Error *err)
     { "shadow", { "", "", " ", " ", " ", " ", " ", "" }, true },
     { "rounded", { "╭", "─", "╮", "│", "╯", "─", "╰", "│" }, false },
     { "solid", { " ", " ", " ", " ", " ", " ", " ", " " }, false },
-    { NULL, { { NUL } }, false },
+    { NULL, { NULL }, false },
   };
 
   schar_T *chars = fconfig->border_chars;
@@ -497,11 +500,8 @@ static void parse_border_style(Object style,  FloatConfig *fconfig, Error *err)
                       "border chars must be one cell");
         return;
       }
-      size_t len = MIN(string.size, sizeof(*chars) - 1);
-      if (len) {
-        memcpy(chars[i], string.data, len);
-      }
-      chars[i][len] = NUL;
+      size_t len = MIN(string.size, MAX_SCHAR_SIZE - 1);
+      chars[i] = schar_from_buf(string.data, len);
       hl_ids[i] = hl_id;
     }
     while (size < 8) {
@@ -509,10 +509,10 @@ static void parse_border_style(Object style,  FloatConfig *fconfig, Error *err)
       memcpy(hl_ids + size, hl_ids, sizeof(*hl_ids) * size);
       size <<= 1;
     }
-    if ((chars[7][0] && chars[1][0] && !chars[0][0])
-        || (chars[1][0] && chars[3][0] && !chars[2][0])
-        || (chars[3][0] && chars[5][0] && !chars[4][0])
-        || (chars[5][0] && chars[7][0] && !chars[6][0])) {
+    if ((chars[7] && chars[1] && !chars[0])
+        || (chars[1] && chars[3] && !chars[2])
+        || (chars[3] && chars[5] && !chars[4])
+        || (chars[5] && chars[7] && !chars[6])) {
       api_set_error(err, kErrorTypeValidation,
                     "corner between used edges must be specified");
     }
@@ -526,7 +526,9 @@ static void parse_border_style(Object style,  FloatConfig *fconfig, Error *err)
     }
     for (size_t i = 0; defaults[i].name; i++) {
       if (strequal(str.data, defaults[i].name)) {
-        memcpy(chars, defaults[i].chars, sizeof(defaults[i].chars));
+        for (size_t j = 0; j < 8; j++) {
+          chars[j] = schar_from_str(defaults[i].chars[j]);
+        }
         memset(hl_ids, 0, 8 * sizeof(*hl_ids));
         if (defaults[i].shadow_color) {
           int hl_blend = SYN_GROUP_STATIC("FloatShadow");
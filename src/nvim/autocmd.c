@@ -2281,6 +2281,15 @@ char *getnextac(int c, void *cookie, int indent, bool do_concat)
 /// @param buf buffer the file is open in
 bool has_autocmd(event_T event, char *sfname, buf_T *buf)
   FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  return has_autocmd_except(event, sfname, buf, NULL, 0);
+}
+
+/// Like has_autocmd(), but ignores autocommands in the groups "ignore_groups",
+/// an array of "n_ignore" group IDs.
+bool has_autocmd_except(event_T event, char *sfname, buf_T *buf, const int *ignore_groups,
+                        size_t n_ignore)
+  FUNC_ATTR_WARN_UNUSED_RESULT
 {
   char *tail = path_tail(sfname);
   bool retval = false;
@@ -2299,7 +2308,14 @@ bool has_autocmd(event_T event, char *sfname, buf_T *buf)
 #endif
 
   for (AutoPat *ap = first_autopat[(int)event]; ap != NULL; ap = ap->next) {
-    if (ap->pat != NULL && ap->cmds != NULL
+    bool ignored = false;
+    for (size_t i = 0; i < n_ignore; i++) {
+      if (ap->group == ignore_groups[i]) {
+        ignored = true;
+        break;
+      }
+    }
+    if (!ignored && ap->pat != NULL && ap->cmds != NULL
         && (ap->buflocal_nr == 0
             ? match_file_pat(NULL,
                              &ap->reg_prog,
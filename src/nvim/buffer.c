@@ -70,6 +70,7 @@
 #include "nvim/map.h"
 #include "nvim/mapping.h"
 #include "nvim/mark.h"
+#include "nvim/match.h"
 #include "nvim/mbyte.h"
 #include "nvim/memline_defs.h"
 #include "nvim/memory.h"
@@ -821,6 +822,7 @@ void buf_freeall(buf_T *buf, int flags)
 
   ml_close(buf, true);              // close and delete the memline/memfile
   buf->b_ml.ml_line_count = 0;      // no lines in buffer
+  match_cache_free(buf);            // forget matches in the lines
   if ((flags & BFA_KEEP_UNDO) == 0) {
     u_blockfree(buf);               // free the memory allocated for undo
     u_clearall(buf);                // reset all undo information
@@ -907,6 +909,7 @@ static void free_buffer_stuff(buf_T *buf, int free_flags)
   uc_clear(&buf->b_ucmds);               // clear local user commands
   buf_delete_signs(buf, "*");            // delete any signs
   extmark_free_all(buf);                 // delete any extmarks
+  match_cache_free(buf);                 // forget remembered matches
   map_clear_mode(buf, MAP_ALL_MODES, true, false);  // clear local mappings
   map_clear_mode(buf, MAP_ALL_MODES, true, true);   // clear local abbrevs
   XFREE_CLEAR(buf->b_start_fenc);
@@ -450,6 +450,31 @@ EXTERN int curbuf_splice_pending INIT(= 0);
 // Maximum number of maphash blocks we will have
 #define MAX_MAPHASH 256
 
+// Result of searching a line for a highlighted pattern, see match_cache_T.
+typedef struct {
+  colnr_T mcr_matchcol;         // column where searching started
+  colnr_T mcr_start;            // start of the match, -1 when not found
+  colnr_T mcr_end;              // end of the match
+} match_cache_result_T;
+
+// Results of searching one line, sorted on mcr_matchcol.
+typedef struct {
+  linenr_T mcl_lnum;
+  kvec_t(match_cache_result_T) mcl_results;
+} match_cache_line_T;
+
+// Matches of a 'hlsearch' or match pattern in a buffer, for lines that were
+// drawn.  Shared by all windows showing the buffer.
+typedef struct {
+  regprog_T *mc_prog;           // pattern, holds a reference
+  int mc_ic;                    // rmm_ic used for matching
+  colnr_T mc_maxcol;            // rmm_maxcol used for matching
+  kvec_t(match_cache_line_T) mc_lines;  // sorted on mcl_lnum
+} match_cache_T;
+
+#define MATCH_CACHE_SIZE 8          // number of patterns in b_match_cache
+#define MATCH_CACHE_MAX_LINES 2000  // number of lines in a match_cache_T
+
 // buffer: structure that holds information about one file
 //
 // Several windows can share a single Buffer
@@ -832,6 +857,13 @@ struct file_buffer {
   int flush_count;
 
   int b_diff_failed;    // internal diff failed for this buffer
+
+  // Remembered matches for highlighting, see next_search_hl().
+  struct {
+    kvec_t(match_cache_T) patterns;
+    varnumber_T changedtick;    // b:changedtick the lines are valid for
+    unsigned chartab_tick;      // match_cache_chartab_tick when valid
+  } b_match_cache;
 };
 
 // Stuff for diff mode.
@@ -909,6 +941,55 @@ typedef struct w_line {
   linenr_T wl_lastlnum;         // last buffer line number for logical line
 } wline_T;
 
+// Rendered screen rows of a buffer line, reused by win_update() when the line
+// needs to be drawn again and nothing it depends on has changed.
+typedef struct {
+  linenr_T lc_lnum;             // buffer line number, 0 when unused
+  int lc_fnum;                  // buffer number
+  varnumber_T lc_changedtick;   // b:changedtick when rendered
+  colnr_T lc_leftcol;           // w_leftcol when rendered
+  int lc_coloff;                // win_col_off() when rendered
+  int lc_cols;                  // width of the window grid
+  int lc_rows;                  // number of screen rows
+  schar_T *lc_chars;            // lc_rows * lc_cols cells
+  sattr_T *lc_attrs;            // lc_rows * lc_cols attributes
+  char *lc_wraps;               // line_wraps[] of each row
+} linecache_T;
+
+#define LINE_CACHE_SIZE 64      // number of entries in w_line_cache
+#define LINE_CACHE_MAX_ROWS 4   // highest lc_rows
+
+// Position in a long line, see plines_cache_T.
+typedef struct {
+  colnr_T pcp_byte;             // byte offset in the line
+  colnr_T pcp_vcol;             // virtual column at that byte
+} plines_checkpoint_T;
+
+// Screen width of a buffer line in a window, see plines_win_nofold().
+typedef struct {
+  linenr_T pc_lnum;             // buffer line number, 0 when unused
+  int pc_fnum;                  // buffer number
+  varnumber_T pc_changedtick;   // b:changedtick when computed
+  unsigned pc_options_tick;     // plines_options_tick when computed
+  int pc_width;                 // w_width_inner when computed
+  int pc_col_off;               // win_col_off() when computed
+  // Options that are changed temporarily without plines_options_changed(),
+  // e.g. 'list' in getvcol_nolist() and 'linebreak' in reset_lbr().
+  bool pc_list;                 // 'list' when computed
+  bool pc_lbr;                  // 'linebreak' when computed
+  int pc_lcs_tab;               // first tab character of 'listchars'
+  long pc_ts;                   // 'tabstop' when computed
+  char *pc_sbr;                 // get_showbreak_value() when computed
+  bool pc_complete;             // pc_vcols and all checkpoints are known
+  unsigned pc_vcols;            // win_linetabsize() of the whole line
+  // positions after each PLINES_CHECKPOINT_CHARS characters, computed up to
+  // where they were needed
+  kvec_t(plines_checkpoint_T) pc_checkpoints;
+} plines_cache_T;
+
+#define PLINES_CACHE_SIZE 256   // number of entries in w_plines_cache
+#define PLINES_CHECKPOINT_CHARS 1024
+
 // Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
 // or row (FR_ROW) layout or is a leaf, which has a window.
 struct frame_S {
@@ -1260,6 +1341,14 @@ struct window_S {
   int w_lines_valid;                // number of valid entries
   wline_T *w_lines;
 
+  // Rendered lines, indexed by line number modulo LINE_CACHE_SIZE.
+  // NULL until a line is cached.
+  linecache_T *w_line_cache;
+
+  // Screen widths of lines, indexed by line number modulo PLINES_CACHE_SIZE.
+  // NULL until a width is cached.
+  plines_cache_T *w_plines_cache;
+
   garray_T w_folds;                 // array of nested folds
   bool w_fold_manual;               // when true: some folds are opened/closed
                                     // manually
@@ -33,6 +33,7 @@
 #include "nvim/insexpand.h"
 #include "nvim/macros.h"
 #include "nvim/mark.h"
+#include "nvim/match.h"
 #include "nvim/mbyte.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
@@ -163,6 +164,7 @@ static void changed_common(linenr_T lnum, colnr_T col, linenr_T lnume, linenr_T
 {
   // mark the buffer as modified
   changed();
+  match_cache_changed(curbuf, lnum, lnume, xtra);
 
   if (curwin->w_p_diff && diff_internal()) {
     curtab->tp_diff_update = true;
@@ -785,6 +785,7 @@ void channel_terminal_open(buf_T *buf, Channel *chan)
   topts.write_cb = term_write;
   topts.resize_cb = term_resize;
   topts.close_cb = term_close;
+  topts.flow_cb = term_flow;
   buf->b_p_channel = (long)chan->id;  // 'channel' option
   Terminal *term = terminal_open(buf, topts);
   chan->term = term;
@@ -810,6 +811,20 @@ static void term_resize(uint16_t width, uint16_t height, void *data)
   pty_process_resize(&chan->stream.pty, width, height);
 }
 
+static void term_flow(bool pause, void *data)
+{
+  Channel *chan = data;
+  Stream *out = &chan->stream.proc.out;
+  if (out->closed || out->did_eof) {
+    return;
+  }
+  if (pause) {
+    rstream_stop(out);
+  } else {
+    rstream_start(out, out->read_cb, out->cb_data);
+  }
+}
+
 static inline void term_delayed_free(void **argv)
 {
   Channel *chan = argv[0];
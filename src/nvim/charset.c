@@ -27,6 +27,7 @@
 #include "nvim/keycodes.h"
 #include "nvim/macros.h"
 #include "nvim/mark.h"
+#include "nvim/match.h"
 #include "nvim/mbyte.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
@@ -35,6 +36,7 @@
 #include "nvim/path.h"
 #include "nvim/plines.h"
 #include "nvim/pos.h"
+#include "nvim/regexp.h"
 #include "nvim/state.h"
 #include "nvim/strings.h"
 #include "nvim/vim.h"
@@ -102,7 +104,14 @@ int buf_init_chartab(buf_T *buf, int global)
   bool tilde;
   bool do_isalpha;
 
+  // Matches of "\k" and the like may change.
+  match_cache_chartab_changed();
+
   if (global) {
+    // Cached programs may have been compiled with the old 'isident',
+    // 'isfname' or 'isprint'.
+    regprog_cache_clear();
+
     // Set the default size for printable characters:
     // From <Space> to '~' is 1 (printable), others are 2 (not printable).
     // This also inits all 'isident' and 'isfname' flags to false.
@@ -991,6 +1000,17 @@ void getvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor, colnr_T *en
   chartabsize_T cts;
   init_chartabsize_arg(&cts, wp, pos->lnum, 0, line, line);
 
+  // In a long line start from the nearest remembered position.
+  colnr_T cp_byte;
+  colnr_T cp_vcol;
+  if ((posptr == NULL || posptr - line >= PLINES_CHECKPOINT_CHARS)
+      && plines_checkpoint(wp, pos->lnum, line, false,
+                           posptr == NULL ? MAXCOL : (colnr_T)(posptr - line),
+                           &cp_byte, &cp_vcol)) {
+    ptr = cts.cts_ptr = line + cp_byte;
+    vcol = cts.cts_vcol = cp_vcol;
+  }
+
   // This function is used very often, do some speed optimizations.
   // When 'list', 'linebreak', 'showbreak' and 'breakindent' are not set
   // and there are no virtual text use a simple loop.
@@ -146,6 +146,14 @@ static int coladvance2(pos_T *pos, bool addspaces, bool finetune, colnr_T wcol_a
 
     chartabsize_T cts;
     init_chartabsize_arg(&cts, curwin, pos->lnum, 0, line, line);
+    // In a long line start from the nearest remembered position.
+    colnr_T cp_byte;
+    colnr_T cp_vcol;
+    if (wcol >= PLINES_CHECKPOINT_CHARS
+        && plines_checkpoint(curwin, pos->lnum, line, true, wcol, &cp_byte, &cp_vcol)) {
+      cts.cts_ptr = line + cp_byte;
+      cts.cts_vcol = cp_vcol;
+    }
     while (cts.cts_vcol <= wcol && *cts.cts_ptr != NUL) {
       // Count a tab for what it's worth (if list mode not on)
       csize = win_lbr_chartabsize(&cts, &head);
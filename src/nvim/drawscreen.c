@@ -765,7 +765,7 @@ static void win_redr_border(win_T *wp)
       grid_puts_line_flush(false);
     }
     if (adj[1]) {
-      int ic = (i == 0 && !adj[0] && chars[2][0]) ? 2 : 3;
+      int ic = (i == 0 && !adj[0] && chars[2]) ? 2 : 3;
       grid_puts_line_start(grid, i + adj[0]);
       grid_put_schar(grid, i + adj[0], icol + adj[3], chars[ic], attrs[ic]);
       grid_puts_line_flush(false);
@@ -778,7 +778,7 @@ static void win_redr_border(win_T *wp)
       grid_put_schar(grid, irow + adj[0], 0, chars[6], attrs[6]);
     }
     for (int i = 0; i < icol; i++) {
-      int ic = (i == 0 && !adj[3] && chars[6][0]) ? 6 : 5;
+      int ic = (i == 0 && !adj[3] && chars[6]) ? 6 : 5;
       grid_put_schar(grid, irow + adj[0], i + adj[3], chars[ic], attrs[ic]);
     }
     if (adj[1]) {
@@ -1352,6 +1352,152 @@ static void draw_sep_connectors_win(win_T *wp)
   }
 }
 
+/// Whether rendered lines of window "wp" can be cached: their rendering must
+/// only depend on the buffer text and on state that causes the lines to be
+/// redrawn (and dropped from the cache) when it changes.
+static bool win_line_cache_enabled(win_T *wp, DecorProviders *line_providers)
+{
+  return !VIsual_active
+         && !highlight_match
+         && dollar_vcol == -1
+         && !wp->w_p_rnu
+         && !wp->w_p_cuc
+         && !wp->w_p_spell
+         && !wp->w_p_diff
+         && *wp->w_p_stc == NUL
+         && kv_size(*line_providers) == 0
+         && screen_search_hl.rm.regprog == NULL
+         && wp->w_match_head == NULL
+         && wp->w_buffer->terminal == NULL;
+}
+
+/// Whether line "lnum" of window "wp" can be cached. The cursor line is drawn
+/// differently and updates the cursor position, the top line may be drawn
+/// partially.
+static bool win_line_cacheable(win_T *wp, linenr_T lnum)
+{
+  return lnum != wp->w_cursor.lnum
+         && lnum != wp->w_cursorline
+         && lnum != wp->w_topline;
+}
+
+/// Draws line "lnum" at row "srow" of window "wp" from the line cache.
+///
+/// @return  the row below the line, or 0 when the line is not cached.
+static int win_line_cache_draw(win_T *wp, linenr_T lnum, int srow)
+{
+  if (wp->w_line_cache == NULL) {
+    return 0;
+  }
+  linecache_T *lc = &wp->w_line_cache[lnum % LINE_CACHE_SIZE];
+  if (lc->lc_lnum != lnum
+      || lc->lc_fnum != wp->w_buffer->b_fnum
+      || lc->lc_changedtick != buf_get_changedtick(wp->w_buffer)
+      || lc->lc_cols != wp->w_grid.cols
+      || lc->lc_leftcol != wp->w_leftcol
+      || lc->lc_coloff != win_col_off(wp)
+      || srow + lc->lc_rows > wp->w_grid.rows) {
+    return 0;
+  }
+
+  ScreenGrid *grid = &wp->w_grid;
+  size_t cols = (size_t)lc->lc_cols;
+  for (int i = 0; i < lc->lc_rows; i++) {
+    memcpy(linebuf_char, lc->lc_chars + (size_t)i * cols, cols * sizeof(schar_T));
+    memcpy(linebuf_attr, lc->lc_attrs + (size_t)i * cols, cols * sizeof(sattr_T));
+    bool wrap = lc->lc_wraps[i];
+    grid_put_linebuf(grid, srow + i, 0, lc->lc_cols, lc->lc_cols, false, wp, 0, wrap);
+    if (wrap) {
+      // Same as in win_line().
+      ScreenGrid *current_grid = grid;
+      int current_row = srow + i, dummy_col = 0;
+      grid_adjust(&current_grid, &current_row, &dummy_col);
+      current_grid->attrs[current_grid->line_offset[current_row + 1]] = -1;
+      current_grid->line_wraps[current_row] = true;
+    }
+  }
+  return srow + lc->lc_rows;
+}
+
+/// Stores line "lnum" of window "wp", drawn by win_line() from row "srow" to
+/// "row", in the line cache.
+static void win_line_cache_store(win_T *wp, linenr_T lnum, int srow, int row)
+{
+  int rows = row - srow;
+  if (rows < 1 || rows > LINE_CACHE_MAX_ROWS || row > wp->w_grid.rows) {
+    return;
+  }
+
+  ScreenGrid *grid = &wp->w_grid;
+  int row_off = srow, col_off = 0;
+  grid_adjust(&grid, &row_off, &col_off);
+  if (grid->chars == NULL) {
+    return;
+  }
+
+  if (wp->w_line_cache == NULL) {
+    wp->w_line_cache = xcalloc(LINE_CACHE_SIZE, sizeof(linecache_T));
+  }
+  linecache_T *lc = &wp->w_line_cache[lnum % LINE_CACHE_SIZE];
+  size_t cols = (size_t)wp->w_grid.cols;
+  if (lc->lc_rows * lc->lc_cols != rows * wp->w_grid.cols) {
+    lc->lc_chars = xrealloc(lc->lc_chars, (size_t)rows * cols * sizeof(schar_T));
+    lc->lc_attrs = xrealloc(lc->lc_attrs, (size_t)rows * cols * sizeof(sattr_T));
+  }
+  lc->lc_wraps = xrealloc(lc->lc_wraps, (size_t)rows);
+  for (int i = 0; i < rows; i++) {
+    size_t off = grid->line_offset[row_off + i] + (size_t)col_off;
+    memcpy(lc->lc_chars + (size_t)i * cols, grid->chars + off, cols * sizeof(schar_T));
+    memcpy(lc->lc_attrs + (size_t)i * cols, grid->attrs + off, cols * sizeof(sattr_T));
+    lc->lc_wraps[i] = grid->line_wraps[row_off + i];
+  }
+  lc->lc_lnum = lnum;
+  lc->lc_fnum = wp->w_buffer->b_fnum;
+  lc->lc_changedtick = buf_get_changedtick(wp->w_buffer);
+  lc->lc_leftcol = wp->w_leftcol;
+  lc->lc_coloff = win_col_off(wp);
+  lc->lc_cols = wp->w_grid.cols;
+  lc->lc_rows = rows;
+}
+
+/// Drops cached lines "top" to "bot" (exclusive) of window "wp".
+static void win_line_cache_invalidate(win_T *wp, linenr_T top, linenr_T bot)
+{
+  if (wp->w_line_cache == NULL) {
+    return;
+  }
+  for (int i = 0; i < LINE_CACHE_SIZE; i++) {
+    linecache_T *lc = &wp->w_line_cache[i];
+    if (lc->lc_lnum >= top && lc->lc_lnum < bot) {
+      lc->lc_lnum = 0;
+    }
+  }
+}
+
+/// Drops cached lines "top" to "bot" (exclusive) of buffer "buf" in all
+/// windows, also when they are not visible.
+static void buf_line_cache_invalidate(buf_T *buf, linenr_T top, linenr_T bot)
+{
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    if (wp->w_buffer == buf) {
+      win_line_cache_invalidate(wp, top, bot);
+    }
+  }
+}
+
+void win_line_cache_free(win_T *wp)
+{
+  if (wp->w_line_cache == NULL) {
+    return;
+  }
+  for (int i = 0; i < LINE_CACHE_SIZE; i++) {
+    xfree(wp->w_line_cache[i].lc_chars);
+    xfree(wp->w_line_cache[i].lc_attrs);
+    xfree(wp->w_line_cache[i].lc_wraps);
+  }
+  XFREE_CLEAR(wp->w_line_cache);
+}
+
 /// Update a single window.
 ///
 /// This may cause the windows below it also to be redrawn (when clearing the
@@ -1580,6 +1726,14 @@ static void win_update(win_T *wp, DecorProviders *providers)
   wp->w_redraw_top = 0;  // reset for next time
   wp->w_redraw_bot = 0;
 
+  // Drop cached lines that need to be drawn again.
+  if (type >= UPD_SOME_VALID) {
+    win_line_cache_invalidate(wp, 1, MAXLNUM);
+  } else if (mod_top != 0) {
+    win_line_cache_invalidate(wp, mod_top, mod_bot == 0 ? MAXLNUM : mod_bot);
+  }
+  const bool line_cache = win_line_cache_enabled(wp, &line_providers);
+
   // When only displaying the lines at the top, set top_end.  Used when
   // window has scrolled down for msg_scrolled.
   if (type == UPD_REDRAW_TOP) {
@@ -2200,16 +2354,32 @@ static void win_update(win_T *wp, DecorProviders *providers)
           syntax_end_parsing(wp, syntax_last_parsed + 1);
         }
 
-        // Display one line
-        row = win_line(wp, lnum, srow,
-                       foldinfo.fi_lines ? srow : wp->w_grid.rows,
-                       mod_top == 0, false, foldinfo, &line_providers, &provider_err);
+        // Display one line, from the line cache when possible.
+        bool cache_line = line_cache && foldinfo.fi_lines == 0
+                          && win_line_cacheable(wp, lnum);
+        row = cache_line ? win_line_cache_draw(wp, lnum, srow) : 0;
+        bool cached = row != 0;
+        if (!cached) {
+          size_t extmarks = kv_size(win_extmark_arr);
+          row = win_line(wp, lnum, srow,
+                         foldinfo.fi_lines ? srow : wp->w_grid.rows,
+                         mod_top == 0, false, foldinfo, &line_providers, &provider_err);
+          // A line with watched extmarks must be drawn to report their position.
+          if (cache_line && kv_size(win_extmark_arr) == extmarks) {
+            win_line_cache_store(wp, lnum, srow, row);
+          }
+        }
 
         if (foldinfo.fi_lines == 0) {
           wp->w_lines[idx].wl_folded = false;
           wp->w_lines[idx].wl_lastlnum = lnum;
-          did_update = DID_LINE;
-          syntax_last_parsed = lnum;
+          // A cached line did not parse syntax.
+          if (cached) {
+            did_update = DID_NONE;
+          } else {
+            did_update = DID_LINE;
+            syntax_last_parsed = lnum;
+          }
         } else {
           foldinfo.fi_lines--;
           wp->w_lines[idx].wl_folded = true;
@@ -2620,6 +2790,7 @@ void redraw_buf_later(buf_T *buf, int type)
 
 void redraw_buf_line_later(buf_T *buf, linenr_T line, bool force)
 {
+  buf_line_cache_invalidate(buf, line, line + 1);
   FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
     if (wp->w_buffer == buf) {
       redrawWinline(wp, MIN(line, buf->b_ml.ml_line_count));
@@ -2632,6 +2803,7 @@ void redraw_buf_line_later(buf_T *buf, linenr_T line, bool force)
 
 void redraw_buf_range_later(buf_T *buf,  linenr_T firstline, linenr_T lastline)
 {
+  buf_line_cache_invalidate(buf, firstline, lastline + 1);
   FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
     if (wp->w_buffer == buf
         && lastline >= wp->w_topline && firstline < wp->w_botline) {
@@ -2747,6 +2919,7 @@ void win_redraw_last_status(const frame_T *frp)
 void redrawWinline(win_T *wp, linenr_T lnum)
   FUNC_ATTR_NONNULL_ALL
 {
+  win_line_cache_invalidate(wp, lnum, lnum + 1);
   if (lnum >= wp->w_topline
       && lnum < wp->w_botline) {
     if (wp->w_redraw_top == 0 || wp->w_redraw_top > lnum) {
@@ -1403,7 +1403,7 @@ static int pc_status;
 #define PC_STATUS_RIGHT 1       // right half of double-wide char
 #define PC_STATUS_LEFT  2       // left half of double-wide char
 #define PC_STATUS_SET   3       // pc_bytes was filled
-static char pc_bytes[MB_MAXBYTES + 1];  // saved bytes
+static char pc_bytes[MAX_SCHAR_SIZE];  // saved bytes
 static int pc_attr;
 static int pc_row;
 static int pc_col;
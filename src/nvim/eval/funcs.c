@@ -61,6 +61,7 @@
 #include "nvim/getchar.h"
 #include "nvim/gettext.h"
 #include "nvim/globals.h"
+#include "nvim/grid.h"
 #include "nvim/grid_defs.h"
 #include "nvim/hashtab.h"
 #include "nvim/highlight_defs.h"
@@ -6800,7 +6801,9 @@ static void f_screenchar(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
   if (row < 0 || row >= grid->rows || col < 0 || col >= grid->cols) {
     c = -1;
   } else {
-    c = utf_ptr2char((char *)grid->chars[grid->line_offset[row] + (size_t)col]);
+    char buf[MAX_SCHAR_SIZE];
+    schar_get(buf, grid->chars[grid->line_offset[row] + (size_t)col]);
+    c = utf_ptr2char(buf);
   }
   rettv->vval.v_number = c;
 }
@@ -6818,8 +6821,10 @@ static void f_screenchars(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
     tv_list_alloc_ret(rettv, 0);
     return;
   }
+  char buf[MAX_SCHAR_SIZE];
+  schar_get(buf, grid->chars[grid->line_offset[row] + (size_t)col]);
   int pcc[MAX_MCO];
-  int c = utfc_ptr2char((char *)grid->chars[grid->line_offset[row] + (size_t)col], pcc);
+  int c = utfc_ptr2char(buf, pcc);
   int composing_len = 0;
   while (pcc[composing_len] != 0) {
     composing_len++;
@@ -6861,7 +6866,9 @@ static void f_screenstring(typval_T *argvars, typval_T *rettv, EvalFuncData fptr
     return;
   }
 
-  rettv->vval.v_string = xstrdup((char *)grid->chars[grid->line_offset[row] + (size_t)col]);
+  char buf[MAX_SCHAR_SIZE];
+  schar_get(buf, grid->chars[grid->line_offset[row] + (size_t)col]);
+  rettv->vval.v_string = xstrdup(buf);
 }
 
 /// "search()" function
@@ -11,6 +11,7 @@
 #include "nvim/event/libuv_process.h"
 #include "nvim/event/loop.h"
 #include "nvim/event/process.h"
+#include "nvim/event/rstream.h"
 #include "nvim/globals.h"
 #include "nvim/log.h"
 #include "nvim/macros.h"
@@ -370,6 +371,14 @@ static void flush_stream(Process *proc, Stream *stream)
 
   size_t max_bytes = stream->num_bytes + (size_t)system_buffer_size;
 
+  // The consumer may have paused reading (e.g. a terminal with a backlog of
+  // output), the remaining data must still be read before the EOF.
+  if (stream->read_cb && stream->uvstream && !stream->did_eof
+      && !uv_is_active((uv_handle_t *)stream->uvstream)
+      && rbuffer_space(stream->buffer) > 0) {
+    rstream_start(stream, stream->read_cb, stream->cb_data);
+  }
+
   // Read remaining data.
   while (!stream->closed && stream->num_bytes < max_bytes) {
     // Remember number of bytes before polling
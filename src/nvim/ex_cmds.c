@@ -356,10 +356,13 @@ static int linelen(int *has_tab)
   return len;
 }
 
-// Buffer for two lines used during sorting.  They are allocated to
-// contain the longest line being sorted.
+// Buffer for a line used during sorting.  It is allocated to contain the
+// longest line being sorted.
 static char *sortbuf1;
-static char *sortbuf2;
+
+// The NUL terminated keys of the lines being sorted on strings, one after the
+// other.  Comparing lines then doesn't need to get them from the memline.
+static kvec_t(char) sortkeys;
 
 static int sort_lc;       ///< sort using locale
 static int sort_ic;       ///< ignore case
@@ -373,10 +376,7 @@ static int sort_abort;    ///< flag to indicate if sorting has been interrupted
 typedef struct {
   linenr_T lnum;          ///< line number
   union {
-    struct {
-      varnumber_T start_col_nr;  ///< starting column number
-      varnumber_T end_col_nr;    ///< ending column number
-    } line;
+    size_t key_off;       ///< offset of the key in "sortkeys"
     struct {
       varnumber_T value;         ///< value if sorting by integer
       bool is_number;            ///< true when line contains a number
@@ -410,8 +410,6 @@ static int sort_compare(const void *s1, const void *s2)
     sort_abort = true;
   }
 
-  // When sorting numbers "start_col_nr" is the number, not the column
-  // number.
   if (sort_nr) {
     if (l1.st_u.num.is_number != l2.st_u.num.is_number) {
       result = l1.st_u.num.is_number - l2.st_u.num.is_number;
@@ -427,17 +425,8 @@ static int sort_compare(const void *s1, const void *s2)
              ? 0 : l1.st_u.value_flt > l2.st_u.value_flt
              ? 1 : -1;
   } else {
-    // We need to copy one line into "sortbuf1", because there is no
-    // guarantee that the first pointer becomes invalid when obtaining the
-    // second one.
-    memcpy(sortbuf1, ml_get(l1.lnum) + l1.st_u.line.start_col_nr,
-           (size_t)(l1.st_u.line.end_col_nr - l1.st_u.line.start_col_nr + 1));
-    sortbuf1[l1.st_u.line.end_col_nr - l1.st_u.line.start_col_nr] = NUL;
-    memcpy(sortbuf2, ml_get(l2.lnum) + l2.st_u.line.start_col_nr,
-           (size_t)(l2.st_u.line.end_col_nr - l2.st_u.line.start_col_nr + 1));
-    sortbuf2[l2.st_u.line.end_col_nr - l2.st_u.line.start_col_nr] = NUL;
-
-    result = string_compare(sortbuf1, sortbuf2);
+    result = string_compare(sortkeys.items + l1.st_u.key_off,
+                            sortkeys.items + l2.st_u.key_off);
   }
 
   // If two lines have the same value, preserve the original line order.
@@ -447,6 +436,73 @@ static int sort_compare(const void *s1, const void *s2)
   return result;
 }
 
+/// Key for sorting "nr" on its number: flipping the sign bit makes the
+/// unsigned order the same as the signed order.
+static inline uint64_t sort_nr_key(const sorti_T *nr)
+{
+  return (uint64_t)nr->st_u.num.value ^ ((uint64_t)1 << 63);
+}
+
+/// Sort "nrs" on numbers, like qsort() with sort_compare() does, using a
+/// stable LSD radix sort on the bytes of the number.  Lines without a number
+/// come first.  Ties keep the original line order because the sort is
+/// stable.
+static void sort_radix_nr(sorti_T *nrs, size_t count)
+{
+  sorti_T *tmp = xmalloc(count * sizeof(sorti_T));
+
+  // Move the lines without a number to the front, keeping their order.
+  size_t nonum = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (!nrs[i].st_u.num.is_number) {
+      tmp[nonum++] = nrs[i];
+    }
+  }
+  size_t num = nonum;
+  for (size_t i = 0; i < count; i++) {
+    if (nrs[i].st_u.num.is_number) {
+      tmp[num++] = nrs[i];
+    }
+  }
+  memcpy(nrs, tmp, count * sizeof(sorti_T));
+
+  sorti_T *src = nrs + nonum;
+  sorti_T *dst = tmp + nonum;
+  size_t n = count - nonum;
+  for (int shift = 0; shift < 64 && !sort_abort; shift += 8) {
+    size_t counts[256] = { 0 };
+    for (size_t i = 0; i < n; i++) {
+      counts[(sort_nr_key(&src[i]) >> shift) & 0xff]++;
+    }
+    // Skip the pass if all numbers have the same byte here.
+    if (n == 0 || counts[(sort_nr_key(&src[0]) >> shift) & 0xff] == n) {
+      continue;
+    }
+    size_t offset = 0;
+    for (int b = 0; b < 256; b++) {
+      size_t c = counts[b];
+      counts[b] = offset;
+      offset += c;
+    }
+    for (size_t i = 0; i < n; i++) {
+      dst[counts[(sort_nr_key(&src[i]) >> shift) & 0xff]++] = src[i];
+    }
+    sorti_T *const swap = src;
+    src = dst;
+    dst = swap;
+
+    fast_breakcheck();
+    if (got_int) {
+      sort_abort = true;
+    }
+  }
+  if (src != nrs + nonum) {
+    memcpy(nrs + nonum, src, n * sizeof(sorti_T));
+  }
+
+  xfree(tmp);
+}
+
 /// ":sort".
 void ex_sort(exarg_T *eap)
 {
@@ -475,7 +531,7 @@ void ex_sort(exarg_T *eap)
     return;
   }
   sortbuf1 = NULL;
-  sortbuf2 = NULL;
+  kv_init(sortkeys);
   regmatch.regprog = NULL;
   sorti_T *nrs = xmalloc(count * sizeof(sorti_T));
 
@@ -552,11 +608,13 @@ void ex_sort(exarg_T *eap)
   // sorting.
   sort_nr += sort_what;
 
-  // Make an array with all line numbers.  This avoids having to copy all
-  // the lines into allocated memory.
-  // When sorting on strings "start_col_nr" is the offset in the line, for
-  // numbers sorting it's the number to sort on.  This means the pattern
-  // matching and number conversion only has to be done once per line.
+  // Make an array with all line numbers.
+  // When sorting on strings the part of the line to sort on is copied to
+  // "sortkeys", for numbers sorting the number to sort on is stored.  This
+  // means the pattern matching and number conversion only has to be done
+  // once per line, and comparing does not need ml_get().  The price is that
+  // for string sorting "sortkeys" holds a copy of every key, which without
+  // a pattern is about the size of the sorted lines.
   // Also get the longest line length for allocating "sortbuf".
   for (lnum = eap->line1; lnum <= eap->line2; lnum++) {
     s = ml_get(lnum);
@@ -621,9 +679,11 @@ void ex_sort(exarg_T *eap)
       }
       *s2 = c;
     } else {
-      // Store the column to sort at.
-      nrs[lnum - eap->line1].st_u.line.start_col_nr = start_col;
-      nrs[lnum - eap->line1].st_u.line.end_col_nr = end_col;
+      // Store the key to sort on.
+      size_t key_len = (size_t)(end_col - start_col);
+      nrs[lnum - eap->line1].st_u.key_off = kv_size(sortkeys);
+      kv_concat_len(sortkeys, s + start_col, key_len);
+      kv_push(sortkeys, NUL);
     }
 
     nrs[lnum - eap->line1].lnum = lnum;
@@ -638,10 +698,14 @@ void ex_sort(exarg_T *eap)
 
   // Allocate a buffer that can hold the longest line.
   sortbuf1 = xmalloc((size_t)maxlen + 1);
-  sortbuf2 = xmalloc((size_t)maxlen + 1);
 
-  // Sort the array of line numbers.  Note: can't be interrupted!
-  qsort((void *)nrs, count, sizeof(sorti_T), sort_compare);
+  // Sort the array of line numbers.  When interrupted "sort_abort" is set and
+  // the lines are left unchanged.
+  if (sort_nr) {
+    sort_radix_nr(nrs, count);
+  } else {
+    qsort((void *)nrs, count, sizeof(sorti_T), sort_compare);
+  }
 
   if (sort_abort) {
     goto sortend;
@@ -711,7 +775,7 @@ void ex_sort(exarg_T *eap)
 sortend:
   xfree(nrs);
   xfree(sortbuf1);
-  xfree(sortbuf2);
+  kv_destroy(sortkeys);
   vim_regfree(regmatch.regprog);
   if (got_int) {
     emsg(_(e_interr));
@@ -4437,6 +4501,33 @@ void ex_global(exarg_T *eap)
   vim_regfree(regmatch.regprog);
 }
 
+/// Check if `cmd` is a plain ":delete", possibly into the black hole register.
+/// Such a command can be applied to a run of consecutive marked lines at once.
+///
+/// @param[out] regname  '_' for the black hole register, NUL otherwise.
+static bool global_cmd_is_delete(const char *cmd, int *regname)
+{
+  cmd = skipwhite(cmd);
+  const char *p = cmd;
+  while (ASCII_ISLOWER(*p)) {
+    p++;
+  }
+  size_t len = (size_t)(p - cmd);
+  if (len == 0 || len > 6 || strncmp(cmd, "delete", len) != 0) {
+    return false;
+  }
+  p = skipwhite(p);
+  *regname = NUL;
+  if (*p == '_') {
+    *regname = '_';
+    p = skipwhite(p + 1);
+  }
+  // do_one_cmd() already split off the command after a NL, a NL can only be
+  // here when it was escaped as "\<NL>".  Then the command after it is to be
+  // executed for each line and this is not just a ":delete".
+  return *p == NUL;
+}
+
 /// Execute `cmd` on lines marked with ml_setmarked().
 void global_exe(char *cmd)
 {
@@ -4458,8 +4549,29 @@ void global_exe(char *cmd)
   global_busy = 1;
   old_lcount = curbuf->b_ml.ml_line_count;
 
+  // ":g/pat/d" deletes each run of consecutive marked lines with one command.
+  // Deleted lines shift through the numbered registers, the last nine are
+  // deleted one by one for these to end up the same.
+  int regname = NUL;
+  const bool coalesce = global_cmd_is_delete(cmd, &regname)
+                        && (regname == '_' || !has_event(EVENT_TEXTYANKPOST));
+  const linenr_T nsingle = regname == '_' ? 0 : 9;
+  linenr_T remaining = coalesce ? ml_countmarked() : 0;
+
   while (!got_int && (lnum = ml_firstmarked()) != 0 && global_busy == 1) {
-    global_exe_one(cmd, lnum);
+    linenr_T count = 1;
+    if (coalesce && remaining - 1 > nsingle) {
+      count += ml_marked_run(lnum, remaining - 1 - nsingle);
+    }
+    remaining -= count;
+    if (count > 1) {
+      char run_cmd[40];
+      snprintf(run_cmd, sizeof(run_cmd), "delete %s%" PRIdLINENR,
+               regname == '_' ? "_ " : "", count);
+      global_exe_one(run_cmd, lnum);
+    } else {
+      global_exe_one(cmd, lnum);
+    }
     os_breakcheck();
   }
 
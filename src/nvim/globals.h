@@ -83,7 +83,12 @@ EXTERN struct nvim_stats_s {
   int64_t fsync;
   int64_t redraw;
   int16_t log_skip;  // How many logs were tried and skipped before log_init.
-} g_stats INIT(= { 0, 0, 0 });
+  int64_t regprog_cache_hit;   // vim_regcomp() calls that reused a program
+  int64_t regprog_cache_miss;  // vim_regcomp() calls that had to compile
+  int64_t term_received;       // bytes of output received by terminals
+  int64_t term_paused;         // times the output of a terminal job was paused
+  int64_t term_resumed;        // times it was resumed
+} g_stats INIT(= { 0, 0, 0, 0, 0, 0, 0, 0 });
 
 // Values for "starting".
 #define NO_SCREEN       2       // no screen updating yet
@@ -14,13 +14,16 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/arabic.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/globals.h"
 #include "nvim/grid.h"
 #include "nvim/highlight.h"
 #include "nvim/log.h"
+#include "nvim/map.h"
 #include "nvim/message.h"
 #include "nvim/option_defs.h"
 #include "nvim/types.h"
@@ -36,6 +39,12 @@
 // Per-cell attributes
 static size_t linebuf_size = 0;
 
+// Interned text of screen cells which doesn't fit inline in a schar_T.
+// Glyphs are never removed, the table only grows with the number of distinct
+// composed characters which have been displayed.
+static Map(cstr_t, int) glyph_map = MAP_INIT;  ///< text -> index + 1
+static kvec_t(char *) glyph_table = KV_INITIAL_VALUE;  ///< index -> text
+
 /// Determine if dedicated window grid should be used or the default_grid
 ///
 /// If UI did not request multigrid support, draw all windows on the
@@ -55,17 +64,82 @@ void grid_adjust(ScreenGrid **grid, int *row_off, int *col_off)
   }
 }
 
-/// Put a unicode char, and up to MAX_MCO composing chars, in a screen cell.
-int schar_from_cc(char *p, int c, int u8cc[MAX_MCO])
+/// Get the screen cell for the UTF-8 text "buf[len]", which must be shorter
+/// than MAX_SCHAR_SIZE.
+schar_T schar_from_buf(const char *buf, size_t len)
+{
+  assert(len < MAX_SCHAR_SIZE);
+  schar_T sc = 0;
+  if (len <= sizeof(sc) && (len == 0 || (uint8_t)buf[0] != 0xFF)) {
+    memcpy(&sc, buf, len);
+    return sc;
+  }
+
+  char key[MAX_SCHAR_SIZE];
+  memcpy(key, buf, len);
+  key[len] = NUL;
+  int idx = map_get(cstr_t, int)(&glyph_map, key);
+  if (!idx) {
+    char *glyph = xstrdup(key);
+    kv_push(glyph_table, glyph);
+    idx = (int)kv_size(glyph_table);
+    map_put(cstr_t, int)(&glyph_map, glyph, idx);
+  }
+  uint32_t i = (uint32_t)idx - 1;
+  assert(i < 0xFFFFFF);
+  char bytes[4] = { (char)0xFF, (char)(i >> 16), (char)(i >> 8), (char)i };
+  memcpy(&sc, bytes, sizeof(sc));
+  return sc;
+}
+
+/// Get the screen cell for the NUL-terminated UTF-8 text "str".
+schar_T schar_from_str(const char *str)
+{
+  return schar_from_buf(str, strnlen(str, MAX_SCHAR_SIZE - 1));
+}
+
+/// Get the screen cell for a unicode character.
+schar_T schar_from_char(int c)
+{
+  char buf[MB_MAXBYTES];
+  return schar_from_buf(buf, (size_t)utf_char2bytes(c, buf));
+}
+
+/// Get the screen cell for a unicode char and up to MAX_MCO composing chars.
+schar_T schar_from_cc(int c, int u8cc[MAX_MCO])
 {
-  int len = utf_char2bytes(c, p);
+  char buf[MAX_SCHAR_SIZE];
+  int len = utf_char2bytes(c, buf);
   for (int i = 0; i < MAX_MCO; i++) {
     if (u8cc[i] == 0) {
       break;
     }
-    len += utf_char2bytes(u8cc[i], p + len);
+    len += utf_char2bytes(u8cc[i], buf + len);
   }
-  p[len] = 0;
+  return schar_from_buf(buf, (size_t)len);
+}
+
+/// Get the text of a screen cell.
+///
+/// @param[out] buf_out NUL-terminated UTF-8 text, MAX_SCHAR_SIZE bytes.
+/// @return length of the text
+size_t schar_get(char *buf_out, schar_T sc)
+{
+  char bytes[sizeof(sc)];
+  memcpy(bytes, &sc, sizeof(sc));
+  if ((uint8_t)bytes[0] == 0xFF) {
+    size_t i = ((size_t)(uint8_t)bytes[1] << 16) | ((size_t)(uint8_t)bytes[2] << 8)
+               | (size_t)(uint8_t)bytes[3];
+    assert(i < kv_size(glyph_table));
+    return xstrlcpy(buf_out, kv_A(glyph_table, i), MAX_SCHAR_SIZE);
+  }
+
+  size_t len = 0;
+  while (len < sizeof(sc) && bytes[len] != NUL) {
+    buf_out[len] = bytes[len];
+    len++;
+  }
+  buf_out[len] = NUL;
   return len;
 }
 
@@ -74,7 +148,7 @@ int schar_from_cc(char *p, int c, int u8cc[MAX_MCO])
 void grid_clear_line(ScreenGrid *grid, size_t off, int width, bool valid)
 {
   for (int col = 0; col < width; col++) {
-    schar_from_ascii(grid->chars[off + (size_t)col], ' ');
+    grid->chars[off + (size_t)col] = schar_from_ascii(' ');
   }
   int fill = valid ? 0 : -1;
   (void)memset(grid->attrs + off, fill, (size_t)width * sizeof(sattr_T));
@@ -92,7 +166,7 @@ bool grid_invalid_row(ScreenGrid *grid, int row)
 
 static int line_off2cells(schar_T *line, size_t off, size_t max_off)
 {
-  return (off + 1 < max_off && line[off + 1][0] == 0) ? 2 : 1;
+  return (off + 1 < max_off && line[off + 1] == 0) ? 2 : 1;
 }
 
 /// Return number of display cells for char at grid->chars[off].
@@ -123,7 +197,7 @@ int grid_fix_col(ScreenGrid *grid, int col, int row)
 
   col += coloff;
   if (grid->chars != NULL && col > 0
-      && grid->chars[grid->line_offset[row] + (size_t)col][0] == 0) {
+      && grid->chars[grid->line_offset[row] + (size_t)col] == 0) {
     return col - 1 - coloff;
   }
   return col - coloff;
@@ -138,7 +212,8 @@ void grid_putchar(ScreenGrid *grid, int c, int row, int col, int attr)
   grid_puts(grid, buf, row, col, attr);
 }
 
-/// get a single character directly from grid.chars into "bytes[]".
+/// get a single character directly from grid.chars into "bytes[]", which
+/// must have room for MAX_SCHAR_SIZE bytes.
 /// Also return its attribute in *attrp;
 void grid_getbytes(ScreenGrid *grid, int row, int col, char *bytes, int *attrp)
 {
@@ -151,7 +226,7 @@ void grid_getbytes(ScreenGrid *grid, int row, int col, char *bytes, int *attrp)
 
   size_t off = grid->line_offset[row] + (size_t)col;
   *attrp = grid->attrs[off];
-  schar_copy(bytes, grid->chars[off]);
+  schar_get(bytes, grid->chars[off]);
 }
 
 /// put string '*text' on the window grid at position 'row' and 'col', with
@@ -181,12 +256,12 @@ void grid_puts_line_start(ScreenGrid *grid, int row)
   put_dirty_grid = grid;
 }
 
-void grid_put_schar(ScreenGrid *grid, int row, int col, char *schar, int attr)
+void grid_put_schar(ScreenGrid *grid, int row, int col, schar_T schar, int attr)
 {
   assert(put_dirty_row == row);
   size_t off = grid->line_offset[row] + (size_t)col;
-  if (grid->attrs[off] != attr || schar_cmp(grid->chars[off], schar) || rdb_flags & RDB_NODELTA) {
-    schar_copy(grid->chars[off], schar);
+  if (grid->attrs[off] != attr || grid->chars[off] != schar || rdb_flags & RDB_NODELTA) {
+    grid->chars[off] = schar;
     grid->attrs[off] = attr;
 
     put_dirty_first = MIN(put_dirty_first, col);
@@ -287,11 +362,10 @@ int grid_puts_len(ScreenGrid *grid, const char *text, int textlen, int row, int
       mbyte_cells = 1;
     }
 
-    schar_T buf;
-    schar_from_cc(buf, u8c, u8cc);
+    schar_T buf = schar_from_cc(u8c, u8cc);
 
-    int need_redraw = schar_cmp(grid->chars[off], buf)
-                      || (mbyte_cells == 2 && grid->chars[off + 1][0] != 0)
+    int need_redraw = grid->chars[off] != buf
+                      || (mbyte_cells == 2 && grid->chars[off + 1] != 0)
                       || grid->attrs[off] != attr
                       || exmode_active
                       || rdb_flags & RDB_NODELTA;
@@ -315,14 +389,14 @@ int grid_puts_len(ScreenGrid *grid, const char *text, int textlen, int row, int
 
       // When at the start of the text and overwriting the right half of a
       // two-cell character in the same grid, truncate that into a '>'.
-      if (ptr == text && col > 0 && grid->chars[off][0] == 0) {
-        schar_from_ascii(grid->chars[off - 1], '>');
+      if (ptr == text && col > 0 && grid->chars[off] == 0) {
+        grid->chars[off - 1] = schar_from_ascii('>');
       }
 
-      schar_copy(grid->chars[off], buf);
+      grid->chars[off] = buf;
       grid->attrs[off] = attr;
       if (mbyte_cells == 2) {
-        grid->chars[off + 1][0] = 0;
+        grid->chars[off + 1] = 0;
         grid->attrs[off + 1] = attr;
       }
       put_dirty_first = MIN(put_dirty_first, col);
@@ -422,12 +496,12 @@ void grid_fill(ScreenGrid *grid, int start_row, int end_row, int start_col, int
     int dirty_last = 0;
 
     int col = start_col;
-    schar_from_char(sc, c1);
+    sc = schar_from_char(c1);
     size_t lineoff = grid->line_offset[row];
     for (col = start_col; col < end_col; col++) {
       size_t off = lineoff + (size_t)col;
-      if (schar_cmp(grid->chars[off], sc) || grid->attrs[off] != attr || rdb_flags & RDB_NODELTA) {
-        schar_copy(grid->chars[off], sc);
+      if (grid->chars[off] != sc || grid->attrs[off] != attr || rdb_flags & RDB_NODELTA) {
+        grid->chars[off] = sc;
         grid->attrs[off] = attr;
         if (dirty_first == INT_MAX) {
           dirty_first = col;
@@ -435,7 +509,7 @@ void grid_fill(ScreenGrid *grid, int start_row, int end_row, int start_col, int
         dirty_last = col + 1;
       }
       if (col == start_col) {
-        schar_from_char(sc, c2);
+        sc = schar_from_char(c2);
       }
     }
     if (dirty_last > dirty_first) {
@@ -475,11 +549,10 @@ void grid_fill(ScreenGrid *grid, int start_row, int end_row, int start_col, int
 static int grid_char_needs_redraw(ScreenGrid *grid, size_t off_from, size_t off_to, int cols)
 {
   return (cols > 0
-          && ((schar_cmp(linebuf_char[off_from], grid->chars[off_to])
+          && ((linebuf_char[off_from] != grid->chars[off_to]
                || linebuf_attr[off_from] != grid->attrs[off_to]
                || (line_off2cells(linebuf_char, off_from, off_from + (size_t)cols) > 1
-                   && schar_cmp(linebuf_char[off_from + 1],
-                                grid->chars[off_to + 1])))
+                   && linebuf_char[off_from + 1] != grid->chars[off_to + 1]))
               || rdb_flags & RDB_NODELTA));
 }
 
@@ -531,8 +604,7 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol, int cle
   if (rlflag) {
     // Clear rest first, because it's left of the text.
     if (clear_width > 0) {
-      while (col <= endcol && grid->chars[off_to][0] == ' '
-             && grid->chars[off_to][1] == NUL
+      while (col <= endcol && grid->chars[off_to] == schar_from_ascii(' ')
              && grid->attrs[off_to] == bg_attr) {
         off_to++;
         col++;
@@ -585,9 +657,9 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol, int cle
         clear_next = true;
       }
 
-      schar_copy(grid->chars[off_to], linebuf_char[off_from]);
+      grid->chars[off_to] = linebuf_char[off_from];
       if (char_cells == 2) {
-        schar_copy(grid->chars[off_to + 1], linebuf_char[off_from + 1]);
+        grid->chars[off_to + 1] = linebuf_char[off_from + 1];
       }
 
       grid->attrs[off_to] = linebuf_attr[off_from];
@@ -606,7 +678,7 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol, int cle
   if (clear_next) {
     // Clear the second half of a double-wide character of which the left
     // half was overwritten with a single-wide character.
-    schar_from_ascii(grid->chars[off_to], ' ');
+    grid->chars[off_to] = schar_from_ascii(' ');
     end_dirty++;
   }
 
@@ -615,12 +687,10 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol, int cle
     // blank out the rest of the line
     // TODO(bfredl): we could cache winline widths
     while (col < clear_width) {
-      if (grid->chars[off_to][0] != ' '
-          || grid->chars[off_to][1] != NUL
+      if (grid->chars[off_to] != schar_from_ascii(' ')
           || grid->attrs[off_to] != bg_attr
           || rdb_flags & RDB_NODELTA) {
-        grid->chars[off_to][0] = ' ';
-        grid->chars[off_to][1] = NUL;
+        grid->chars[off_to] = schar_from_ascii(' ');
         grid->attrs[off_to] = bg_attr;
         if (start_dirty == -1) {
           start_dirty = col;
@@ -722,6 +792,12 @@ void grid_free_all_mem(void)
   grid_free(&default_grid);
   xfree(linebuf_char);
   xfree(linebuf_attr);
+
+  map_destroy(cstr_t, int)(&glyph_map);
+  for (size_t i = 0; i < kv_size(glyph_table); i++) {
+    xfree(kv_A(glyph_table, i));
+  }
+  kv_destroy(glyph_table);
 }
 
 /// (Re)allocates a window grid if size changed while in ext_multigrid mode.
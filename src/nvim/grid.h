@@ -31,31 +31,14 @@ EXTERN sattr_T *linebuf_attr INIT(= NULL);
 // Low-level functions to manipulate individual character cells on the
 // screen grid.
 
-/// Put a ASCII character in a screen cell.
-static inline void schar_from_ascii(char *p, const char c)
+/// Get the screen cell for an ASCII character.
+static inline schar_T schar_from_ascii(char c)
 {
-  p[0] = c;
-  p[1] = 0;
-}
-
-/// Put a unicode character in a screen cell.
-static inline int schar_from_char(char *p, int c)
-{
-  int len = utf_char2bytes(c, p);
-  p[len] = NUL;
-  return len;
-}
-
-/// compare the contents of two screen cells.
-static inline int schar_cmp(char *sc1, char *sc2)
-{
-  return strncmp(sc1, sc2, sizeof(schar_T));
-}
-
-/// copy the contents of screen cell `sc2` into cell `sc1`
-static inline void schar_copy(char *sc1, char *sc2)
-{
-  xstrlcpy(sc1, sc2, sizeof(schar_T));
+#ifdef ORDER_BIG_ENDIAN
+  return (schar_T)(uint8_t)c << 24;
+#else
+  return (schar_T)(uint8_t)c;
+#endif
 }
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
@@ -10,9 +10,18 @@
 #define MAX_MCO  6  // fixed value for 'maxcombine'
 
 // The characters and attributes drawn on grids.
-typedef char schar_T[(MAX_MCO + 1) * 4 + 1];
+//
+// A screen cell holds its text in 32 bits. When the UTF-8 text fits in four
+// bytes (a single character without composing characters) the bytes are
+// stored inline, padded with NUL. Longer text is interned in a table of
+// glyphs, and the cell holds its index with 0xFF as the first byte, which
+// can not start valid UTF-8. See schar_from_buf() and schar_get().
+typedef uint32_t schar_T;
 typedef int sattr_T;
 
+/// Maximum size of the text of a screen cell, including the NUL.
+#define MAX_SCHAR_SIZE ((MAX_MCO + 1) * 4 + 1)
+
 enum {
   kZIndexDefaultGrid = 0,
   kZIndexFloatDefault = 50,
@@ -28,13 +37,13 @@ enum {
 /// the new state can be compared with the existing state of the grid. This way
 /// we can avoid sending bigger updates than necessary to the Ul layer.
 ///
-/// Screen cells are stored as NUL-terminated UTF-8 strings, and a cell can
-/// contain up to MAX_MCO composing characters after the base character.
-/// The composing characters are to be drawn on top of the original character.
-/// The content after the NUL is not defined (so comparison must be done a
-/// single cell at a time). Double-width characters are stored in the left cell,
-/// and the right cell should only contain the empty string. When a part of the
-/// screen is cleared, the cells should be filled with a single whitespace char.
+/// Screen cells are schar_T values, holding UTF-8 text which can contain up
+/// to MAX_MCO composing characters after the base character. The composing
+/// characters are to be drawn on top of the original character. Cells with
+/// the same text have the same value, so they can be compared as integers.
+/// Double-width characters are stored in the left cell, and the right cell
+/// should only contain the empty string (0). When a part of the screen is
+/// cleared, the cells should be filled with a single whitespace char.
 ///
 /// attrs[] contains the highlighting attribute for each cell.
 /// line_offset[n] is the offset from chars[] and attrs[] for the
@@ -324,8 +324,10 @@ int main(int argc, char **argv)
   }
 
   bool remote_ui = (ui_client_channel_id != 0);
+  // Benchmark mode: replay a redraw stream through the TUI, see ui_client_replay().
+  const char *ui_replay = (use_builtin_ui && !remote_ui) ? os_getenv("NVIM_UI_REPLAY") : NULL;
 
-  if (use_builtin_ui && !remote_ui) {
+  if (use_builtin_ui && !remote_ui && !ui_replay) {
     ui_client_forward_stdin = !stdin_isatty;
     uint64_t rv = ui_client_start_server(params.argc, params.argv);
     if (!rv) {
@@ -387,6 +389,9 @@ int main(int argc, char **argv)
     input_start();
   }
 
+  if (ui_replay) {
+    ui_client_replay(ui_replay);  // NORETURN
+  }
   if (ui_client_channel_id) {
     ui_client_run(remote_ui);  // NORETURN
   }
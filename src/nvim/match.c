@@ -9,7 +9,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/ascii.h"
+#include "nvim/buffer.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/charset.h"
 #include "nvim/drawscreen.h"
@@ -44,6 +46,10 @@
 
 static const char *e_invalwindow = N_("E957: Invalid window number");
 
+/// Incremented when 'iskeyword' or another option used for character classes
+/// changed, remembered matches are not valid then.
+static unsigned match_cache_chartab_tick = 0;
+
 #define SEARCH_HL_PRIORITY 0
 
 /// Add match to the match list of window "wp".
@@ -405,6 +411,197 @@ static int next_search_hl_pos(match_T *shl, linenr_T lnum, matchitem_T *match, c
   return 0;
 }
 
+/// Get the remembered matches for the pattern of "shl" in its buffer.
+///
+/// @return  NULL when matches of the pattern cannot be remembered.
+static match_cache_T *match_cache_get(match_T *shl)
+  FUNC_ATTR_NONNULL_ALL
+{
+  buf_T *buf = shl->buf;
+  regprog_T *prog = shl->rm.regprog;
+
+  if (buf == NULL || !re_line_local(prog)) {
+    return NULL;
+  }
+  if (buf->b_match_cache.changedtick != buf_get_changedtick(buf)
+      || buf->b_match_cache.chartab_tick != match_cache_chartab_tick) {
+    match_cache_free(buf);
+    buf->b_match_cache.changedtick = buf_get_changedtick(buf);
+    buf->b_match_cache.chartab_tick = match_cache_chartab_tick;
+  }
+
+  for (size_t i = 0; i < kv_size(buf->b_match_cache.patterns); i++) {
+    match_cache_T *mc = &kv_A(buf->b_match_cache.patterns, i);
+    if (mc->mc_prog == prog && mc->mc_ic == shl->rm.rmm_ic
+        && mc->mc_maxcol == shl->rm.rmm_maxcol) {
+      return mc;
+    }
+  }
+
+  // Drop the oldest pattern when there are too many.
+  if (kv_size(buf->b_match_cache.patterns) >= MATCH_CACHE_SIZE) {
+    match_cache_clear_lines(&kv_A(buf->b_match_cache.patterns, 0));
+    vim_regfree(kv_A(buf->b_match_cache.patterns, 0).mc_prog);
+    kv_size(buf->b_match_cache.patterns)--;
+    memmove(&kv_A(buf->b_match_cache.patterns, 0), &kv_A(buf->b_match_cache.patterns, 1),
+            kv_size(buf->b_match_cache.patterns) * sizeof(match_cache_T));
+  }
+  kv_push(buf->b_match_cache.patterns, ((match_cache_T){
+    .mc_prog = vim_regref(prog),
+    .mc_ic = shl->rm.rmm_ic,
+    .mc_maxcol = shl->rm.rmm_maxcol,
+  }));
+  return &kv_last(buf->b_match_cache.patterns);
+}
+
+/// @return  index of the first line in "mc" at or after "lnum".
+static size_t match_cache_find_line(match_cache_T *mc, linenr_T lnum)
+{
+  size_t lo = 0;
+  size_t hi = kv_size(mc->mc_lines);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (kv_A(mc->mc_lines, mid).mcl_lnum < lnum) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/// @return  index of the first result in "mcl" at or after "matchcol".
+static size_t match_cache_find_result(match_cache_line_T *mcl, colnr_T matchcol)
+{
+  size_t lo = 0;
+  size_t hi = kv_size(mcl->mcl_results);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (kv_A(mcl->mcl_results, mid).mcr_matchcol < matchcol) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/// Look up the result of searching line "lnum" from "matchcol" in "mc".
+/// When found, sets "shl->rm" like vim_regexec_multi() and "*nmatched".
+///
+/// @return  true if the result was remembered.
+static bool match_cache_lookup(match_cache_T *mc, match_T *shl, linenr_T lnum, colnr_T matchcol,
+                               long *nmatched)
+{
+  size_t li = match_cache_find_line(mc, lnum);
+  if (li >= kv_size(mc->mc_lines) || kv_A(mc->mc_lines, li).mcl_lnum != lnum) {
+    return false;
+  }
+  match_cache_line_T *mcl = &kv_A(mc->mc_lines, li);
+  size_t ri = match_cache_find_result(mcl, matchcol);
+  if (ri >= kv_size(mcl->mcl_results) || kv_A(mcl->mcl_results, ri).mcr_matchcol != matchcol) {
+    return false;
+  }
+
+  match_cache_result_T *r = &kv_A(mcl->mcl_results, ri);
+  if (r->mcr_start < 0) {
+    *nmatched = 0;
+  } else {
+    shl->rm.startpos[0].lnum = 0;
+    shl->rm.startpos[0].col = r->mcr_start;
+    shl->rm.endpos[0].lnum = 0;
+    shl->rm.endpos[0].col = r->mcr_end;
+    *nmatched = 1;
+  }
+  return true;
+}
+
+/// Remember the result of searching line "lnum" from "matchcol" in "mc".
+static void match_cache_store(match_cache_T *mc, match_T *shl, linenr_T lnum, colnr_T matchcol,
+                              long nmatched)
+{
+  size_t li = match_cache_find_line(mc, lnum);
+  if (li >= kv_size(mc->mc_lines) || kv_A(mc->mc_lines, li).mcl_lnum != lnum) {
+    if (kv_size(mc->mc_lines) >= MATCH_CACHE_MAX_LINES) {
+      match_cache_clear_lines(mc);
+      li = 0;
+    }
+    (void)kv_pushp(mc->mc_lines);
+    memmove(&kv_A(mc->mc_lines, li + 1), &kv_A(mc->mc_lines, li),
+            (kv_size(mc->mc_lines) - li - 1) * sizeof(match_cache_line_T));
+    kv_A(mc->mc_lines, li) = (match_cache_line_T){ .mcl_lnum = lnum };
+  }
+
+  match_cache_line_T *mcl = &kv_A(mc->mc_lines, li);
+  size_t ri = match_cache_find_result(mcl, matchcol);
+  (void)kv_pushp(mcl->mcl_results);
+  memmove(&kv_A(mcl->mcl_results, ri + 1), &kv_A(mcl->mcl_results, ri),
+          (kv_size(mcl->mcl_results) - ri - 1) * sizeof(match_cache_result_T));
+  kv_A(mcl->mcl_results, ri) = (match_cache_result_T){
+    .mcr_matchcol = matchcol,
+    .mcr_start = nmatched == 0 ? -1 : shl->rm.startpos[0].col,
+    .mcr_end = nmatched == 0 ? -1 : shl->rm.endpos[0].col,
+  };
+}
+
+static void match_cache_clear_lines(match_cache_T *mc)
+{
+  for (size_t i = 0; i < kv_size(mc->mc_lines); i++) {
+    kv_destroy(kv_A(mc->mc_lines, i).mcl_results);
+  }
+  kv_size(mc->mc_lines) = 0;
+}
+
+/// Forget the remembered matches in buffer "buf".
+void match_cache_free(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  for (size_t i = 0; i < kv_size(buf->b_match_cache.patterns); i++) {
+    match_cache_T *mc = &kv_A(buf->b_match_cache.patterns, i);
+    match_cache_clear_lines(mc);
+    kv_destroy(mc->mc_lines);
+    vim_regfree(mc->mc_prog);
+  }
+  kv_destroy(buf->b_match_cache.patterns);
+}
+
+/// Adjust the remembered matches in "buf" after lines "lnum" up to "lnume"
+/// were changed and "xtra" lines were inserted below them (negative when
+/// deleting).  Only valid when this is the only change since the matches
+/// were remembered, otherwise they are forgotten when used next.
+void match_cache_changed(buf_T *buf, linenr_T lnum, linenr_T lnume, linenr_T xtra)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (kv_size(buf->b_match_cache.patterns) == 0
+      || buf->b_match_cache.changedtick + 1 != buf_get_changedtick(buf)) {
+    return;
+  }
+
+  for (size_t i = 0; i < kv_size(buf->b_match_cache.patterns); i++) {
+    match_cache_T *mc = &kv_A(buf->b_match_cache.patterns, i);
+    size_t to = 0;
+    for (size_t from = 0; from < kv_size(mc->mc_lines); from++) {
+      match_cache_line_T *mcl = &kv_A(mc->mc_lines, from);
+      if (mcl->mcl_lnum >= lnum && mcl->mcl_lnum < lnume) {
+        kv_destroy(mcl->mcl_results);
+        continue;
+      }
+      if (mcl->mcl_lnum >= lnume) {
+        mcl->mcl_lnum += xtra;
+      }
+      kv_A(mc->mc_lines, to++) = *mcl;
+    }
+    kv_size(mc->mc_lines) = to;
+  }
+  buf->b_match_cache.changedtick = buf_get_changedtick(buf);
+}
+
+/// Forget all remembered matches when 'iskeyword' or a similar option changed.
+void match_cache_chartab_changed(void)
+{
+  match_cache_chartab_tick++;
+}
+
 /// Search for a next 'hlsearch' or match.
 /// Uses shl->buf.
 /// Sets shl->lnum and shl->rm contents.
@@ -476,30 +673,40 @@ static void next_search_hl(win_T *win, match_T *search_hl, match_T *shl, linenr_
 
     shl->lnum = lnum;
     if (shl->rm.regprog != NULL) {
-      // Remember whether shl->rm is using a copy of the regprog in
-      // cur->mit_match.
-      bool regprog_is_copy = (shl != search_hl && cur != NULL
-                              && shl == &cur->mit_hl
-                              && cur->mit_match.regprog == cur->mit_hl.rm.regprog);
-      int timed_out = false;
-
-      nmatched = vim_regexec_multi(&shl->rm, win, shl->buf, lnum, matchcol,
-                                   &(shl->tm), &timed_out);
-      // Copy the regprog, in case it got freed and recompiled.
-      if (regprog_is_copy) {
-        cur->mit_match.regprog = cur->mit_hl.rm.regprog;
-      }
-      if (called_emsg > called_emsg_before || got_int || timed_out) {
-        // Error while handling regexp: stop using this regexp.
-        if (shl == search_hl) {
-          // don't free regprog in the match list, it's a copy
-          vim_regfree(shl->rm.regprog);
-          set_no_hlsearch(true);
+      // Matches in lines that did not change since they were drawn are
+      // remembered, no need to search again.
+      match_cache_T *mc = match_cache_get(shl);
+      if (mc == NULL || !match_cache_lookup(mc, shl, lnum, matchcol, &nmatched)) {
+        // Remember whether shl->rm is using a copy of the regprog in
+        // cur->mit_match.
+        bool regprog_is_copy = (shl != search_hl && cur != NULL
+                                && shl == &cur->mit_hl
+                                && cur->mit_match.regprog == cur->mit_hl.rm.regprog);
+        int timed_out = false;
+
+        nmatched = vim_regexec_multi(&shl->rm, win, shl->buf, lnum, matchcol,
+                                     &(shl->tm), &timed_out);
+        // Copy the regprog, in case it got freed and recompiled.
+        if (regprog_is_copy) {
+          cur->mit_match.regprog = cur->mit_hl.rm.regprog;
+        }
+        if (called_emsg > called_emsg_before || got_int || timed_out) {
+          // Error while handling regexp: stop using this regexp.
+          if (shl == search_hl) {
+            // don't free regprog in the match list, it's a copy
+            vim_regfree(shl->rm.regprog);
+            set_no_hlsearch(true);
+          }
+          shl->rm.regprog = NULL;
+          shl->lnum = 0;
+          got_int = false;  // avoid the "Type :quit to exit Vim" message
+          break;
+        }
+        // The regprog may have been recompiled, "mc" is only valid for the
+        // one it was found with.
+        if (mc != NULL && mc->mc_prog == shl->rm.regprog) {
+          match_cache_store(mc, shl, lnum, matchcol, nmatched);
         }
-        shl->rm.regprog = NULL;
-        shl->lnum = 0;
-        got_int = false;  // avoid the "Type :quit to exit Vim" message
-        break;
       }
     } else if (cur != NULL) {
       nmatched = next_search_hl_pos(shl, lnum, cur, matchcol);
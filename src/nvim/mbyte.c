@@ -63,6 +63,7 @@
 #include "nvim/optionstr.h"
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
+#include "nvim/plines.h"
 #include "nvim/pos.h"
 #include "nvim/strings.h"
 #include "nvim/types.h"
@@ -2760,6 +2761,7 @@ void f_setcellwidths(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
   }
 
   xfree(cw_table_save);
+  plines_options_changed();
   redraw_all_later(UPD_NOT_VALID);
 }
 
@@ -2630,6 +2630,64 @@ linenr_T ml_firstmarked(void)
   return (linenr_T)0;
 }
 
+/// Clear the marks of the lines directly following "lnum" that are marked,
+/// stopping at the first line that is not marked or after "max" lines.
+///
+/// @return  the number of lines cleared
+linenr_T ml_marked_run(linenr_T lnum, linenr_T max)
+{
+  if (curbuf->b_ml.ml_mfp == NULL) {
+    return 0;
+  }
+
+  linenr_T count = 0;
+  for (lnum++; count < max && lnum <= curbuf->b_ml.ml_line_count;) {
+    bhdr_T *hp;
+    if ((hp = ml_find_line(curbuf, lnum, ML_FIND)) == NULL) {
+      break;
+    }
+    DATA_BL *dp = hp->bh_data;
+
+    for (int i = lnum - curbuf->b_ml.ml_locked_low;
+         count < max && lnum <= curbuf->b_ml.ml_locked_high; i++, lnum++, count++) {
+      if (!((dp->db_index[i]) & DB_MARKED)) {
+        return count;
+      }
+      (dp->db_index[i]) &= DB_INDEX_MASK;
+      curbuf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
+      lowest_marked = lnum + 1;
+    }
+  }
+
+  return count;
+}
+
+/// @return  the number of lines with a DB_MARKED flag
+linenr_T ml_countmarked(void)
+{
+  if (curbuf->b_ml.ml_mfp == NULL || lowest_marked == 0) {
+    return 0;
+  }
+
+  linenr_T count = 0;
+  for (linenr_T lnum = lowest_marked; lnum <= curbuf->b_ml.ml_line_count;) {
+    bhdr_T *hp;
+    if ((hp = ml_find_line(curbuf, lnum, ML_FIND)) == NULL) {
+      break;
+    }
+    DATA_BL *dp = hp->bh_data;
+
+    for (int i = lnum - curbuf->b_ml.ml_locked_low;
+         lnum <= curbuf->b_ml.ml_locked_high; i++, lnum++) {
+      if ((dp->db_index[i]) & DB_MARKED) {
+        count++;
+      }
+    }
+  }
+
+  return count;
+}
+
 /// clear all DB_MARKED flags
 void ml_clearmarked(void)
 {
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <uv.h>
 
 #include "nvim/api/extmark.h"
 #include "nvim/arglist.h"
@@ -536,14 +537,46 @@ void time_to_bytes(time_t time_, uint8_t buf[8])
 static struct consumed_blk *arena_reuse_blk;
 static size_t arena_reuse_blk_count = 0;
 
+// Protects arena_reuse_blk and arena_alloc_count once arenas are filled from
+// other threads than the main thread. See arena_init_threads().
+static uv_mutex_t arena_mutex;
+static bool arena_threads = false;
+
+#define ARENA_LOCK() \
+  do { \
+    if (arena_threads) { \
+      uv_mutex_lock(&arena_mutex); \
+    } \
+  } while (0)
+#define ARENA_UNLOCK() \
+  do { \
+    if (arena_threads) { \
+      uv_mutex_unlock(&arena_mutex); \
+    } \
+  } while (0)
+
+/// Allows arenas to be allocated from in other threads than the main thread.
+///
+/// An arena itself is still only to be used by one thread at a time.
+/// Must be called on the main thread, before any other thread uses an arena.
+void arena_init_threads(void)
+{
+  if (!arena_threads) {
+    uv_mutex_init(&arena_mutex);
+    arena_threads = true;
+  }
+}
+
 static void arena_free_reuse_blks(void)
 {
+  ARENA_LOCK();
   while (arena_reuse_blk_count > 0) {
     struct consumed_blk *blk = arena_reuse_blk;
     arena_reuse_blk = arena_reuse_blk->prev;
     xfree(blk);
     arena_reuse_blk_count--;
   }
+  ARENA_UNLOCK();
 }
 
 /// Finish the allocations in an arena.
@@ -562,12 +595,15 @@ ArenaMem arena_finish(Arena *arena)
 void alloc_block(Arena *arena)
 {
   struct consumed_blk *prev_blk = (struct consumed_blk *)arena->cur_blk;
+  ARENA_LOCK();
   if (arena_reuse_blk_count > 0) {
     arena->cur_blk = (char *)arena_reuse_blk;
     arena_reuse_blk = arena_reuse_blk->prev;
     arena_reuse_blk_count--;
+    ARENA_UNLOCK();
   } else {
     arena_alloc_count++;
+    ARENA_UNLOCK();
     arena->cur_blk = xmalloc(ARENA_BLOCK_SIZE);
   }
   arena->pos = 0;
@@ -598,7 +634,9 @@ void *arena_alloc(Arena *arena, size_t size, bool align)
       // size, but still with block pointer head. We do this even for
       // arena->size / 2, as there likely is space left for the next
       // small allocation in the current block.
+      ARENA_LOCK();
       arena_alloc_count++;
+      ARENA_UNLOCK();
       size_t hdr_size = sizeof(struct consumed_blk);
       size_t aligned_hdr_size = (align ? arena_align_offset(hdr_size) : hdr_size);
       char *alloc = xmalloc(size + aligned_hdr_size);
@@ -626,6 +664,7 @@ void arena_mem_free(ArenaMem mem)
   struct consumed_blk *b = mem;
   // peel of the first block, as it is guaranteed to be ARENA_BLOCK_SIZE,
   // not a custom fix_blk
+  ARENA_LOCK();
   if (arena_reuse_blk_count < REUSE_MAX && b != NULL) {
     struct consumed_blk *reuse_blk = b;
     b = b->prev;
@@ -633,12 +672,35 @@ void arena_mem_free(ArenaMem mem)
     arena_reuse_blk = reuse_blk;
     arena_reuse_blk_count++;
   }
+  ARENA_UNLOCK();
+
+  while (b) {
+    struct consumed_blk *prev = b->prev;
+    xfree(b);
+    b = prev;
+  }
+}
+
+/// Frees all allocations in an arena, but keeps its current block to serve
+/// further allocations. Cheaper than arena_finish() + arena_mem_free() when an
+/// arena is used for many short-lived batches of objects.
+void arena_reset(Arena *arena)
+{
+  if (!arena->cur_blk) {
+    return;
+  }
 
+  // The blocks before the current one might be large custom blocks, which
+  // should not end up in the reuse list.
+  struct consumed_blk *blk = (struct consumed_blk *)arena->cur_blk;
+  struct consumed_blk *b = blk->prev;
   while (b) {
     struct consumed_blk *prev = b->prev;
     xfree(b);
     b = prev;
   }
+  blk->prev = NULL;
+  arena->pos = sizeof(struct consumed_blk);
 }
 
 char *arena_memdupz(Arena *arena, const char *buf, size_t size)
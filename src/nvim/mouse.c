@@ -1796,8 +1796,9 @@ int mouse_check_fold(void)
     // Remember the character under the mouse, might be one of foldclose or
     // foldopen fillchars in the fold column.
     if (gp->chars != NULL) {
-      mouse_char = utf_ptr2char((char *)gp->chars[gp->line_offset[row]
-                                                  + (unsigned)col]);
+      char buf[MAX_SCHAR_SIZE];
+      schar_get(buf, gp->chars[gp->line_offset[row] + (unsigned)col]);
+      mouse_char = utf_ptr2char(buf);
     }
 
     // Check for position outside of the fold column.
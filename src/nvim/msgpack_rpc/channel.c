@@ -17,6 +17,7 @@
 #include "nvim/api/private/dispatch.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/api/ui.h"
+#include "nvim/api/vim.h"
 #include "nvim/channel.h"
 #include "nvim/event/defs.h"
 #include "nvim/event/loop.h"
@@ -34,6 +35,7 @@
 #include "nvim/msgpack_rpc/helpers.h"
 #include "nvim/msgpack_rpc/unpacker.h"
 #include "nvim/os/input.h"
+#include "nvim/os/time.h"
 #include "nvim/rbuffer.h"
 #include "nvim/types.h"
 #include "nvim/ui.h"
@@ -110,6 +112,11 @@ static void log_client_msg(uint64_t channel_id, bool is_request, const char *nam
 # define log_server_msg(...)
 #endif
 
+/// Messages which grew larger than this are decoded off the main thread, so
+/// that huge requests (nvim_buf_set_lines() from a formatter, say) don't stall
+/// the editor while they are being unpacked.
+#define RPC_DECODE_THREAD_MIN (1024 * 1024)
+
 static PMap(cstr_t) event_strings = MAP_INIT;
 static msgpack_sbuffer out_buffer;
 
@@ -121,6 +128,7 @@ void rpc_init(void)
 {
   ch_before_blocking_events = multiqueue_new_child(main_loop.events);
   msgpack_sbuffer_init(&out_buffer);
+  arena_init_threads();
 }
 
 void rpc_start(Channel *channel)
@@ -134,9 +142,13 @@ void rpc_start(Channel *channel)
   rpc->next_request_id = 1;
   rpc->info = (Dictionary)ARRAY_DICT_INIT;
   kv_init(rpc->call_stack);
+  kv_init(rpc->decode_buf);
+  rpc->flow = (RpcFlow){ .high_watermark = RPC_FLOW_HIGH_WATERMARK,
+                         .low_watermark = RPC_FLOW_LOW_WATERMARK };
 
   if (channel->streamtype != kChannelStreamInternal) {
     Stream *out = channel_outstream(channel);
+    wstream_set_write_cb(channel_instream(channel), rpc_write_cb, channel);
 #ifdef NVIM_LOG_DEBUG
     Stream *in = channel_instream(channel);
     DLOG("rpc ch %" PRIu64 " in-stream=%p out-stream=%p", channel->id,
@@ -284,75 +296,168 @@ static void receive_msgpack(Stream *stream, RBuffer *rbuf, size_t c, void *data,
   Channel *channel = data;
   channel_incref(channel);
 
+  if (channel->rpc.decoding) {
+    // Leave the data in rbuf, decode_done_cb() picks it up.
+    channel->rpc.decode_eof |= eof;
+    goto end;
+  }
+
   if (eof) {
-    channel_close(channel->id, kChannelPartRpc, NULL);
-    char buf[256];
-    snprintf(buf, sizeof(buf), "ch %" PRIu64 " was closed by the client",
-             channel->id);
-    chan_close_with_error(channel, buf, LOGLVL_INF);
+    receive_eof(channel);
     goto end;
   }
 
   DLOG("ch %" PRIu64 ": parsing %zu bytes from msgpack Stream: %p",
        channel->id, rbuffer_size(rbuf), (void *)stream);
 
-  Unpacker *p = channel->rpc.unpacker;
-  size_t size = 0;
-  p->read_ptr = rbuffer_read_ptr(rbuf, &size);
-  p->read_size = size;
-  parse_msgpack(channel);
-  size_t consumed = size - p->read_size;
-  rbuffer_consumed_compact(rbuf, consumed);
+  receive_rbuffer(channel, rbuf);
 
 end:
   channel_decref(channel);
 }
 
-static void parse_msgpack(Channel *channel)
+static void receive_eof(Channel *channel)
+{
+  channel_close(channel->id, kChannelPartRpc, NULL);
+  char buf[256];
+  snprintf(buf, sizeof(buf), "ch %" PRIu64 " was closed by the client",
+           channel->id);
+  chan_close_with_error(channel, buf, LOGLVL_INF);
+}
+
+static void receive_rbuffer(Channel *channel, RBuffer *rbuf)
+{
+  RpcState *rpc = &channel->rpc;
+  Unpacker *p = rpc->unpacker;
+  size_t size = 0;
+  char *ptr = rbuffer_read_ptr(rbuf, &size);
+
+  if (!kv_size(rpc->decode_buf) && !decode_offload(channel)) {
+    p->read_ptr = ptr;
+    p->read_size = size;
+    parse_msgpack(channel);
+    size_t consumed = size - p->read_size;
+    rbuffer_consumed_compact(rbuf, consumed);
+    return;
+  }
+
+  // Continue after the data left over by decode_work_cb()
+  if (size) {
+    kv_concat_len(rpc->decode_buf, ptr, size);
+    rbuffer_consumed_compact(rbuf, size);
+  }
+  if (!kv_size(rpc->decode_buf)) {
+    return;
+  }
+
+  if (decode_offload(channel)) {
+    rpc->decoding = true;
+    rpc->decode_work.data = channel;
+    channel_incref(channel);
+    uv_queue_work(&main_loop.uv, &rpc->decode_work, decode_work_cb, decode_done_cb);
+    return;
+  }
+
+  p->read_ptr = rpc->decode_buf.items;
+  p->read_size = kv_size(rpc->decode_buf);
+  parse_msgpack(channel);
+  decode_buf_consumed(rpc);
+}
+
+/// Whether the rest of the current message should be decoded by decode_work_cb().
+///
+/// Only large messages are decoded on a thread, as handing over the data has a
+/// latency of its own. The header of a message (and redraw events for the UI
+/// client) are always decoded on the main thread.
+static bool decode_offload(Channel *channel)
 {
   Unpacker *p = channel->rpc.unpacker;
-  while (unpacker_advance(p)) {
-    if (p->type == kMessageTypeRedrawEvent) {
-      // When exiting, ui_client_stop() has already been called, so don't handle UI events.
-      if (ui_client_channel_id && !exiting) {
-        if (p->grid_line_event) {
-          ui_client_event_raw_line(p->grid_line_event);
-        } else if (p->ui_handler.fn != NULL && p->result.type == kObjectTypeArray) {
-          p->ui_handler.fn(p->result.data.array);
-        }
-      }
-      arena_mem_free(arena_finish(&p->arena));
-    } else if (p->type == kMessageTypeResponse) {
-      ChannelCallFrame *frame = kv_last(channel->rpc.call_stack);
-      if (p->request_id != frame->request_id) {
-        char buf[256];
-        snprintf(buf, sizeof(buf),
-                 "ch %" PRIu64 " returned a response with an unknown request "
-                 "id. Ensure the client is properly synchronized",
-                 channel->id);
-        chan_close_with_error(channel, buf, LOGLVL_ERR);
-      }
-      frame->returned = true;
-      frame->errored = (p->error.type != kObjectTypeNil);
+  return (p->state == 1 || p->state == 2) && channel->rpc.msg_bytes >= RPC_DECODE_THREAD_MIN;
+}
 
-      if (frame->errored) {
-        frame->result = p->error;
-        // TODO(bfredl): p->result should not even be decoded
-        // api_free_object(p->result);
-      } else {
-        frame->result = p->result;
-      }
-      frame->result_mem = arena_finish(&p->arena);
-    } else {
-      log_client_msg(channel->id, p->type == kMessageTypeRequest, p->handler.name);
+/// Drops the part of decode_buf which has been read by the unpacker.
+static void decode_buf_consumed(RpcState *rpc)
+{
+  size_t left = rpc->unpacker->read_size;
+  if (left) {
+    memmove(rpc->decode_buf.items, rpc->decode_buf.items + kv_size(rpc->decode_buf) - left, left);
+  }
+  kv_size(rpc->decode_buf) = left;
+}
 
-      Object res = p->result;
-      if (p->result.type != kObjectTypeArray) {
-        chan_close_with_error(channel, "msgpack-rpc request args has to be an array", LOGLVL_ERR);
-        return;
-      }
-      Array arg = res.data.array;
-      handle_request(channel, p, arg);
+/// Decodes a large message into the unpacker arena. Runs on the libuv
+/// threadpool, while the channel is marked as `decoding` the main thread does
+/// not touch the unpacker or decode_buf.
+static void decode_work_cb(uv_work_t *req)
+{
+  Channel *channel = req->data;
+  RpcState *rpc = &channel->rpc;
+  Unpacker *p = rpc->unpacker;
+
+  p->read_ptr = rpc->decode_buf.items;
+  p->read_size = kv_size(rpc->decode_buf);
+  rpc->decode_done = unpacker_advance(p);
+  rpc->msg_bytes += kv_size(rpc->decode_buf) - p->read_size;
+}
+
+/// Dispatches the message decoded by decode_work_cb(), on the main thread.
+static void decode_done_cb(uv_work_t *req, int status)
+{
+  Channel *channel = req->data;
+  RpcState *rpc = &channel->rpc;
+  Unpacker *p = rpc->unpacker;
+
+  rpc->decoding = false;
+  if (channel->id == ui_client_channel_id) {
+    ui_client_record(rpc->decode_buf.items, kv_size(rpc->decode_buf) - p->read_size);
+  }
+  decode_buf_consumed(rpc);
+
+  if (!rpc->closed) {
+    if (rpc->decode_done) {
+      size_t msg_bytes = rpc->msg_bytes;
+      rpc->msg_bytes = 0;
+      handle_message(channel, p, msg_bytes);
+    } else if (unpacker_closed(p)) {
+      chan_close_with_error(channel, p->unpack_error.msg, LOGLVL_ERR);
+      api_clear_error(&p->unpack_error);
+    }
+  }
+
+  // Data which arrived in the meantime, and what was left after the message.
+  Stream *stream = channel_outstream(channel);
+  if (!rpc->closed && !stream->closed) {
+    receive_rbuffer(channel, stream->buffer);
+  }
+
+  if (rpc->decode_eof && !rpc->decoding) {
+    rpc->decode_eof = false;
+    if (!rpc->closed) {
+      receive_eof(channel);
+    }
+  }
+
+  channel_decref(channel);
+}
+
+static void parse_msgpack(Channel *channel)
+{
+  Unpacker *p = channel->rpc.unpacker;
+  while (true) {
+    const char *read_ptr = p->read_ptr;
+    size_t read_size = p->read_size;
+    bool done = unpacker_advance(p);
+    channel->rpc.msg_bytes += read_size - p->read_size;
+    if (channel->id == ui_client_channel_id) {
+      ui_client_record(read_ptr, read_size - p->read_size);
+    }
+    if (!done) {
+      break;
+    }
+    size_t msg_bytes = channel->rpc.msg_bytes;
+    channel->rpc.msg_bytes = 0;
+    if (!handle_message(channel, p, msg_bytes)) {
+      return;
     }
   }
 
@@ -362,8 +467,58 @@ static void parse_msgpack(Channel *channel)
   }
 }
 
+/// Handles a message completely decoded by the unpacker.
+///
+/// @return false if the channel was closed because of a malformed message.
+static bool handle_message(Channel *channel, Unpacker *p, size_t msg_bytes)
+{
+  if (p->type == kMessageTypeRedrawEvent) {
+    // When exiting, ui_client_stop() has already been called, so don't handle UI events.
+    if (ui_client_channel_id && !exiting) {
+      if (p->grid_line_event) {
+        ui_client_event_raw_line(p->grid_line_event);
+      } else if (p->ui_handler.fn != NULL && p->result.type == kObjectTypeArray) {
+        p->ui_handler.fn(p->result.data.array);
+      }
+    }
+    arena_mem_free(arena_finish(&p->arena));
+  } else if (p->type == kMessageTypeResponse) {
+    ChannelCallFrame *frame = kv_last(channel->rpc.call_stack);
+    if (p->request_id != frame->request_id) {
+      char buf[256];
+      snprintf(buf, sizeof(buf),
+               "ch %" PRIu64 " returned a response with an unknown request "
+               "id. Ensure the client is properly synchronized",
+               channel->id);
+      chan_close_with_error(channel, buf, LOGLVL_ERR);
+    }
+    frame->returned = true;
+    frame->errored = (p->error.type != kObjectTypeNil);
+
+    if (frame->errored) {
+      frame->result = p->error;
+      // TODO(bfredl): p->result should not even be decoded
+      // api_free_object(p->result);
+    } else {
+      frame->result = p->result;
+    }
+    frame->result_mem = arena_finish(&p->arena);
+  } else {
+    log_client_msg(channel->id, p->type == kMessageTypeRequest, p->handler.name);
+
+    Object res = p->result;
+    if (p->result.type != kObjectTypeArray) {
+      chan_close_with_error(channel, "msgpack-rpc request args has to be an array", LOGLVL_ERR);
+      return false;
+    }
+    Array arg = res.data.array;
+    handle_request(channel, p, arg, msg_bytes);
+  }
+  return true;
+}
+
 /// Handles requests and notifications received on the channel.
-static void handle_request(Channel *channel, Unpacker *p, Array args)
+static void handle_request(Channel *channel, Unpacker *p, Array args, size_t bytes_in)
   FUNC_ATTR_NONNULL_ALL
 {
   assert(p->type == kMessageTypeRequest || p->type == kMessageTypeNotification);
@@ -383,6 +538,8 @@ static void handle_request(Channel *channel, Unpacker *p, Array args)
   evdata->used_mem = p->arena;
   p->arena = (Arena)ARENA_EMPTY;
   evdata->request_id = p->request_id;
+  evdata->bytes_in = bytes_in;
+  evdata->received = os_hrtime();
   channel_incref(channel);
   if (p->handler.fast) {
     bool is_get_mode = p->handler.fn == handle_nvim_get_mode;
@@ -422,19 +579,29 @@ static void request_event(void **argv)
     goto free_ret;
   }
 
-  Object result = handler.fn(channel->id, e->args, &e->used_mem, &error);
-  if (e->type == kMessageTypeRequest || ERROR_SET(&error)) {
+  uint64_t start = os_hrtime();
+  Object result = NIL;
+  WBuffer *buffer = NULL;
+  if (handler.fn == handle_nvim_call_atomic && e->type == kMessageTypeRequest
+      && e->args.size == 1 && e->args.items[0].type == kObjectTypeArray) {
+    buffer = serialize_call_atomic(channel, e, &error);
+  } else {
+    result = handler.fn(channel->id, e->args, &e->used_mem, &error);
+  }
+  uint64_t exec_time = os_hrtime() - start;
+  bool errored = ERROR_SET(&error);
+  size_t bytes_out = 0;
+  if (!buffer && (e->type == kMessageTypeRequest || errored)) {
     // Send the response.
-    msgpack_packer response;
-    msgpack_packer_init(&response, &out_buffer, msgpack_sbuffer_write);
-    channel_write(channel, serialize_response(channel->id,
-                                              e->handler,
-                                              e->type,
-                                              e->request_id,
-                                              &error,
-                                              result,
-                                              &out_buffer));
+    buffer = serialize_response(channel->id, e->handler, e->type, e->request_id,
+                                &error, result, &out_buffer);
   }
+  if (buffer) {
+    bytes_out = buffer->size;
+    channel_write(channel, buffer);
+  }
+  rpc_stats_record(channel, handler.name, e->bytes_in, bytes_out,
+                   start - e->received, exec_time, errored);
   if (!handler.arena_return) {
     api_free_object(result);
   }
@@ -447,6 +614,152 @@ free_ret:
   api_clear_error(&error);
 }
 
+static size_t rpc_stats_bucket(uint64_t ns)
+{
+  uint64_t us = ns / 1000;
+  size_t bucket = 0;
+  while (us > 0 && bucket < RPC_STATS_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void rpc_stats_record(Channel *channel, const char *name, size_t bytes_in,
+                             size_t bytes_out, uint64_t wait_time, uint64_t exec_time,
+                             bool errored)
+{
+  RpcMethodStats *stats = pmap_get(cstr_t)(channel->rpc.method_stats, name);
+  if (!stats) {
+    stats = xcalloc(1, sizeof(*stats));
+    pmap_put(cstr_t)(channel->rpc.method_stats, name, stats);
+  }
+  stats->calls++;
+  stats->errors += errored;
+  stats->bytes_in += bytes_in;
+  stats->bytes_out += bytes_out;
+  stats->wait_total += wait_time;
+  stats->wait_max = MAX(stats->wait_max, wait_time);
+  stats->wait_hist[rpc_stats_bucket(wait_time)]++;
+  stats->exec_total += exec_time;
+  stats->exec_max = MAX(stats->exec_max, exec_time);
+  stats->exec_hist[rpc_stats_bucket(exec_time)]++;
+}
+
+static void rpc_stats_add(RpcMethodStats *dst, const RpcMethodStats *src)
+{
+  dst->calls += src->calls;
+  dst->errors += src->errors;
+  dst->bytes_in += src->bytes_in;
+  dst->bytes_out += src->bytes_out;
+  dst->wait_total += src->wait_total;
+  dst->wait_max = MAX(dst->wait_max, src->wait_max);
+  dst->exec_total += src->exec_total;
+  dst->exec_max = MAX(dst->exec_max, src->exec_max);
+  for (size_t i = 0; i < RPC_STATS_BUCKETS; i++) {
+    dst->wait_hist[i] += src->wait_hist[i];
+    dst->exec_hist[i] += src->exec_hist[i];
+  }
+}
+
+static void rpc_stats_merge(PMap(cstr_t) *total, Channel *channel)
+{
+  const char *name;
+  RpcMethodStats *stats;
+  map_foreach(channel->rpc.method_stats, name, stats, {
+    RpcMethodStats *sum = pmap_get(cstr_t)(total, name);
+    if (!sum) {
+      sum = xcalloc(1, sizeof(*sum));
+      pmap_put(cstr_t)(total, name, sum);
+    }
+    rpc_stats_add(sum, stats);
+  });
+}
+
+static Array rpc_stats_histogram(const uint64_t *hist)
+{
+  // Trailing empty buckets are omitted.
+  size_t size = RPC_STATS_BUCKETS;
+  while (size > 0 && hist[size - 1] == 0) {
+    size--;
+  }
+  Array rv = ARRAY_DICT_INIT;
+  for (size_t i = 0; i < size; i++) {
+    ADD(rv, INTEGER_OBJ((Integer)hist[i]));
+  }
+  return rv;
+}
+
+static Dictionary rpc_stats_to_dict(const RpcMethodStats *stats)
+{
+  Dictionary rv = ARRAY_DICT_INIT;
+  PUT(rv, "calls", INTEGER_OBJ((Integer)stats->calls));
+  PUT(rv, "errors", INTEGER_OBJ((Integer)stats->errors));
+  PUT(rv, "bytes_in", INTEGER_OBJ((Integer)stats->bytes_in));
+  PUT(rv, "bytes_out", INTEGER_OBJ((Integer)stats->bytes_out));
+  PUT(rv, "wait_total", INTEGER_OBJ((Integer)stats->wait_total));
+  PUT(rv, "wait_max", INTEGER_OBJ((Integer)stats->wait_max));
+  PUT(rv, "wait_hist", ARRAY_OBJ(rpc_stats_histogram(stats->wait_hist)));
+  PUT(rv, "exec_total", INTEGER_OBJ((Integer)stats->exec_total));
+  PUT(rv, "exec_max", INTEGER_OBJ((Integer)stats->exec_max));
+  PUT(rv, "exec_hist", ARRAY_OBJ(rpc_stats_histogram(stats->exec_hist)));
+  return rv;
+}
+
+static void rpc_stats_clear(Channel *channel)
+{
+  RpcMethodStats *stats;
+  map_foreach_value(channel->rpc.method_stats, stats, {
+    xfree(stats);
+  });
+  pmap_clear(cstr_t)(channel->rpc.method_stats);
+}
+
+/// Gets per-method request statistics.
+///
+/// @param id Channel id, or 0 to sum up the statistics of all RPC channels.
+/// @param reset Clear the statistics after reading them.
+/// @param[out] err Error details, if any
+/// @return Dictionary of method name to statistics.
+Dictionary rpc_method_stats(uint64_t id, bool reset, Error *err)
+{
+  PMap(cstr_t) total = MAP_INIT;
+  Channel *channel;
+
+  if (id) {
+    if (!(channel = find_rpc_channel(id))) {
+      api_set_error(err, kErrorTypeValidation, "Invalid channel: %" PRIu64, id);
+      return (Dictionary)ARRAY_DICT_INIT;
+    }
+  }
+
+  map_foreach_value(&channels, channel, {
+    if (!channel->is_rpc || (id && channel->id != id)) {
+      continue;
+    }
+    rpc_stats_merge(&total, channel);
+    if (reset) {
+      rpc_stats_clear(channel);
+    }
+  });
+
+  Dictionary rv = ARRAY_DICT_INIT;
+  const char *name;
+  RpcMethodStats *sum;
+  map_foreach(&total, name, sum, {
+    PUT(rv, name, DICTIONARY_OBJ(rpc_stats_to_dict(sum)));
+    xfree(sum);
+  });
+  pmap_destroy(cstr_t)(&total);
+  return rv;
+}
+
+/// Writes a packed "redraw" notification to a channel.
+///
+/// While the channel is congested the batch is dropped, and the UI gets a full
+/// refresh once the client has caught up.
+///
+/// @return false if the buffer was not written
 bool rpc_write_raw(uint64_t id, WBuffer *buffer)
 {
   Channel *channel = find_rpc_channel(id);
@@ -455,9 +768,98 @@ bool rpc_write_raw(uint64_t id, WBuffer *buffer)
     return false;
   }
 
+  if (rpc_congested(channel)) {
+    channel->rpc.flow.dropped_redraws++;
+    channel->rpc.flow.resync = true;
+    wstream_release_wbuffer(buffer);
+    return false;
+  }
+
   return channel_write(channel, buffer);
 }
 
+/// Whether notifications to `channel` should be dropped, as the client is not
+/// reading fast enough. See RpcFlow.
+static bool rpc_congested(Channel *channel)
+{
+  RpcFlow *flow = &channel->rpc.flow;
+  if (channel->streamtype == kChannelStreamInternal || !flow->high_watermark) {
+    return false;
+  }
+
+  if (!flow->congested && channel_instream(channel)->curmem >= flow->high_watermark) {
+    flow->congested = true;
+    flow->congestions++;
+    WLOG("RPC: ch %" PRIu64 ": client is not reading, dropping notifications",
+         channel->id);
+  }
+  return flow->congested;
+}
+
+static void rpc_write_cb(Stream *stream, void *data, int status)
+{
+  Channel *channel = data;
+  RpcFlow *flow = &channel->rpc.flow;
+  if (!flow->congested || stream->curmem > flow->low_watermark) {
+    return;
+  }
+
+  flow->congested = false;
+  if (flow->resync && !channel->rpc.closed) {
+    flow->resync = false;
+    channel_incref(channel);
+    multiqueue_put(main_loop.events, rpc_resync_event, 1, channel);
+  }
+}
+
+static void rpc_resync_event(void **argv)
+{
+  Channel *channel = argv[0];
+  if (!channel->rpc.closed) {
+    remote_ui_resync(channel->id);
+  }
+  channel_decref(channel);
+}
+
+/// Gets the flow control state of a channel, optionally changing its
+/// watermarks. See RpcFlow.
+///
+/// @param high New high watermark, or -1 to keep the current one
+/// @param low New low watermark, or -1 to keep the current one
+Dictionary rpc_flow(uint64_t id, Integer high, Integer low, Error *err)
+{
+  Dictionary rv = ARRAY_DICT_INIT;
+  Channel *channel = find_rpc_channel(id);
+  if (!channel) {
+    api_set_error(err, kErrorTypeValidation, "Invalid channel: %" PRIu64, id);
+    return rv;
+  }
+
+  RpcFlow *flow = &channel->rpc.flow;
+  size_t new_high = high >= 0 ? (size_t)high : flow->high_watermark;
+  size_t new_low = low >= 0 ? (size_t)low : flow->low_watermark;
+  if (new_low > new_high) {
+    api_set_error(err, kErrorTypeValidation, "'low' must not exceed 'high'");
+    return rv;
+  }
+  flow->high_watermark = new_high;
+  flow->low_watermark = new_low;
+
+  size_t queued = 0;
+  if (channel->streamtype != kChannelStreamInternal) {
+    queued = channel_instream(channel)->curmem;
+  }
+
+  PUT(rv, "high", INTEGER_OBJ((Integer)flow->high_watermark));
+  PUT(rv, "low", INTEGER_OBJ((Integer)flow->low_watermark));
+  PUT(rv, "queued", INTEGER_OBJ((Integer)queued));
+  PUT(rv, "congested", BOOLEAN_OBJ(flow->congested));
+  PUT(rv, "congestions", INTEGER_OBJ((Integer)flow->congestions));
+  PUT(rv, "dropped_events", INTEGER_OBJ((Integer)flow->dropped_events));
+  PUT(rv, "dropped_redraws", INTEGER_OBJ((Integer)flow->dropped_redraws));
+  return rv;
+}
+
 static bool channel_write(Channel *channel, WBuffer *buffer)
 {
   bool success;
@@ -574,7 +976,12 @@ static void broadcast_event(const char *name, Array args)
 
   for (size_t i = 0; i < kv_size(subscribed); i++) {
     Channel *c = kv_A(subscribed, i);
-    channel_write(c, buffer);
+    if (rpc_congested(c)) {
+      c->rpc.flow.dropped_events++;
+      wstream_release_wbuffer(buffer);
+    } else {
+      channel_write(c, buffer);
+    }
   }
 
 end:
@@ -637,7 +1044,10 @@ void rpc_free(Channel *channel)
   });
 
   pmap_destroy(cstr_t)(channel->rpc.subscribed_events);
+  rpc_stats_clear(channel);
+  pmap_destroy(cstr_t)(channel->rpc.method_stats);
   kv_destroy(channel->rpc.call_stack);
+  kv_destroy(channel->rpc.decode_buf);
   api_free_dictionary(channel->rpc.info);
 }
 
@@ -702,6 +1112,59 @@ static WBuffer *serialize_response(uint64_t channel_id, MsgpackRpcRequestHandler
   return rv;
 }
 
+/// Executes a nvim_call_atomic() request, packing each result into the
+/// response as soon as its call returned. The results array is packed with a
+/// fixed size header, which is filled in once the number of results is known.
+///
+/// @param[out] err Validation error of the request. If set, NULL is returned
+///             and the error response should be sent instead.
+static WBuffer *serialize_call_atomic(Channel *channel, RequestEvent *e, Error *err)
+{
+  msgpack_sbuffer sbuffer;
+  msgpack_sbuffer_init(&sbuffer);
+  msgpack_packer pac;
+  msgpack_packer_init(&pac, &sbuffer, msgpack_sbuffer_write);
+
+  msgpack_pack_array(&pac, 4);
+  msgpack_pack_int(&pac, 1);
+  msgpack_pack_uint32(&pac, e->request_id);
+  msgpack_pack_nil(&pac);  // error
+  msgpack_pack_array(&pac, 2);
+  size_t count_pos = sbuffer.size;
+  char array32[5] = { (char)0xdd, 0, 0, 0, 0 };
+  msgpack_sbuffer_write(&sbuffer, array32, sizeof array32);
+
+  Error nested_error = ERROR_INIT;
+  size_t count = call_atomic_packed(channel->id, e->args.items[0].data.array, &pac,
+                                    &nested_error, err);
+  if (ERROR_SET(err)) {
+    api_clear_error(&nested_error);
+    msgpack_sbuffer_destroy(&sbuffer);
+    return NULL;
+  }
+
+  uint32_t n = (uint32_t)count;
+  char *count_ptr = sbuffer.data + count_pos + 1;
+  count_ptr[0] = (char)(n >> 24);
+  count_ptr[1] = (char)(n >> 16);
+  count_ptr[2] = (char)(n >> 8);
+  count_ptr[3] = (char)n;
+
+  if (ERROR_SET(&nested_error)) {
+    msgpack_pack_array(&pac, 3);
+    msgpack_rpc_from_integer((Integer)count, &pac);
+    msgpack_rpc_from_integer(nested_error.type, &pac);
+    msgpack_rpc_from_string(cstr_as_string(nested_error.msg), &pac);
+  } else {
+    msgpack_pack_nil(&pac);
+  }
+  api_clear_error(&nested_error);
+
+  log_server_msg(channel->id, &sbuffer);
+  size_t size = sbuffer.size;
+  return wstream_new_buffer(msgpack_sbuffer_release(&sbuffer), size, 1, free);
+}
+
 void rpc_set_client_info(uint64_t id, Dictionary info)
 {
   Channel *chan = find_rpc_channel(id);
@@ -28,8 +28,49 @@ typedef struct {
   Array args;
   uint32_t request_id;
   Arena used_mem;
+  size_t bytes_in;  ///< size of the serialized request
+  uint64_t received;  ///< os_hrtime() when the request was received
 } RequestEvent;
 
+/// Number of buckets in the latency histograms of RpcMethodStats.
+/// Bucket 0 counts calls taking less than 1 us, bucket i (i > 0) counts calls
+/// taking [2^(i-1), 2^i) us. The last bucket also holds everything slower.
+#define RPC_STATS_BUCKETS 24
+
+/// Per-method request statistics of an RPC channel. See nvim__rpc_stats().
+typedef struct {
+  uint64_t calls;
+  uint64_t errors;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint64_t wait_total;  ///< ns spent in channel->events before execution
+  uint64_t wait_max;
+  uint64_t exec_total;  ///< ns spent executing the handler
+  uint64_t exec_max;
+  uint64_t wait_hist[RPC_STATS_BUCKETS];
+  uint64_t exec_hist[RPC_STATS_BUCKETS];
+} RpcMethodStats;
+
+/// Default watermarks of RpcFlow, in bytes queued for writing.
+#define RPC_FLOW_HIGH_WATERMARK (16 * 1024 * 1024)
+#define RPC_FLOW_LOW_WATERMARK (1024 * 1024)
+
+/// Flow control of the notifications Nvim sends on its own accord. When more
+/// than `high_watermark` bytes are waiting to be written to the client, the
+/// channel is congested: "redraw" batches and subscribed events are dropped
+/// until the client has read enough to bring the queue below `low_watermark`.
+/// Dropped redraw batches are replaced by a full refresh of the UI.
+/// See nvim__rpc_flow().
+typedef struct {
+  size_t high_watermark;  ///< 0 disables flow control
+  size_t low_watermark;
+  bool congested;
+  bool resync;  ///< redraw events were dropped, the UI must be refreshed
+  uint64_t congestions;  ///< number of times the channel became congested
+  uint64_t dropped_events;
+  uint64_t dropped_redraws;
+} RpcFlow;
+
 typedef struct {
   PMap(cstr_t) subscribed_events[1];
   bool closed;
@@ -37,6 +78,16 @@ typedef struct {
   uint32_t next_request_id;
   kvec_t(ChannelCallFrame *) call_stack;
   Dictionary info;
+  PMap(cstr_t) method_stats[1];  ///< method name -> RpcMethodStats
+  size_t msg_bytes;  ///< bytes consumed by the message being unpacked
+  RpcFlow flow;
+
+  // Decoding of large messages off the main thread
+  uv_work_t decode_work;
+  kvec_t(char) decode_buf;  ///< data not yet consumed by the unpacker
+  bool decoding;  ///< decode_work is queued, don't touch the unpacker
+  bool decode_done;  ///< decode_work completed a message
+  bool decode_eof;  ///< EOF was received while decoding
 } RpcState;
 
 #endif  // NVIM_MSGPACK_RPC_CHANNEL_DEFS_H
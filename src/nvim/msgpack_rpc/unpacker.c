@@ -9,7 +9,9 @@
 #include "mpack/conv.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/ascii.h"
+#include "nvim/grid.h"
 #include "nvim/macros.h"
+#include "nvim/mbyte.h"
 #include "nvim/memory.h"
 #include "nvim/msgpack_rpc/channel_defs.h"
 #include "nvim/msgpack_rpc/helpers.h"
@@ -301,6 +303,8 @@ error:
 // <0>[2, "redraw", <10>[{11}["grid_line", <14>[g, r, c, [<15>[cell], <15>[cell], ...]], ...], <11>[...], ...]]
 //
 // where [cell] is [char, repeat, attr], where 'repeat' and 'attr' is optional
+//
+// "grid_line_runs" is decoded a whole event at a time, in state 16.
 
 bool unpacker_advance(Unpacker *p)
 {
@@ -323,7 +327,7 @@ bool unpacker_advance(Unpacker *p)
       return false;
     }
 
-    if (p->state == 15) {
+    if (p->state == 15 || p->state == 16) {
       // grid_line event already unpacked
       goto done;
     } else {
@@ -359,9 +363,10 @@ done:
     return true;
   case 13:
   case 15:
+  case 16:
     p->ncalls--;
     if (p->ncalls > 0) {
-      p->state = (p->state == 15) ? 14 : 12;
+      p->state = (p->state == 15) ? 14 : (p->state == 16) ? 16 : 12;
     } else if (p->nevents > 0) {
       p->state = 11;
     } else {
@@ -422,7 +427,8 @@ redo:
     p->nevents--;
     p->read_ptr = data;
     p->read_size = size;
-    if (p->ui_handler.fn != ui_client_event_grid_line) {
+    if (p->ui_handler.fn != ui_client_event_grid_line
+        && p->ui_handler.fn != ui_client_event_grid_line_runs) {
       p->state = 12;
       if (p->grid_line_event) {
         arena_mem_free(arena_finish(&p->arena));
@@ -434,6 +440,10 @@ redo:
       p->arena = (Arena)ARENA_EMPTY;
       p->grid_line_event = arena_alloc(&p->arena, sizeof *p->grid_line_event, true);
       g = p->grid_line_event;
+      if (p->ui_handler.fn == ui_client_event_grid_line_runs) {
+        p->state = 16;
+        goto redo;
+      }
     }
     FALLTHROUGH;
 
@@ -496,13 +506,17 @@ redo:
     if (g->icell == g->ncells - 1 && cellsize == 1 && cellbuf[0] == ' ' && repeat > 1) {
       g->clear_width = repeat;
     } else {
+      if (cellsize >= MAX_SCHAR_SIZE) {
+        p->state = -1;
+        return false;
+      }
+      schar_T sc = schar_from_buf(cellbuf, cellsize);
       for (int r = 0; r < repeat; r++) {
         if (g->coloff >= (int)grid_line_buf_size) {
           p->state = -1;
           return false;
         }
-        memcpy(grid_line_buf_char[g->coloff], cellbuf, cellsize);
-        grid_line_buf_char[g->coloff][cellsize] = NUL;
+        grid_line_buf_char[g->coloff] = sc;
         grid_line_buf_attr[g->coloff++] = g->cur_attr;
       }
     }
@@ -520,6 +534,72 @@ redo:
     p->read_size = size;
     goto redo;
 
+  case 16:
+    NEXT_TYPE(tok, MPACK_TOKEN_ARRAY);
+    if (tok.length != 6) {
+      p->state = -1;
+      return false;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      NEXT_TYPE(tok, MPACK_TOKEN_UINT);
+      g->args[i] = (int)tok.data.value.lo;
+    }
+
+    NEXT_TYPE(tok, MPACK_TOKEN_STR);
+    if (tok.length > size) {
+      return false;
+    }
+    if (!unpack_line_text(g, data, tok.length)) {
+      p->state = -1;
+      return false;
+    }
+    data += tok.length;
+    size -= tok.length;
+
+    NEXT_TYPE(tok, MPACK_TOKEN_ARRAY);
+    size_t nruns = tok.length;
+    if (nruns % 2 != 0) {
+      p->state = -1;
+      return false;
+    }
+    int pos = 0;
+    g->cur_attr = 0;
+    g->clear_width = 0;
+    for (size_t i = 0; i < nruns; i += 2) {
+      NEXT_TYPE(tok, MPACK_TOKEN_UINT);
+      int attr = (int)tok.data.value.lo;
+      NEXT_TYPE(tok, MPACK_TOKEN_UINT);
+      int count = (int)MIN(tok.data.value.lo, grid_line_buf_size);
+      while (count > 0 && pos < g->coloff) {
+        grid_line_buf_attr[pos++] = attr;
+        count--;
+      }
+      if (count > 0) {
+        // counted past the end of the text: clear the rest
+        if (g->clear_width > 0 && attr != g->cur_attr) {
+          p->state = -1;
+          return false;
+        }
+        g->cur_attr = attr;
+        g->clear_width += count;
+        if (g->coloff + g->clear_width > (int)grid_line_buf_size) {
+          p->state = -1;
+          return false;
+        }
+      }
+    }
+    if (pos < g->coloff) {
+      p->state = -1;
+      return false;
+    }
+
+    NEXT_TYPE(tok, MPACK_TOKEN_BOOLEAN);
+    g->wrap = mpack_unpack_boolean(tok);
+    p->read_ptr = data;
+    p->read_size = size;
+    return true;
+
   case 12:
     return true;
 
@@ -527,3 +607,50 @@ redo:
     abort();
   }
 }
+
+/// Decodes the text of a "grid_line_runs" event into grid_line_buf_char.
+/// See remote_ui_line_runs() for the format.
+static bool unpack_line_text(GridLineEvent *g, const char *text, size_t len)
+{
+  g->coloff = 0;
+  size_t i = 0;
+  while (i < len) {
+    int repeat = 1;
+    if (text[i] == 0x02) {
+      if (i + 2 >= len) {
+        return false;
+      }
+      repeat = (uint8_t)text[i + 1];
+      i += 2;
+    }
+
+    const char *cell = text + i;
+    size_t cellsize;
+    if (text[i] == NUL) {
+      cellsize = 0;
+      i++;
+    } else if (text[i] == 0x01) {
+      if (i + 1 >= len) {
+        return false;
+      }
+      cellsize = (uint8_t)text[i + 1];
+      cell += 2;
+      i += 2 + cellsize;
+      if (cellsize >= MAX_SCHAR_SIZE || i > len) {
+        return false;
+      }
+    } else {
+      cellsize = (size_t)utf_ptr2len_len(cell, (int)(len - i));
+      i += cellsize;
+    }
+
+    schar_T sc = schar_from_buf(cell, cellsize);
+    for (int r = 0; r < repeat; r++) {
+      if (g->coloff >= (int)grid_line_buf_size) {
+        return false;
+      }
+      grid_line_buf_char[g->coloff++] = sc;
+    }
+  }
+  return true;
+}
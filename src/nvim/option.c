@@ -82,6 +82,7 @@
 #include "nvim/os/lang.h"
 #include "nvim/os/os.h"
 #include "nvim/path.h"
+#include "nvim/plines.h"
 #include "nvim/popupmenu.h"
 #include "nvim/pos.h"
 #include "nvim/regexp.h"
@@ -2678,6 +2679,8 @@ static const char *set_num_option(int opt_idx, char *varp, long value, char *err
 /// Called after an option changed: check if something needs to be redrawn.
 void check_redraw_for(buf_T *buf, win_T *win, uint32_t flags)
 {
+  plines_options_changed();
+
   // Careful: P_RALL is a combination of other P_ flags
   bool all = (flags & P_RALL) == P_RALL;
 
@@ -7,9 +7,12 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/ascii.h"
+#include "nvim/buffer.h"
 #include "nvim/charset.h"
 #include "nvim/decoration.h"
 #include "nvim/diff.h"
@@ -29,6 +32,10 @@
 # include "plines.c.generated.h"
 #endif
 
+// Incremented when an option that may change the width of text is set, which
+// invalidates w_plines_cache of all windows.
+static unsigned plines_options_tick = 0;
+
 /// Functions calculating vertical size of text when displayed inside a window.
 /// Calls horizontal size functions defined below.
 
@@ -99,15 +106,13 @@ int plines_win_nofill(win_T *wp, linenr_T lnum, bool winheight)
 /// "wp".  Does not care about folding, 'wrap' or 'diff'.
 int plines_win_nofold(win_T *wp, linenr_T lnum)
 {
-  char *s;
   unsigned int col;
   int width;
 
-  s = ml_get_buf(wp->w_buffer, lnum, false);
-  if (*s == NUL) {  // empty line
+  col = plines_cache_width(wp, lnum);
+  if (col == 0) {  // empty line
     return 1;
   }
-  col = win_linetabsize(wp, lnum, s, MAXCOL);
 
   // If list mode is on, then the '$' at the end of the line may take up one
   // extra column.
@@ -151,6 +156,19 @@ int plines_win_col(win_T *wp, linenr_T lnum, long column)
   chartabsize_T cts;
 
   init_chartabsize_arg(&cts, wp, lnum, 0, line, line);
+  // In a long line start at the last checkpoint before "column".
+  if (column >= PLINES_CHECKPOINT_CHARS) {
+    plines_cache_T *pc = plines_cache_get(wp, lnum);
+    size_t k = (size_t)column / PLINES_CHECKPOINT_CHARS;
+    plines_cache_fill(wp, lnum, pc, line, MAXCOL, MAXCOL, k);
+    k = MIN(k, kv_size(pc->pc_checkpoints));
+    if (k > 0) {
+      plines_checkpoint_T cp = kv_A(pc->pc_checkpoints, k - 1);
+      cts.cts_ptr = line + cp.pcp_byte;
+      cts.cts_vcol = cp.pcp_vcol;
+      column -= (long)k * PLINES_CHECKPOINT_CHARS;
+    }
+  }
   while (*cts.cts_ptr != NUL && --column >= 0) {
     cts.cts_vcol += win_lbr_chartabsize(&cts, NULL);
     MB_PTR_ADV(cts.cts_ptr);
@@ -181,6 +199,156 @@ int plines_win_col(win_T *wp, linenr_T lnum, long column)
   return lines;
 }
 
+/// Get the cache entry of line "lnum" in window "wp", emptied when the buffer,
+/// the window width or an option changed since it was filled.  Options that
+/// are changed for a moment without setting them ('list', 'linebreak',
+/// 'showbreak', 'tabstop') are checked directly.
+static plines_cache_T *plines_cache_get(win_T *wp, linenr_T lnum)
+{
+  buf_T *buf = wp->w_buffer;
+  if (wp->w_plines_cache == NULL) {
+    wp->w_plines_cache = xcalloc(PLINES_CACHE_SIZE, sizeof(plines_cache_T));
+  }
+  plines_cache_T *pc = &wp->w_plines_cache[lnum % PLINES_CACHE_SIZE];
+  const int col_off = win_col_off(wp);
+  char *const sbr = get_showbreak_value(wp);
+  if (pc->pc_lnum != lnum
+      || pc->pc_fnum != buf->b_fnum
+      || pc->pc_changedtick != buf_get_changedtick(buf)
+      || pc->pc_options_tick != plines_options_tick
+      || pc->pc_width != wp->w_width_inner
+      || pc->pc_col_off != col_off
+      || pc->pc_list != wp->w_p_list
+      || pc->pc_lbr != wp->w_p_lbr
+      || pc->pc_lcs_tab != wp->w_p_lcs_chars.tab1
+      || pc->pc_ts != buf->b_p_ts
+      || pc->pc_sbr != sbr) {
+    pc->pc_lnum = lnum;
+    pc->pc_fnum = buf->b_fnum;
+    pc->pc_changedtick = buf_get_changedtick(buf);
+    pc->pc_options_tick = plines_options_tick;
+    pc->pc_width = wp->w_width_inner;
+    pc->pc_col_off = col_off;
+    pc->pc_list = wp->w_p_list;
+    pc->pc_lbr = wp->w_p_lbr;
+    pc->pc_lcs_tab = wp->w_p_lcs_chars.tab1;
+    pc->pc_ts = buf->b_p_ts;
+    pc->pc_sbr = sbr;
+    pc->pc_complete = false;
+    kv_size(pc->pc_checkpoints) = 0;
+  }
+  return pc;
+}
+
+/// Adds checkpoints to "pc" for line "lnum", the text of which is "line",
+/// until there are "want" of them or the last one is beyond byte "upto_byte"
+/// or virtual column "upto_vcol". When the end of the line is reached its
+/// width is stored.
+static void plines_cache_fill(win_T *wp, linenr_T lnum, plines_cache_T *pc, char *line,
+                              colnr_T upto_byte, colnr_T upto_vcol, size_t want)
+{
+  size_t n = kv_size(pc->pc_checkpoints);
+  if (pc->pc_complete
+      || n >= want
+      || (n > 0 && (kv_A(pc->pc_checkpoints, n - 1).pcp_byte >= upto_byte
+                    || kv_A(pc->pc_checkpoints, n - 1).pcp_vcol > upto_vcol))) {
+    return;
+  }
+
+  // Same as win_linetabsize(), remembering positions along the way.
+  chartabsize_T cts;
+  init_chartabsize_arg(&cts, wp, lnum, 0, line, line);
+  if (n > 0) {
+    cts.cts_ptr = line + kv_A(pc->pc_checkpoints, n - 1).pcp_byte;
+    cts.cts_vcol = kv_A(pc->pc_checkpoints, n - 1).pcp_vcol;
+  }
+  for (size_t i = n * PLINES_CHECKPOINT_CHARS; *cts.cts_ptr != NUL;
+       i++, MB_PTR_ADV(cts.cts_ptr)) {
+    if (i > 0 && i % PLINES_CHECKPOINT_CHARS == 0
+        && i / PLINES_CHECKPOINT_CHARS > kv_size(pc->pc_checkpoints)) {
+      colnr_T byte = (colnr_T)(cts.cts_ptr - line);
+      kv_push(pc->pc_checkpoints, ((plines_checkpoint_T) {
+        .pcp_byte = byte,
+        .pcp_vcol = cts.cts_vcol,
+      }));
+      if (kv_size(pc->pc_checkpoints) >= want || byte >= upto_byte
+          || cts.cts_vcol > upto_vcol) {
+        clear_chartabsize_arg(&cts);
+        return;
+      }
+    }
+    cts.cts_vcol += win_lbr_chartabsize(&cts, NULL);
+  }
+  clear_chartabsize_arg(&cts);
+  pc->pc_vcols = (unsigned)cts.cts_vcol;
+  pc->pc_complete = true;
+}
+
+/// Get the screen width of line "lnum" in window "wp", like win_linetabsize().
+static unsigned plines_cache_width(win_T *wp, linenr_T lnum)
+{
+  plines_cache_T *pc = plines_cache_get(wp, lnum);
+  if (!pc->pc_complete) {
+    char *line = ml_get_buf(wp->w_buffer, lnum, false);
+    plines_cache_fill(wp, lnum, pc, line, MAXCOL, MAXCOL, SIZE_MAX);
+  }
+  return pc->pc_vcols;
+}
+
+/// Find a position in a long line to start walking from, to get the virtual
+/// column of byte "byte" (when "by_vcol" is false) or the byte at virtual
+/// column "vcol" (when "by_vcol" is true).
+///
+/// @param line  text of line "lnum" in the buffer of window "wp".
+/// @param[out] cp_byte  byte offset of the position
+/// @param[out] cp_vcol  virtual column at the position
+///
+/// @return false when there is no position before the requested one.
+bool plines_checkpoint(win_T *wp, linenr_T lnum, char *line, bool by_vcol, colnr_T col,
+                       colnr_T *cp_byte, colnr_T *cp_vcol)
+{
+  plines_cache_T *pc = plines_cache_get(wp, lnum);
+  plines_cache_fill(wp, lnum, pc, line, by_vcol ? MAXCOL : col, by_vcol ? col : MAXCOL,
+                    SIZE_MAX);
+
+  // Binary search for the last checkpoint at or before "col".
+  size_t lo = 0;
+  size_t hi = kv_size(pc->pc_checkpoints);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    plines_checkpoint_T *cp = &kv_A(pc->pc_checkpoints, mid);
+    if ((by_vcol ? cp->pcp_vcol : cp->pcp_byte) <= col) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) {
+    return false;
+  }
+  *cp_byte = kv_A(pc->pc_checkpoints, lo - 1).pcp_byte;
+  *cp_vcol = kv_A(pc->pc_checkpoints, lo - 1).pcp_vcol;
+  return true;
+}
+
+/// Invalidates the cached screen widths of lines in all windows, after an
+/// option changed.
+void plines_options_changed(void)
+{
+  plines_options_tick++;
+}
+
+void plines_cache_free(win_T *wp)
+{
+  if (wp->w_plines_cache == NULL) {
+    return;
+  }
+  for (int i = 0; i < PLINES_CACHE_SIZE; i++) {
+    kv_destroy(wp->w_plines_cache[i].pc_checkpoints);
+  }
+  XFREE_CLEAR(wp->w_plines_cache);
+}
+
 /// Get the number of screen lines lnum takes up. This takes care of
 /// both folds and topfill, and limits to the current window height.
 ///
@@ -12,7 +12,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/arglist.h"
 #include "nvim/ascii.h"
 #include "nvim/autocmd.h"
@@ -25,6 +27,7 @@
 #include "nvim/eval/typval.h"
 #include "nvim/eval/typval_defs.h"
 #include "nvim/eval/window.h"
+#include "nvim/event/loop.h"
 #include "nvim/ex_cmds.h"
 #include "nvim/ex_cmds2.h"
 #include "nvim/ex_cmds_defs.h"
@@ -39,6 +42,7 @@
 #include "nvim/highlight_defs.h"
 #include "nvim/highlight_group.h"
 #include "nvim/macros.h"
+#include "nvim/main.h"
 #include "nvim/mark.h"
 #include "nvim/mbyte.h"
 #include "nvim/memfile_defs.h"
@@ -49,6 +53,7 @@
 #include "nvim/normal.h"
 #include "nvim/option.h"
 #include "nvim/optionstr.h"
+#include "nvim/os/fileio.h"
 #include "nvim/os/fs_defs.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
@@ -240,6 +245,47 @@ typedef struct vgr_args_S {
   char *qf_title;      ///< quickfix list title
 } vgr_args_T;
 
+/// Lines of a file read by vimgrep without loading it into a buffer.
+typedef struct {
+  char *text;            ///< file contents, each line NUL terminated
+  char **lines;          ///< start of each line in "text"
+  linenr_T count;        ///< number of lines
+  buf_T *kwbuf;          ///< buffer with the options of a dummy buffer, for
+                         ///< the 'iskeyword' used by "\k" and "\<"
+} vgr_lines_T;
+
+/// A match found by vimgrep, with the positions passed to qf_add_entry().
+typedef struct {
+  linenr_T lnum;
+  linenr_T end_lnum;
+  colnr_T col;
+  colnr_T end_col;
+} vgr_match_T;
+
+typedef kvec_t(vgr_match_T) vgr_matches_T;
+
+/// A file read and searched by vimgrep on a worker thread.  The main thread
+/// adds the matches to the quickfix list in the order of the files.
+typedef struct {
+  uv_work_t req;
+  bool started;          ///< the work was queued
+  bool done;             ///< the work is finished or was cancelled
+  bool read;             ///< the file could be read into "lines"
+  bool failed;           ///< the pattern could not be used on the thread,
+                         ///< "matches" is not complete
+  char *fname;
+  char *spat;
+  regmmatch_T regmatch;  ///< shares the program with the :vimgrep command
+  long tomatch;          ///< maximum number of matches
+  int flags;
+  vgr_lines_T lines;
+  vgr_matches_T matches;
+} vgr_job_T;
+
+/// Number of files read and searched ahead by worker threads.  Limits the
+/// memory used for files of which the matches were not added yet.
+#define VGR_JOBS 8
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "quickfix.c.generated.h"
 #endif
@@ -5204,106 +5250,372 @@ static bool vgr_qflist_valid(win_T *wp, qf_info_T *qi, unsigned qfid, char *titl
   return true;
 }
 
-/// Search for a pattern in all the lines in a buffer and add the matching lines
-/// to a quickfix list.
-static bool vgr_match_buflines(qf_list_T *qfl, char *fname, buf_T *buf, char *spat,
-                               regmmatch_T *regmatch, long *tomatch, int duplicate_name, int flags)
-  FUNC_ATTR_NONNULL_ARG(1, 3, 4, 5, 6)
+/// Check whether file "fname" can be searched by vimgrep without loading it
+/// into a buffer, which is much faster.
+///
+/// @return false when the file needs to be loaded into a buffer: autocommands
+///         would be triggered, or 'fileencodings' and 'fileformats' might make
+///         the buffer lines differ from the lines in the file.
+static bool vgr_can_read_file(char *fname)
+{
+  // The events triggered when loading and wiping out a dummy buffer.
+  static const event_T events[] = {
+    EVENT_BUFREADPRE, EVENT_BUFREADPOST, EVENT_BUFREADCMD, EVENT_SWAPEXISTS,
+    EVENT_BUFUNLOAD, EVENT_BUFDELETE, EVENT_BUFWIPEOUT,
+  };
+  // Filetype detection only sets 'filetype', and the FileType autocommands
+  // are not done for a dummy buffer.  EditorConfig only sets options.
+  const int ignore_groups[] = { augroup_find("filetypedetect"), augroup_find("editorconfig") };
+  for (size_t i = 0; i < ARRAY_SIZE(events); i++) {
+    if (has_event(events[i])
+        && has_autocmd_except(events[i], fname, NULL, ignore_groups, ARRAY_SIZE(ignore_groups))) {
+      return false;
+    }
+  }
+
+  // The file is used as it is when it is valid UTF-8 and UTF-8 is tried
+  // first, and there are no CR characters that could make it "dos" or
+  // "mac" format.
+  const char *fencs = p_fencs;
+  if (strncmp(fencs, "ucs-bom,", 8) == 0) {
+    fencs += 8;
+  }
+  return strncmp(fencs, "utf-8", 5) == 0 && (fencs[5] == NUL || fencs[5] == ',')
+         && *p_ffs != NUL;
+}
+
+/// Read file "fname" when vgr_can_read_file() returned true.  Can be used on a
+/// worker thread.
+///
+/// @return false when the file needs to be loaded into a buffer: it is not
+///         valid UTF-8 or has a BOM, CR or NUL bytes, or it can't be read.
+static bool vgr_read_file(const char *fname, vgr_lines_T *lines)
+  FUNC_ATTR_NONNULL_ALL
 {
-  bool found_match = false;
-  const size_t pat_len = strlen(spat);
-
-  for (linenr_T lnum = 1; lnum <= buf->b_ml.ml_line_count && *tomatch > 0; lnum++) {
-    colnr_T col = 0;
-    if (!(flags & VGR_FUZZY)) {
-      // Regular expression match
-      while (vim_regexec_multi(regmatch, curwin, buf, lnum, col, NULL, NULL) > 0) {
-        // Pass the buffer number so that it gets used even for a
-        // dummy buffer, unless duplicate_name is set, then the
-        // buffer will be wiped out below.
-        if (qf_add_entry(qfl,
-                         NULL,   // dir
-                         fname,
-                         NULL,
-                         duplicate_name ? 0 : buf->b_fnum,
-                         ml_get_buf(buf, regmatch->startpos[0].lnum + lnum, false),
-                         regmatch->startpos[0].lnum + lnum,
-                         regmatch->endpos[0].lnum + lnum,
-                         regmatch->startpos[0].col + 1,
-                         regmatch->endpos[0].col + 1,
-                         false,  // vis_col
-                         NULL,   // search pattern
-                         0,      // nr
-                         0,      // type
-                         true)   // valid
-            == QF_FAIL) {
-          got_int = true;
-          break;
-        }
-        found_match = true;
-        if (--*tomatch == 0) {
-          break;
-        }
-        if ((flags & VGR_GLOBAL) == 0 || regmatch->endpos[0].lnum > 0) {
-          break;
-        }
-        col = regmatch->endpos[0].col + (col == regmatch->endpos[0].col);
-        if (col > (colnr_T)strlen(ml_get_buf(buf, lnum, false))) {
-          break;
-        }
+  FileInfo file_info;
+  if (!os_fileinfo(fname, &file_info) || os_isdir(fname)) {
+    return false;
+  }
+  const uint64_t size = os_fileinfo_size(&file_info);
+  if (size > INT_MAX) {
+    return false;
+  }
+
+  char *text = xmallocz((size_t)size);
+  if (size > 0) {
+    FileDescriptor fp;
+    if (file_open(&fp, fname, kFileReadOnly, 0) != 0) {
+      xfree(text);
+      return false;
+    }
+    const ptrdiff_t n = file_read(&fp, text, (size_t)size);
+    file_close(&fp, false);
+    if (n != (ptrdiff_t)size) {
+      xfree(text);
+      return false;
+    }
+  }
+
+  const uint8_t *u = (uint8_t *)text;
+  if ((size >= 3 && u[0] == 0xef && u[1] == 0xbb && u[2] == 0xbf)
+      || (size >= 2 && ((u[0] == 0xfe && u[1] == 0xff) || (u[0] == 0xff && u[1] == 0xfe)))
+      || memchr(text, CAR, (size_t)size) != NULL
+      || memchr(text, NUL, (size_t)size) != NULL
+      || !utf_valid_string(text, text + size)) {
+    xfree(text);
+    return false;
+  }
+
+  // An empty file has one empty line, like an empty buffer.  A NL at the end
+  // of the last line doesn't start another one.
+  linenr_T count = 1;
+  for (char *p = text; (p = memchr(p, NL, (size_t)(text + size - p))) != NULL; p++) {
+    if (p + 1 < text + size) {
+      count++;
+    }
+  }
+  lines->text = text;
+  lines->lines = xmalloc((size_t)count * sizeof(char *));
+  lines->count = count;
+  char *p = text;
+  for (linenr_T i = 0; i < count; i++) {
+    lines->lines[i] = p;
+    p = xstrchrnul(p, NL);
+    *p++ = NUL;
+  }
+  return true;
+}
+
+/// Get line "lnum" of the file read by vgr_read_file().
+static char *vgr_getline(linenr_T lnum, void *data)
+{
+  return ((vgr_lines_T *)data)->lines[lnum - 1];
+}
+
+/// Get line "lnum" of buffer "buf", or of "lines" when "buf" is NULL.
+static char *vgr_get_line(buf_T *buf, vgr_lines_T *lines, linenr_T lnum)
+{
+  return buf != NULL ? ml_get_buf(buf, lnum, false) : vgr_getline(lnum, lines);
+}
+
+/// Find the matches for vimgrep that start in line "lnum" of buffer "buf", or
+/// of "lines" when "buf" is NULL, and append them to "matches".
+///
+/// @param work     NULL on the main thread, see vim_regexec_lines()
+/// @param tomatch  maximum number of matches, decremented for each match
+static void vgr_match_line(vgr_matches_T *matches, buf_T *buf, vgr_lines_T *lines,
+                           regwork_T *work, char *spat, regmmatch_T *regmatch, linenr_T lnum,
+                           long *tomatch, int flags)
+  FUNC_ATTR_NONNULL_ARG(1, 5, 6, 8)
+{
+  const linenr_T line_count = buf != NULL ? buf->b_ml.ml_line_count : lines->count;
+  colnr_T col = 0;
+  if (!(flags & VGR_FUZZY)) {
+    // Regular expression match
+    while ((buf != NULL
+            ? vim_regexec_multi(regmatch, curwin, buf, lnum, col, NULL, NULL)
+            : vim_regexec_lines(regmatch, lines->kwbuf, vgr_getline, lines, line_count,
+                                work, lnum, col, NULL, NULL)) > 0) {
+      kv_push(*matches, ((vgr_match_T){
+        .lnum = regmatch->startpos[0].lnum + lnum,
+        .end_lnum = regmatch->endpos[0].lnum + lnum,
+        .col = regmatch->startpos[0].col + 1,
+        .end_col = regmatch->endpos[0].col + 1,
+      }));
+      if (--*tomatch == 0) {
+        break;
       }
-    } else {
-      char *const str = ml_get_buf(buf, lnum, false);
-      int score;
-      uint32_t matches[MAX_FUZZY_MATCHES];
-      const size_t sz = sizeof(matches) / sizeof(matches[0]);
-
-      // Fuzzy string match
-      while (fuzzy_match(str + col, spat, false, &score, matches, (int)sz) > 0) {
-        // Pass the buffer number so that it gets used even for a
-        // dummy buffer, unless duplicate_name is set, then the
-        // buffer will be wiped out below.
-        if (qf_add_entry(qfl,
-                         NULL,   // dir
-                         fname,
-                         NULL,
-                         duplicate_name ? 0 : buf->b_fnum,
-                         str,
-                         lnum,
-                         0,
-                         (colnr_T)matches[0] + col + 1,
-                         0,
-                         false,  // vis_col
-                         NULL,   // search pattern
-                         0,      // nr
-                         0,      // type
-                         true)   // valid
-            == QF_FAIL) {
-          got_int = true;
-          break;
-        }
-        found_match = true;
-        if (--*tomatch == 0) {
-          break;
-        }
-        if ((flags & VGR_GLOBAL) == 0) {
-          break;
-        }
-        col = (colnr_T)matches[pat_len - 1] + col + 1;
-        if (col > (colnr_T)strlen(str)) {
-          break;
-        }
+      if ((flags & VGR_GLOBAL) == 0 || regmatch->endpos[0].lnum > 0) {
+        break;
+      }
+      col = regmatch->endpos[0].col + (col == regmatch->endpos[0].col);
+      if (col > (colnr_T)strlen(vgr_get_line(buf, lines, lnum))) {
+        break;
+      }
+    }
+  } else {
+    char *const str = vgr_get_line(buf, lines, lnum);
+    const size_t pat_len = strlen(spat);
+    int score;
+    uint32_t fuzzy_matches[MAX_FUZZY_MATCHES];
+    const size_t sz = sizeof(fuzzy_matches) / sizeof(fuzzy_matches[0]);
+
+    // Fuzzy string match
+    while (fuzzy_match(str + col, spat, false, &score, fuzzy_matches, (int)sz) > 0) {
+      kv_push(*matches, ((vgr_match_T){
+        .lnum = lnum,
+        .col = (colnr_T)fuzzy_matches[0] + col + 1,
+      }));
+      if (--*tomatch == 0) {
+        break;
+      }
+      if ((flags & VGR_GLOBAL) == 0) {
+        break;
+      }
+      col = (colnr_T)fuzzy_matches[pat_len - 1] + col + 1;
+      if (col > (colnr_T)strlen(str)) {
+        break;
       }
     }
+  }
+}
+
+/// Add the vimgrep matches "matches" in buffer "buf", or in "lines" when "buf"
+/// is NULL, to a quickfix list.
+///
+/// @return  false when adding failed, "got_int" is set then.
+static bool vgr_add_matches(qf_list_T *qfl, char *fname, int fnum, buf_T *buf,
+                            vgr_lines_T *lines, vgr_matches_T *matches)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 6)
+{
+  for (size_t i = 0; i < kv_size(*matches); i++) {
+    const vgr_match_T *const m = &kv_A(*matches, i);
+    if (qf_add_entry(qfl,
+                     NULL,   // dir
+                     fname,
+                     NULL,
+                     fnum,
+                     vgr_get_line(buf, lines, m->lnum),
+                     m->lnum,
+                     m->end_lnum,
+                     m->col,
+                     m->end_col,
+                     false,  // vis_col
+                     NULL,   // search pattern
+                     0,      // nr
+                     0,      // type
+                     true)   // valid
+        == QF_FAIL) {
+      got_int = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Search for a pattern in all the lines in a buffer, or in "lines" when "buf"
+/// is NULL, and add the matching lines to a quickfix list.
+static bool vgr_match_buflines(qf_list_T *qfl, char *fname, buf_T *buf, vgr_lines_T *lines,
+                               char *spat, regmmatch_T *regmatch, long *tomatch,
+                               int duplicate_name, int flags)
+  FUNC_ATTR_NONNULL_ARG(1, 5, 6, 7)
+{
+  bool found_match = false;
+  const linenr_T line_count = buf != NULL ? buf->b_ml.ml_line_count : lines->count;
+  // Pass the buffer number so that it gets used even for a dummy buffer,
+  // unless duplicate_name is set, then the buffer will be wiped out below.
+  const int fnum = duplicate_name || buf == NULL ? 0 : buf->b_fnum;
+  vgr_matches_T matches = KV_INITIAL_VALUE;
+
+  for (linenr_T lnum = 1; lnum <= line_count && *tomatch > 0; lnum++) {
+    kv_size(matches) = 0;
+    vgr_match_line(&matches, buf, lines, NULL, spat, regmatch, lnum, tomatch, flags);
+    if (!vgr_add_matches(qfl, fname, fnum, buf, lines, &matches)) {
+      break;
+    }
+    found_match |= kv_size(matches) > 0;
     line_breakcheck();
     if (got_int) {
       break;
     }
   }
 
+  kv_destroy(matches);
   return found_match;
 }
 
+/// Get the buffer for matching "\k" in files that are not loaded, with the
+/// 'iskeyword' a dummy buffer gets.  "*kwbuf" is set when it is created.
+static buf_T *vgr_get_kwbuf(buf_T **kwbuf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (*kwbuf == NULL) {
+    *kwbuf = buflist_new(NULL, NULL, (linenr_T)1, BLN_DUMMY);
+    if (*kwbuf != NULL) {
+      buf_copy_options(*kwbuf, BCO_ENTER | BCO_NOHELP);
+    }
+  }
+  return *kwbuf != NULL ? *kwbuf : curbuf;
+}
+
+/// Read and search the file of "job", on a worker thread.
+static void vgr_job_work_cb(uv_work_t *req)
+{
+  vgr_job_T *job = req->data;
+  if (!vgr_read_file(job->fname, &job->lines)) {
+    return;
+  }
+  job->read = true;
+
+  regwork_T *work = regwork_new(true);
+  for (linenr_T lnum = 1; lnum <= job->lines.count && job->tomatch > 0 && !got_int; lnum++) {
+    vgr_match_line(&job->matches, NULL, &job->lines, work, job->spat, &job->regmatch, lnum,
+                   &job->tomatch, job->flags);
+    if (regwork_failed(work)) {
+      job->failed = true;
+      break;
+    }
+  }
+  regwork_free(work);
+}
+
+static void vgr_job_done_cb(uv_work_t *req, int status)
+{
+  vgr_job_T *job = req->data;
+  job->done = true;
+}
+
+/// Start reading and searching file "fi" of the vimgrep arguments on a worker
+/// thread, unless it is loaded in a buffer or can't be read directly.
+static void vgr_job_start(vgr_job_T *job, vgr_args_T *cmd_args, int fi, buf_T **kwbuf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  char *fname = cmd_args->fnames[fi];
+  *job = (vgr_job_T){ .fname = fname };
+  if (buflist_findname_exp(fname) != NULL || !vgr_can_read_file(fname)) {
+    return;
+  }
+  job->started = true;
+  job->spat = cmd_args->spat;
+  // The main thread may replace the program of the command when the NFA
+  // engine gives up, keep this one alive.
+  job->regmatch = cmd_args->regmatch;
+  job->regmatch.regprog = vim_regref(cmd_args->regmatch.regprog);
+  job->tomatch = cmd_args->tomatch;
+  job->flags = cmd_args->flags;
+  job->lines.kwbuf = vgr_get_kwbuf(kwbuf);
+  job->req.data = job;
+  uv_queue_work(&main_loop.uv, &job->req, vgr_job_work_cb, vgr_job_done_cb);
+}
+
+/// Wait for the work of "job" to finish, if it was started.  Only uv callbacks
+/// and fast events are processed meanwhile, like os_breakcheck() does.
+static void vgr_job_wait(vgr_job_T *job)
+{
+  if (job->started) {
+    LOOP_PROCESS_EVENTS_UNTIL(&main_loop, NULL, -1, job->done);
+  }
+}
+
+/// Cancel the work of "job" if it is still queued, wait for it to finish and
+/// free its memory.
+static void vgr_job_finish(vgr_job_T *job)
+{
+  if (!job->started) {
+    return;
+  }
+  uv_cancel((uv_req_t *)&job->req);
+  vgr_job_wait(job);
+  if (job->read) {
+    xfree(job->lines.lines);
+    xfree(job->lines.text);
+  }
+  kv_destroy(job->matches);
+  vim_regfree(job->regmatch.regprog);
+  job->started = false;
+}
+
+/// Search file "fi" of the vimgrep arguments without loading it into a
+/// buffer, a buffer is only created for a quickfix entry.  Uses the matches
+/// found by "job" when it was started for the file.
+///
+/// @return  false when the file needs to be loaded into a buffer.
+static bool vgr_search_file(qf_list_T *qfl, vgr_args_T *cmd_args, int fi, char *fname,
+                            vgr_job_T *job, buf_T **kwbuf)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 4, 6)
+{
+  vgr_lines_T lines = { 0 };
+  vgr_lines_T *lp = &lines;
+  if (job != NULL && job->started) {
+    if (!job->read) {
+      return false;
+    }
+    if (!job->failed) {
+      // Add the matches found by the worker, up to the remaining count.
+      if (kv_size(job->matches) > (size_t)cmd_args->tomatch) {
+        kv_size(job->matches) = (size_t)cmd_args->tomatch;
+      }
+      cmd_args->tomatch -= (long)kv_size(job->matches);
+      vgr_add_matches(qfl, fname, 0, NULL, &job->lines, &job->matches);
+      return true;
+    }
+    // The pattern could not be used by the worker, search the lines here.
+    lp = &job->lines;
+  } else if (!vgr_read_file(cmd_args->fnames[fi], &lines)) {
+    return false;
+  } else {
+    lines.kwbuf = vgr_get_kwbuf(kwbuf);
+  }
+
+  vgr_match_buflines(qfl, fname, NULL, lp, cmd_args->spat, &cmd_args->regmatch,
+                     &cmd_args->tomatch, false, cmd_args->flags);
+  if (lp == &lines) {
+    xfree(lines.lines);
+    xfree(lines.text);
+  }
+  return true;
+}
+
 /// Jump to the first match and update the directory.
 static void vgr_jump_to_match(qf_info_T *qi, int forceit, bool *redraw_for_dummy,
                               buf_T *first_match_buf, char *target_dir)  // NOLINT(readability-non-const-parameter)
@@ -5400,6 +5712,20 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
   // ":lcd %:p:h" changes the meaning of short path names.
   os_dirname(dirname_start, MAXPATHL);
 
+  // Buffer for matching "\k" in files that are not loaded, see
+  // vgr_get_kwbuf().
+  buf_T *kwbuf = NULL;
+
+  // Files that don't need a buffer are read and searched by worker threads,
+  // up to VGR_JOBS files ahead.  The matches are added here, in the order of
+  // the files.  Patterns that use the cursor, marks, etc. can only be used
+  // on the main thread.
+  vgr_job_T *jobs = NULL;
+  int next_job = 0;
+  if (!re_position_dependent(cmd_args->regmatch.regprog)) {
+    jobs = xcalloc(VGR_JOBS, sizeof(vgr_job_T));
+  }
+
   time_t seconds = (time_t)0;
   for (int fi = 0; fi < cmd_args->fcount && !got_int && cmd_args->tomatch > 0; fi++) {
     char *fname = path_try_shorten_fname(cmd_args->fnames[fi]);
@@ -5410,8 +5736,27 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
       vgr_display_fname(fname);
     }
 
+    vgr_job_T *job = NULL;
+    if (jobs != NULL) {
+      for (; next_job < cmd_args->fcount && next_job < fi + VGR_JOBS; next_job++) {
+        vgr_job_start(&jobs[next_job % VGR_JOBS], cmd_args, next_job, &kwbuf);
+      }
+      job = &jobs[fi % VGR_JOBS];
+      vgr_job_wait(job);
+    }
+
     buf_T *buf = buflist_findname_exp(cmd_args->fnames[fi]);
     bool using_dummy;
+    // Check again, autocommands for a file loaded into a buffer may have
+    // changed things since the job was started.
+    bool searched = buf == NULL && vgr_can_read_file(cmd_args->fnames[fi])
+                    && vgr_search_file(qf_get_curlist(qi), cmd_args, fi, fname, job, &kwbuf);
+    if (job != NULL) {
+      vgr_job_finish(job);
+    }
+    if (searched) {
+      continue;
+    }
     if (buf == NULL || buf->b_ml.ml_mfp == NULL) {
       // Remember that a buffer with this name already exists.
       duplicate_name = (buf != NULL);
@@ -5441,6 +5786,7 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
       bool found_match = vgr_match_buflines(qf_get_curlist(qi),
                                             fname,
                                             buf,
+                                            NULL,
                                             cmd_args->spat,
                                             &cmd_args->regmatch,
                                             &cmd_args->tomatch,
@@ -5508,6 +5854,15 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
   status = OK;
 
 theend:
+  if (jobs != NULL) {
+    for (int i = 0; i < VGR_JOBS; i++) {
+      vgr_job_finish(&jobs[i]);
+    }
+    xfree(jobs);
+  }
+  if (kwbuf != NULL) {
+    wipe_buffer(kwbuf, false);
+  }
   xfree(dirname_now);
   xfree(dirname_start);
   return status;
@@ -27,6 +27,7 @@
 #include "nvim/globals.h"
 #include "nvim/keycodes.h"
 #include "nvim/macros.h"
+#include "nvim/map.h"
 #include "nvim/mark.h"
 #include "nvim/mbyte.h"
 #include "nvim/memline.h"
@@ -114,7 +115,6 @@ static const char e_z_not_allowed[] = N_("E66: \\z( not allowed here");
 static const char e_z1_not_allowed[] = N_("E67: \\z1 - \\z9 not allowed here");
 static const char e_missing_sb[] = N_("E69: Missing ] after %s%%[");
 static const char e_empty_sb[] = N_("E70: Empty %s%%[]");
-static const char e_recursive[] = N_("E956: Cannot use pattern recursively");
 static const char e_regexp_number_after_dot_pos_search_chr[]
   = N_("E1204: No Number allowed after .: '\\%%%c'");
 static const char e_nfa_regexp_missing_value_in_chr[]
@@ -305,6 +305,8 @@ static void init_class_tab(void)
 #define RF_HASNL    4   // can match a NL
 #define RF_ICOMBINE 8   // ignore combining characters
 #define RF_LOOKBH   16  // uses "\@<=" or "\@<!"
+#define RF_POSDEP   32  // uses the cursor, Visual area, marks, line numbers,
+                        // virtual columns or the start/end of the file
 
 // Global work variables for vim_regcomp().
 
@@ -315,6 +317,7 @@ static int regnzpar;            ///< \z() count.
 static int re_has_z;            ///< \z item detected
 static unsigned regflags;       ///< RF_ flags for prog
 static int had_eol;             ///< true when EOL found by vim_regcomp()
+static bool reg_nocache;        ///< program depends on the cursor, "~" or curbuf
 
 static magic_T reg_magic;       ///< magicness of the pattern
 
@@ -375,6 +378,27 @@ typedef struct {
 static regengine_T bt_regengine;
 static regengine_T nfa_regengine;
 
+/// Maximum number of programs kept in the cache of compiled patterns.
+#define REGPROG_CACHE_SIZE 100
+
+/// Entry in the cache of compiled patterns, see vim_regcomp().
+typedef struct regprog_cache_entry regprog_cache_entry_T;
+struct regprog_cache_entry {
+  char *key;                    ///< pattern with the flags it was compiled with
+  regprog_T *prog;              ///< holds one reference for the cache
+  bool had_eol;                 ///< value of vim_regcomp_had_eol()
+  regprog_cache_entry_T *prev;  ///< more recently used entry
+  regprog_cache_entry_T *next;  ///< less recently used entry
+};
+
+/// Cache of compiled patterns, most recently used first.
+static struct {
+  Map(cstr_t, ptr_t) entries;
+  regprog_cache_entry_T *first;
+  regprog_cache_entry_T *last;
+  int count;
+} regprog_cache = { MAP_INIT, NULL, NULL, 0 };
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "regexp.c.generated.h"
 #endif
@@ -386,6 +410,23 @@ int re_multiline(const regprog_T *prog)
   return prog->regflags & RF_HASNL;
 }
 
+/// Return true if where "prog" matches in a line only depends on the text of
+/// the line and buffer options, thus matches can be remembered until the line
+/// is changed.
+bool re_line_local(const regprog_T *prog)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return (prog->regflags & (RF_HASNL | RF_LOOKBH | RF_POSDEP)) == 0;
+}
+
+/// Return true if "prog" uses the cursor, the Visual area, marks or other
+/// positions, thus its matches may change without the text changing.
+bool re_position_dependent(const regprog_T *prog)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return prog->regflags & RF_POSDEP;
+}
+
 // Check for an equivalence class name "[=a=]".  "pp" points to the '['.
 // Returns a character representing the class. Zero means that no item was
 // recognized.  Otherwise "pp" is advanced to after the item.
@@ -933,15 +974,90 @@ static int read_limits(long *minval, long *maxval)
 
 // vim_regexec and friends
 
-// Global work variables for vim_regexec().
+// struct to save start/end pointer/position in for \(\)
+typedef struct {
+  union {
+    uint8_t *ptr;
+    lpos_T pos;
+  } se_u;
+} save_se_T;
+
+// Structure used to save the current input state, when it needs to be
+// restored after trying a match.  Used by reg_save() and reg_restore().
+// Also stores the length of "backpos".
+typedef struct {
+  union {
+    uint8_t *ptr;       // rex.input pointer, for single-line regexp
+    lpos_T pos;        // rex.input pos, for multi-line regexp
+  } rs_u;
+  int rs_len;
+} regsave_T;
+
+// Submatches found by the NFA engine.
+typedef struct {
+  int in_use;       ///< number of subexpr with useful info
+
+  // When REG_MULTI is true list.multi is used, otherwise list.line.
+  union {
+    struct multipos {
+      linenr_T start_lnum;
+      linenr_T end_lnum;
+      colnr_T start_col;
+      colnr_T end_col;
+    } multi[NSUBEXP];
+    struct linepos {
+      uint8_t *start;
+      uint8_t *end;
+    } line[NSUBEXP];
+  } list;
+  colnr_T orig_start_col;  // list.multi[0].start_col without \zs
+} regsub_T;
 
-// Sometimes need to save a copy of a line.  Since alloc()/free() is very
-// slow, we keep one allocated piece of memory and only re-allocate it when
-// it's too small.  It's freed in bt_regexec_both() when finished.
-static uint8_t *reg_tofree = NULL;
-static unsigned reg_tofreelen;
+typedef struct {
+  regsub_T norm;      // \( .. \) matches
+  regsub_T synt;      // \z( .. \) matches
+} regsubs_T;
+
+// Memory used while matching that is kept for the next match, so that it does
+// not need to be allocated every time.  Matches on the main thread use
+// "reg_work", unless it is in use.  Matching in another thread needs its own,
+// see regwork_new().
+struct regwork {
+  bool in_use;        ///< used by a match that is in progress
+  bool thread;        ///< used in another thread: don't give messages and
+                      ///< don't check for interrupts
+  bool failed;        ///< an error was found while "thread" is set
+
+  // Sometimes need to save a copy of a line.  Since alloc()/free() is very
+  // slow, we keep one allocated piece of memory and only re-allocate it when
+  // it's too small.  It's freed in bt_regexec_both() when finished.
+  uint8_t *tofree;
+  unsigned tofreelen;
+
+  // "regstack" and "backpos" are used by regmatch() of the backtracking
+  // engine, see there.
+  garray_T regstack;
+  garray_T backpos;
+
+  // "listid" each NFA state was last added with, for the first and a
+  // recursive call of nfa_regmatch().  "lastlist_len" entries are allocated.
+  int (*nfa_lastlist)[2];
+  int nfa_lastlist_len;
+
+  // DFA built lazily for an NFA program, by the "id" of the program.
+  Map(uint64_t, ptr_t) nfa_dfas;
+};
+
+static regwork_T reg_work = {
+  .regstack = GA_EMPTY_INIT_VALUE,
+  .backpos = GA_EMPTY_INIT_VALUE,
+  .nfa_dfas = MAP_INIT,
+};
 
-// Structure used to store the execution state of the regex engine.
+// Structure used to store the execution state of the regex engine.  Each call
+// of vim_regexec() and friends has its own, which is passed as "rex" to the
+// functions that need it, so that recursive use does not clobber it and
+// compiled programs are not changed while matching.
 // Which ones are set depends on whether a single-line or multi-line match is
 // done:
 //                      single-line             multi-line
@@ -956,7 +1072,10 @@ static unsigned reg_tofreelen;
 // reg_firstlnum        <invalid>               first line in which to search
 // reg_maxline          0                       last line nr
 // reg_line_lbr         false or true           false
-typedef struct {
+// reg_getline_fn       NULL                    NULL or line provider
+struct regexec {
+  regwork_T *work;  ///< memory kept between matches
+
   regmatch_T *reg_match;
   regmmatch_T *reg_mmatch;
 
@@ -971,6 +1090,12 @@ typedef struct {
   linenr_T reg_maxline;
   bool reg_line_lbr;  // "\n" in string is line break
 
+  // When not NULL lines are obtained with this instead of from "reg_buf",
+  // see vim_regexec_lines().
+  reg_getline_T reg_getline_fn;
+  void *reg_getline_data;
+  linenr_T reg_line_count;
+
   // The current match-position is remembered with these variables:
   linenr_T lnum;  ///< line number, relative to first line
   uint8_t *line;   ///< start of current line
@@ -1008,47 +1133,84 @@ typedef struct {
   int nfa_alt_listid;
 
   int nfa_has_zsubexpr;  ///< NFA regexp has \z( ), set zsubexpr.
-} regexec_T;
 
-static regexec_T rex;
-static bool rex_in_use = false;
+  int nfa_match;  ///< whether a match has been found
+  proftime_T *nfa_time_limit;
+  int *nfa_timed_out;
+  int nfa_time_count;
+  save_se_T *nfa_endp;  ///< if not NULL match must end at this position
+  int nfa_ll_index;  ///< 0 for first call to nfa_regmatch(), 1 for recursive call
+  int nfa_addstate_depth;  ///< recursion depth of addstate()
+  regsubs_T nfa_temp_subs;  ///< copy of submatches made by addstate()
+
+  // State for the backtracking engine regexec.
+  uint8_t *reg_startzp[NSUBEXP];  ///< Workspace to mark beginning
+  uint8_t *reg_endzp[NSUBEXP];    ///<   and end of \z(...\) matches
+  lpos_T reg_startzpos[NSUBEXP];  ///< idem, beginning pos
+  lpos_T reg_endzpos[NSUBEXP];    ///< idem, end pos
+  regsave_T behind_pos;           ///< where a look-behind match must end
+  long brace_min[10];             ///< Minimums for complex brace repeats
+  long brace_max[10];             ///< Maximums for complex brace repeats
+  int brace_count[10];            ///< Current counts for complex brace repeats
+  long bl_minval;                 ///< limits set by BRACE_LIMITS for the
+  long bl_maxval;                 ///< next BRACE_SIMPLE
+};
 
-static void reg_breakcheck(void)
+static void reg_breakcheck(regexec_T *rex)
 {
-  if (!rex.reg_nobreak) {
+  if (!rex->reg_nobreak && !rex->work->thread) {
     fast_breakcheck();
   }
 }
 
+/// Give error message "msg" found while matching, unless matching in another
+/// thread, then only remember there was an error.
+static void reg_emsg(regexec_T *rex, const char *msg)
+{
+  if (rex->work->thread) {
+    rex->work->failed = true;
+  } else {
+    emsg(msg);
+  }
+}
+
+/// Like reg_emsg() for an internal error.
+static void reg_iemsg(regexec_T *rex, const char *msg)
+{
+  if (rex->work->thread) {
+    rex->work->failed = true;
+  } else {
+    iemsg(msg);
+  }
+}
+
 // Return true if character 'c' is included in 'iskeyword' option for
 // "reg_buf" buffer.
-static bool reg_iswordc(int c)
+static bool reg_iswordc(regexec_T *rex, int c)
 {
-  return vim_iswordc_buf(c, rex.reg_buf);
+  return vim_iswordc_buf(c, rex->reg_buf);
 }
 
 // Get pointer to the line "lnum", which is relative to "reg_firstlnum".
-static char *reg_getline(linenr_T lnum)
+static char *reg_getline(regexec_T *rex, linenr_T lnum)
 {
   // when looking behind for a match/no-match lnum is negative.  But we
   // can't go before line 1
-  if (rex.reg_firstlnum + lnum < 1) {
+  if (rex->reg_firstlnum + lnum < 1) {
     return NULL;
   }
-  if (lnum > rex.reg_maxline) {
+  if (lnum > rex->reg_maxline) {
     // Must have matched the "\n" in the last line.
     return "";
   }
-  return ml_get_buf(rex.reg_buf, rex.reg_firstlnum + lnum, false);
+  if (rex->reg_getline_fn != NULL) {
+    return rex->reg_getline_fn(rex->reg_firstlnum + lnum, rex->reg_getline_data);
+  }
+  return ml_get_buf(rex->reg_buf, rex->reg_firstlnum + lnum, false);
 }
 
-static uint8_t *reg_startzp[NSUBEXP];  // Workspace to mark beginning
-static uint8_t *reg_endzp[NSUBEXP];    //   and end of \z(...\) matches
-static lpos_T reg_startzpos[NSUBEXP];   // idem, beginning pos
-static lpos_T reg_endzpos[NSUBEXP];     // idem, end pos
-
 // true if using multi-line regexp.
-#define REG_MULTI       (rex.reg_match == NULL)
+#define REG_MULTI       (rex->reg_match == NULL)
 
 // Create a new extmatch and mark it as referenced once.
 static reg_extmatch_T *make_extmatch(void)
@@ -1083,30 +1245,32 @@ void unref_extmatch(reg_extmatch_T *em)
 }
 
 // Get class of previous character.
-static int reg_prev_class(void)
+static int reg_prev_class(regexec_T *rex)
 {
-  if (rex.input > rex.line) {
-    return mb_get_class_tab((char *)rex.input - 1 -
-                            utf_head_off((char *)rex.line, (char *)rex.input - 1),
-                            rex.reg_buf->b_chartab);
+  if (rex->input > rex->line) {
+    return mb_get_class_tab((char *)rex->input - 1 -
+                            utf_head_off((char *)rex->line, (char *)rex->input - 1),
+                            rex->reg_buf->b_chartab);
   }
   return -1;
 }
 
 // Return true if the current rex.input position matches the Visual area.
-static bool reg_match_visual(void)
+static bool reg_match_visual(regexec_T *rex)
 {
   pos_T top, bot;
   linenr_T lnum;
   colnr_T col;
-  win_T *wp = rex.reg_win == NULL ? curwin : rex.reg_win;
+  win_T *wp = rex->reg_win == NULL ? curwin : rex->reg_win;
   int mode;
   colnr_T start, end;
   colnr_T start2, end2;
   colnr_T curswant;
 
-  // Check if the buffer is the current buffer and not using a string.
-  if (rex.reg_buf != curbuf || VIsual.lnum == 0 || !REG_MULTI) {
+  // Check if the buffer is the current buffer and not using a string or
+  // lines from a provider.
+  if (rex->reg_buf != curbuf || VIsual.lnum == 0 || !REG_MULTI
+      || rex->reg_getline_fn != NULL) {
     return false;
   }
 
@@ -1131,12 +1295,12 @@ static bool reg_match_visual(void)
     mode = curbuf->b_visual.vi_mode;
     curswant = curbuf->b_visual.vi_curswant;
   }
-  lnum = rex.lnum + rex.reg_firstlnum;
+  lnum = rex->lnum + rex->reg_firstlnum;
   if (lnum < top.lnum || lnum > bot.lnum) {
     return false;
   }
 
-  col = (colnr_T)(rex.input - rex.line);
+  col = (colnr_T)(rex->input - rex->line);
   if (mode == 'v') {
     if ((lnum == top.lnum && col < top.col)
         || (lnum == bot.lnum && col >= bot.col + (*p_sel != 'e'))) {
@@ -1155,11 +1319,12 @@ static bool reg_match_visual(void)
       end = MAXCOL;
     }
 
-    // getvvcol() flushes rex.line, need to get it again
-    rex.line = (uint8_t *)reg_getline(rex.lnum);
-    rex.input = rex.line + col;
+    // getvvcol() flushes rex->line, need to get it again
+    rex->line = (uint8_t *)reg_getline(rex, rex->lnum);
+    rex->input = rex->line + col;
 
-    unsigned int cols_u = win_linetabsize(wp, rex.reg_firstlnum + rex.lnum, (char *)rex.line, col);
+    unsigned int cols_u = win_linetabsize(wp, rex->reg_firstlnum + rex->lnum, (char *)rex->line,
+                                          col);
     assert(cols_u <= MAXCOL);
     colnr_T cols = (colnr_T)cols_u;
     if (cols < start || cols > end - (*p_sel == 'e')) {
@@ -1171,18 +1336,18 @@ static bool reg_match_visual(void)
 
 // Check the regexp program for its magic number.
 // Return true if it's wrong.
-static int prog_magic_wrong(void)
+static int prog_magic_wrong(regexec_T *rex)
 {
   regprog_T *prog;
 
-  prog = REG_MULTI ? rex.reg_mmatch->regprog : rex.reg_match->regprog;
+  prog = REG_MULTI ? rex->reg_mmatch->regprog : rex->reg_match->regprog;
   if (prog->engine == &nfa_regengine) {
     // For NFA matcher we don't check the magic
     return false;
   }
 
   if (UCHARAT(((bt_regprog_T *)prog)->program) != REGMAGIC) {
-    emsg(_(e_re_corr));
+    reg_emsg(rex, _(e_re_corr));
     return true;
   }
   return false;
@@ -1191,54 +1356,54 @@ static int prog_magic_wrong(void)
 // Cleanup the subexpressions, if this wasn't done yet.
 // This construction is used to clear the subexpressions only when they are
 // used (to increase speed).
-static void cleanup_subexpr(void)
+static void cleanup_subexpr(regexec_T *rex)
 {
-  if (!rex.need_clear_subexpr) {
+  if (!rex->need_clear_subexpr) {
     return;
   }
 
   if (REG_MULTI) {
     // Use 0xff to set lnum to -1
-    memset(rex.reg_startpos, 0xff, sizeof(lpos_T) * NSUBEXP);
-    memset(rex.reg_endpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_startpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_endpos, 0xff, sizeof(lpos_T) * NSUBEXP);
   } else {
-    memset(rex.reg_startp, 0, sizeof(char *) * NSUBEXP);
-    memset(rex.reg_endp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_startp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_endp, 0, sizeof(char *) * NSUBEXP);
   }
-  rex.need_clear_subexpr = false;
+  rex->need_clear_subexpr = false;
 }
 
-static void cleanup_zsubexpr(void)
+static void cleanup_zsubexpr(regexec_T *rex)
 {
-  if (!rex.need_clear_zsubexpr) {
+  if (!rex->need_clear_zsubexpr) {
     return;
   }
 
   if (REG_MULTI) {
     // Use 0xff to set lnum to -1
-    memset(reg_startzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
-    memset(reg_endzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_startzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_endzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
   } else {
-    memset(reg_startzp, 0, sizeof(char *) * NSUBEXP);
-    memset(reg_endzp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_startzp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_endzp, 0, sizeof(char *) * NSUBEXP);
   }
-  rex.need_clear_zsubexpr = false;
+  rex->need_clear_zsubexpr = false;
 }
 
 // Advance rex.lnum, rex.line and rex.input to the next line.
-static void reg_nextline(void)
+static void reg_nextline(regexec_T *rex)
 {
-  rex.line = (uint8_t *)reg_getline(++rex.lnum);
-  rex.input = rex.line;
-  reg_breakcheck();
+  rex->line = (uint8_t *)reg_getline(rex, ++rex->lnum);
+  rex->input = rex->line;
+  reg_breakcheck(rex);
 }
 
 // Check whether a backreference matches.
 // Returns RA_FAIL, RA_NOMATCH or RA_MATCH.
 // If "bytelen" is not NULL, it is set to the byte length of the match in the
 // last line.
-static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T end_lnum,
-                              colnr_T end_col, int *bytelen)
+static int match_with_backref(regexec_T *rex, linenr_T start_lnum, colnr_T start_col,
+                              linenr_T end_lnum, colnr_T end_col, int *bytelen)
 {
   linenr_T clnum = start_lnum;
   colnr_T ccol = start_col;
@@ -1251,21 +1416,22 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
   for (;;) {
     // Since getting one line may invalidate the other, need to make copy.
     // Slow!
-    if (rex.line != reg_tofree) {
-      len = (int)strlen((char *)rex.line);
-      if (reg_tofree == NULL || len >= (int)reg_tofreelen) {
+    regwork_T *const work = rex->work;
+    if (rex->line != work->tofree) {
+      len = (int)strlen((char *)rex->line);
+      if (work->tofree == NULL || len >= (int)work->tofreelen) {
         len += 50;              // get some extra
-        xfree(reg_tofree);
-        reg_tofree = xmalloc((size_t)len);
-        reg_tofreelen = (unsigned)len;
+        xfree(work->tofree);
+        work->tofree = xmalloc((size_t)len);
+        work->tofreelen = (unsigned)len;
       }
-      STRCPY(reg_tofree, rex.line);
-      rex.input = reg_tofree + (rex.input - rex.line);
-      rex.line = reg_tofree;
+      STRCPY(work->tofree, rex->line);
+      rex->input = work->tofree + (rex->input - rex->line);
+      rex->line = work->tofree;
     }
 
     // Get the line to compare with.
-    p = reg_getline(clnum);
+    p = reg_getline(rex, clnum);
     assert(p);
 
     if (clnum == end_lnum) {
@@ -1274,7 +1440,7 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
       len = (int)strlen(p + ccol);
     }
 
-    if (cstrncmp(p + ccol, (char *)rex.input, &len) != 0) {
+    if (cstrncmp(rex, p + ccol, (char *)rex->input, &len) != 0) {
       return RA_NOMATCH;  // doesn't match
     }
     if (bytelen != NULL) {
@@ -1283,12 +1449,12 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
     if (clnum == end_lnum) {
       break;  // match and at end!
     }
-    if (rex.lnum >= rex.reg_maxline) {
+    if (rex->lnum >= rex->reg_maxline) {
       return RA_NOMATCH;  // text too short
     }
 
     // Advance to next line.
-    reg_nextline();
+    reg_nextline(rex);
     if (bytelen != NULL) {
       *bytelen = 0;
     }
@@ -1299,7 +1465,7 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
     }
   }
 
-  // found a match!  Note that rex.line may now point to a copy of the line,
+  // found a match!  Note that rex->line may now point to a copy of the line,
   // that should not matter.
   return RA_MATCH;
 }
@@ -1389,11 +1555,11 @@ static void mb_decompose(int c, int *c1, int *c2, int *c3)
 /// Compare two strings, ignore case if rex.reg_ic set.
 /// Return 0 if strings match, non-zero otherwise.
 /// Correct the length "*n" when composing characters are ignored.
-static int cstrncmp(char *s1, char *s2, int *n)
+static int cstrncmp(regexec_T *rex, char *s1, char *s2, int *n)
 {
   int result;
 
-  if (!rex.reg_ic) {
+  if (!rex->reg_ic) {
     result = strncmp(s1, s2, (size_t)(*n));
   } else {
     assert(*n >= 0);
@@ -1401,7 +1567,7 @@ static int cstrncmp(char *s1, char *s2, int *n)
   }
 
   // if it failed and it's utf8 and we want to combineignore:
-  if (result != 0 && rex.reg_icombine) {
+  if (result != 0 && rex->reg_icombine) {
     char *str1, *str2;
     int c1, c2, c11, c12;
     int junk;
@@ -1418,13 +1584,13 @@ static int cstrncmp(char *s1, char *s2, int *n)
       // decompose the character if necessary, into 'base' characters
       // because I don't care about Arabic, I will hard-code the Hebrew
       // which I *do* care about!  So sue me...
-      if (c1 != c2 && (!rex.reg_ic || utf_fold(c1) != utf_fold(c2))) {
+      if (c1 != c2 && (!rex->reg_ic || utf_fold(c1) != utf_fold(c2))) {
         // decomposition necessary?
         mb_decompose(c1, &c11, &junk, &junk);
         mb_decompose(c2, &c12, &junk, &junk);
         c1 = c11;
         c2 = c12;
-        if (c11 != c12 && (!rex.reg_ic || utf_fold(c11) != utf_fold(c12))) {
+        if (c11 != c12 && (!rex->reg_ic || utf_fold(c11) != utf_fold(c12))) {
           break;
         }
       }
@@ -1447,11 +1613,11 @@ static int cstrncmp(char *s1, char *s2, int *n)
 /// @param  c  character to find in @a s
 ///
 /// @return  NULL if no match, otherwise pointer to the position in @a s
-static inline char *cstrchr(const char *const s, const int c)
+static inline char *cstrchr(regexec_T *rex, const char *const s, const int c)
   FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_ALL
   FUNC_ATTR_ALWAYS_INLINE
 {
-  if (!rex.reg_ic) {
+  if (!rex->reg_ic) {
     return vim_strchr(s, c);
   }
 
@@ -1585,6 +1751,7 @@ static bool can_f_submatch = false;  // true when submatch() can be used
 // substitution string is an expression that contains a call to substitute()
 // and submatch().
 typedef struct {
+  regexec_T *sm_rex;  ///< state of the vim_regsub() call, for reg_getline()
   regmatch_T *sm_match;
   regmmatch_T *sm_mmatch;
   linenr_T sm_firstlnum;
@@ -1651,56 +1818,28 @@ static void clear_submatch_list(staticList10_T *sl)
 /// Returns the size of the replacement, including terminating NUL.
 int vim_regsub(regmatch_T *rmp, char *source, typval_T *expr, char *dest, int destlen, int flags)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
-
-  rex.reg_match = rmp;
-  rex.reg_mmatch = NULL;
-  rex.reg_maxline = 0;
-  rex.reg_buf = curbuf;
-  rex.reg_line_lbr = true;
-  int result = vim_regsub_both(source, expr, dest, destlen, flags);
-
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
-
-  return result;
+  regexec_T rex = {
+    .reg_match = rmp,
+    .reg_mmatch = NULL,
+    .reg_maxline = 0,
+    .reg_buf = curbuf,
+    .reg_line_lbr = true,
+  };
+  return vim_regsub_both(&rex, source, expr, dest, destlen, flags);
 }
 
 int vim_regsub_multi(regmmatch_T *rmp, linenr_T lnum, char *source, char *dest, int destlen,
                      int flags)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
-
-  rex.reg_match = NULL;
-  rex.reg_mmatch = rmp;
-  rex.reg_buf = curbuf;  // always works on the current buffer!
-  rex.reg_firstlnum = lnum;
-  rex.reg_maxline = curbuf->b_ml.ml_line_count - lnum;
-  rex.reg_line_lbr = false;
-  int result = vim_regsub_both(source, NULL, dest, destlen, flags);
-
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
-
-  return result;
+  regexec_T rex = {
+    .reg_match = NULL,
+    .reg_mmatch = rmp,
+    .reg_buf = curbuf,  // always works on the current buffer!
+    .reg_firstlnum = lnum,
+    .reg_maxline = curbuf->b_ml.ml_line_count - lnum,
+    .reg_line_lbr = false,
+  };
+  return vim_regsub_both(&rex, source, NULL, dest, destlen, flags);
 }
 
 // When nesting more than a couple levels it's probably a mistake.
@@ -1716,7 +1855,8 @@ void free_resub_eval_result(void)
 }
 #endif
 
-static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen, int flags)
+static int vim_regsub_both(regexec_T *rex, char *source, typval_T *expr, char *dest, int destlen,
+                           int flags)
 {
   char *src;
   char *dst;
@@ -1736,7 +1876,7 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
     emsg(_(e_null));
     return 0;
   }
-  if (prog_magic_wrong()) {
+  if (prog_magic_wrong(rex)) {
     return 0;
   }
   if (nesting == MAX_REGSUB_NESTING) {
@@ -1773,11 +1913,12 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
         rsm_save = rsm;
       }
       can_f_submatch = true;
-      rsm.sm_match = rex.reg_match;
-      rsm.sm_mmatch = rex.reg_mmatch;
-      rsm.sm_firstlnum = rex.reg_firstlnum;
-      rsm.sm_maxline = rex.reg_maxline;
-      rsm.sm_line_lbr = rex.reg_line_lbr;
+      rsm.sm_rex = rex;
+      rsm.sm_match = rex->reg_match;
+      rsm.sm_mmatch = rex->reg_mmatch;
+      rsm.sm_firstlnum = rex->reg_firstlnum;
+      rsm.sm_maxline = rex->reg_maxline;
+      rsm.sm_line_lbr = rex->reg_line_lbr;
 
       // Although unlikely, it is possible that the expression invokes a
       // substitute command (it might fail, but still).  Therefore keep
@@ -1982,31 +2123,31 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
         dst++;
       } else {
         if (REG_MULTI) {
-          clnum = rex.reg_mmatch->startpos[no].lnum;
-          if (clnum < 0 || rex.reg_mmatch->endpos[no].lnum < 0) {
+          clnum = rex->reg_mmatch->startpos[no].lnum;
+          if (clnum < 0 || rex->reg_mmatch->endpos[no].lnum < 0) {
             s = NULL;
           } else {
-            s = reg_getline(clnum) + rex.reg_mmatch->startpos[no].col;
-            if (rex.reg_mmatch->endpos[no].lnum == clnum) {
-              len = rex.reg_mmatch->endpos[no].col
-                    - rex.reg_mmatch->startpos[no].col;
+            s = reg_getline(rex, clnum) + rex->reg_mmatch->startpos[no].col;
+            if (rex->reg_mmatch->endpos[no].lnum == clnum) {
+              len = rex->reg_mmatch->endpos[no].col
+                    - rex->reg_mmatch->startpos[no].col;
             } else {
               len = (int)strlen(s);
             }
           }
         } else {
-          s = rex.reg_match->startp[no];
-          if (rex.reg_match->endp[no] == NULL) {
+          s = rex->reg_match->startp[no];
+          if (rex->reg_match->endp[no] == NULL) {
             s = NULL;
           } else {
-            len = (int)(rex.reg_match->endp[no] - s);
+            len = (int)(rex->reg_match->endp[no] - s);
           }
         }
         if (s != NULL) {
           for (;;) {
             if (len == 0) {
               if (REG_MULTI) {
-                if (rex.reg_mmatch->endpos[no].lnum == clnum) {
+                if (rex->reg_mmatch->endpos[no].lnum == clnum) {
                   break;
                 }
                 if (copy) {
@@ -2017,9 +2158,9 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
                   *dst = CAR;
                 }
                 dst++;
-                s = reg_getline(++clnum);
-                if (rex.reg_mmatch->endpos[no].lnum == clnum) {
-                  len = rex.reg_mmatch->endpos[no].col;
+                s = reg_getline(rex, ++clnum);
+                if (rex->reg_mmatch->endpos[no].lnum == clnum) {
+                  len = rex->reg_mmatch->endpos[no].col;
                 } else {
                   len = (int)strlen(s);
                 }
@@ -2104,18 +2245,10 @@ exit:
 /// overwritten.
 static char *reg_getline_submatch(linenr_T lnum)
 {
-  char *s;
-  linenr_T save_first = rex.reg_firstlnum;
-  linenr_T save_max = rex.reg_maxline;
-
+  regexec_T rex = *rsm.sm_rex;
   rex.reg_firstlnum = rsm.sm_firstlnum;
   rex.reg_maxline = rsm.sm_maxline;
-
-  s = reg_getline(lnum);
-
-  rex.reg_firstlnum = save_first;
-  rex.reg_maxline = save_max;
-  return s;
+  return reg_getline(&rex, lnum);
 }
 
 /// Used for the submatch() function: get the string from the n'th submatch in
@@ -2263,19 +2396,21 @@ list_T *reg_submatch_list(int no)
 /// @param win   window in which to search or NULL
 /// @param buf   buffer in which to search
 /// @param lnum  nr of line to start looking for match
-static void init_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum)
-{
-  rex.reg_match = NULL;
-  rex.reg_mmatch = rmp;
-  rex.reg_buf = buf;
-  rex.reg_win = win;
-  rex.reg_firstlnum = lnum;
-  rex.reg_maxline = rex.reg_buf->b_ml.ml_line_count - lnum;
-  rex.reg_line_lbr = false;
-  rex.reg_ic = rmp->rmm_ic;
-  rex.reg_icombine = false;
-  rex.reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
-  rex.reg_maxcol = rmp->rmm_maxcol;
+static void init_regexec_multi(regexec_T *rex, regmmatch_T *rmp, win_T *win, buf_T *buf,
+                               linenr_T lnum)
+{
+  rex->reg_match = NULL;
+  rex->reg_mmatch = rmp;
+  rex->reg_buf = buf;
+  rex->reg_win = win;
+  rex->reg_firstlnum = lnum;
+  rex->reg_maxline = (rex->reg_getline_fn != NULL
+                     ? rex->reg_line_count : rex->reg_buf->b_ml.ml_line_count) - lnum;
+  rex->reg_line_lbr = false;
+  rex->reg_ic = rmp->rmm_ic;
+  rex->reg_icombine = false;
+  rex->reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
+  rex->reg_maxcol = rmp->rmm_maxcol;
 }
 
 // XXX Do not allow headers generator to catch definitions from regexp_nfa.c
@@ -2311,13 +2446,17 @@ static uint8_t regname[][30] = {
 #endif
 
 // Compile a regular expression into internal code.
-// Returns the program in allocated memory.
+// Returns the program in allocated memory.  Programs are shared through a
+// cache of recently compiled patterns, they must not be modified.  Only the
+// DFA that the NFA engine builds lazily is added to a program, it depends on
+// nothing but the program and 'ignorecase', and is rebuilt when that differs.
 // Use vim_regfree() to free the memory.
 // Returns NULL for an error.
 regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
 {
   regprog_T *prog = NULL;
   const char *expr = expr_arg;
+  const int called_emsg_start = called_emsg;
 
   regexp_engine = (int)p_re;
 
@@ -2344,13 +2483,27 @@ regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
   bt_regengine.expr = expr;
   nfa_regengine.expr = expr;
 #endif
-  // reg_iswordc() uses rex.reg_buf
-  rex.reg_buf = curbuf;
+  char *key = regprog_cache_key(expr_arg, re_flags);
+  regprog_cache_entry_T *entry = map_get(cstr_t, ptr_t)(&regprog_cache.entries, key);
+  if (entry != NULL) {
+    xfree(key);
+    regprog_cache_use(entry);
+    g_stats.regprog_cache_hit++;
+    had_eol = entry->had_eol;
+    regexp_engine = (int)entry->prog->re_engine;
+    entry->prog->re_refcount++;
+    return entry->prog;
+  }
+  g_stats.regprog_cache_miss++;
+  if (entry != NULL) {
+    XFREE_CLEAR(key);
+  }
 
   //
   // First try the NFA engine, unless backtracking was requested.
   //
   const int called_emsg_before = called_emsg;
+  reg_nocache = false;
   if (regexp_engine != BACKTRACKING_ENGINE) {
     prog = nfa_regengine.regcomp((uint8_t *)expr,
                                  re_flags + (regexp_engine == AUTOMATIC_ENGINE ? RE_AUTO : 0));
@@ -2389,15 +2542,118 @@ regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
     // to be very slow when executing it.
     prog->re_engine = (unsigned)regexp_engine;
     prog->re_flags = (unsigned)re_flags;
+    prog->re_refcount = 1;
+
+    // Only cache a program that compiled without any message and that does
+    // not depend on the cursor position, the previous substitute string or
+    // the current buffer.
+    if (key != NULL && called_emsg == called_emsg_start && !reg_nocache) {
+      regprog_cache_add(key, prog);
+      key = NULL;
+    }
   }
 
+  xfree(key);
+  return prog;
+}
+
+/// Get the key for the cache of compiled patterns: "expr" with everything
+/// else that affects compiling it.
+///
+/// @return  allocated key
+static char *regprog_cache_key(const char *expr, int re_flags)
+{
+  size_t len = strlen(expr) + 50;
+  char *key = xmalloc(len);
+  snprintf(key, len, "%d,%d,%d,%d:%s", (int)p_re, re_flags, reg_do_extmatch,
+           vim_strchr(p_cpo, CPO_LITERAL) != NULL, expr);
+  return key;
+}
+
+/// Make "entry" the most recently used one.
+static void regprog_cache_use(regprog_cache_entry_T *entry)
+{
+  if (entry == regprog_cache.first) {
+    return;
+  }
+  regprog_cache_unlink(entry);
+  entry->next = regprog_cache.first;
+  if (regprog_cache.first != NULL) {
+    regprog_cache.first->prev = entry;
+  }
+  regprog_cache.first = entry;
+  if (regprog_cache.last == NULL) {
+    regprog_cache.last = entry;
+  }
+}
+
+static void regprog_cache_unlink(regprog_cache_entry_T *entry)
+{
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
+  } else if (regprog_cache.first == entry) {
+    regprog_cache.first = entry->next;
+  }
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  } else if (regprog_cache.last == entry) {
+    regprog_cache.last = entry->prev;
+  }
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+/// Add "prog", compiled for "key", to the cache.  Takes over "key".
+/// When the cache is full the least recently used program is dropped.
+static void regprog_cache_add(char *key, regprog_T *prog)
+{
+  if (regprog_cache.count >= REGPROG_CACHE_SIZE) {
+    regprog_cache_remove(regprog_cache.last);
+  }
+
+  regprog_cache_entry_T *entry = xcalloc(1, sizeof(*entry));
+  entry->key = key;
+  entry->prog = prog;
+  entry->had_eol = had_eol;
+  prog->re_refcount++;
+  map_put(cstr_t, ptr_t)(&regprog_cache.entries, key, entry);
+  regprog_cache.count++;
+  regprog_cache_use(entry);
+}
+
+static void regprog_cache_remove(regprog_cache_entry_T *entry)
+{
+  regprog_cache_unlink(entry);
+  map_del(cstr_t, ptr_t)(&regprog_cache.entries, entry->key);
+  regprog_cache.count--;
+  vim_regfree(entry->prog);
+  xfree(entry->key);
+  xfree(entry);
+}
+
+/// Drop all programs from the cache of compiled patterns.  Needed when
+/// something changes that compiled programs depend on: the backtracking
+/// engine builds [[:ident:]], [[:fname:]] and [[:print:]] from the options.
+void regprog_cache_clear(void)
+{
+  while (regprog_cache.first != NULL) {
+    regprog_cache_remove(regprog_cache.first);
+  }
+}
+
+/// Get another reference to "prog", to be released with vim_regfree().
+regprog_T *vim_regref(regprog_T *prog)
+  FUNC_ATTR_NONNULL_ALL
+{
+  prog->re_refcount++;
   return prog;
 }
 
 // Free a compiled regexp program, returned by vim_regcomp().
+// A program that is also used elsewhere is only freed by the last call.
 void vim_regfree(regprog_T *prog)
 {
-  if (prog != NULL) {
+  if (prog != NULL && --prog->re_refcount <= 0) {
     prog->engine->regfree(prog);
   }
 }
@@ -2405,14 +2661,82 @@ void vim_regfree(regprog_T *prog)
 #if defined(EXITFREE)
 void free_regexp_stuff(void)
 {
-  ga_clear(&regstack);
-  ga_clear(&backpos);
-  xfree(reg_tofree);
+  regprog_cache_clear();
+  map_destroy(cstr_t, ptr_t)(&regprog_cache.entries);
+  regwork_clear(&reg_work);
   xfree(reg_prev_sub);
 }
 
 #endif
 
+/// Allocate memory for matching outside of the main thread.  Each thread
+/// needs its own, compiled programs can be shared.  With "thread" set no
+/// messages are given and interrupts are not checked, use regwork_failed()
+/// to find out whether matching failed.  Free with regwork_free().
+regwork_T *regwork_new(bool thread)
+{
+  regwork_T *work = xcalloc(1, sizeof(regwork_T));
+  *work = (regwork_T){
+    .thread = thread,
+    .regstack = GA_EMPTY_INIT_VALUE,
+    .backpos = GA_EMPTY_INIT_VALUE,
+    .nfa_dfas = MAP_INIT,
+  };
+  return work;
+}
+
+void regwork_free(regwork_T *work)
+{
+  if (work == NULL) {
+    return;
+  }
+  regwork_clear(work);
+  xfree(work);
+}
+
+/// @return  true when an error was found while matching with "work", or the
+///          pattern can't be used with it.  Then the match results can't be
+///          trusted, match again on the main thread to get the error message.
+bool regwork_failed(const regwork_T *work)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  return work->failed;
+}
+
+static void regwork_clear(regwork_T *work)
+{
+  ga_clear(&work->regstack);
+  ga_clear(&work->backpos);
+  XFREE_CLEAR(work->tofree);
+  work->tofreelen = 0;
+  XFREE_CLEAR(work->nfa_lastlist);
+  work->nfa_lastlist_len = 0;
+  nfa_dfa_T *dfa;
+  map_foreach_value(&work->nfa_dfas, dfa, {
+    nfa_dfa_free(dfa);
+  });
+  map_destroy(uint64_t, ptr_t)(&work->nfa_dfas);
+}
+
+/// Get the memory for a match on the main thread.  Usually "reg_work", but a
+/// pattern may be used while another match is in progress, e.g. from an
+/// expression evaluated for it.  Then separate memory is allocated.
+static regwork_T *regwork_acquire(void)
+{
+  regwork_T *work = reg_work.in_use ? regwork_new(false) : &reg_work;
+  work->in_use = true;
+  return work;
+}
+
+static void regwork_release(regwork_T *work)
+{
+  if (work == &reg_work) {
+    work->in_use = false;
+  } else {
+    regwork_free(work);
+  }
+}
+
 static void report_re_switch(const char *pat)
 {
   if (p_verbose > 0) {
@@ -2437,29 +2761,8 @@ static void report_re_switch(const char *pat)
 /// @return true if there is a match, false if not.
 static bool vim_regexec_string(regmatch_T *rmp, const char *line, colnr_T col, bool nl)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  // Cannot use the same prog recursively, it contains state.
-  if (rmp->regprog->re_in_use) {
-    emsg(_(e_recursive));
-    return false;
-  }
-  rmp->regprog->re_in_use = true;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
-
-  rex.reg_startp = NULL;
-  rex.reg_endp = NULL;
-  rex.reg_startpos = NULL;
-  rex.reg_endpos = NULL;
-
-  int result = rmp->regprog->engine->regexec_nl(rmp, (uint8_t *)line, col, nl);
-  rmp->regprog->re_in_use = false;
+  regexec_T rex = { .work = regwork_acquire() };
+  int result = rmp->regprog->engine->regexec_nl(&rex, rmp, (uint8_t *)line, col, nl);
 
   // NFA engine aborted because it's very slow, use backtracking engine instead.
   if (rmp->regprog->re_engine == AUTOMATIC_ENGINE
@@ -2469,24 +2772,27 @@ static bool vim_regexec_string(regmatch_T *rmp, const char *line, colnr_T col, b
     char *pat = xstrdup(((nfa_regprog_T *)rmp->regprog)->pattern);
 
     p_re = BACKTRACKING_ENGINE;
-    vim_regfree(rmp->regprog);
     report_re_switch(pat);
-    rmp->regprog = vim_regcomp(pat, re_flags);
-    if (rmp->regprog != NULL) {
-      rmp->regprog->re_in_use = true;
-      result = rmp->regprog->engine->regexec_nl(rmp, (uint8_t *)line, col, nl);
-      rmp->regprog->re_in_use = false;
+    regprog_T *prog = vim_regcomp(pat, re_flags);
+    if (prog != NULL) {
+      // When another match is in progress it may still be using the NFA
+      // program, only replace it for the outer match.
+      regprog_T *nfa_prog = rmp->regprog;
+      rmp->regprog = prog;
+      result = prog->engine->regexec_nl(&rex, rmp, (uint8_t *)line, col, nl);
+      if (rex.work == &reg_work) {
+        vim_regfree(nfa_prog);
+      } else {
+        rmp->regprog = nfa_prog;
+        vim_regfree(prog);
+      }
     }
 
     xfree(pat);
     p_re = save_p_re;
   }
 
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
-
+  regwork_release(rex.work);
   return result > 0;
 }
 
@@ -2533,24 +2839,49 @@ long vim_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum,
                        proftime_T *tm, int *timed_out)
   FUNC_ATTR_NONNULL_ARG(1)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
+  return regexec_multi(rmp, win, buf, NULL, NULL, 0, NULL, lnum, col, tm, timed_out);
+}
 
-  // Cannot use the same prog recursively, it contains state.
-  if (rmp->regprog->re_in_use) {
-    emsg(_(e_recursive));
-    return false;
-  }
-  rmp->regprog->re_in_use = true;
+/// Match a regexp against lines that are not in a buffer.
+/// Like vim_regexec_multi(), but lines are obtained by calling "get_line".
+/// "buf" is only used for options like 'iskeyword'.
+///
+/// @param get_line    called to get a line, with its one-based number and "data".
+///                    The text must remain valid until the next call.
+/// @param line_count  number of lines
+/// @param work        from regwork_new() when not called on the main thread,
+///                    otherwise NULL.  The pattern must not be position
+///                    dependent then, see re_position_dependent().  When the
+///                    NFA engine gives up regwork_failed() returns true.
+long vim_regexec_lines(regmmatch_T *rmp, buf_T *buf, reg_getline_T get_line, void *data,
+                       linenr_T line_count, regwork_T *work, linenr_T lnum, colnr_T col,
+                       proftime_T *tm, int *timed_out)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 3)
+{
+  return regexec_multi(rmp, NULL, buf, get_line, data, line_count, work, lnum, col, tm,
+                       timed_out);
+}
 
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
+static long regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, reg_getline_T get_line,
+                          void *data, linenr_T line_count, regwork_T *work, linenr_T lnum,
+                          colnr_T col, proftime_T *tm, int *timed_out)
+  FUNC_ATTR_NONNULL_ARG(1)
+{
+  regexec_T rex = {
+    .work = work != NULL ? work : regwork_acquire(),
+    .reg_getline_fn = get_line,
+    .reg_getline_data = data,
+    .reg_line_count = line_count,
+  };
+  long result = rmp->regprog->engine->regexec_multi(&rex, rmp, win, buf, lnum, col, tm, timed_out);
 
-  long result = rmp->regprog->engine->regexec_multi(rmp, win, buf, lnum, col, tm, timed_out);
-  rmp->regprog->re_in_use = false;
+  if (work != NULL && work->thread) {
+    // Can't compile another program here.
+    if (result == NFA_TOO_EXPENSIVE) {
+      work->failed = true;
+    }
+    return result <= 0 ? 0 : result;
+  }
 
   // NFA engine aborted because it's very slow, use backtracking engine instead.
   if (rmp->regprog->re_engine == AUTOMATIC_ENGINE
@@ -2574,21 +2905,24 @@ long vim_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum,
       // previous one to avoid "regprog" becoming NULL.
       rmp->regprog = prev_prog;
     } else {
-      vim_regfree(prev_prog);
-
-      rmp->regprog->re_in_use = true;
-      result = rmp->regprog->engine->regexec_multi(rmp, win, buf, lnum, col, tm, timed_out);
-      rmp->regprog->re_in_use = false;
+      regprog_T *prog = rmp->regprog;
+      result = prog->engine->regexec_multi(&rex, rmp, win, buf, lnum, col, tm, timed_out);
+      // When another match is in progress it may still be using the NFA
+      // program, only replace it for the outer match.
+      if (rex.work == &reg_work) {
+        vim_regfree(prev_prog);
+      } else {
+        rmp->regprog = prev_prog;
+        vim_regfree(prog);
+      }
     }
 
     xfree(pat);
     p_re = save_p_re;
   }
 
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
+  if (work == NULL) {
+    regwork_release(rex.work);
   }
-
   return result <= 0 ? 0 : result;
 }
@@ -246,9 +246,6 @@ static uint8_t *regcode;         ///< Code-emit pointer, or JUST_CALC_SIZE
 static long regsize;            ///< Code size.
 static int reg_toolong;         ///< true when offset out of range
 static uint8_t had_endbrace[NSUBEXP];  ///< flags, true if end of () found
-static long brace_min[10];        ///< Minimums for complex brace repeats
-static long brace_max[10];        ///< Maximums for complex brace repeats
-static int brace_count[10];       ///< Current counts for complex brace repeats
 static int one_exactly = false;   ///< only do one char for EXACTLY
 
 // When making changes to classchars also change nfa_classcodes.
@@ -285,25 +282,6 @@ typedef enum regstate_E {
   RS_STAR_SHORT,  // STAR/PLUS/BRACE_SIMPLE shortest match
 } regstate_T;
 
-// Structure used to save the current input state, when it needs to be
-// restored after trying a match.  Used by reg_save() and reg_restore().
-// Also stores the length of "backpos".
-typedef struct {
-  union {
-    uint8_t *ptr;       // rex.input pointer, for single-line regexp
-    lpos_T pos;        // rex.input pos, for multi-line regexp
-  } rs_u;
-  int rs_len;
-} regsave_T;
-
-// struct to save start/end pointer/position in for \(\)
-typedef struct {
-  union {
-    uint8_t *ptr;
-    lpos_T pos;
-  } se_u;
-} save_se_T;
-
 // used for BEHIND and NOBEHIND matching
 typedef struct regbehind_S {
   regsave_T save_after;
@@ -343,15 +321,11 @@ typedef struct backpos_S {
   regsave_T bp_pos;           // last input position
 } backpos_T;
 
-// "regstack" and "backpos" are used by regmatch().  They are kept over calls
-// to avoid invoking malloc() and free() often.
+// "regstack" and "backpos" in regwork_T are used by regmatch().  They are
+// kept over calls to avoid invoking malloc() and free() often.
 // "regstack" is a stack with regitem_T items, sometimes preceded by regstar_T
 // or regbehind_T.
 // "backpos_T" is a table with backpos_T for BACK
-static garray_T regstack = GA_EMPTY_INIT_VALUE;
-static garray_T backpos = GA_EMPTY_INIT_VALUE;
-
-static regsave_T behind_pos;
 
 // Both for regstack and backpos tables we use the following strategy of
 // allocation (to reduce malloc/free calls):
@@ -1807,6 +1781,7 @@ static uint8_t *regatom(int *flagp)
   // NOTREACHED
 
   case Magic('~'):              // previous substitute pattern
+    reg_nocache = true;
     if (reg_prev_sub != NULL) {
       uint8_t *lp;
 
@@ -1918,10 +1893,12 @@ static uint8_t *regatom(int *flagp)
     // pattern -- regardless of whether or not it makes sense.
     case '^':
       ret = regnode(RE_BOF);
+      regflags |= RF_POSDEP;
       break;
 
     case '$':
       ret = regnode(RE_EOF);
+      regflags |= RF_POSDEP;
       break;
 
     case '#':
@@ -1931,10 +1908,12 @@ static uint8_t *regatom(int *flagp)
         return FAIL;
       }
       ret = regnode(CURSOR);
+      regflags |= RF_POSDEP;
       break;
 
     case 'V':
       ret = regnode(RE_VISUAL);
+      regflags |= RF_POSDEP;
       break;
 
     case 'C':
@@ -2069,6 +2048,7 @@ static uint8_t *regatom(int *flagp)
           // "\%'m", "\%<'m" and "\%>'m": Mark
           c = getchr();
           ret = regnode(RE_MARK);
+          regflags |= RF_POSDEP;
           if (ret == JUST_CALC_SIZE) {
             regsize += 2;
           } else {
@@ -2082,6 +2062,13 @@ static uint8_t *regatom(int *flagp)
             rc_did_emsg = true;
             return NULL;
           }
+          // "\%23c" only depends on the text, "\%.c" on the cursor.
+          if (c != 'c' || cur) {
+            regflags |= RF_POSDEP;
+          }
+          if (cur) {
+            reg_nocache = true;
+          }
           if (c == 'l') {
             if (cur) {
               n = (uint32_t)curwin->w_cursor.lnum;
@@ -2352,8 +2339,9 @@ collection:
               }
               break;
             case CLASS_KEYWORD:
+              reg_nocache = true;
               for (cu = 1; cu <= 255; cu++) {
-                if (reg_iswordc(cu)) {
+                if (vim_iswordc(cu)) {
                   regmbc(cu);
                 }
               }
@@ -2863,7 +2851,6 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
 
   // Allocate space.
   bt_regprog_T *r = xmalloc(offsetof(bt_regprog_T, program) + (size_t)regsize);
-  r->re_in_use = false;
 
   // Second pass: emit code.
   regcomp_start(expr, re_flags);
@@ -2872,6 +2859,8 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
   if (reg(REG_NOPAREN, &flags) == NULL || reg_toolong) {
     xfree(r);
     if (reg_toolong) {
+      // Reset it here, regnext() also checks it when matching.
+      reg_toolong = false;
       EMSG_RET_NULL(_("E339: Pattern too long"));
     }
     return NULL;
@@ -2984,59 +2973,57 @@ static void bt_regfree(regprog_T *prog)
   xfree(prog);
 }
 
-#define ADVANCE_REGINPUT() MB_PTR_ADV(rex.input)
+#define ADVANCE_REGINPUT() MB_PTR_ADV(rex->input)
 
 // The arguments from BRACE_LIMITS are stored here.  They are actually local
 // to regmatch(), but they are here to reduce the amount of stack space used
 // (it can be called recursively many times).
-static long bl_minval;
-static long bl_maxval;
 
 // Save the input line and position in a regsave_T.
-static void reg_save(regsave_T *save, garray_T *gap)
+static void reg_save(regexec_T *rex, regsave_T *save, garray_T *gap)
   FUNC_ATTR_NONNULL_ALL
 {
   if (REG_MULTI) {
-    save->rs_u.pos.col = (colnr_T)(rex.input - rex.line);
-    save->rs_u.pos.lnum = rex.lnum;
+    save->rs_u.pos.col = (colnr_T)(rex->input - rex->line);
+    save->rs_u.pos.lnum = rex->lnum;
   } else {
-    save->rs_u.ptr = rex.input;
+    save->rs_u.ptr = rex->input;
   }
   save->rs_len = gap->ga_len;
 }
 
 // Restore the input line and position from a regsave_T.
-static void reg_restore(regsave_T *save, garray_T *gap)
+static void reg_restore(regexec_T *rex, regsave_T *save, garray_T *gap)
   FUNC_ATTR_NONNULL_ALL
 {
   if (REG_MULTI) {
-    if (rex.lnum != save->rs_u.pos.lnum) {
+    if (rex->lnum != save->rs_u.pos.lnum) {
       // only call reg_getline() when the line number changed to save
       // a bit of time
-      rex.lnum = save->rs_u.pos.lnum;
-      rex.line = (uint8_t *)reg_getline(rex.lnum);
+      rex->lnum = save->rs_u.pos.lnum;
+      rex->line = (uint8_t *)reg_getline(rex, rex->lnum);
     }
-    rex.input = rex.line + save->rs_u.pos.col;
+    rex->input = rex->line + save->rs_u.pos.col;
   } else {
-    rex.input = save->rs_u.ptr;
+    rex->input = save->rs_u.ptr;
   }
   gap->ga_len = save->rs_len;
 }
 
 // Return true if current position is equal to saved position.
-static bool reg_save_equal(const regsave_T *save)
+static bool reg_save_equal(regexec_T *rex, const regsave_T *save)
   FUNC_ATTR_NONNULL_ALL
 {
   if (REG_MULTI) {
-    return rex.lnum == save->rs_u.pos.lnum
-           && rex.input == rex.line + save->rs_u.pos.col;
+    return rex->lnum == save->rs_u.pos.lnum
+           && rex->input == rex->line + save->rs_u.pos.col;
   }
-  return rex.input == save->rs_u.ptr;
+  return rex->input == save->rs_u.ptr;
 }
 
 // Save the sub-expressions before attempting a match.
 #define save_se(savep, posp, pp) \
-  REG_MULTI ? save_se_multi((savep), (posp)) : save_se_one((savep), (pp))
+  REG_MULTI ? save_se_multi(rex, (savep), (posp)) : save_se_one(rex, (savep), (pp))
 
 // After a failed match restore the sub-expressions.
 #define restore_se(savep, posp, pp) { \
@@ -3050,31 +3037,31 @@ static bool reg_save_equal(const regsave_T *save)
 // values for when there is no match.
 // Use se_save() to use pointer (save_se_multi()) or position (save_se_one()),
 // depending on REG_MULTI.
-static void save_se_multi(save_se_T *savep, lpos_T *posp)
+static void save_se_multi(regexec_T *rex, save_se_T *savep, lpos_T *posp)
 {
   savep->se_u.pos = *posp;
-  posp->lnum = rex.lnum;
-  posp->col = (colnr_T)(rex.input - rex.line);
+  posp->lnum = rex->lnum;
+  posp->col = (colnr_T)(rex->input - rex->line);
 }
 
-static void save_se_one(save_se_T *savep, uint8_t **pp)
+static void save_se_one(regexec_T *rex, save_se_T *savep, uint8_t **pp)
 {
   savep->se_u.ptr = *pp;
-  *pp = rex.input;
+  *pp = rex->input;
 }
 
 /// regrepeat - repeatedly match something simple, return how many.
 /// Advances rex.input (and rex.lnum) to just after the matched chars.
 ///
 /// @param maxcount  maximum number of matches allowed
-static int regrepeat(uint8_t *p, long maxcount)
+static int regrepeat(regexec_T *rex, uint8_t *p, long maxcount)
 {
   long count = 0;
   uint8_t *opnd;
   int mask;
   int testval = 0;
 
-  uint8_t *scan = rex.input;  // Make local copy of rex.input for speed.
+  uint8_t *scan = rex->input;  // Make local copy of rex->input for speed.
   opnd = OPERAND(p);
   switch (OP(p)) {
   case ANY:
@@ -3086,13 +3073,13 @@ static int regrepeat(uint8_t *p, long maxcount)
         count++;
         MB_PTR_ADV(scan);
       }
-      if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-          || rex.reg_line_lbr || count == maxcount) {
+      if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+          || rex->reg_line_lbr || count == maxcount) {
         break;
       }
       count++;  // count the line-break
-      reg_nextline();
-      scan = rex.input;
+      reg_nextline(rex);
+      scan = rex->input;
       if (got_int) {
         break;
       }
@@ -3109,16 +3096,16 @@ static int regrepeat(uint8_t *p, long maxcount)
       if (vim_isIDc(utf_ptr2char((char *)scan)) && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
-        reg_nextline();
-        scan = rex.input;
+        reg_nextline(rex);
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -3134,20 +3121,20 @@ static int regrepeat(uint8_t *p, long maxcount)
   case SKWORD:
   case SKWORD + ADD_NL:
     while (count < maxcount) {
-      if (vim_iswordp_buf((char *)scan, rex.reg_buf)
+      if (vim_iswordp_buf((char *)scan, rex->reg_buf)
           && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
-        reg_nextline();
-        scan = rex.input;
+        reg_nextline(rex);
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -3166,16 +3153,16 @@ static int regrepeat(uint8_t *p, long maxcount)
       if (vim_isfilec(utf_ptr2char((char *)scan)) && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
-        reg_nextline();
-        scan = rex.input;
+        reg_nextline(rex);
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -3192,19 +3179,19 @@ static int regrepeat(uint8_t *p, long maxcount)
   case SPRINT + ADD_NL:
     while (count < maxcount) {
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
-        reg_nextline();
-        scan = rex.input;
+        reg_nextline(rex);
+        scan = rex->input;
         if (got_int) {
           break;
         }
       } else if (vim_isprintc(utf_ptr2char((char *)scan)) == 1
                  && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -3220,12 +3207,12 @@ do_class:
     while (count < maxcount) {
       int l;
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
-        reg_nextline();
-        scan = rex.input;
+        reg_nextline(rex);
+        scan = rex->input;
         if (got_int) {
           break;
         }
@@ -3236,7 +3223,7 @@ do_class:
         scan += l;
       } else if ((class_tab[*scan] & mask) == testval) {
         scan++;
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -3320,7 +3307,7 @@ do_class:
     // This doesn't do a multi-byte character, because a MULTIBYTECODE
     // would have been used for it.  It does handle single-byte
     // characters, such as latin1.
-    if (rex.reg_ic) {
+    if (rex->reg_ic) {
       cu = mb_toupper(*opnd);
       cl = mb_tolower(*opnd);
       while (count < maxcount && (*scan == cu || *scan == cl)) {
@@ -3343,7 +3330,7 @@ do_class:
     // Safety check (just in case 'encoding' was changed since
     // compiling the program).
     if ((len = utfc_ptr2len((char *)opnd)) > 1) {
-      if (rex.reg_ic) {
+      if (rex->reg_ic) {
         cf = utf_fold(utf_ptr2char((char *)opnd));
       }
       while (count < maxcount && utfc_ptr2len((char *)scan) >= len) {
@@ -3352,7 +3339,7 @@ do_class:
             break;
           }
         }
-        if (i < len && (!rex.reg_ic
+        if (i < len && (!rex->reg_ic
                         || utf_fold(utf_ptr2char((char *)scan)) != cf)) {
           break;
         }
@@ -3373,24 +3360,24 @@ do_class:
     while (count < maxcount) {
       int len;
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
-        reg_nextline();
-        scan = rex.input;
+        reg_nextline(rex);
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else if ((len = utfc_ptr2len((char *)scan)) > 1) {
-        if ((cstrchr((char *)opnd, utf_ptr2char((char *)scan)) == NULL) == testval) {
+        if ((cstrchr(rex, (char *)opnd, utf_ptr2char((char *)scan)) == NULL) == testval) {
           break;
         }
         scan += len;
       } else {
-        if ((cstrchr((char *)opnd, *scan) == NULL) == testval) {
+        if ((cstrchr(rex, (char *)opnd, *scan) == NULL) == testval) {
           break;
         }
         scan++;
@@ -3401,15 +3388,15 @@ do_class:
 
   case NEWL:
     while (count < maxcount
-           && ((*scan == NUL && rex.lnum <= rex.reg_maxline && !rex.reg_line_lbr
-                && REG_MULTI) || (*scan == '\n' && rex.reg_line_lbr))) {
+           && ((*scan == NUL && rex->lnum <= rex->reg_maxline && !rex->reg_line_lbr
+                && REG_MULTI) || (*scan == '\n' && rex->reg_line_lbr))) {
       count++;
-      if (rex.reg_line_lbr) {
+      if (rex->reg_line_lbr) {
         ADVANCE_REGINPUT();
       } else {
-        reg_nextline();
+        reg_nextline(rex);
       }
-      scan = rex.input;
+      scan = rex->input;
       if (got_int) {
         break;
       }
@@ -3417,89 +3404,91 @@ do_class:
     break;
 
   default:  // Oh dear.  Called inappropriately.
-    iemsg(_(e_re_corr));
+    reg_iemsg(rex, _(e_re_corr));
 #ifdef REGEXP_DEBUG
     printf("Called regrepeat with op code %d\n", OP(p));
 #endif
     break;
   }
 
-  rex.input = scan;
+  rex->input = scan;
 
   return (int)count;
 }
 
 // Push an item onto the regstack.
 // Returns pointer to new item.  Returns NULL when out of memory.
-static regitem_T *regstack_push(regstate_T state, uint8_t *scan)
+static regitem_T *regstack_push(regexec_T *rex, regstate_T state, uint8_t *scan)
+  FUNC_ATTR_NONNULL_ARG(1)
 {
   regitem_T *rp;
 
-  if ((long)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-    emsg(_(e_maxmempat));
+  if ((long)((unsigned)rex->work->regstack.ga_len >> 10) >= p_mmp) {
+    reg_emsg(rex, _(e_maxmempat));
     return NULL;
   }
-  ga_grow(&regstack, sizeof(regitem_T));
+  ga_grow(&rex->work->regstack, sizeof(regitem_T));
 
-  rp = (regitem_T *)((char *)regstack.ga_data + regstack.ga_len);
+  rp = (regitem_T *)((char *)rex->work->regstack.ga_data + rex->work->regstack.ga_len);
   rp->rs_state = state;
   rp->rs_scan = scan;
 
-  regstack.ga_len += (int)sizeof(regitem_T);
+  rex->work->regstack.ga_len += (int)sizeof(regitem_T);
   return rp;
 }
 
 // Pop an item from the regstack.
-static void regstack_pop(uint8_t **scan)
+static void regstack_pop(regexec_T *rex, uint8_t **scan)
+  FUNC_ATTR_NONNULL_ALL
 {
   regitem_T *rp;
 
-  rp = (regitem_T *)((char *)regstack.ga_data + regstack.ga_len) - 1;
+  rp = (regitem_T *)((char *)rex->work->regstack.ga_data + rex->work->regstack.ga_len) - 1;
   *scan = rp->rs_scan;
 
-  regstack.ga_len -= (int)sizeof(regitem_T);
+  rex->work->regstack.ga_len -= (int)sizeof(regitem_T);
 }
 
 // Save the current subexpr to "bp", so that they can be restored
 // later by restore_subexpr().
-static void save_subexpr(regbehind_T *bp)
+static void save_subexpr(regexec_T *rex, regbehind_T *bp)
   FUNC_ATTR_NONNULL_ALL
 {
-  // When "rex.need_clear_subexpr" is set we don't need to save the values, only
+  // When "rex->need_clear_subexpr" is set we don't need to save the values, only
   // remember that this flag needs to be set again when restoring.
-  bp->save_need_clear_subexpr = rex.need_clear_subexpr;
-  if (rex.need_clear_subexpr) {
+  bp->save_need_clear_subexpr = rex->need_clear_subexpr;
+  if (rex->need_clear_subexpr) {
     return;
   }
 
   for (int i = 0; i < NSUBEXP; i++) {
     if (REG_MULTI) {
-      bp->save_start[i].se_u.pos = rex.reg_startpos[i];
-      bp->save_end[i].se_u.pos = rex.reg_endpos[i];
+      bp->save_start[i].se_u.pos = rex->reg_startpos[i];
+      bp->save_end[i].se_u.pos = rex->reg_endpos[i];
     } else {
-      bp->save_start[i].se_u.ptr = rex.reg_startp[i];
-      bp->save_end[i].se_u.ptr = rex.reg_endp[i];
+      bp->save_start[i].se_u.ptr = rex->reg_startp[i];
+      bp->save_end[i].se_u.ptr = rex->reg_endp[i];
     }
   }
 }
 
 // Restore the subexpr from "bp".
-static void restore_subexpr(regbehind_T *bp)
+static void restore_subexpr(regexec_T *rex, regbehind_T *bp)
   FUNC_ATTR_NONNULL_ALL
 {
   // Only need to restore saved values when they are not to be cleared.
-  rex.need_clear_subexpr = bp->save_need_clear_subexpr;
-  if (rex.need_clear_subexpr) {
+  rex->need_clear_subexpr = bp->save_need_clear_subexpr;
+  if (rex->need_clear_subexpr) {
     return;
   }
 
   for (int i = 0; i < NSUBEXP; i++) {
     if (REG_MULTI) {
-      rex.reg_startpos[i] = bp->save_start[i].se_u.pos;
-      rex.reg_endpos[i] = bp->save_end[i].se_u.pos;
+      rex->reg_startpos[i] = bp->save_start[i].se_u.pos;
+      rex->reg_endpos[i] = bp->save_end[i].se_u.pos;
     } else {
-      rex.reg_startp[i] = bp->save_start[i].se_u.ptr;
-      rex.reg_endp[i] = bp->save_end[i].se_u.ptr;
+      rex->reg_startp[i] = bp->save_start[i].se_u.ptr;
+      rex->reg_endp[i] = bp->save_end[i].se_u.ptr;
     }
   }
 }
@@ -3520,7 +3509,7 @@ static void restore_subexpr(regbehind_T *bp)
 ///         just after the last matched character.
 ///         - false when there is no match.  Leaves rex.input and rex.lnum in an
 ///         undefined state!
-static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
+static bool regmatch(regexec_T *rex, uint8_t *scan, proftime_T *tm, int *timed_out)
 {
   uint8_t *next;          // Next node.
   int op;
@@ -3532,14 +3521,14 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
   // Make "regstack" and "backpos" empty.  They are allocated and freed in
   // bt_regexec_both() to reduce malloc()/free() calls.
-  regstack.ga_len = 0;
-  backpos.ga_len = 0;
+  rex->work->regstack.ga_len = 0;
+  rex->work->backpos.ga_len = 0;
 
   // Repeat until "regstack" is empty.
   for (;;) {
     // Some patterns may take a long time to match, e.g., "\([a-z]\+\)\+Q".
     // Allow interrupting them with CTRL-C.
-    reg_breakcheck();
+    reg_breakcheck(rex);
 
 #ifdef REGEXP_DEBUG
     if (scan != NULL && regnarrate) {
@@ -3590,19 +3579,19 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
       op = OP(scan);
       // Check for character class with NL added.
-      if (!rex.reg_line_lbr && WITH_NL(op) && REG_MULTI
-          && *rex.input == NUL && rex.lnum <= rex.reg_maxline) {
-        reg_nextline();
-      } else if (rex.reg_line_lbr && WITH_NL(op) && *rex.input == '\n') {
+      if (!rex->reg_line_lbr && WITH_NL(op) && REG_MULTI
+          && *rex->input == NUL && rex->lnum <= rex->reg_maxline) {
+        reg_nextline(rex);
+      } else if (rex->reg_line_lbr && WITH_NL(op) && *rex->input == '\n') {
         ADVANCE_REGINPUT();
       } else {
         if (WITH_NL(op)) {
           op -= ADD_NL;
         }
-        c = utf_ptr2char((char *)rex.input);
+        c = utf_ptr2char((char *)rex->input);
         switch (op) {
         case BOL:
-          if (rex.input != rex.line) {
+          if (rex->input != rex->line) {
             status = RA_NOMATCH;
           }
           break;
@@ -3617,25 +3606,25 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           // We're not at the beginning of the file when below the first
           // line where we started, not at the start of the line or we
           // didn't start at the first line of the buffer.
-          if (rex.lnum != 0 || rex.input != rex.line
-              || (REG_MULTI && rex.reg_firstlnum > 1)) {
+          if (rex->lnum != 0 || rex->input != rex->line
+              || (REG_MULTI && rex->reg_firstlnum > 1)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_EOF:
-          if (rex.lnum != rex.reg_maxline || c != NUL) {
+          if (rex->lnum != rex->reg_maxline || c != NUL) {
             status = RA_NOMATCH;
           }
           break;
 
         case CURSOR:
           // Check if the buffer is in a window and compare the
-          // rex.reg_win->w_cursor position to the match position.
-          if (rex.reg_win == NULL
-              || (rex.lnum + rex.reg_firstlnum != rex.reg_win->w_cursor.lnum)
-              || ((colnr_T)(rex.input - rex.line) !=
-                  rex.reg_win->w_cursor.col)) {
+          // rex->reg_win->w_cursor position to the match position.
+          if (rex->reg_win == NULL
+              || (rex->lnum + rex->reg_firstlnum != rex->reg_win->w_cursor.lnum)
+              || ((colnr_T)(rex->input - rex->line) !=
+                  rex->reg_win->w_cursor.col)) {
             status = RA_NOMATCH;
           }
           break;
@@ -3646,13 +3635,15 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           int mark = OPERAND(scan)[0];
           int cmp = OPERAND(scan)[1];
           pos_T *pos;
-          size_t col = REG_MULTI ? (size_t)(rex.input - rex.line) : 0;
-          fmark_T *fm = mark_get(rex.reg_buf, curwin, NULL, kMarkBufLocal, mark);
+          size_t col = REG_MULTI ? (size_t)(rex->input - rex->line) : 0;
+          // Lines from a provider have no marks.
+          fmark_T *fm = rex->reg_getline_fn != NULL
+                        ? NULL : mark_get(rex->reg_buf, curwin, NULL, kMarkBufLocal, mark);
 
           // Line may have been freed, get it again.
           if (REG_MULTI) {
-            rex.line = (uint8_t *)reg_getline(rex.lnum);
-            rex.input = rex.line + col;
+            rex->line = (uint8_t *)reg_getline(rex, rex->lnum);
+            rex->input = rex->line + col;
           }
 
           if (fm == NULL                    // mark doesn't exist
@@ -3660,18 +3651,18 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
             status = RA_NOMATCH;
           } else {
             pos = &fm->mark;
-            const colnr_T pos_col = pos->lnum == rex.lnum + rex.reg_firstlnum
+            const colnr_T pos_col = pos->lnum == rex->lnum + rex->reg_firstlnum
                                     && pos->col == MAXCOL
-              ? (colnr_T)strlen((char *)reg_getline(pos->lnum - rex.reg_firstlnum))
+              ? (colnr_T)strlen((char *)reg_getline(rex, pos->lnum - rex->reg_firstlnum))
               : pos->col;
 
-            if (pos->lnum == rex.lnum + rex.reg_firstlnum
-                ? (pos_col == (colnr_T)(rex.input - rex.line)
+            if (pos->lnum == rex->lnum + rex->reg_firstlnum
+                ? (pos_col == (colnr_T)(rex->input - rex->line)
                    ? (cmp == '<' || cmp == '>')
-                   : (pos_col < (colnr_T)(rex.input - rex.line)
+                   : (pos_col < (colnr_T)(rex->input - rex->line)
                       ? cmp != '>'
                       : cmp != '<'))
-                : (pos->lnum < rex.lnum + rex.reg_firstlnum
+                : (pos->lnum < rex->lnum + rex->reg_firstlnum
                    ? cmp != '>'
                    : cmp != '<')) {
               status = RA_NOMATCH;
@@ -3681,63 +3672,63 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         break;
 
         case RE_VISUAL:
-          if (!reg_match_visual()) {
+          if (!reg_match_visual(rex)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_LNUM:
-          assert(rex.lnum + rex.reg_firstlnum >= 0
-                 && (uintmax_t)(rex.lnum + rex.reg_firstlnum) <= UINT32_MAX);
+          assert(rex->lnum + rex->reg_firstlnum >= 0
+                 && (uintmax_t)(rex->lnum + rex->reg_firstlnum) <= UINT32_MAX);
           if (!REG_MULTI
-              || !re_num_cmp((uint32_t)(rex.lnum + rex.reg_firstlnum), scan)) {
+              || !re_num_cmp((uint32_t)(rex->lnum + rex->reg_firstlnum), scan)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_COL:
-          assert(rex.input - rex.line + 1 >= 0
-                 && (uintmax_t)(rex.input - rex.line + 1) <= UINT32_MAX);
-          if (!re_num_cmp((uint32_t)(rex.input - rex.line + 1), scan)) {
+          assert(rex->input - rex->line + 1 >= 0
+                 && (uintmax_t)(rex->input - rex->line + 1) <= UINT32_MAX);
+          if (!re_num_cmp((uint32_t)(rex->input - rex->line + 1), scan)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_VCOL:
-          if (!re_num_cmp(win_linetabsize(rex.reg_win == NULL
-                                          ? curwin : rex.reg_win,
-                                          rex.reg_firstlnum + rex.lnum,
-                                          (char *)rex.line,
-                                          (colnr_T)(rex.input - rex.line)) + 1,
+          if (!re_num_cmp(win_linetabsize(rex->reg_win == NULL
+                                          ? curwin : rex->reg_win,
+                                          rex->reg_firstlnum + rex->lnum,
+                                          (char *)rex->line,
+                                          (colnr_T)(rex->input - rex->line)) + 1,
                           scan)) {
             status = RA_NOMATCH;
           }
           break;
 
-        case BOW:  // \<word; rex.input points to w
+        case BOW:  // \<word; rex->input points to w
           if (c == NUL) {  // Can't match at end of line
             status = RA_NOMATCH;
           } else {
             // Get class of current and previous char (if it exists).
             const int this_class =
-              mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
+              mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
             if (this_class <= 1) {
               status = RA_NOMATCH;  // Not on a word at all.
-            } else if (reg_prev_class() == this_class) {
+            } else if (reg_prev_class(rex) == this_class) {
               status = RA_NOMATCH;  // Previous char is in same word.
             }
           }
           break;
 
-        case EOW:  // word\>; rex.input points after d
-          if (rex.input == rex.line) {  // Can't match at start of line
+        case EOW:  // word\>; rex->input points after d
+          if (rex->input == rex->line) {  // Can't match at start of line
             status = RA_NOMATCH;
           } else {
             int this_class, prev_class;
 
             // Get class of current and previous char (if it exists).
-            this_class = mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
-            prev_class = reg_prev_class();
+            this_class = mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
+            prev_class = reg_prev_class(rex);
             if (this_class == prev_class
                 || prev_class == 0 || prev_class == 1) {
               status = RA_NOMATCH;
@@ -3763,7 +3754,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         case SIDENT:
-          if (ascii_isdigit(*rex.input) || !vim_isIDc(c)) {
+          if (ascii_isdigit(*rex->input) || !vim_isIDc(c)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3771,7 +3762,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         case KWORD:
-          if (!vim_iswordp_buf((char *)rex.input, rex.reg_buf)) {
+          if (!vim_iswordp_buf((char *)rex->input, rex->reg_buf)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3779,8 +3770,8 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         case SKWORD:
-          if (ascii_isdigit(*rex.input)
-              || !vim_iswordp_buf((char *)rex.input, rex.reg_buf)) {
+          if (ascii_isdigit(*rex->input)
+              || !vim_iswordp_buf((char *)rex->input, rex->reg_buf)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3796,7 +3787,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         case SFNAME:
-          if (ascii_isdigit(*rex.input) || !vim_isfilec(c)) {
+          if (ascii_isdigit(*rex->input) || !vim_isfilec(c)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3804,7 +3795,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         case PRINT:
-          if (!vim_isprintc(utf_ptr2char((char *)rex.input))) {
+          if (!vim_isprintc(utf_ptr2char((char *)rex->input))) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3812,7 +3803,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         case SPRINT:
-          if (ascii_isdigit(*rex.input) || !vim_isprintc(utf_ptr2char((char *)rex.input))) {
+          if (ascii_isdigit(*rex->input) || !vim_isprintc(utf_ptr2char((char *)rex->input))) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -3969,27 +3960,27 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
           opnd = OPERAND(scan);
           // Inline the first byte, for speed.
-          if (*opnd != *rex.input
-              && (!rex.reg_ic)) {
+          if (*opnd != *rex->input
+              && (!rex->reg_ic)) {
             status = RA_NOMATCH;
           } else if (*opnd == NUL) {
             // match empty string always works; happens when "~" is
             // empty.
           } else {
-            if (opnd[1] == NUL && !rex.reg_ic) {
+            if (opnd[1] == NUL && !rex->reg_ic) {
               len = 1;  // matched a single byte above
             } else {
               // Need to match first byte again for multi-byte.
               len = (int)strlen((char *)opnd);
-              if (cstrncmp((char *)opnd, (char *)rex.input, &len) != 0) {
+              if (cstrncmp(rex, (char *)opnd, (char *)rex->input, &len) != 0) {
                 status = RA_NOMATCH;
               }
             }
             // Check for following composing character, unless %C
             // follows (skips over all composing chars).
             if (status != RA_NOMATCH
-                && utf_composinglike((char *)rex.input, (char *)rex.input + len)
-                && !rex.reg_icombine
+                && utf_composinglike((char *)rex->input, (char *)rex->input + len)
+                && !rex->reg_icombine
                 && OP(next) != RE_COMPOSING) {
               // raaron: This code makes a composing character get
               // ignored, which is the correct behavior (sometimes)
@@ -3997,7 +3988,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
               status = RA_NOMATCH;
             }
             if (status != RA_NOMATCH) {
-              rex.input += len;
+              rex->input += len;
             }
           }
         }
@@ -4007,7 +3998,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case ANYBUT:
           if (c == NUL) {
             status = RA_NOMATCH;
-          } else if ((cstrchr((char *)OPERAND(scan), c) == NULL) == (op == ANYOF)) {
+          } else if ((cstrchr(rex, (char *)OPERAND(scan), c) == NULL) == (op == ANYOF)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -4029,36 +4020,36 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
             // When only a composing char is given match at any
             // position where that composing char appears.
             status = RA_NOMATCH;
-            for (i = 0; rex.input[i] != NUL;
-                 i += utf_ptr2len((char *)rex.input + i)) {
-              const int inpc = utf_ptr2char((char *)rex.input + i);
+            for (i = 0; rex->input[i] != NUL;
+                 i += utf_ptr2len((char *)rex->input + i)) {
+              const int inpc = utf_ptr2char((char *)rex->input + i);
               if (!utf_iscomposing(inpc)) {
                 if (i > 0) {
                   break;
                 }
               } else if (opndc == inpc) {
                 // Include all following composing chars.
-                len = i + utfc_ptr2len((char *)rex.input + i);
+                len = i + utfc_ptr2len((char *)rex->input + i);
                 status = RA_MATCH;
                 break;
               }
             }
           } else {
             for (i = 0; i < len; i++) {
-              if (opnd[i] != rex.input[i]) {
+              if (opnd[i] != rex->input[i]) {
                 status = RA_NOMATCH;
                 break;
               }
             }
           }
-          rex.input += len;
+          rex->input += len;
         }
         break;
 
         case RE_COMPOSING:
           // Skip composing characters.
-          while (utf_iscomposing(utf_ptr2char((char *)rex.input))) {
-            MB_CPTR_ADV(rex.input);
+          while (utf_iscomposing(utf_ptr2char((char *)rex->input))) {
+            MB_CPTR_ADV(rex->input);
           }
           break;
 
@@ -4074,23 +4065,23 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           // at the same position as the previous time.
           // The positions are stored in "backpos" and found by the
           // current value of "scan", the position in the RE program.
-          backpos_T *bp = (backpos_T *)backpos.ga_data;
-          for (i = 0; i < backpos.ga_len; i++) {
+          backpos_T *bp = (backpos_T *)rex->work->backpos.ga_data;
+          for (i = 0; i < rex->work->backpos.ga_len; i++) {
             if (bp[i].bp_scan == scan) {
               break;
             }
           }
-          if (i == backpos.ga_len) {
-            backpos_T *p = GA_APPEND_VIA_PTR(backpos_T, &backpos);
+          if (i == rex->work->backpos.ga_len) {
+            backpos_T *p = GA_APPEND_VIA_PTR(backpos_T, &rex->work->backpos);
             p->bp_scan = scan;
-          } else if (reg_save_equal(&bp[i].bp_pos)) {
+          } else if (reg_save_equal(rex, &bp[i].bp_pos)) {
             // Still at same position as last time, fail.
             status = RA_NOMATCH;
           }
 
           assert(status != RA_FAIL);
           if (status != RA_NOMATCH) {
-            reg_save(&bp[i].bp_pos, &backpos);
+            reg_save(rex, &bp[i].bp_pos, &rex->work->backpos);
           }
         }
         break;
@@ -4106,21 +4097,21 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case MOPEN + 8:
         case MOPEN + 9:
           no = op - MOPEN;
-          cleanup_subexpr();
-          rp = regstack_push(RS_MOPEN, scan);
+          cleanup_subexpr(rex);
+          rp = regstack_push(rex, RS_MOPEN, scan);
           if (rp == NULL) {
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &rex.reg_startpos[no],
-                    &rex.reg_startp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_startpos[no],
+                    &rex->reg_startp[no]);
             // We simply continue and handle the result when done.
           }
           break;
 
         case NOPEN:         // \%(
         case NCLOSE:        // \) after \%(
-          if (regstack_push(RS_NOPEN, scan) == NULL) {
+          if (regstack_push(rex, RS_NOPEN, scan) == NULL) {
             status = RA_FAIL;
           }
           // We simply continue and handle the result when done.
@@ -4136,14 +4127,14 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case ZOPEN + 8:
         case ZOPEN + 9:
           no = op - ZOPEN;
-          cleanup_zsubexpr();
-          rp = regstack_push(RS_ZOPEN, scan);
+          cleanup_zsubexpr(rex);
+          rp = regstack_push(rex, RS_ZOPEN, scan);
           if (rp == NULL) {
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &reg_startzpos[no],
-                    &reg_startzp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_startzpos[no],
+                    &rex->reg_startzp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -4159,13 +4150,13 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case MCLOSE + 8:
         case MCLOSE + 9:
           no = op - MCLOSE;
-          cleanup_subexpr();
-          rp = regstack_push(RS_MCLOSE, scan);
+          cleanup_subexpr(rex);
+          rp = regstack_push(rex, RS_MCLOSE, scan);
           if (rp == NULL) {
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &rex.reg_endpos[no], &rex.reg_endp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_endpos[no], &rex->reg_endp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -4180,14 +4171,14 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case ZCLOSE + 8:
         case ZCLOSE + 9:
           no = op - ZCLOSE;
-          cleanup_zsubexpr();
-          rp = regstack_push(RS_ZCLOSE, scan);
+          cleanup_zsubexpr(rex);
+          rp = regstack_push(rex, RS_ZCLOSE, scan);
           if (rp == NULL) {
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &reg_endzpos[no],
-                    &reg_endzp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_endzpos[no],
+                    &rex->reg_endzp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -4204,37 +4195,37 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           int len;
 
           no = op - BACKREF;
-          cleanup_subexpr();
+          cleanup_subexpr(rex);
           if (!REG_MULTI) {  // Single-line regexp
-            if (rex.reg_startp[no] == NULL || rex.reg_endp[no] == NULL) {
+            if (rex->reg_startp[no] == NULL || rex->reg_endp[no] == NULL) {
               // Backref was not set: Match an empty string.
               len = 0;
             } else {
               // Compare current input with back-ref in the same line.
-              len = (int)(rex.reg_endp[no] - rex.reg_startp[no]);
-              if (cstrncmp((char *)rex.reg_startp[no], (char *)rex.input, &len) != 0) {
+              len = (int)(rex->reg_endp[no] - rex->reg_startp[no]);
+              if (cstrncmp(rex, (char *)rex->reg_startp[no], (char *)rex->input, &len) != 0) {
                 status = RA_NOMATCH;
               }
             }
           } else {  // Multi-line regexp
-            if (rex.reg_startpos[no].lnum < 0 || rex.reg_endpos[no].lnum < 0) {
+            if (rex->reg_startpos[no].lnum < 0 || rex->reg_endpos[no].lnum < 0) {
               // Backref was not set: Match an empty string.
               len = 0;
             } else {
-              if (rex.reg_startpos[no].lnum == rex.lnum
-                  && rex.reg_endpos[no].lnum == rex.lnum) {
+              if (rex->reg_startpos[no].lnum == rex->lnum
+                  && rex->reg_endpos[no].lnum == rex->lnum) {
                 // Compare back-ref within the current line.
-                len = rex.reg_endpos[no].col - rex.reg_startpos[no].col;
-                if (cstrncmp((char *)rex.line + rex.reg_startpos[no].col,
-                             (char *)rex.input, &len) != 0) {
+                len = rex->reg_endpos[no].col - rex->reg_startpos[no].col;
+                if (cstrncmp(rex, (char *)rex->line + rex->reg_startpos[no].col,
+                             (char *)rex->input, &len) != 0) {
                   status = RA_NOMATCH;
                 }
               } else {
                 // Messy situation: Need to compare between two lines.
-                int r = match_with_backref(rex.reg_startpos[no].lnum,
-                                           rex.reg_startpos[no].col,
-                                           rex.reg_endpos[no].lnum,
-                                           rex.reg_endpos[no].col,
+                int r = match_with_backref(rex, rex->reg_startpos[no].lnum,
+                                           rex->reg_startpos[no].col,
+                                           rex->reg_endpos[no].lnum,
+                                           rex->reg_endpos[no].col,
                                            &len);
                 if (r != RA_MATCH) {
                   status = r;
@@ -4244,7 +4235,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           }
 
           // Matched the backref, skip over it.
-          rex.input += len;
+          rex->input += len;
         }
         break;
 
@@ -4257,15 +4248,15 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case ZREF + 7:
         case ZREF + 8:
         case ZREF + 9:
-          cleanup_zsubexpr();
+          cleanup_zsubexpr(rex);
           no = op - ZREF;
           if (re_extmatch_in != NULL
               && re_extmatch_in->matches[no] != NULL) {
             int len = (int)strlen((char *)re_extmatch_in->matches[no]);
-            if (cstrncmp((char *)re_extmatch_in->matches[no], (char *)rex.input, &len) != 0) {
+            if (cstrncmp(rex, (char *)re_extmatch_in->matches[no], (char *)rex->input, &len) != 0) {
               status = RA_NOMATCH;
             } else {
-              rex.input += len;
+              rex->input += len;
             }
           } else {
             // Backref was not set: Match an empty string.
@@ -4276,7 +4267,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           if (OP(next) != BRANCH) {     // No choice.
             next = OPERAND(scan);               // Avoid recursion.
           } else {
-            rp = regstack_push(RS_BRANCH, scan);
+            rp = regstack_push(rex, RS_BRANCH, scan);
             if (rp == NULL) {
               status = RA_FAIL;
             } else {
@@ -4287,14 +4278,14 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
         case BRACE_LIMITS:
           if (OP(next) == BRACE_SIMPLE) {
-            bl_minval = OPERAND_MIN(scan);
-            bl_maxval = OPERAND_MAX(scan);
+            rex->bl_minval = OPERAND_MIN(scan);
+            rex->bl_maxval = OPERAND_MAX(scan);
           } else if (OP(next) >= BRACE_COMPLEX
                      && OP(next) < BRACE_COMPLEX + 10) {
             no = OP(next) - BRACE_COMPLEX;
-            brace_min[no] = OPERAND_MIN(scan);
-            brace_max[no] = OPERAND_MAX(scan);
-            brace_count[no] = 0;
+            rex->brace_min[no] = OPERAND_MIN(scan);
+            rex->brace_max[no] = OPERAND_MAX(scan);
+            rex->brace_count[no] = 0;
           } else {
             internal_error("BRACE_LIMITS");
             status = RA_FAIL;
@@ -4312,17 +4303,17 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case BRACE_COMPLEX + 8:
         case BRACE_COMPLEX + 9:
           no = op - BRACE_COMPLEX;
-          brace_count[no]++;
+          rex->brace_count[no]++;
 
           // If not matched enough times yet, try one more
-          if (brace_count[no] <= (brace_min[no] <= brace_max[no]
-                                  ? brace_min[no] : brace_max[no])) {
-            rp = regstack_push(RS_BRCPLX_MORE, scan);
+          if (rex->brace_count[no] <= (rex->brace_min[no] <= rex->brace_max[no]
+                                  ? rex->brace_min[no] : rex->brace_max[no])) {
+            rp = regstack_push(rex, RS_BRCPLX_MORE, scan);
             if (rp == NULL) {
               status = RA_FAIL;
             } else {
               rp->rs_no = (int16_t)no;
-              reg_save(&rp->rs_un.regsave, &backpos);
+              reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
               next = OPERAND(scan);
               // We continue and handle the result when done.
             }
@@ -4330,27 +4321,27 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           }
 
           // If matched enough times, may try matching some more
-          if (brace_min[no] <= brace_max[no]) {
+          if (rex->brace_min[no] <= rex->brace_max[no]) {
             // Range is the normal way around, use longest match
-            if (brace_count[no] <= brace_max[no]) {
-              rp = regstack_push(RS_BRCPLX_LONG, scan);
+            if (rex->brace_count[no] <= rex->brace_max[no]) {
+              rp = regstack_push(rex, RS_BRCPLX_LONG, scan);
               if (rp == NULL) {
                 status = RA_FAIL;
               } else {
                 rp->rs_no = (int16_t)no;
-                reg_save(&rp->rs_un.regsave, &backpos);
+                reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
                 next = OPERAND(scan);
                 // We continue and handle the result when done.
               }
             }
           } else {
             // Range is backwards, use shortest match first
-            if (brace_count[no] <= brace_min[no]) {
-              rp = regstack_push(RS_BRCPLX_SHORT, scan);
+            if (rex->brace_count[no] <= rex->brace_min[no]) {
+              rp = regstack_push(rex, RS_BRCPLX_SHORT, scan);
               if (rp == NULL) {
                 status = RA_FAIL;
               } else {
-                reg_save(&rp->rs_un.regsave, &backpos);
+                reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
                 // We continue and handle the result when done.
               }
             }
@@ -4366,7 +4357,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           // what character comes next.
           if (OP(next) == EXACTLY) {
             rst.nextb = *OPERAND(next);
-            if (rex.reg_ic) {
+            if (rex->reg_ic) {
               if (mb_isupper(rst.nextb)) {
                 rst.nextb_ic = mb_tolower(rst.nextb);
               } else {
@@ -4383,15 +4374,15 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
             rst.minval = (op == STAR) ? 0 : 1;
             rst.maxval = MAX_LIMIT;
           } else {
-            rst.minval = bl_minval;
-            rst.maxval = bl_maxval;
+            rst.minval = rex->bl_minval;
+            rst.maxval = rex->bl_maxval;
           }
 
           // When maxval > minval, try matching as much as possible, up
           // to maxval.  When maxval < minval, try matching at least the
           // minimal number (since the range is backwards, that's also
           // maxval!).
-          rst.count = regrepeat(OPERAND(scan), rst.maxval);
+          rst.count = regrepeat(rex, OPERAND(scan), rst.maxval);
           if (got_int) {
             status = RA_FAIL;
             break;
@@ -4401,13 +4392,14 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
             // It could match.  Prepare for trying to match what
             // follows.  The code is below.  Parameters are stored in
             // a regstar_T on the regstack.
-            if ((long)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-              emsg(_(e_maxmempat));
+            if ((long)((unsigned)rex->work->regstack.ga_len >> 10) >= p_mmp) {
+              reg_emsg(rex, _(e_maxmempat));
               status = RA_FAIL;
             } else {
-              ga_grow(&regstack, sizeof(regstar_T));
-              regstack.ga_len += (int)sizeof(regstar_T);
-              rp = regstack_push(rst.minval <= rst.maxval ? RS_STAR_LONG : RS_STAR_SHORT, scan);
+              ga_grow(&rex->work->regstack, sizeof(regstar_T));
+              rex->work->regstack.ga_len += (int)sizeof(regstar_T);
+              rp = regstack_push(rex, rst.minval <= rst.maxval ? RS_STAR_LONG : RS_STAR_SHORT,
+                                 scan);
               if (rp == NULL) {
                 status = RA_FAIL;
               } else {
@@ -4424,12 +4416,12 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case NOMATCH:
         case MATCH:
         case SUBPAT:
-          rp = regstack_push(RS_NOMATCH, scan);
+          rp = regstack_push(rex, RS_NOMATCH, scan);
           if (rp == NULL) {
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)op;
-            reg_save(&rp->rs_un.regsave, &backpos);
+            reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
             next = OPERAND(scan);
             // We continue and handle the result when done.
           }
@@ -4438,22 +4430,22 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         case BEHIND:
         case NOBEHIND:
           // Need a bit of room to store extra positions.
-          if ((long)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-            emsg(_(e_maxmempat));
+          if ((long)((unsigned)rex->work->regstack.ga_len >> 10) >= p_mmp) {
+            reg_emsg(rex, _(e_maxmempat));
             status = RA_FAIL;
           } else {
-            ga_grow(&regstack, sizeof(regbehind_T));
-            regstack.ga_len += (int)sizeof(regbehind_T);
-            rp = regstack_push(RS_BEHIND1, scan);
+            ga_grow(&rex->work->regstack, sizeof(regbehind_T));
+            rex->work->regstack.ga_len += (int)sizeof(regbehind_T);
+            rp = regstack_push(rex, RS_BEHIND1, scan);
             if (rp == NULL) {
               status = RA_FAIL;
             } else {
               // Need to save the subexpr to be able to restore them
               // when there is a match but we don't use it.
-              save_subexpr(((regbehind_T *)rp) - 1);
+              save_subexpr(rex, ((regbehind_T *)rp) - 1);
 
               rp->rs_no = (int16_t)op;
-              reg_save(&rp->rs_un.regsave, &backpos);
+              reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
               // First try if what follows matches.  If it does then we
               // check the behind match by looping.
             }
@@ -4462,23 +4454,23 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
         case BHPOS:
           if (REG_MULTI) {
-            if (behind_pos.rs_u.pos.col != (colnr_T)(rex.input - rex.line)
-                || behind_pos.rs_u.pos.lnum != rex.lnum) {
+            if (rex->behind_pos.rs_u.pos.col != (colnr_T)(rex->input - rex->line)
+                || rex->behind_pos.rs_u.pos.lnum != rex->lnum) {
               status = RA_NOMATCH;
             }
-          } else if (behind_pos.rs_u.ptr != rex.input) {
+          } else if (rex->behind_pos.rs_u.ptr != rex->input) {
             status = RA_NOMATCH;
           }
           break;
 
         case NEWL:
-          if ((c != NUL || !REG_MULTI || rex.lnum > rex.reg_maxline
-               || rex.reg_line_lbr) && (c != '\n' || !rex.reg_line_lbr)) {
+          if ((c != NUL || !REG_MULTI || rex->lnum > rex->reg_maxline
+               || rex->reg_line_lbr) && (c != '\n' || !rex->reg_line_lbr)) {
             status = RA_NOMATCH;
-          } else if (rex.reg_line_lbr) {
+          } else if (rex->reg_line_lbr) {
             ADVANCE_REGINPUT();
           } else {
-            reg_nextline();
+            reg_nextline(rex);
           }
           break;
 
@@ -4487,7 +4479,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           break;
 
         default:
-          iemsg(_(e_re_corr));
+          reg_iemsg(rex, _(e_re_corr));
 #ifdef REGEXP_DEBUG
           printf("Illegal op code %d\n", op);
 #endif
@@ -4507,68 +4499,68 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
     // If there is something on the regstack execute the code for the state.
     // If the state is popped then loop and use the older state.
-    while (!GA_EMPTY(&regstack) && status != RA_FAIL) {
-      rp = (regitem_T *)((char *)regstack.ga_data + regstack.ga_len) - 1;
+    while (!GA_EMPTY(&rex->work->regstack) && status != RA_FAIL) {
+      rp = (regitem_T *)((char *)rex->work->regstack.ga_data + rex->work->regstack.ga_len) - 1;
       switch (rp->rs_state) {
       case RS_NOPEN:
         // Result is passed on as-is, simply pop the state.
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         break;
 
       case RS_MOPEN:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &rex.reg_startpos[rp->rs_no],
-                     &rex.reg_startp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_startpos[rp->rs_no],
+                     &rex->reg_startp[rp->rs_no]);
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         break;
 
       case RS_ZOPEN:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &reg_startzpos[rp->rs_no],
-                     &reg_startzp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_startzpos[rp->rs_no],
+                     &rex->reg_startzp[rp->rs_no]);
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         break;
 
       case RS_MCLOSE:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &rex.reg_endpos[rp->rs_no],
-                     &rex.reg_endp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_endpos[rp->rs_no],
+                     &rex->reg_endp[rp->rs_no]);
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         break;
 
       case RS_ZCLOSE:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &reg_endzpos[rp->rs_no],
-                     &reg_endzp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_endzpos[rp->rs_no],
+                     &rex->reg_endzp[rp->rs_no]);
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         break;
 
       case RS_BRANCH:
         if (status == RA_MATCH) {
           // this branch matched, use it
-          regstack_pop(&scan);
+          regstack_pop(rex, &scan);
         } else {
           if (status != RA_BREAK) {
             // After a non-matching branch: try next one.
-            reg_restore(&rp->rs_un.regsave, &backpos);
+            reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
             scan = rp->rs_scan;
           }
           if (scan == NULL || OP(scan) != BRANCH) {
             // no more branches, didn't find a match
             status = RA_NOMATCH;
-            regstack_pop(&scan);
+            regstack_pop(rex, &scan);
           } else {
             // Prepare to try a branch.
             rp->rs_scan = regnext(scan);
-            reg_save(&rp->rs_un.regsave, &backpos);
+            reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
             scan = OPERAND(scan);
           }
         }
@@ -4577,22 +4569,22 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
       case RS_BRCPLX_MORE:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          reg_restore(&rp->rs_un.regsave, &backpos);
-          brace_count[rp->rs_no]--;             // decrement match count
+          reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
+          rex->brace_count[rp->rs_no]--;             // decrement match count
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         break;
 
       case RS_BRCPLX_LONG:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
           // There was no match, but we did find enough matches.
-          reg_restore(&rp->rs_un.regsave, &backpos);
-          brace_count[rp->rs_no]--;
+          reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
+          rex->brace_count[rp->rs_no]--;
           // continue with the items after "\{}"
           status = RA_CONT;
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         if (status == RA_CONT) {
           scan = regnext(scan);
         }
@@ -4602,9 +4594,9 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
           // There was no match, try to match one more item.
-          reg_restore(&rp->rs_un.regsave, &backpos);
+          reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         if (status == RA_NOMATCH) {
           scan = OPERAND(scan);
           status = RA_CONT;
@@ -4620,10 +4612,10 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         } else {
           status = RA_CONT;
           if (rp->rs_no != SUBPAT) {            // zero-width
-            reg_restore(&rp->rs_un.regsave, &backpos);
+            reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
           }
         }
-        regstack_pop(&scan);
+        regstack_pop(rex, &scan);
         if (status == RA_CONT) {
           scan = regnext(scan);
         }
@@ -4631,8 +4623,8 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 
       case RS_BEHIND1:
         if (status == RA_NOMATCH) {
-          regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regbehind_T);
+          regstack_pop(rex, &scan);
+          rex->work->regstack.ga_len -= (int)sizeof(regbehind_T);
         } else {
           // The stuff after BEHIND/NOBEHIND matches.  Now try if
           // the behind part does (not) match before the current
@@ -4641,7 +4633,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           // the current position.
 
           // save the position after the found match for next
-          reg_save(&(((regbehind_T *)rp) - 1)->save_after, &backpos);
+          reg_save(rex, &(((regbehind_T *)rp) - 1)->save_after, &rex->work->backpos);
 
           // Start looking for a match with operand at the current
           // position.  Go back one character until we find the
@@ -4649,33 +4641,33 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           // line (for multi-line matching).
           // Set behind_pos to where the match should end, BHPOS
           // will match it.  Save the current value.
-          (((regbehind_T *)rp) - 1)->save_behind = behind_pos;
-          behind_pos = rp->rs_un.regsave;
+          (((regbehind_T *)rp) - 1)->save_behind = rex->behind_pos;
+          rex->behind_pos = rp->rs_un.regsave;
 
           rp->rs_state = RS_BEHIND2;
 
-          reg_restore(&rp->rs_un.regsave, &backpos);
+          reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
           scan = OPERAND(rp->rs_scan) + 4;
         }
         break;
 
       case RS_BEHIND2:
         // Looping for BEHIND / NOBEHIND match.
-        if (status == RA_MATCH && reg_save_equal(&behind_pos)) {
+        if (status == RA_MATCH && reg_save_equal(rex, &rex->behind_pos)) {
           // found a match that ends where "next" started
-          behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
+          rex->behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
           if (rp->rs_no == BEHIND) {
-            reg_restore(&(((regbehind_T *)rp) - 1)->save_after,
-                        &backpos);
+            reg_restore(rex, &(((regbehind_T *)rp) - 1)->save_after,
+                        &rex->work->backpos);
           } else {
             // But we didn't want a match.  Need to restore the
             // subexpr, because what follows matched, so they have
             // been set.
             status = RA_NOMATCH;
-            restore_subexpr(((regbehind_T *)rp) - 1);
+            restore_subexpr(rex, ((regbehind_T *)rp) - 1);
           }
-          regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regbehind_T);
+          regstack_pop(rex, &scan);
+          rex->work->regstack.ga_len -= (int)sizeof(regbehind_T);
         } else {
           long limit;
 
@@ -4686,25 +4678,25 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           if (REG_MULTI) {
             if (limit > 0
                 && ((rp->rs_un.regsave.rs_u.pos.lnum
-                     < behind_pos.rs_u.pos.lnum
-                     ? (colnr_T)strlen((char *)rex.line)
-                     : behind_pos.rs_u.pos.col)
+                     < rex->behind_pos.rs_u.pos.lnum
+                     ? (colnr_T)strlen((char *)rex->line)
+                     : rex->behind_pos.rs_u.pos.col)
                     - rp->rs_un.regsave.rs_u.pos.col >= limit)) {
               no = FAIL;
             } else if (rp->rs_un.regsave.rs_u.pos.col == 0) {
               if (rp->rs_un.regsave.rs_u.pos.lnum
-                  < behind_pos.rs_u.pos.lnum
-                  || reg_getline(--rp->rs_un.regsave.rs_u.pos.lnum)
+                  < rex->behind_pos.rs_u.pos.lnum
+                  || reg_getline(rex, --rp->rs_un.regsave.rs_u.pos.lnum)
                   == NULL) {
                 no = FAIL;
               } else {
-                reg_restore(&rp->rs_un.regsave, &backpos);
+                reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
                 rp->rs_un.regsave.rs_u.pos.col =
-                  (colnr_T)strlen((char *)rex.line);
+                  (colnr_T)strlen((char *)rex->line);
               }
             } else {
               const uint8_t *const line =
-                (uint8_t *)reg_getline(rp->rs_un.regsave.rs_u.pos.lnum);
+                (uint8_t *)reg_getline(rex, rp->rs_un.regsave.rs_u.pos.lnum);
 
               rp->rs_un.regsave.rs_u.pos.col -=
                 utf_head_off((char *)line,
@@ -4712,32 +4704,32 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
                 + 1;
             }
           } else {
-            if (rp->rs_un.regsave.rs_u.ptr == rex.line) {
+            if (rp->rs_un.regsave.rs_u.ptr == rex->line) {
               no = FAIL;
             } else {
-              MB_PTR_BACK(rex.line, rp->rs_un.regsave.rs_u.ptr);
+              MB_PTR_BACK(rex->line, rp->rs_un.regsave.rs_u.ptr);
               if (limit > 0
-                  && (behind_pos.rs_u.ptr - rp->rs_un.regsave.rs_u.ptr) > (ptrdiff_t)limit) {
+                  && (rex->behind_pos.rs_u.ptr - rp->rs_un.regsave.rs_u.ptr) > (ptrdiff_t)limit) {
                 no = FAIL;
               }
             }
           }
           if (no == OK) {
             // Advanced, prepare for finding match again.
-            reg_restore(&rp->rs_un.regsave, &backpos);
+            reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
             scan = OPERAND(rp->rs_scan) + 4;
             if (status == RA_MATCH) {
               // We did match, so subexpr may have been changed,
               // need to restore them for the next try.
               status = RA_NOMATCH;
-              restore_subexpr(((regbehind_T *)rp) - 1);
+              restore_subexpr(rex, ((regbehind_T *)rp) - 1);
             }
           } else {
             // Can't advance.  For NOBEHIND that's a match.
-            behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
+            rex->behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
             if (rp->rs_no == NOBEHIND) {
-              reg_restore(&(((regbehind_T *)rp) - 1)->save_after,
-                          &backpos);
+              reg_restore(rex, &(((regbehind_T *)rp) - 1)->save_after,
+                          &rex->work->backpos);
               status = RA_MATCH;
             } else {
               // We do want a proper match.  Need to restore the
@@ -4745,11 +4737,11 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
               // been set.
               if (status == RA_MATCH) {
                 status = RA_NOMATCH;
-                restore_subexpr(((regbehind_T *)rp) - 1);
+                restore_subexpr(rex, ((regbehind_T *)rp) - 1);
               }
             }
-            regstack_pop(&scan);
-            regstack.ga_len -= (int)sizeof(regbehind_T);
+            regstack_pop(rex, &scan);
+            rex->work->regstack.ga_len -= (int)sizeof(regbehind_T);
           }
         }
         break;
@@ -4759,14 +4751,14 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         regstar_T *rst = ((regstar_T *)rp) - 1;
 
         if (status == RA_MATCH) {
-          regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regstar_T);
+          regstack_pop(rex, &scan);
+          rex->work->regstack.ga_len -= (int)sizeof(regstar_T);
           break;
         }
 
         // Tried once already, restore input pointers.
         if (status != RA_BREAK) {
-          reg_restore(&rp->rs_un.regsave, &backpos);
+          reg_restore(rex, &rp->rs_un.regsave, &rex->work->backpos);
         }
 
         // Repeat until we found a position where it could match.
@@ -4779,22 +4771,22 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
               if (--rst->count < rst->minval) {
                 break;
               }
-              if (rex.input == rex.line) {
+              if (rex->input == rex->line) {
                 // backup to last char of previous line
-                if (rex.lnum == 0) {
+                if (rex->lnum == 0) {
                   status = RA_NOMATCH;
                   break;
                 }
-                rex.lnum--;
-                rex.line = (uint8_t *)reg_getline(rex.lnum);
+                rex->lnum--;
+                rex->line = (uint8_t *)reg_getline(rex, rex->lnum);
                 // Just in case regrepeat() didn't count right.
-                if (rex.line == NULL) {
+                if (rex->line == NULL) {
                   break;
                 }
-                rex.input = rex.line + strlen((char *)rex.line);
-                reg_breakcheck();
+                rex->input = rex->line + strlen((char *)rex->line);
+                reg_breakcheck(rex);
               } else {
-                MB_PTR_BACK(rex.line, rex.input);
+                MB_PTR_BACK(rex->line, rex->input);
               }
             } else {
               // Range is backwards, use shortest match first.
@@ -4802,7 +4794,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
               // Couldn't or didn't match: try advancing one
               // char.
               if (rst->count == rst->minval
-                  || regrepeat(OPERAND(rp->rs_scan), 1L) == 0) {
+                  || regrepeat(rex, OPERAND(rp->rs_scan), 1L) == 0) {
                 break;
               }
               rst->count++;
@@ -4815,9 +4807,9 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
           }
 
           // If it could match, try it.
-          if (rst->nextb == NUL || *rex.input == rst->nextb
-              || *rex.input == rst->nextb_ic) {
-            reg_save(&rp->rs_un.regsave, &backpos);
+          if (rst->nextb == NUL || *rex->input == rst->nextb
+              || *rex->input == rst->nextb_ic) {
+            reg_save(rex, &rp->rs_un.regsave, &rex->work->backpos);
             scan = regnext(rp->rs_scan);
             status = RA_CONT;
             break;
@@ -4825,8 +4817,8 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
         }
         if (status != RA_CONT) {
           // Failed.
-          regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regstar_T);
+          regstack_pop(rex, &scan);
+          rex->work->regstack.ga_len -= (int)sizeof(regstar_T);
           status = RA_NOMATCH;
         }
       }
@@ -4836,7 +4828,7 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
       // If we want to continue the inner loop or didn't pop a state
       // continue matching loop
       if (status == RA_CONT || rp == (regitem_T *)
-          ((char *)regstack.ga_data + regstack.ga_len) - 1) {
+          ((char *)rex->work->regstack.ga_data + rex->work->regstack.ga_len) - 1) {
         break;
       }
     }
@@ -4847,11 +4839,11 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
     }
 
     // If the regstack is empty or something failed we are done.
-    if (GA_EMPTY(&regstack) || status == RA_FAIL) {
+    if (GA_EMPTY(&rex->work->regstack) || status == RA_FAIL) {
       if (scan == NULL) {
         // We get here only if there's trouble -- normally "case END" is
         // the terminating point.
-        iemsg(_(e_re_corr));
+        reg_iemsg(rex, _(e_re_corr));
 #ifdef REGEXP_DEBUG
         printf("Premature EOL\n");
 #endif
@@ -4869,36 +4861,36 @@ static bool regmatch(uint8_t *scan, proftime_T *tm, int *timed_out)
 /// @param timed_out  flag set on timeout or NULL
 ///
 /// @return  0 for failure, or number of lines contained in the match.
-static long regtry(bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_out)
+static long regtry(regexec_T *rex, bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_out)
 {
-  rex.input = rex.line + col;
-  rex.need_clear_subexpr = true;
+  rex->input = rex->line + col;
+  rex->need_clear_subexpr = true;
   // Clear the external match subpointers if necessaey.
-  rex.need_clear_zsubexpr = (prog->reghasz == REX_SET);
+  rex->need_clear_zsubexpr = (prog->reghasz == REX_SET);
 
-  if (regmatch(prog->program + 1, tm, timed_out) == 0) {
+  if (regmatch(rex, prog->program + 1, tm, timed_out) == 0) {
     return 0;
   }
 
-  cleanup_subexpr();
+  cleanup_subexpr(rex);
   if (REG_MULTI) {
-    if (rex.reg_startpos[0].lnum < 0) {
-      rex.reg_startpos[0].lnum = 0;
-      rex.reg_startpos[0].col = col;
+    if (rex->reg_startpos[0].lnum < 0) {
+      rex->reg_startpos[0].lnum = 0;
+      rex->reg_startpos[0].col = col;
     }
-    if (rex.reg_endpos[0].lnum < 0) {
-      rex.reg_endpos[0].lnum = rex.lnum;
-      rex.reg_endpos[0].col = (int)(rex.input - rex.line);
+    if (rex->reg_endpos[0].lnum < 0) {
+      rex->reg_endpos[0].lnum = rex->lnum;
+      rex->reg_endpos[0].col = (int)(rex->input - rex->line);
     } else {
       // Use line number of "\ze".
-      rex.lnum = rex.reg_endpos[0].lnum;
+      rex->lnum = rex->reg_endpos[0].lnum;
     }
   } else {
-    if (rex.reg_startp[0] == NULL) {
-      rex.reg_startp[0] = rex.line + col;
+    if (rex->reg_startp[0] == NULL) {
+      rex->reg_startp[0] = rex->line + col;
     }
-    if (rex.reg_endp[0] == NULL) {
-      rex.reg_endp[0] = rex.input;
+    if (rex->reg_endp[0] == NULL) {
+      rex->reg_endp[0] = rex->input;
     }
   }
   // Package any found \z(...\) matches for export. Default is none.
@@ -4908,27 +4900,29 @@ static long regtry(bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_o
   if (prog->reghasz == REX_SET) {
     int i;
 
-    cleanup_zsubexpr();
+    cleanup_zsubexpr(rex);
     re_extmatch_out = make_extmatch();
     for (i = 0; i < NSUBEXP; i++) {
       if (REG_MULTI) {
         // Only accept single line matches.
-        if (reg_startzpos[i].lnum >= 0
-            && reg_endzpos[i].lnum == reg_startzpos[i].lnum
-            && reg_endzpos[i].col >= reg_startzpos[i].col) {
+        if (rex->reg_startzpos[i].lnum >= 0
+            && rex->reg_endzpos[i].lnum == rex->reg_startzpos[i].lnum
+            && rex->reg_endzpos[i].col >= rex->reg_startzpos[i].col) {
+          char *line = reg_getline(rex, rex->reg_startzpos[i].lnum);
           re_extmatch_out->matches[i] =
-            (uint8_t *)xstrnsave((char *)reg_getline(reg_startzpos[i].lnum) + reg_startzpos[i].col,
-                                 (size_t)(reg_endzpos[i].col - reg_startzpos[i].col));
+            (uint8_t *)xstrnsave(line + rex->reg_startzpos[i].col,
+                                 (size_t)(rex->reg_endzpos[i].col - rex->reg_startzpos[i].col));
         }
       } else {
-        if (reg_startzp[i] != NULL && reg_endzp[i] != NULL) {
+        if (rex->reg_startzp[i] != NULL && rex->reg_endzp[i] != NULL) {
           re_extmatch_out->matches[i] =
-            (uint8_t *)xstrnsave((char *)reg_startzp[i], (size_t)(reg_endzp[i] - reg_startzp[i]));
+            (uint8_t *)xstrnsave((char *)rex->reg_startzp[i],
+                                 (size_t)(rex->reg_endzp[i] - rex->reg_startzp[i]));
         }
       }
     }
   }
-  return 1 + rex.lnum;
+  return 1 + rex->lnum;
 }
 
 /// Match a regexp against a string ("line" points to the string) or multiple
@@ -4939,7 +4933,8 @@ static long regtry(bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_o
 /// @param timed_out  flag set on timeout or NULL
 ///
 /// @return  0 for failure, or number of lines contained in the match.
-static long bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int *timed_out)
+static long bt_regexec_both(regexec_T *rex, uint8_t *line, colnr_T startcol, proftime_T *tm,
+                            int *timed_out)
 {
   bt_regprog_T *prog;
   uint8_t *s;
@@ -4950,57 +4945,57 @@ static long bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
   // We allocate *_INITIAL amount of bytes first and then set the grow size
   // to much bigger value to avoid many malloc calls in case of deep regular
   // expressions.
-  if (regstack.ga_data == NULL) {
+  if (rex->work->regstack.ga_data == NULL) {
     // Use an item size of 1 byte, since we push different things
     // onto the regstack.
-    ga_init(&regstack, 1, REGSTACK_INITIAL);
-    ga_grow(&regstack, REGSTACK_INITIAL);
-    ga_set_growsize(&regstack, REGSTACK_INITIAL * 8);
+    ga_init(&rex->work->regstack, 1, REGSTACK_INITIAL);
+    ga_grow(&rex->work->regstack, REGSTACK_INITIAL);
+    ga_set_growsize(&rex->work->regstack, REGSTACK_INITIAL * 8);
   }
 
-  if (backpos.ga_data == NULL) {
-    ga_init(&backpos, sizeof(backpos_T), BACKPOS_INITIAL);
-    ga_grow(&backpos, BACKPOS_INITIAL);
-    ga_set_growsize(&backpos, BACKPOS_INITIAL * 8);
+  if (rex->work->backpos.ga_data == NULL) {
+    ga_init(&rex->work->backpos, sizeof(backpos_T), BACKPOS_INITIAL);
+    ga_grow(&rex->work->backpos, BACKPOS_INITIAL);
+    ga_set_growsize(&rex->work->backpos, BACKPOS_INITIAL * 8);
   }
 
   if (REG_MULTI) {
-    prog = (bt_regprog_T *)rex.reg_mmatch->regprog;
-    line = (uint8_t *)reg_getline((linenr_T)0);
-    rex.reg_startpos = rex.reg_mmatch->startpos;
-    rex.reg_endpos = rex.reg_mmatch->endpos;
+    prog = (bt_regprog_T *)rex->reg_mmatch->regprog;
+    line = (uint8_t *)reg_getline(rex, (linenr_T)0);
+    rex->reg_startpos = rex->reg_mmatch->startpos;
+    rex->reg_endpos = rex->reg_mmatch->endpos;
   } else {
-    prog = (bt_regprog_T *)rex.reg_match->regprog;
-    rex.reg_startp = (uint8_t **)rex.reg_match->startp;
-    rex.reg_endp = (uint8_t **)rex.reg_match->endp;
+    prog = (bt_regprog_T *)rex->reg_match->regprog;
+    rex->reg_startp = (uint8_t **)rex->reg_match->startp;
+    rex->reg_endp = (uint8_t **)rex->reg_match->endp;
   }
 
   // Be paranoid...
   if (prog == NULL || line == NULL) {
-    iemsg(_(e_null));
+    reg_iemsg(rex, _(e_null));
     goto theend;
   }
 
   // Check validity of program.
-  if (prog_magic_wrong()) {
+  if (prog_magic_wrong(rex)) {
     goto theend;
   }
 
   // If the start column is past the maximum column: no need to try.
-  if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol) {
+  if (rex->reg_maxcol > 0 && col >= rex->reg_maxcol) {
     goto theend;
   }
 
-  // If pattern contains "\c" or "\C": overrule value of rex.reg_ic
+  // If pattern contains "\c" or "\C": overrule value of rex->reg_ic
   if (prog->regflags & RF_ICASE) {
-    rex.reg_ic = true;
+    rex->reg_ic = true;
   } else if (prog->regflags & RF_NOICASE) {
-    rex.reg_ic = false;
+    rex->reg_ic = false;
   }
 
-  // If pattern contains "\Z" overrule value of rex.reg_icombine
+  // If pattern contains "\Z" overrule value of rex->reg_icombine
   if (prog->regflags & RF_ICOMBINE) {
-    rex.reg_icombine = true;
+    rex->reg_icombine = true;
   }
 
   // If there is a "must appear" string, look for it.
@@ -5010,16 +5005,16 @@ static long bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
 
     // This is used very often, esp. for ":global".  Use two versions of
     // the loop to avoid overhead of conditions.
-    if (!rex.reg_ic) {
+    if (!rex->reg_ic) {
       while ((s = (uint8_t *)vim_strchr((char *)s, c)) != NULL) {
-        if (cstrncmp((char *)s, (char *)prog->regmust, &prog->regmlen) == 0) {
+        if (cstrncmp(rex, (char *)s, (char *)prog->regmust, &prog->regmlen) == 0) {
           break;  // Found it.
         }
         MB_PTR_ADV(s);
       }
     } else {
-      while ((s = (uint8_t *)cstrchr((char *)s, c)) != NULL) {
-        if (cstrncmp((char *)s, (char *)prog->regmust, &prog->regmlen) == 0) {
+      while ((s = (uint8_t *)cstrchr(rex, (char *)s, c)) != NULL) {
+        if (cstrncmp(rex, (char *)s, (char *)prog->regmust, &prog->regmlen) == 0) {
           break;  // Found it.
         }
         MB_PTR_ADV(s);
@@ -5030,20 +5025,19 @@ static long bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
     }
   }
 
-  rex.line = line;
-  rex.lnum = 0;
-  reg_toolong = false;
+  rex->line = line;
+  rex->lnum = 0;
 
   // Simplest case: Anchored match need be tried only once.
   if (prog->reganch) {
-    int c = utf_ptr2char((char *)rex.line + col);
+    int c = utf_ptr2char((char *)rex->line + col);
     if (prog->regstart == NUL
         || prog->regstart == c
-        || (rex.reg_ic
+        || (rex->reg_ic
             && (utf_fold(prog->regstart) == utf_fold(c)
                 || (c < 255 && prog->regstart < 255
                     && mb_tolower(prog->regstart) == mb_tolower(c))))) {
-      retval = regtry(prog, col, tm, timed_out);
+      retval = regtry(rex, prog, col, tm, timed_out);
     } else {
       retval = 0;
     }
@@ -5053,34 +5047,34 @@ static long bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
     while (!got_int) {
       if (prog->regstart != NUL) {
         // Skip until the char we know it must start with.
-        s = (uint8_t *)cstrchr((char *)rex.line + col, prog->regstart);
+        s = (uint8_t *)cstrchr(rex, (char *)rex->line + col, prog->regstart);
         if (s == NULL) {
           retval = 0;
           break;
         }
-        col = (int)(s - rex.line);
+        col = (int)(s - rex->line);
       }
 
       // Check for maximum column to try.
-      if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol) {
+      if (rex->reg_maxcol > 0 && col >= rex->reg_maxcol) {
         retval = 0;
         break;
       }
 
-      retval = regtry(prog, col, tm, timed_out);
+      retval = regtry(rex, prog, col, tm, timed_out);
       if (retval > 0) {
         break;
       }
 
       // if not currently on the first line, get it again
-      if (rex.lnum != 0) {
-        rex.lnum = 0;
-        rex.line = (uint8_t *)reg_getline((linenr_T)0);
+      if (rex->lnum != 0) {
+        rex->lnum = 0;
+        rex->line = (uint8_t *)reg_getline(rex, (linenr_T)0);
       }
-      if (rex.line[col] == NUL) {
+      if (rex->line[col] == NUL) {
         break;
       }
-      col += utfc_ptr2len((char *)rex.line + col);
+      col += utfc_ptr2len((char *)rex->line + col);
       // Check for timeout once in a twenty times to avoid overhead.
       if (tm != NULL && ++tm_count == 20) {
         tm_count = 0;
@@ -5095,41 +5089,41 @@ static long bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
   }
 
 theend:
-  // Free "reg_tofree" when it's a bit big.
+  // Free "tofree" when it's a bit big.
   // Free regstack and backpos if they are bigger than their initial size.
-  if (reg_tofreelen > 400) {
-    XFREE_CLEAR(reg_tofree);
+  if (rex->work->tofreelen > 400) {
+    XFREE_CLEAR(rex->work->tofree);
   }
-  if (regstack.ga_maxlen > REGSTACK_INITIAL) {
-    ga_clear(&regstack);
+  if (rex->work->regstack.ga_maxlen > REGSTACK_INITIAL) {
+    ga_clear(&rex->work->regstack);
   }
-  if (backpos.ga_maxlen > BACKPOS_INITIAL) {
-    ga_clear(&backpos);
+  if (rex->work->backpos.ga_maxlen > BACKPOS_INITIAL) {
+    ga_clear(&rex->work->backpos);
   }
 
   if (retval > 0) {
     // Make sure the end is never before the start.  Can happen when \zs
     // and \ze are used.
     if (REG_MULTI) {
-      const lpos_T *const start = &rex.reg_mmatch->startpos[0];
-      const lpos_T *const end = &rex.reg_mmatch->endpos[0];
+      const lpos_T *const start = &rex->reg_mmatch->startpos[0];
+      const lpos_T *const end = &rex->reg_mmatch->endpos[0];
 
       if (end->lnum < start->lnum
           || (end->lnum == start->lnum && end->col < start->col)) {
-        rex.reg_mmatch->endpos[0] = rex.reg_mmatch->startpos[0];
+        rex->reg_mmatch->endpos[0] = rex->reg_mmatch->startpos[0];
       }
 
       // startpos[0] may be set by "\zs", also return the column where
       // the whole pattern matched.
-      rex.reg_mmatch->rmm_matchcol = col;
+      rex->reg_mmatch->rmm_matchcol = col;
     } else {
-      if (rex.reg_match->endp[0] < rex.reg_match->startp[0]) {
-        rex.reg_match->endp[0] = rex.reg_match->startp[0];
+      if (rex->reg_match->endp[0] < rex->reg_match->startp[0]) {
+        rex->reg_match->endp[0] = rex->reg_match->startp[0];
       }
 
       // startpos[0] may be set by "\zs", also return the column where
       // the whole pattern matched.
-      rex.reg_match->rm_matchcol = col;
+      rex->reg_match->rm_matchcol = col;
     }
   }
 
@@ -5145,20 +5139,20 @@ theend:
 /// @param col   column to start looking for match
 ///
 /// @return  0 for failure, number of lines contained in the match otherwise.
-static int bt_regexec_nl(regmatch_T *rmp, uint8_t *line, colnr_T col, bool line_lbr)
+static int bt_regexec_nl(regexec_T *rex, regmatch_T *rmp, uint8_t *line, colnr_T col, bool line_lbr)
 {
-  rex.reg_match = rmp;
-  rex.reg_mmatch = NULL;
-  rex.reg_maxline = 0;
-  rex.reg_line_lbr = line_lbr;
-  rex.reg_buf = curbuf;
-  rex.reg_win = NULL;
-  rex.reg_ic = rmp->rm_ic;
-  rex.reg_icombine = false;
-  rex.reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
-  rex.reg_maxcol = 0;
-
-  long r = bt_regexec_both(line, col, NULL, NULL);
+  rex->reg_match = rmp;
+  rex->reg_mmatch = NULL;
+  rex->reg_maxline = 0;
+  rex->reg_line_lbr = line_lbr;
+  rex->reg_buf = curbuf;
+  rex->reg_win = NULL;
+  rex->reg_ic = rmp->rm_ic;
+  rex->reg_icombine = false;
+  rex->reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
+  rex->reg_maxcol = 0;
+
+  long r = bt_regexec_both(rex, line, col, NULL, NULL);
   assert(r <= INT_MAX);
   return (int)r;
 }
@@ -5175,11 +5169,11 @@ static int bt_regexec_nl(regmatch_T *rmp, uint8_t *line, colnr_T col, bool line_
 ///
 /// @return zero if there is no match and number of lines contained in the match
 ///         otherwise.
-static long bt_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, colnr_T col,
-                             proftime_T *tm, int *timed_out)
+static long bt_regexec_multi(regexec_T *rex, regmmatch_T *rmp, win_T *win, buf_T *buf,
+                             linenr_T lnum, colnr_T col, proftime_T *tm, int *timed_out)
 {
-  init_regexec_multi(rmp, win, buf, lnum);
-  return bt_regexec_both(NULL, col, tm, timed_out);
+  init_regexec_multi(rex, rmp, win, buf, lnum);
+  return bt_regexec_both(rex, NULL, col, tm, timed_out);
 }
 
 // Compare a number with the operand of RE_LNUM, RE_COL or RE_VCOL.
@@ -56,6 +56,10 @@ typedef enum {
 typedef struct regengine regengine_T;
 typedef struct regprog regprog_T;
 typedef struct reg_extmatch reg_extmatch_T;
+/// State of a single match, owned by the caller of the engine.  See regexp.c.
+typedef struct regexec regexec_T;
+/// Memory used for matching that is kept between matches.  See regexp.c.
+typedef struct regwork regwork_T;
 
 /// Structure to be used for multi-line matching.
 /// Sub-match "no" starts in line "startpos[no].lnum" column "startpos[no].col"
@@ -75,6 +79,9 @@ typedef struct {
 
 #include "nvim/buffer_defs.h"
 
+/// Provides line "lnum" of the text matched with vim_regexec_lines().
+typedef char *(*reg_getline_T)(linenr_T lnum, void *data);
+
 // Structure returned by vim_regcomp() to pass on to vim_regexec().
 // This is the general structure. For the actual matcher, two specific
 // structures are used. See code below.
@@ -83,7 +90,7 @@ struct regprog {
   unsigned regflags;
   unsigned re_engine;  ///< Automatic, backtracking or NFA engine.
   unsigned re_flags;   ///< Second argument for vim_regcomp().
-  bool re_in_use;      ///< prog is being executed
+  int re_refcount;     ///< number of vim_regfree() calls needed to free it
 };
 
 // Structure used by the back track matcher.
@@ -95,7 +102,7 @@ typedef struct {
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;
-  bool re_in_use;
+  int re_refcount;
 
   int regstart;
   uint8_t reganch;
@@ -112,8 +119,7 @@ struct nfa_state {
   int c;
   nfa_state_T *out;
   nfa_state_T *out1;
-  int id;
-  int lastlist[2];                   // 0: normal, 1: recursive
+  int id;  ///< index in "state" of nfa_regprog_T, once compiled
   int val;
 };
 
@@ -124,13 +130,16 @@ typedef struct {
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;
-  bool re_in_use;
+  int re_refcount;
 
   nfa_state_T *start;           // points into state[]
 
   int reganch;                          // pattern starts with ^
   int regstart;                         // char at start of pattern
   uint8_t *match_text;      // plain text to match with
+  uint8_t *startset;        // when not NULL: bytes a match can start with
+  bool startset_ascii;      // "startset" only has ASCII bytes
+  uint64_t id;              // unique number, DFA cache key in regwork_T
 
   int has_zend;                         // pattern contains \ze
   int has_backref;                      // pattern contains \1 .. \9
@@ -167,9 +176,10 @@ struct regengine {
   /// bt_regfree or nfa_regfree
   void (*regfree)(regprog_T *);
   /// bt_regexec_nl or nfa_regexec_nl
-  int (*regexec_nl)(regmatch_T *, uint8_t *, colnr_T, bool);
+  int (*regexec_nl)(regexec_T *, regmatch_T *, uint8_t *, colnr_T, bool);
   /// bt_regexec_mult or nfa_regexec_mult
-  long (*regexec_multi)(regmmatch_T *, win_T *, buf_T *, linenr_T, colnr_T, proftime_T *, int *);
+  long (*regexec_multi)(regexec_T *, regmmatch_T *, win_T *, buf_T *, linenr_T, colnr_T,
+                        proftime_T *, int *);
   // uint8_t *expr;
 };
 
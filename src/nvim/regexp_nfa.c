@@ -11,7 +11,9 @@
 #include <stdbool.h>
 
 #include "nvim/ascii.h"
+#include "klib/kvec.h"
 #include "nvim/garray.h"
+#include "nvim/map.h"
 #include "nvim/os/input.h"
 
 // Logging of NFA engine.
@@ -264,30 +266,6 @@ struct Frag {
 };
 typedef struct Frag Frag_T;
 
-typedef struct {
-  int in_use;       ///< number of subexpr with useful info
-
-  // When REG_MULTI is true list.multi is used, otherwise list.line.
-  union {
-    struct multipos {
-      linenr_T start_lnum;
-      linenr_T end_lnum;
-      colnr_T start_col;
-      colnr_T end_col;
-    } multi[NSUBEXP];
-    struct linepos {
-      uint8_t *start;
-      uint8_t *end;
-    } line[NSUBEXP];
-  } list;
-  colnr_T orig_start_col;  // list.multi[0].start_col without \zs
-} regsub_T;
-
-typedef struct {
-  regsub_T norm;      // \( .. \) matches
-  regsub_T synt;      // \z( .. \) matches
-} regsubs_T;
-
 // nfa_pim_T stores a Postponed Invisible Match.
 typedef struct nfa_pim_S nfa_pim_T;
 struct nfa_pim_S {
@@ -318,26 +296,59 @@ typedef struct {
   int has_pim;                  ///< true when any state has a PIM
 } nfa_list_T;
 
+// Maximum number of DFA states built for one pattern.  When more are needed
+// the DFA is no longer used for it.
+#define NFA_DFA_MAX_STATES 64
+
+// A state of the DFA built by nfa_dfa_may_match(): the set of NFA states that
+// may be active at a position in the text.
+typedef struct {
+  int *states;        ///< sorted indexes of NFA states that consume a
+                      ///< character, or are NFA_EOL or NFA_MATCH
+  int nstates;
+  bool match;         ///< "states" contains NFA_MATCH
+  int eol_match;      ///< a match ends at end-of-line, -1 when not known yet
+  int next[128];      ///< next DFA state for ASCII characters, -1 when not
+                      ///< known yet
+} nfa_dfa_state_T;
+
+// DFA built lazily from an NFA that has no back references, look-around or
+// other items that depend on more than the text itself.  Only used to find
+// out quickly that there is no match in a line, the NFA finds the actual
+// match and its submatches.  The program is not changed while matching, the
+// DFA is kept in the "nfa_dfas" of the regwork_T, by program id.
+typedef struct nfa_dfa nfa_dfa_T;
+struct nfa_dfa {
+  bool usable;        ///< false when the NFA has unsupported items or needs
+                      ///< too many DFA states
+  int reg_ic;         ///< rex.reg_ic the states were built for
+  int start_bol;      ///< DFA state at the start of the line, or -1
+  int start;          ///< DFA state at other columns, or -1
+  kvec_t(nfa_dfa_state_T *) states;
+  Map(String, int) ids;  ///< NFA state set -> index in "states" + 1
+  int *mark;          ///< for each NFA state the generation it was added in
+  int generation;
+  kvec_t(int) work;   ///< NFA states still to be added
+  kvec_t(int) set;    ///< NFA states added
+};
+
 // Variables only used in nfa_regcomp() and descendants.
 static int nfa_re_flags;  ///< re_flags passed to nfa_regcomp().
 static int *post_start;   ///< holds the postfix form of r.e.
 static int *post_end;
 static int *post_ptr;
+static bool nfa_has_zend;     ///< \ze operator encountered, see "has_zend".
+static bool nfa_has_backref;  ///< \1 .. \9 encountered, see "has_backref".
 
 // Set when the pattern should use the NFA engine.
 // E.g. [[:upper:]] only allows 8bit characters for BT engine,
 // while NFA engine handles multibyte characters correctly.
 static bool wants_nfa;
 
-static int nstate;  ///< Number of states in the NFA. Also used when executing.
+static int nstate;  ///< Number of states in the NFA.
+static uint64_t nfa_prog_id;  ///< "id" of the last compiled program
 static int istate;  ///< Index in the state vector, used in alloc_state()
 
-// If not NULL match must end at this position
-static save_se_T *nfa_endp = NULL;
-
-// 0 for first call to nfa_regmatch(), 1 for recursive call.
-static int nfa_ll_index = 0;
-
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "regexp_nfa.c.generated.h"
 #endif
@@ -375,8 +386,8 @@ static void nfa_regcomp_start(uint8_t *expr, int re_flags)
   post_ptr = post_start;
   post_end = post_start + nstate_max;
   wants_nfa = false;
-  rex.nfa_has_zend = false;
-  rex.nfa_has_backref = false;
+  nfa_has_zend = false;
+  nfa_has_backref = false;
 
   // shared with BT engine
   regcomp_start(expr, re_flags);
@@ -516,6 +527,119 @@ static int nfa_get_regstart(nfa_state_T *start, int depth)
   return 0;
 }
 
+// Add the bytes from "lo" to "hi" to "set".
+static void nfa_startset_add_range(uint8_t *set, int lo, int hi)
+{
+  for (int c = lo; c <= hi; c++) {
+    set[c] = true;
+  }
+}
+
+// Figure out which bytes a match of the NFA state list can start with, adding
+// them to "set".  Returns false when any byte is possible, or the list is too
+// complicated to find out.  "budget" limits the number of states looked at.
+static bool nfa_get_startset(nfa_state_T *start, uint8_t *set, int *budget)
+{
+  nfa_state_T *p = start;
+
+  while (p != NULL) {
+    if (--*budget < 0) {
+      return false;
+    }
+    switch (p->c) {
+    // all kinds of zero-width matches
+    case NFA_BOL:
+    case NFA_BOF:
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_CURSOR:
+    case NFA_VISUAL:
+    case NFA_LNUM:
+    case NFA_LNUM_GT:
+    case NFA_LNUM_LT:
+    case NFA_COL:
+    case NFA_COL_GT:
+    case NFA_COL_LT:
+    case NFA_VCOL:
+    case NFA_VCOL_GT:
+    case NFA_VCOL_LT:
+    case NFA_MARK:
+    case NFA_MARK_GT:
+    case NFA_MARK_LT:
+
+    case NFA_MOPEN:
+    case NFA_MOPEN1:
+    case NFA_MOPEN2:
+    case NFA_MOPEN3:
+    case NFA_MOPEN4:
+    case NFA_MOPEN5:
+    case NFA_MOPEN6:
+    case NFA_MOPEN7:
+    case NFA_MOPEN8:
+    case NFA_MOPEN9:
+    case NFA_NOPEN:
+    case NFA_ZOPEN:
+    case NFA_ZOPEN1:
+    case NFA_ZOPEN2:
+    case NFA_ZOPEN3:
+    case NFA_ZOPEN4:
+    case NFA_ZOPEN5:
+    case NFA_ZOPEN6:
+    case NFA_ZOPEN7:
+    case NFA_ZOPEN8:
+    case NFA_ZOPEN9:
+      p = p->out;
+      break;
+
+    case NFA_SPLIT:
+      return nfa_get_startset(p->out, set, budget)
+             && nfa_get_startset(p->out1, set, budget);
+
+    case NFA_WHITE:
+      set[' '] = true;
+      set[TAB] = true;
+      return true;
+
+    case NFA_DIGIT:
+      nfa_startset_add_range(set, '0', '9');
+      return true;
+
+    case NFA_OCTAL:
+      nfa_startset_add_range(set, '0', '7');
+      return true;
+
+    case NFA_HEX:
+      nfa_startset_add_range(set, '0', '9');
+      nfa_startset_add_range(set, 'a', 'f');
+      nfa_startset_add_range(set, 'A', 'F');
+      return true;
+
+    case NFA_WORD:
+      nfa_startset_add_range(set, '0', '9');
+      FALLTHROUGH;
+    case NFA_HEAD:
+      set['_'] = true;
+      FALLTHROUGH;
+    case NFA_ALPHA:
+      nfa_startset_add_range(set, 'a', 'z');
+      nfa_startset_add_range(set, 'A', 'Z');
+      return true;
+
+    default:
+      if (p->c > 0 && p->c != NL) {
+        char buf[MB_MAXBYTES + 1];
+        utf_char2bytes(p->c, buf);
+        set[(uint8_t)buf[0]] = true;
+        return true;
+      }
+      return false;
+    }
+  }
+  return false;
+}
+
 // Figure out if the NFA state list contains just literal text and nothing
 // else.  If so return a string in allocated memory with what must match after
 // regstart.  Otherwise return NULL.
@@ -1936,6 +2060,7 @@ static int nfa_regatom(void)
 
     // Previous substitute pattern.
     // Generated as "\%(pattern\)".
+    reg_nocache = true;
     if (reg_prev_sub == NULL) {
       emsg(_(e_nopresub));
       return FAIL;
@@ -1965,7 +2090,7 @@ static int nfa_regatom(void)
       return FAIL;
     }
     EMIT(NFA_BACKREF1 + refnum);
-    rex.nfa_has_backref = true;
+    nfa_has_backref = true;
   }
   break;
 
@@ -1980,7 +2105,7 @@ static int nfa_regatom(void)
       break;
     case 'e':
       EMIT(NFA_ZEND);
-      rex.nfa_has_zend = true;
+      nfa_has_zend = true;
       if (!re_mult_next("\\zs")) {
         return false;
       }
@@ -1999,7 +2124,7 @@ static int nfa_regatom(void)
         EMSG_RET_FAIL(_(e_z1_not_allowed));
       }
       EMIT(NFA_ZREF1 + (no_Magic(c) - '1'));
-      // No need to set rex.nfa_has_backref, the sub-matches don't
+      // No need to set nfa_has_backref, the sub-matches don't
       // change when \z1 .. \z9 matches or not.
       re_has_z = REX_USE;
       break;
@@ -2068,10 +2193,12 @@ static int nfa_regatom(void)
     // pattern -- regardless of whether or not it makes sense.
     case '^':
       EMIT(NFA_BOF);
+      regflags |= RF_POSDEP;
       break;
 
     case '$':
       EMIT(NFA_EOF);
+      regflags |= RF_POSDEP;
       break;
 
     case '#':
@@ -2082,10 +2209,12 @@ static int nfa_regatom(void)
         return FAIL;
       }
       EMIT(NFA_CURSOR);
+      regflags |= RF_POSDEP;
       break;
 
     case 'V':
       EMIT(NFA_VISUAL);
+      regflags |= RF_POSDEP;
       break;
 
     case 'C':
@@ -2158,6 +2287,13 @@ static int nfa_regatom(void)
           semsg(_(e_nfa_regexp_missing_value_in_chr), no_Magic(c));
           return FAIL;
         }
+        // "\%23c" only depends on the text, "\%.c" on the cursor.
+        if (c != 'c' || cur) {
+          regflags |= RF_POSDEP;
+        }
+        if (cur) {
+          reg_nocache = true;
+        }
         if (c == 'l') {
           if (cur) {
             n = curwin->w_cursor.lnum;
@@ -2198,6 +2334,7 @@ static int nfa_regatom(void)
         EMIT(cmp == '<' ? NFA_MARK_LT :
              cmp == '>' ? NFA_MARK_GT : NFA_MARK);
         EMIT(getchr());
+        regflags |= RF_POSDEP;
         break;
       }
     }
@@ -3440,8 +3577,6 @@ static nfa_state_T *alloc_state(int c, nfa_state_T *out, nfa_state_T *out1)
   s->val  = 0;
 
   s->id   = istate;
-  s->lastlist[0] = 0;
-  s->lastlist[1] = 0;
 
   return s;
 }
@@ -4348,15 +4483,15 @@ static void nfa_postprocess(nfa_regprog_T *prog)
 #define NFA_PIM_NOMATCH  3      // pim executed, no match
 
 #ifdef REGEXP_DEBUG
-static void log_subsexpr(regsubs_T *subs)
+static void log_subsexpr(regexec_T *rex, regsubs_T *subs)
 {
-  log_subexpr(&subs->norm);
-  if (rex.nfa_has_zsubexpr) {
-    log_subexpr(&subs->synt);
+  log_subexpr(rex, &subs->norm);
+  if (rex->nfa_has_zsubexpr) {
+    log_subexpr(rex, &subs->synt);
   }
 }
 
-static void log_subexpr(regsub_T *sub)
+static void log_subexpr(regexec_T *rex, regsub_T *sub)
 {
   int j;
 
@@ -4380,7 +4515,7 @@ static void log_subexpr(regsub_T *sub)
   }
 }
 
-static char *pim_info(const nfa_pim_T *pim)
+static char *pim_info(regexec_T *rex, const nfa_pim_T *pim)
 {
   static char buf[30];
 
@@ -4390,44 +4525,38 @@ static char *pim_info(const nfa_pim_T *pim)
     snprintf(buf, sizeof(buf), " PIM col %d",
              REG_MULTI
              ? (int)pim->end.pos.col
-             : (int)(pim->end.ptr - rex.input));
+             : (int)(pim->end.ptr - rex->input));
   }
   return buf;
 }
 
 #endif
 
-// Used during execution: whether a match has been found.
-static int nfa_match;
-static proftime_T *nfa_time_limit;
-static int *nfa_timed_out;
-static int nfa_time_count;
-
 // Copy postponed invisible match info from "from" to "to".
-static void copy_pim(nfa_pim_T *to, nfa_pim_T *from)
+static void copy_pim(regexec_T *rex, nfa_pim_T *to, nfa_pim_T *from)
 {
   to->result = from->result;
   to->state = from->state;
-  copy_sub(&to->subs.norm, &from->subs.norm);
-  if (rex.nfa_has_zsubexpr) {
-    copy_sub(&to->subs.synt, &from->subs.synt);
+  copy_sub(rex, &to->subs.norm, &from->subs.norm);
+  if (rex->nfa_has_zsubexpr) {
+    copy_sub(rex, &to->subs.synt, &from->subs.synt);
   }
   to->end = from->end;
 }
 
-static void clear_sub(regsub_T *sub)
+static void clear_sub(regexec_T *rex, regsub_T *sub)
 {
   if (REG_MULTI) {
     // Use 0xff to set lnum to -1
-    memset(sub->list.multi, 0xff, sizeof(struct multipos) * (size_t)rex.nfa_nsubexpr);
+    memset(sub->list.multi, 0xff, sizeof(struct multipos) * (size_t)rex->nfa_nsubexpr);
   } else {
-    memset(sub->list.line, 0, sizeof(struct linepos) * (size_t)rex.nfa_nsubexpr);
+    memset(sub->list.line, 0, sizeof(struct linepos) * (size_t)rex->nfa_nsubexpr);
   }
   sub->in_use = 0;
 }
 
 // Copy the submatches from "from" to "to".
-static void copy_sub(regsub_T *to, regsub_T *from)
+static void copy_sub(regexec_T *rex, regsub_T *to, regsub_T *from)
 {
   to->in_use = from->in_use;
   if (from->in_use <= 0) {
@@ -4446,7 +4575,7 @@ static void copy_sub(regsub_T *to, regsub_T *from)
 }
 
 // Like copy_sub() but exclude the main match.
-static void copy_sub_off(regsub_T *to, regsub_T *from)
+static void copy_sub_off(regexec_T *rex, regsub_T *to, regsub_T *from)
 {
   if (to->in_use < from->in_use) {
     to->in_use = from->in_use;
@@ -4466,9 +4595,9 @@ static void copy_sub_off(regsub_T *to, regsub_T *from)
 }
 
 // Like copy_sub() but only do the end of the main match if \ze is present.
-static void copy_ze_off(regsub_T *to, regsub_T *from)
+static void copy_ze_off(regexec_T *rex, regsub_T *to, regsub_T *from)
 {
-  if (!rex.nfa_has_zend) {
+  if (!rex->nfa_has_zend) {
     return;
   }
 
@@ -4486,7 +4615,7 @@ static void copy_ze_off(regsub_T *to, regsub_T *from)
 
 // Return true if "sub1" and "sub2" have the same start positions.
 // When using back-references also check the end position.
-static bool sub_equal(regsub_T *sub1, regsub_T *sub2)
+static bool sub_equal(regexec_T *rex, regsub_T *sub1, regsub_T *sub2)
 {
   int i;
   int todo;
@@ -4515,7 +4644,7 @@ static bool sub_equal(regsub_T *sub1, regsub_T *sub2)
           != sub2->list.multi[i].start_col) {
         return false;
       }
-      if (rex.nfa_has_backref) {
+      if (rex->nfa_has_backref) {
         if (i < sub1->in_use) {
           s1 = sub1->list.multi[i].end_lnum;
         } else {
@@ -4550,7 +4679,7 @@ static bool sub_equal(regsub_T *sub1, regsub_T *sub2)
       if (sp1 != sp2) {
         return false;
       }
-      if (rex.nfa_has_backref) {
+      if (rex->nfa_has_backref) {
         if (i < sub1->in_use) {
           sp1 = sub1->list.line[i].end;
         } else {
@@ -4572,7 +4701,7 @@ static bool sub_equal(regsub_T *sub1, regsub_T *sub2)
 }
 
 #ifdef REGEXP_DEBUG
-static void open_debug_log(TriState result)
+static void open_debug_log(regexec_T *rex, TriState result)
 {
   log_fd = fopen(NFA_REGEXP_RUN_LOG, "a");
   if (log_fd == NULL) {
@@ -4586,7 +4715,8 @@ static void open_debug_log(TriState result)
   fprintf(log_fd, "****************************\n");
 }
 
-static void report_state(char *action, regsub_T *sub, nfa_state_T *state, int lid, nfa_pim_T *pim)
+static void report_state(regexec_T *rex, char *action, regsub_T *sub, nfa_state_T *state, int lid,
+                         nfa_pim_T *pim)
 {
   int col;
 
@@ -4595,15 +4725,15 @@ static void report_state(char *action, regsub_T *sub, nfa_state_T *state, int li
   } else if (REG_MULTI) {
     col = sub->list.multi[0].start_col;
   } else {
-    col = (int)(sub->list.line[0].start - rex.line);
+    col = (int)(sub->list.line[0].start - rex->line);
   }
   nfa_set_code(state->c);
   if (log_fd == NULL) {
-    open_debug_log(kNone);
+    open_debug_log(rex, kNone);
   }
   fprintf(log_fd, "> %s state %d to list %d. char %d: %s (start col %d)%s\n",
           action, abs(state->id), lid, state->c, code, col,
-          pim_info(pim));
+          pim_info(rex, pim));
 }
 
 #endif
@@ -4615,16 +4745,17 @@ static void report_state(char *action, regsub_T *sub, nfa_state_T *state, int li
 ///
 /// @return  true if the same state is already in list "l" with the same
 ///          positions as "subs".
-static bool has_state_with_pos(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs, nfa_pim_T *pim)
-  FUNC_ATTR_NONNULL_ARG(1, 2, 3)
+static bool has_state_with_pos(regexec_T *rex, nfa_list_T *l, nfa_state_T *state, regsubs_T *subs,
+                               nfa_pim_T *pim)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 3, 4)
 {
   for (int i = 0; i < l->n; i++) {
     nfa_thread_T *thread = &l->t[i];
     if (thread->state->id == state->id
-        && sub_equal(&thread->subs.norm, &subs->norm)
-        && (!rex.nfa_has_zsubexpr
-            || sub_equal(&thread->subs.synt, &subs->synt))
-        && pim_equal(&thread->pim, pim)) {
+        && sub_equal(rex, &thread->subs.norm, &subs->norm)
+        && (!rex->nfa_has_zsubexpr
+            || sub_equal(rex, &thread->subs.synt, &subs->synt))
+        && pim_equal(rex, &thread->pim, pim)) {
       return true;
     }
   }
@@ -4633,7 +4764,7 @@ static bool has_state_with_pos(nfa_list_T *l, nfa_state_T *state, regsubs_T *sub
 
 // Return true if "one" and "two" are equal.  That includes when both are not
 // set.
-static bool pim_equal(const nfa_pim_T *one, const nfa_pim_T *two)
+static bool pim_equal(regexec_T *rex, const nfa_pim_T *one, const nfa_pim_T *two)
 {
   const bool one_unused = (one == NULL || one->result == NFA_PIM_UNUSED);
   const bool two_unused = (two == NULL || two->result == NFA_PIM_UNUSED);
@@ -4751,11 +4882,11 @@ static bool match_follows(const nfa_state_T *startstate, int depth)
 /// @param subs   pointers to subexpressions
 ///
 /// @return  true if "state" is already in list "l".
-static bool state_in_list(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs)
+static bool state_in_list(regexec_T *rex, nfa_list_T *l, nfa_state_T *state, regsubs_T *subs)
   FUNC_ATTR_NONNULL_ALL
 {
-  if (state->lastlist[nfa_ll_index] == l->id) {
-    if (!rex.nfa_has_backref || has_state_with_pos(l, state, subs, NULL)) {
+  if (rex->work->nfa_lastlist[state->id][rex->nfa_ll_index] == l->id) {
+    if (!rex->nfa_has_backref || has_state_with_pos(rex, l, state, subs, NULL)) {
       return true;
     }
   }
@@ -4773,11 +4904,11 @@ static bool state_in_list(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs)
 /// @param pim       postponed look-behind match
 /// @param off_arg   byte offset, when -1 go to next line
 ///
-/// @return  "subs_arg", possibly copied into temp_subs.
+/// @return  "subs_arg", possibly copied into rex->nfa_temp_subs.
 ///          NULL when recursiveness is too deep.
-static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_arg, nfa_pim_T *pim,
-                           int off_arg)
-  FUNC_ATTR_NONNULL_ARG(1, 2) FUNC_ATTR_WARN_UNUSED_RESULT
+static regsubs_T *addstate(regexec_T *rex, nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_arg,
+                           nfa_pim_T *pim, int off_arg)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 3) FUNC_ATTR_WARN_UNUSED_RESULT
 {
   int subidx;
   int off = off_arg;
@@ -4792,16 +4923,14 @@ static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_ar
   int i;
   regsub_T *sub;
   regsubs_T *subs = subs_arg;
-  static regsubs_T temp_subs;
 #ifdef REGEXP_DEBUG
   int did_print = false;
 #endif
-  static int depth = 0;
 
   // This function is called recursively.  When the depth is too much we run
   // out of stack and crash, limit recursiveness here.
-  if (++depth >= 5000 || subs == NULL) {
-    depth--;
+  if (++rex->nfa_addstate_depth >= 5000 || subs == NULL) {
+    rex->nfa_addstate_depth--;
     return NULL;
   }
 
@@ -4846,11 +4975,11 @@ static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_ar
     // "^" won't match past end-of-line, don't bother trying.
     // Except when at the end of the line, or when we are going to the
     // next line for a look-behind match.
-    if (rex.input > rex.line
-        && *rex.input != NUL
-        && (nfa_endp == NULL
+    if (rex->input > rex->line
+        && *rex->input != NUL
+        && (rex->nfa_endp == NULL
             || !REG_MULTI
-            || rex.lnum == nfa_endp->se_u.pos.lnum)) {
+            || rex->lnum == rex->nfa_endp->se_u.pos.lnum)) {
       goto skip_add;
     }
     FALLTHROUGH;
@@ -4881,12 +5010,12 @@ static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_ar
   // endless loop for "\(\)*"
 
   default:
-    if (state->lastlist[nfa_ll_index] == l->id && state->c != NFA_SKIP) {
+    if (rex->work->nfa_lastlist[state->id][rex->nfa_ll_index] == l->id && state->c != NFA_SKIP) {
       // This state is already in the list, don't add it again,
       // unless it is an MOPEN that is used for a backreference or
       // when there is a PIM. For NFA_MATCH check the position,
       // lower position is preferred.
-      if (!rex.nfa_has_backref && pim == NULL && !l->has_pim
+      if (!rex->nfa_has_backref && pim == NULL && !l->has_pim
           && state->c != NFA_MATCH) {
         // When called from addstate_here() do insert before
         // existing states.
@@ -4908,14 +5037,14 @@ skip_add:
                   abs(state->id), l->id, state->c, code,
                   pim == NULL ? "NULL" : "yes", l->has_pim, found);
 #endif
-          depth--;
+          rex->nfa_addstate_depth--;
           return subs;
         }
       }
 
       // Do not add the state again when it exists with the same
       // positions.
-      if (has_state_with_pos(l, state, subs, pim)) {
+      if (has_state_with_pos(rex, l, state, subs, pim)) {
         goto skip_add;
       }
     }
@@ -4927,18 +5056,18 @@ skip_add:
       const size_t newsize = (size_t)newlen * sizeof(nfa_thread_T);
 
       if ((long)(newsize >> 10) >= p_mmp) {
-        emsg(_(e_maxmempat));
-        depth--;
+        reg_emsg(rex, _(e_maxmempat));
+        rex->nfa_addstate_depth--;
         return NULL;
       }
-      if (subs != &temp_subs) {
+      if (subs != &rex->nfa_temp_subs) {
         // "subs" may point into the current array, need to make a
         // copy before it becomes invalid.
-        copy_sub(&temp_subs.norm, &subs->norm);
-        if (rex.nfa_has_zsubexpr) {
-          copy_sub(&temp_subs.synt, &subs->synt);
+        copy_sub(rex, &rex->nfa_temp_subs.norm, &subs->norm);
+        if (rex->nfa_has_zsubexpr) {
+          copy_sub(rex, &rex->nfa_temp_subs.synt, &subs->synt);
         }
-        subs = &temp_subs;
+        subs = &rex->nfa_temp_subs;
       }
 
       nfa_thread_T *const newt = xrealloc(l->t, newsize);
@@ -4947,28 +5076,28 @@ skip_add:
     }
 
     // add the state to the list
-    state->lastlist[nfa_ll_index] = l->id;
+    rex->work->nfa_lastlist[state->id][rex->nfa_ll_index] = l->id;
     thread = &l->t[l->n++];
     thread->state = state;
     if (pim == NULL) {
       thread->pim.result = NFA_PIM_UNUSED;
     } else {
-      copy_pim(&thread->pim, pim);
+      copy_pim(rex, &thread->pim, pim);
       l->has_pim = true;
     }
-    copy_sub(&thread->subs.norm, &subs->norm);
-    if (rex.nfa_has_zsubexpr) {
-      copy_sub(&thread->subs.synt, &subs->synt);
+    copy_sub(rex, &thread->subs.norm, &subs->norm);
+    if (rex->nfa_has_zsubexpr) {
+      copy_sub(rex, &thread->subs.synt, &subs->synt);
     }
 #ifdef REGEXP_DEBUG
-    report_state("Adding", &thread->subs.norm, state, l->id, pim);
+    report_state(rex, "Adding", &thread->subs.norm, state, l->id, pim);
     did_print = true;
 #endif
   }
 
 #ifdef REGEXP_DEBUG
   if (!did_print) {
-    report_state("Processing", &subs->norm, state, l->id, pim);
+    report_state(rex, "Processing", &subs->norm, state, l->id, pim);
   }
 #endif
   switch (state->c) {
@@ -4977,14 +5106,14 @@ skip_add:
 
   case NFA_SPLIT:
     // order matters here
-    subs = addstate(l, state->out, subs, pim, off_arg);
-    subs = addstate(l, state->out1, subs, pim, off_arg);
+    subs = addstate(rex, l, state->out, subs, pim, off_arg);
+    subs = addstate(rex, l, state->out1, subs, pim, off_arg);
     break;
 
   case NFA_EMPTY:
   case NFA_NOPEN:
   case NFA_NCLOSE:
-    subs = addstate(l, state->out, subs, pim, off_arg);
+    subs = addstate(rex, l, state->out, subs, pim, off_arg);
     break;
 
   case NFA_MOPEN:
@@ -5038,12 +5167,12 @@ skip_add:
         sub->in_use = subidx + 1;
       }
       if (off == -1) {
-        sub->list.multi[subidx].start_lnum = rex.lnum + 1;
+        sub->list.multi[subidx].start_lnum = rex->lnum + 1;
         sub->list.multi[subidx].start_col = 0;
       } else {
-        sub->list.multi[subidx].start_lnum = rex.lnum;
+        sub->list.multi[subidx].start_lnum = rex->lnum;
         sub->list.multi[subidx].start_col =
-          (colnr_T)(rex.input - rex.line + off);
+          (colnr_T)(rex->input - rex->line + off);
       }
       sub->list.multi[subidx].end_lnum = -1;
     } else {
@@ -5058,10 +5187,10 @@ skip_add:
         }
         sub->in_use = subidx + 1;
       }
-      sub->list.line[subidx].start = rex.input + off;
+      sub->list.line[subidx].start = rex->input + off;
     }
 
-    subs = addstate(l, state->out, subs, pim, off_arg);
+    subs = addstate(rex, l, state->out, subs, pim, off_arg);
     if (subs == NULL) {
       break;
     }
@@ -5084,12 +5213,12 @@ skip_add:
     break;
 
   case NFA_MCLOSE:
-    if (rex.nfa_has_zend
+    if (rex->nfa_has_zend
         && (REG_MULTI
             ? subs->norm.list.multi[0].end_lnum >= 0
             : subs->norm.list.line[0].end != NULL)) {
       // Do not overwrite the position set by \ze.
-      subs = addstate(l, state->out, subs, pim, off_arg);
+      subs = addstate(rex, l, state->out, subs, pim, off_arg);
       break;
     }
     FALLTHROUGH;
@@ -5133,23 +5262,23 @@ skip_add:
     if (REG_MULTI) {
       save_multipos = sub->list.multi[subidx];
       if (off == -1) {
-        sub->list.multi[subidx].end_lnum = rex.lnum + 1;
+        sub->list.multi[subidx].end_lnum = rex->lnum + 1;
         sub->list.multi[subidx].end_col = 0;
       } else {
-        sub->list.multi[subidx].end_lnum = rex.lnum;
+        sub->list.multi[subidx].end_lnum = rex->lnum;
         sub->list.multi[subidx].end_col =
-          (colnr_T)(rex.input - rex.line + off);
+          (colnr_T)(rex->input - rex->line + off);
       }
       // avoid compiler warnings
       save_ptr = NULL;
     } else {
       save_ptr = sub->list.line[subidx].end;
-      sub->list.line[subidx].end = rex.input + off;
+      sub->list.line[subidx].end = rex->input + off;
       // avoid compiler warnings
       CLEAR_FIELD(save_multipos);
     }
 
-    subs = addstate(l, state->out, subs, pim, off_arg);
+    subs = addstate(rex, l, state->out, subs, pim, off_arg);
     if (subs == NULL) {
       break;
     }
@@ -5168,7 +5297,7 @@ skip_add:
     sub->in_use = save_in_use;
     break;
   }
-  depth--;
+  rex->nfa_addstate_depth--;
   return subs;
 }
 
@@ -5181,9 +5310,9 @@ skip_add:
 /// @param state  state to update
 /// @param subs   pointers to subexpressions
 /// @param pim    postponed look-behind match
-static regsubs_T *addstate_here(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs, nfa_pim_T *pim,
-                                int *ip)
-  FUNC_ATTR_NONNULL_ARG(1, 2, 5) FUNC_ATTR_WARN_UNUSED_RESULT
+static regsubs_T *addstate_here(regexec_T *rex, nfa_list_T *l, nfa_state_T *state, regsubs_T *subs,
+                                nfa_pim_T *pim, int *ip)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 3, 6) FUNC_ATTR_WARN_UNUSED_RESULT
 {
   int tlen = l->n;
   int count;
@@ -5192,7 +5321,7 @@ static regsubs_T *addstate_here(nfa_list_T *l, nfa_state_T *state, regsubs_T *su
   // First add the state(s) at the end, so that we know how many there are.
   // Pass the listidx as offset (avoids adding another argument to
   // addstate()).
-  regsubs_T *r = addstate(l, state, subs, pim, -listidx - ADDSTATE_HERE_OFFSET);
+  regsubs_T *r = addstate(rex, l, state, subs, pim, -listidx - ADDSTATE_HERE_OFFSET);
   if (r == NULL) {
     return NULL;
   }
@@ -5218,7 +5347,7 @@ static regsubs_T *addstate_here(nfa_list_T *l, nfa_state_T *state, regsubs_T *su
       const size_t newsize = (size_t)newlen * sizeof(nfa_thread_T);
 
       if ((long)(newsize >> 10) >= p_mmp) {
-        emsg(_(e_maxmempat));
+        reg_emsg(rex, _(e_maxmempat));
         return NULL;
       }
       nfa_thread_T *const newl = xmalloc(newsize);
@@ -5252,7 +5381,7 @@ static regsubs_T *addstate_here(nfa_list_T *l, nfa_state_T *state, regsubs_T *su
 }
 
 // Check character class "class" against current character c.
-static int check_char_class(int cls, int c)
+static int check_char_class(regexec_T *rex, int cls, int c)
 {
   switch (cls) {
   case NFA_CLASS_ALNUM:
@@ -5341,7 +5470,7 @@ static int check_char_class(int cls, int c)
     }
     break;
   case NFA_CLASS_KEYWORD:
-    if (reg_iswordc(c)) {
+    if (reg_iswordc(rex, c)) {
       return OK;
     }
     break;
@@ -5353,7 +5482,11 @@ static int check_char_class(int cls, int c)
 
   default:
     // should not be here :P
-    siemsg(_(e_ill_char_class), (int64_t)cls);
+    if (rex->work->thread) {
+      rex->work->failed = true;
+    } else {
+      siemsg(_(e_ill_char_class), (int64_t)cls);
+    }
     return FAIL;
   }
   return FAIL;
@@ -5365,7 +5498,7 @@ static int check_char_class(int cls, int c)
 /// @param bytelen  out: length of match in bytes
 ///
 /// @return  true if it matches.
-static int match_backref(regsub_T *sub, int subidx, int *bytelen)
+static int match_backref(regexec_T *rex, regsub_T *sub, int subidx, int *bytelen)
 {
   int len;
 
@@ -5381,17 +5514,17 @@ retempty:
         || sub->list.multi[subidx].end_lnum < 0) {
       goto retempty;
     }
-    if (sub->list.multi[subidx].start_lnum == rex.lnum
-        && sub->list.multi[subidx].end_lnum == rex.lnum) {
+    if (sub->list.multi[subidx].start_lnum == rex->lnum
+        && sub->list.multi[subidx].end_lnum == rex->lnum) {
       len = sub->list.multi[subidx].end_col
             - sub->list.multi[subidx].start_col;
-      if (cstrncmp((char *)rex.line + sub->list.multi[subidx].start_col,
-                   (char *)rex.input, &len) == 0) {
+      if (cstrncmp(rex, (char *)rex->line + sub->list.multi[subidx].start_col,
+                   (char *)rex->input, &len) == 0) {
         *bytelen = len;
         return true;
       }
     } else {
-      if (match_with_backref(sub->list.multi[subidx].start_lnum,
+      if (match_with_backref(rex, sub->list.multi[subidx].start_lnum,
                              sub->list.multi[subidx].start_col,
                              sub->list.multi[subidx].end_lnum,
                              sub->list.multi[subidx].end_col,
@@ -5405,7 +5538,7 @@ retempty:
       goto retempty;
     }
     len = (int)(sub->list.line[subidx].end - sub->list.line[subidx].start);
-    if (cstrncmp((char *)sub->list.line[subidx].start, (char *)rex.input, &len) == 0) {
+    if (cstrncmp(rex, (char *)sub->list.line[subidx].start, (char *)rex->input, &len) == 0) {
       *bytelen = len;
       return true;
     }
@@ -5418,11 +5551,11 @@ retempty:
 /// @param bytelen  out: length of match in bytes
 ///
 /// @return  true if it matches.
-static int match_zref(int subidx, int *bytelen)
+static int match_zref(regexec_T *rex, int subidx, int *bytelen)
 {
   int len;
 
-  cleanup_zsubexpr();
+  cleanup_zsubexpr(rex);
   if (re_extmatch_in == NULL || re_extmatch_in->matches[subidx] == NULL) {
     // backref was not set, match an empty string
     *bytelen = 0;
@@ -5430,7 +5563,7 @@ static int match_zref(int subidx, int *bytelen)
   }
 
   len = (int)strlen((char *)re_extmatch_in->matches[subidx]);
-  if (cstrncmp((char *)re_extmatch_in->matches[subidx], (char *)rex.input, &len) == 0) {
+  if (cstrncmp(rex, (char *)re_extmatch_in->matches[subidx], (char *)rex->input, &len) == 0) {
     *bytelen = len;
     return true;
   }
@@ -5440,30 +5573,19 @@ static int match_zref(int subidx, int *bytelen)
 // Save list IDs for all NFA states of "prog" into "list".
 // Also reset the IDs to zero.
 // Only used for the recursive value lastlist[1].
-static void nfa_save_listids(nfa_regprog_T *prog, int *list)
+static void nfa_save_listids(regexec_T *rex, nfa_regprog_T *prog, int *list)
 {
-  int i;
-  nfa_state_T *p;
-
-  // Order in the list is reverse, it's a bit faster that way.
-  p = &prog->state[0];
-  for (i = prog->nstate; --i >= 0;) {
-    list[i] = p->lastlist[1];
-    p->lastlist[1] = 0;
-    p++;
+  for (int i = 0; i < prog->nstate; i++) {
+    list[i] = rex->work->nfa_lastlist[i][1];
+    rex->work->nfa_lastlist[i][1] = 0;
   }
 }
 
 // Restore list IDs from "list" to all NFA states.
-static void nfa_restore_listids(nfa_regprog_T *prog, int *list)
+static void nfa_restore_listids(regexec_T *rex, nfa_regprog_T *prog, int *list)
 {
-  int i;
-  nfa_state_T *p;
-
-  p = &prog->state[0];
-  for (i = prog->nstate; --i >= 0;) {
-    p->lastlist[1] = list[i];
-    p++;
+  for (int i = 0; i < prog->nstate; i++) {
+    rex->work->nfa_lastlist[i][1] = list[i];
   }
 }
 
@@ -5481,15 +5603,16 @@ static bool nfa_re_num_cmp(uintmax_t val, int op, uintmax_t pos)
 // Recursively call nfa_regmatch()
 // "pim" is NULL or contains info about a Postponed Invisible Match (start
 // position).
-static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T *prog,
-                              regsubs_T *submatch, regsubs_T *m, int **listids, int *listids_len)
-  FUNC_ATTR_NONNULL_ARG(1, 3, 5, 6, 7)
+static int recursive_regmatch(regexec_T *rex, nfa_state_T *state, nfa_pim_T *pim,
+                              nfa_regprog_T *prog, regsubs_T *submatch, regsubs_T *m, int **listids,
+                              int *listids_len)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 4, 6, 7, 8)
 {
-  const int save_reginput_col = (int)(rex.input - rex.line);
-  const int save_reglnum = rex.lnum;
-  const int save_nfa_match = nfa_match;
-  const int save_nfa_listid = rex.nfa_listid;
-  save_se_T *const save_nfa_endp = nfa_endp;
+  const int save_reginput_col = (int)(rex->input - rex->line);
+  const int save_reglnum = rex->lnum;
+  const int save_nfa_match = rex->nfa_match;
+  const int save_nfa_listid = rex->nfa_listid;
+  save_se_T *const save_nfa_endp = rex->nfa_endp;
   save_se_T endpos;
   save_se_T *endposp = NULL;
   int need_restore = false;
@@ -5497,9 +5620,9 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
   if (pim != NULL) {
     // start at the position where the postponed match was
     if (REG_MULTI) {
-      rex.input = rex.line + pim->end.pos.col;
+      rex->input = rex->line + pim->end.pos.col;
     } else {
-      rex.input = pim->end.ptr;
+      rex->input = pim->end.ptr;
     }
   }
 
@@ -5512,14 +5635,14 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     endposp = &endpos;
     if (REG_MULTI) {
       if (pim == NULL) {
-        endpos.se_u.pos.col = (int)(rex.input - rex.line);
-        endpos.se_u.pos.lnum = rex.lnum;
+        endpos.se_u.pos.col = (int)(rex->input - rex->line);
+        endpos.se_u.pos.lnum = rex->lnum;
       } else {
         endpos.se_u.pos = pim->end.pos;
       }
     } else {
       if (pim == NULL) {
-        endpos.se_u.ptr = rex.input;
+        endpos.se_u.ptr = rex->input;
       } else {
         endpos.se_u.ptr = pim->end.ptr;
       }
@@ -5531,31 +5654,31 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     // bytes if possible.
     if (state->val <= 0) {
       if (REG_MULTI) {
-        rex.line = (uint8_t *)reg_getline(--rex.lnum);
-        if (rex.line == NULL) {
+        rex->line = (uint8_t *)reg_getline(rex, --rex->lnum);
+        if (rex->line == NULL) {
           // can't go before the first line
-          rex.line = (uint8_t *)reg_getline(++rex.lnum);
+          rex->line = (uint8_t *)reg_getline(rex, ++rex->lnum);
         }
       }
-      rex.input = rex.line;
+      rex->input = rex->line;
     } else {
-      if (REG_MULTI && (int)(rex.input - rex.line) < state->val) {
+      if (REG_MULTI && (int)(rex->input - rex->line) < state->val) {
         // Not enough bytes in this line, go to end of
         // previous line.
-        rex.line = (uint8_t *)reg_getline(--rex.lnum);
-        if (rex.line == NULL) {
+        rex->line = (uint8_t *)reg_getline(rex, --rex->lnum);
+        if (rex->line == NULL) {
           // can't go before the first line
-          rex.line = (uint8_t *)reg_getline(++rex.lnum);
-          rex.input = rex.line;
+          rex->line = (uint8_t *)reg_getline(rex, ++rex->lnum);
+          rex->input = rex->line;
         } else {
-          rex.input = rex.line + strlen((char *)rex.line);
+          rex->input = rex->line + strlen((char *)rex->line);
         }
       }
-      if ((int)(rex.input - rex.line) >= state->val) {
-        rex.input -= state->val;
-        rex.input -= utf_head_off((char *)rex.line, (char *)rex.input);
+      if ((int)(rex->input - rex->line) >= state->val) {
+        rex->input -= state->val;
+        rex->input -= utf_head_off((char *)rex->line, (char *)rex->input);
       } else {
-        rex.input = rex.line;
+        rex->input = rex->line;
       }
     }
   }
@@ -5568,7 +5691,7 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
 #endif
   // Have to clear the lastlist field of the NFA nodes, so that
   // nfa_regmatch() and addstate() can run properly after recursion.
-  if (nfa_ll_index == 1) {
+  if (rex->nfa_ll_index == 1) {
     // Already calling nfa_regmatch() recursively.  Save the lastlist[1]
     // values and clear them.
     if (*listids == NULL || *listids_len < prog->nstate) {
@@ -5576,45 +5699,45 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
       *listids = xmalloc(sizeof(**listids) * (size_t)prog->nstate);
       *listids_len = prog->nstate;
     }
-    nfa_save_listids(prog, *listids);
+    nfa_save_listids(rex, prog, *listids);
     need_restore = true;
-    // any value of rex.nfa_listid will do
+    // any value of rex->nfa_listid will do
   } else {
     // First recursive nfa_regmatch() call, switch to the second lastlist
-    // entry.  Make sure rex.nfa_listid is different from a previous
+    // entry.  Make sure rex->nfa_listid is different from a previous
     // recursive call, because some states may still have this ID.
-    nfa_ll_index++;
-    if (rex.nfa_listid <= rex.nfa_alt_listid) {
-      rex.nfa_listid = rex.nfa_alt_listid;
+    rex->nfa_ll_index++;
+    if (rex->nfa_listid <= rex->nfa_alt_listid) {
+      rex->nfa_listid = rex->nfa_alt_listid;
     }
   }
 
   // Call nfa_regmatch() to check if the current concat matches at this
   // position. The concat ends with the node NFA_END_INVISIBLE
-  nfa_endp = endposp;
-  const int result = nfa_regmatch(prog, state->out, submatch, m);
+  rex->nfa_endp = endposp;
+  const int result = nfa_regmatch(rex, prog, state->out, submatch, m);
 
   if (need_restore) {
-    nfa_restore_listids(prog, *listids);
+    nfa_restore_listids(rex, prog, *listids);
   } else {
-    nfa_ll_index--;
-    rex.nfa_alt_listid = rex.nfa_listid;
+    rex->nfa_ll_index--;
+    rex->nfa_alt_listid = rex->nfa_listid;
   }
 
   // restore position in input text
-  rex.lnum = save_reglnum;
+  rex->lnum = save_reglnum;
   if (REG_MULTI) {
-    rex.line = (uint8_t *)reg_getline(rex.lnum);
+    rex->line = (uint8_t *)reg_getline(rex, rex->lnum);
   }
-  rex.input = rex.line + save_reginput_col;
+  rex->input = rex->line + save_reginput_col;
   if (result != NFA_TOO_EXPENSIVE) {
-    nfa_match = save_nfa_match;
-    rex.nfa_listid = save_nfa_listid;
+    rex->nfa_match = save_nfa_match;
+    rex->nfa_listid = save_nfa_listid;
   }
-  nfa_endp = save_nfa_endp;
+  rex->nfa_endp = save_nfa_endp;
 
 #ifdef REGEXP_DEBUG
-  open_debug_log(result);
+  open_debug_log(rex, result);
 #endif
 
   return result;
@@ -5779,37 +5902,505 @@ static int failure_chance(nfa_state_T *state, int depth)
 }
 
 // Skip until the char "c" we know a match must start with.
-static int skip_to_start(int c, colnr_T *colp)
+static int skip_to_start(regexec_T *rex, int c, colnr_T *colp)
 {
-  const uint8_t *const s = (uint8_t *)cstrchr((char *)rex.line + *colp, c);
+  const uint8_t *const s = (uint8_t *)cstrchr(rex, (char *)rex->line + *colp, c);
   if (s == NULL) {
     return FAIL;
   }
-  *colp = (int)(s - rex.line);
+  *colp = (int)(s - rex->line);
   return OK;
 }
 
+// Check whether character "curc" matches the collection starting at state
+// "start", which is NFA_START_COLL or NFA_START_NEG_COLL.
+static bool match_collection(regexec_T *rex, nfa_state_T *start, int curc)
+{
+  // What follows is a list of characters, until NFA_END_COLL.
+  // One of them must match or none of them must match.
+  nfa_state_T *state = start->out;
+  const bool result_if_matched = (start->c == NFA_START_COLL);
+  for (;;) {
+    if (state->c == NFA_END_COLL) {
+      return !result_if_matched;
+    }
+    if (state->c == NFA_RANGE_MIN) {
+      int c1 = state->val;
+      state = state->out;             // advance to NFA_RANGE_MAX
+      int c2 = state->val;
+#ifdef REGEXP_DEBUG
+      fprintf(log_fd, "NFA_RANGE_MIN curc=%d c1=%d c2=%d\n",
+              curc, c1, c2);
+#endif
+      if (curc >= c1 && curc <= c2) {
+        return result_if_matched;
+      }
+      if (rex->reg_ic) {
+        int curc_low = utf_fold(curc);
+
+        for (; c1 <= c2; c1++) {
+          if (utf_fold(c1) == curc_low) {
+            return result_if_matched;
+          }
+        }
+      }
+    } else if (state->c < 0 ? check_char_class(rex, state->c, curc)
+               : (curc == state->c
+                  || (rex->reg_ic
+                      && utf_fold(curc) == utf_fold(state->c)))) {
+      return result_if_matched;
+    }
+    state = state->out;
+  }
+}
+
+// Return true when "startset" of "prog" can be used to skip positions where a
+// match cannot start.  With 'ignorecase' a non-ASCII character may fold to an
+// ASCII one, thus then only a set of ASCII bytes can be used.
+static bool use_startset(regexec_T *rex, const nfa_regprog_T *prog)
+{
+  return prog->startset != NULL
+         && !rex->reg_icombine
+         && (!rex->reg_ic || prog->startset_ascii);
+}
+
+// Return true when a match of "prog" may start with byte "b".
+static bool startset_has(regexec_T *rex, const nfa_regprog_T *prog, uint8_t b)
+{
+  if (prog->startset[b]) {
+    return true;
+  }
+  return rex->reg_ic
+         && (b >= 0x80
+             || prog->startset[TOLOWER_ASC(b)]
+             || prog->startset[TOUPPER_ASC(b)]);
+}
+
+// Skip to the first byte a match of "prog" may start with, at or after
+// "*colp".  Return FAIL if there is none.
+static int skip_to_startset(regexec_T *rex, const nfa_regprog_T *prog, colnr_T *colp)
+{
+  const uint8_t *s = rex->line + *colp;
+  while (*s != NUL && !startset_has(rex, prog, *s)) {
+    s++;
+  }
+  if (*s == NUL) {
+    return FAIL;
+  }
+  *colp = (int)(s - rex->line);
+  return OK;
+}
+
+// Return true when the DFA can simulate NFA state "state".
+static bool nfa_dfa_supports(const nfa_state_T *state)
+{
+  switch (state->c) {
+  // epsilon and zero-width states
+  case NFA_SPLIT:
+  case NFA_EMPTY:
+  case NFA_MATCH:
+  case NFA_BOL:
+  case NFA_EOL:
+  case NFA_ZSTART:
+  case NFA_ZEND:
+  case NFA_ANY_COMPOSING:
+  case NFA_MOPEN:
+  case NFA_MOPEN1:
+  case NFA_MOPEN2:
+  case NFA_MOPEN3:
+  case NFA_MOPEN4:
+  case NFA_MOPEN5:
+  case NFA_MOPEN6:
+  case NFA_MOPEN7:
+  case NFA_MOPEN8:
+  case NFA_MOPEN9:
+  case NFA_MCLOSE:
+  case NFA_MCLOSE1:
+  case NFA_MCLOSE2:
+  case NFA_MCLOSE3:
+  case NFA_MCLOSE4:
+  case NFA_MCLOSE5:
+  case NFA_MCLOSE6:
+  case NFA_MCLOSE7:
+  case NFA_MCLOSE8:
+  case NFA_MCLOSE9:
+  case NFA_NOPEN:
+  case NFA_NCLOSE:
+
+  // states that consume a character
+  case NFA_ANY:
+  case NFA_START_COLL:
+  case NFA_START_NEG_COLL:
+  case NFA_WHITE:
+  case NFA_NWHITE:
+  case NFA_DIGIT:
+  case NFA_NDIGIT:
+  case NFA_HEX:
+  case NFA_NHEX:
+  case NFA_OCTAL:
+  case NFA_NOCTAL:
+  case NFA_WORD:
+  case NFA_NWORD:
+  case NFA_HEAD:
+  case NFA_NHEAD:
+  case NFA_ALPHA:
+  case NFA_NALPHA:
+  case NFA_LOWER:
+  case NFA_NLOWER:
+  case NFA_UPPER:
+  case NFA_NUPPER:
+  case NFA_LOWER_IC:
+  case NFA_NLOWER_IC:
+  case NFA_UPPER_IC:
+  case NFA_NUPPER_IC:
+
+  // items inside a collection
+  case NFA_END_COLL:
+  case NFA_RANGE_MIN:
+  case NFA_RANGE_MAX:
+  case NFA_CLASS_ALNUM:
+  case NFA_CLASS_ALPHA:
+  case NFA_CLASS_BLANK:
+  case NFA_CLASS_CNTRL:
+  case NFA_CLASS_DIGIT:
+  case NFA_CLASS_GRAPH:
+  case NFA_CLASS_LOWER:
+  case NFA_CLASS_PUNCT:
+  case NFA_CLASS_SPACE:
+  case NFA_CLASS_UPPER:
+  case NFA_CLASS_XDIGIT:
+  case NFA_CLASS_TAB:
+  case NFA_CLASS_RETURN:
+  case NFA_CLASS_BACKSPACE:
+  case NFA_CLASS_ESCAPE:
+    return true;
+
+  default:
+    // A regular character.  Everything else depends on the position, a
+    // buffer, options or other matches.
+    return state->c > 0;
+  }
+}
+
+// Return true when NFA state "state", which consumes a character, matches
+// character "c".
+static bool nfa_dfa_char_match(regexec_T *rex, const nfa_state_T *state, int c)
+{
+  switch (state->c) {
+  case NFA_MATCH:
+  case NFA_EOL:
+    return false;
+  case NFA_ANY:
+    return c > 0;
+  case NFA_START_COLL:
+  case NFA_START_NEG_COLL:
+    return match_collection(rex, (nfa_state_T *)state, c);
+  case NFA_WHITE:
+    return ascii_iswhite(c);
+  case NFA_NWHITE:
+    return !ascii_iswhite(c);
+  case NFA_DIGIT:
+    return ri_digit(c);
+  case NFA_NDIGIT:
+    return !ri_digit(c);
+  case NFA_HEX:
+    return ri_hex(c);
+  case NFA_NHEX:
+    return !ri_hex(c);
+  case NFA_OCTAL:
+    return ri_octal(c);
+  case NFA_NOCTAL:
+    return !ri_octal(c);
+  case NFA_WORD:
+    return ri_word(c);
+  case NFA_NWORD:
+    return !ri_word(c);
+  case NFA_HEAD:
+    return ri_head(c);
+  case NFA_NHEAD:
+    return !ri_head(c);
+  case NFA_ALPHA:
+    return ri_alpha(c);
+  case NFA_NALPHA:
+    return !ri_alpha(c);
+  case NFA_LOWER:
+    return ri_lower(c);
+  case NFA_NLOWER:
+    return !ri_lower(c);
+  case NFA_UPPER:
+    return ri_upper(c);
+  case NFA_NUPPER:
+    return !ri_upper(c);
+  case NFA_LOWER_IC:
+    return ri_lower(c) || (rex->reg_ic && ri_upper(c));
+  case NFA_NLOWER_IC:
+    return !(ri_lower(c) || (rex->reg_ic && ri_upper(c)));
+  case NFA_UPPER_IC:
+    return ri_upper(c) || (rex->reg_ic && ri_lower(c));
+  case NFA_NUPPER_IC:
+    return !(ri_upper(c) || (rex->reg_ic && ri_lower(c)));
+  default:
+    return c == state->c || (rex->reg_ic && utf_fold(c) == utf_fold(state->c));
+  }
+}
+
+// Add the NFA states in dfa->work and the states reachable from them without
+// consuming a character to dfa->set, sorted.  "at_bol" and "at_eol" tell
+// whether "^" and "$" match.
+static void nfa_dfa_closure(nfa_regprog_T *prog, nfa_dfa_T *dfa, bool at_bol, bool at_eol)
+{
+  dfa->generation++;
+  kv_size(dfa->set) = 0;
+  while (kv_size(dfa->work) > 0) {
+    int idx = kv_pop(dfa->work);
+    if (dfa->mark[idx] == dfa->generation) {
+      continue;
+    }
+    dfa->mark[idx] = dfa->generation;
+
+    nfa_state_T *state = &prog->state[idx];
+    switch (state->c) {
+    case NFA_SPLIT:
+      kv_push(dfa->work, (int)(state->out1 - prog->state));
+      kv_push(dfa->work, (int)(state->out - prog->state));
+      break;
+
+    case NFA_BOL:
+      if (at_bol) {
+        kv_push(dfa->work, (int)(state->out - prog->state));
+      }
+      break;
+
+    case NFA_EOL:
+      if (at_eol) {
+        kv_push(dfa->work, (int)(state->out - prog->state));
+      } else {
+        kv_push(dfa->set, idx);
+      }
+      break;
+
+    case NFA_MATCH:
+    case NFA_ANY:
+    case NFA_START_COLL:
+    case NFA_START_NEG_COLL:
+      kv_push(dfa->set, idx);
+      break;
+
+    default:
+      if (state->c > 0 || (state->c >= NFA_WHITE && state->c <= NFA_NUPPER_IC)) {
+        kv_push(dfa->set, idx);
+      } else {
+        // zero-width state
+        kv_push(dfa->work, (int)(state->out - prog->state));
+      }
+      break;
+    }
+  }
+  qsort(dfa->set.items, kv_size(dfa->set), sizeof(int), nfa_dfa_cmp);
+}
+
+static int nfa_dfa_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+// Get the index of the DFA state for the NFA states in dfa->set, adding it
+// when needed.  Returns -1 when there are too many DFA states.
+static int nfa_dfa_add_state(nfa_regprog_T *prog, nfa_dfa_T *dfa)
+{
+  String key = { .data = (char *)dfa->set.items, .size = kv_size(dfa->set) * sizeof(int) };
+  int id = map_get(String, int)(&dfa->ids, key);
+  if (id > 0) {
+    return id - 1;
+  }
+  if (kv_size(dfa->states) >= NFA_DFA_MAX_STATES) {
+    return -1;
+  }
+
+  nfa_dfa_state_T *ds = xmalloc(sizeof(nfa_dfa_state_T));
+  ds->nstates = (int)kv_size(dfa->set);
+  ds->states = xmemdup(dfa->set.items, key.size);
+  ds->match = false;
+  for (int i = 0; i < ds->nstates; i++) {
+    if (prog->state[ds->states[i]].c == NFA_MATCH) {
+      ds->match = true;
+    }
+  }
+  ds->eol_match = -1;
+  memset(ds->next, -1, sizeof(ds->next));
+
+  kv_push(dfa->states, ds);
+  key.data = (char *)ds->states;
+  map_put(String, int)(&dfa->ids, key, (int)kv_size(dfa->states));
+  return (int)kv_size(dfa->states) - 1;
+}
+
+// Get the DFA state after DFA state "si" when the next character is "c".
+// Returns -1 when there are too many DFA states.
+static int nfa_dfa_next(regexec_T *rex, nfa_regprog_T *prog, nfa_dfa_T *dfa, int si, int c)
+{
+  nfa_dfa_state_T *ds = kv_A(dfa->states, si);
+  if (c < 128 && ds->next[c] >= 0) {
+    return ds->next[c];
+  }
+
+  // A match may also start at the next position.
+  kv_size(dfa->work) = 0;
+  kv_push(dfa->work, (int)(prog->start - prog->state));
+  for (int i = 0; i < ds->nstates; i++) {
+    nfa_state_T *state = &prog->state[ds->states[i]];
+    if (nfa_dfa_char_match(rex, state, c)) {
+      nfa_state_T *out = (state->c == NFA_START_COLL || state->c == NFA_START_NEG_COLL)
+                         ? state->out1->out : state->out;
+      kv_push(dfa->work, (int)(out - prog->state));
+    }
+  }
+  nfa_dfa_closure(prog, dfa, false, false);
+  int next = nfa_dfa_add_state(prog, dfa);
+  if (c < 128) {
+    ds->next[c] = next;
+  }
+  return next;
+}
+
+// Return true when a match ends at the end of the line when DFA state "ds"
+// is active there.
+static bool nfa_dfa_eol_match(nfa_regprog_T *prog, nfa_dfa_T *dfa, nfa_dfa_state_T *ds)
+{
+  if (ds->eol_match < 0) {
+    kv_size(dfa->work) = 0;
+    for (int i = 0; i < ds->nstates; i++) {
+      if (prog->state[ds->states[i]].c == NFA_EOL) {
+        kv_push(dfa->work, ds->states[i]);
+      }
+    }
+    ds->eol_match = false;
+    if (kv_size(dfa->work) > 0) {
+      nfa_dfa_closure(prog, dfa, true, true);
+      for (size_t i = 0; i < kv_size(dfa->set); i++) {
+        if (prog->state[kv_A(dfa->set, i)].c == NFA_MATCH) {
+          ds->eol_match = true;
+        }
+      }
+    }
+  }
+  return ds->eol_match;
+}
+
+// Free the DFA states of "dfa".
+static void nfa_dfa_clear(nfa_dfa_T *dfa)
+{
+  for (size_t i = 0; i < kv_size(dfa->states); i++) {
+    xfree(kv_A(dfa->states, i)->states);
+    xfree(kv_A(dfa->states, i));
+  }
+  kv_size(dfa->states) = 0;
+  map_clear(String, int)(&dfa->ids);
+  dfa->start_bol = -1;
+  dfa->start = -1;
+}
+
+static void nfa_dfa_free(nfa_dfa_T *dfa)
+{
+  if (dfa == NULL) {
+    return;
+  }
+  nfa_dfa_clear(dfa);
+  kv_destroy(dfa->states);
+  map_destroy(String, int)(&dfa->ids);
+  xfree(dfa->mark);
+  kv_destroy(dfa->work);
+  kv_destroy(dfa->set);
+  xfree(dfa);
+}
+
+// Return false when "prog" cannot match in the current line at or after
+// column "col".  Returns true when it may match, or when this can't be
+// decided without running the NFA.
+static bool nfa_dfa_may_match(regexec_T *rex, nfa_regprog_T *prog, colnr_T col)
+{
+  nfa_dfa_T *dfa = map_get(uint64_t, ptr_t)(&rex->work->nfa_dfas, prog->id);
+  if (dfa == NULL) {
+    dfa = xcalloc(1, sizeof(nfa_dfa_T));
+    map_put(uint64_t, ptr_t)(&rex->work->nfa_dfas, prog->id, dfa);
+    dfa->usable = true;
+    for (int i = 0; i < prog->nstate; i++) {
+      if (!nfa_dfa_supports(&prog->state[i])) {
+        dfa->usable = false;
+        break;
+      }
+    }
+    if (dfa->usable) {
+      dfa->mark = xcalloc((size_t)prog->nstate, sizeof(int));
+      dfa->reg_ic = rex->reg_ic;
+      dfa->start_bol = -1;
+      dfa->start = -1;
+      kv_resize(dfa->set, 16);
+    }
+  }
+  // With \Z composing characters are ignored, the DFA doesn't do that.
+  if (!dfa->usable || rex->reg_icombine) {
+    return true;
+  }
+  if (dfa->reg_ic != rex->reg_ic) {
+    nfa_dfa_clear(dfa);
+    dfa->reg_ic = rex->reg_ic;
+  }
+
+  int *startp = col == 0 ? &dfa->start_bol : &dfa->start;
+  if (*startp < 0) {
+    kv_size(dfa->work) = 0;
+    kv_push(dfa->work, (int)(prog->start - prog->state));
+    nfa_dfa_closure(prog, dfa, col == 0, false);
+    *startp = nfa_dfa_add_state(prog, dfa);
+  }
+
+  const uint8_t *p = rex->line + col;
+  int si = *startp;
+  while (si >= 0) {
+    nfa_dfa_state_T *ds = kv_A(dfa->states, si);
+    if (ds->match) {
+      return true;
+    }
+    if (*p == NUL) {
+      return nfa_dfa_eol_match(prog, dfa, ds);
+    }
+    int len = utf_ptr2len((char *)p);
+    if (utfc_ptr2len((char *)p) != len) {
+      // Composing characters are matched in a special way.
+      return true;
+    }
+    si = nfa_dfa_next(rex, prog, dfa, si, *p < 0x80 ? *p : utf_ptr2char((char *)p));
+    p += len;
+  }
+
+  // Too many DFA states, don't use it for this pattern any longer.
+  nfa_dfa_clear(dfa);
+  dfa->usable = false;
+  return true;
+}
+
 // Check for a match with match_text.
 // Called after skip_to_start() has found regstart.
 // Returns zero for no match, 1 for a match.
-static long find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text)
+static long find_match_text(regexec_T *rex, colnr_T *startcol, int regstart, uint8_t *match_text)
 {
 #define PTR2LEN(x) utf_ptr2len(x)
 
   colnr_T col = *startcol;
-  int regstart_len = PTR2LEN((char *)rex.line + col);
+  int regstart_len = PTR2LEN((char *)rex->line + col);
 
   for (;;) {
     bool match = true;
     uint8_t *s1 = match_text;
-    uint8_t *s2 = rex.line + col + regstart_len;  // skip regstart
+    uint8_t *s2 = rex->line + col + regstart_len;  // skip regstart
     while (*s1) {
       int c1_len = PTR2LEN((char *)s1);
       int c1 = utf_ptr2char((char *)s1);
       int c2_len = PTR2LEN((char *)s2);
       int c2 = utf_ptr2char((char *)s2);
 
-      if ((c1 != c2 && (!rex.reg_ic || utf_fold(c1) != utf_fold(c2)))
+      if ((c1 != c2 && (!rex->reg_ic || utf_fold(c1) != utf_fold(c2)))
           || c1_len != c2_len) {
         match = false;
         break;
@@ -5820,15 +6411,15 @@ static long find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text
     if (match
         // check that no composing char follows
         && !utf_iscomposing(utf_ptr2char((char *)s2))) {
-      cleanup_subexpr();
+      cleanup_subexpr(rex);
       if (REG_MULTI) {
-        rex.reg_startpos[0].lnum = rex.lnum;
-        rex.reg_startpos[0].col = col;
-        rex.reg_endpos[0].lnum = rex.lnum;
-        rex.reg_endpos[0].col = (colnr_T)(s2 - rex.line);
+        rex->reg_startpos[0].lnum = rex->lnum;
+        rex->reg_startpos[0].col = col;
+        rex->reg_endpos[0].lnum = rex->lnum;
+        rex->reg_endpos[0].col = (colnr_T)(s2 - rex->line);
       } else {
-        rex.reg_startp[0] = rex.line + col;
-        rex.reg_endp[0] = s2;
+        rex->reg_startp[0] = rex->line + col;
+        rex->reg_endp[0] = s2;
       }
       *startcol = col;
       return 1L;
@@ -5836,7 +6427,7 @@ static long find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text
 
     // Try finding regstart after the current match.
     col += regstart_len;  // skip regstart
-    if (skip_to_start(regstart, &col) == FAIL) {
+    if (skip_to_start(rex, regstart, &col) == FAIL) {
       break;
     }
   }
@@ -5847,11 +6438,11 @@ static long find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text
 #undef PTR2LEN
 }
 
-static int nfa_did_time_out(void)
+static int nfa_did_time_out(regexec_T *rex)
 {
-  if (nfa_time_limit != NULL && profile_passed_limit(*nfa_time_limit)) {
-    if (nfa_timed_out != NULL) {
-      *nfa_timed_out = true;
+  if (rex->nfa_time_limit != NULL && profile_passed_limit(*rex->nfa_time_limit)) {
+    if (rex->nfa_timed_out != NULL) {
+      *rex->nfa_timed_out = true;
     }
     return true;
   }
@@ -5869,8 +6460,9 @@ static int nfa_did_time_out(void)
 /// When there is a match "submatch" contains the positions.
 ///
 /// Note: Caller must ensure that: start != NULL.
-static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *submatch, regsubs_T *m)
-  FUNC_ATTR_NONNULL_ARG(1, 2, 4)
+static int nfa_regmatch(regexec_T *rex, nfa_regprog_T *prog, nfa_state_T *start,
+                        regsubs_T *submatch, regsubs_T *m)
+  FUNC_ATTR_NONNULL_ARG(1, 2, 3, 5)
 {
   int result = false;
   int flag = 0;
@@ -5890,11 +6482,11 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
   regsubs_T *r;
   // Some patterns may take a long time to match, especially when using
   // recursive_regmatch(). Allow interrupting them with CTRL-C.
-  reg_breakcheck();
+  reg_breakcheck(rex);
   if (got_int) {
     return false;
   }
-  if (nfa_did_time_out()) {
+  if (nfa_did_time_out(rex)) {
     return false;
   }
 
@@ -5906,7 +6498,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     return false;
   }
 #endif
-  nfa_match = false;
+  rex->nfa_match = false;
 
   // Allocate memory for the lists of nodes.
   size_t size = (size_t)(prog->nstate + 1) * sizeof(nfa_thread_T);
@@ -5937,25 +6529,25 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #ifdef REGEXP_DEBUG
   fprintf(log_fd, "(---) STARTSTATE first\n");
 #endif
-  thislist->id = rex.nfa_listid + 1;
+  thislist->id = rex->nfa_listid + 1;
 
   // Inline optimized code for addstate(thislist, start, m, 0) if we know
   // it's the first MOPEN.
   if (toplevel) {
     if (REG_MULTI) {
-      m->norm.list.multi[0].start_lnum = rex.lnum;
-      m->norm.list.multi[0].start_col = (colnr_T)(rex.input - rex.line);
+      m->norm.list.multi[0].start_lnum = rex->lnum;
+      m->norm.list.multi[0].start_col = (colnr_T)(rex->input - rex->line);
       m->norm.orig_start_col = m->norm.list.multi[0].start_col;
     } else {
-      m->norm.list.line[0].start = rex.input;
+      m->norm.list.line[0].start = rex->input;
     }
     m->norm.in_use = 1;
-    r = addstate(thislist, start->out, m, NULL, 0);
+    r = addstate(rex, thislist, start->out, m, NULL, 0);
   } else {
-    r = addstate(thislist, start, m, NULL, 0);
+    r = addstate(rex, thislist, start, m, NULL, 0);
   }
   if (r == NULL) {
-    nfa_match = NFA_TOO_EXPENSIVE;
+    rex->nfa_match = NFA_TOO_EXPENSIVE;
     goto theend;
   }
 
@@ -5967,8 +6559,8 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
   // Run for each character.
   for (;;) {
-    int curc = utf_ptr2char((char *)rex.input);
-    int clen = utfc_ptr2len((char *)rex.input);
+    int curc = utf_ptr2char((char *)rex->input);
+    int clen = utfc_ptr2len((char *)rex->input);
     if (curc == NUL) {
       clen = 0;
       go_to_nextline = false;
@@ -5979,20 +6571,20 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     nextlist = &list[flag ^= 1];
     nextlist->n = 0;                // clear nextlist
     nextlist->has_pim = false;
-    rex.nfa_listid++;
+    rex->nfa_listid++;
     if (prog->re_engine == AUTOMATIC_ENGINE
-        && (rex.nfa_listid >= NFA_MAX_STATES)) {
+        && (rex->nfa_listid >= NFA_MAX_STATES)) {
       // Too many states, retry with old engine.
-      nfa_match = NFA_TOO_EXPENSIVE;
+      rex->nfa_match = NFA_TOO_EXPENSIVE;
       goto theend;
     }
 
-    thislist->id = rex.nfa_listid;
-    nextlist->id = rex.nfa_listid + 1;
+    thislist->id = rex->nfa_listid;
+    nextlist->id = rex->nfa_listid + 1;
 
 #ifdef REGEXP_DEBUG
     fprintf(log_fd, "------------------------------------------\n");
-    fprintf(log_fd, ">>> Reginput is \"%s\"\n", rex.input);
+    fprintf(log_fd, ">>> Reginput is \"%s\"\n", rex->input);
     fprintf(log_fd,
             ">>> Advanced one character... Current char is %c (code %d) \n",
             curc,
@@ -6020,13 +6612,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     for (listidx = 0; listidx < thislist->n; listidx++) {
       // If the list gets very long there probably is something wrong.
       // At least allow interrupting with CTRL-C.
-      reg_breakcheck();
+      reg_breakcheck(rex);
       if (got_int) {
         break;
       }
-      if (nfa_time_limit != NULL && ++nfa_time_count == 20) {
-        nfa_time_count = 0;
-        if (nfa_did_time_out()) {
+      if (rex->nfa_time_limit != NULL && ++rex->nfa_time_count == 20) {
+        rex->nfa_time_count = 0;
+        if (nfa_did_time_out(rex)) {
           break;
         }
       }
@@ -6045,12 +6637,12 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         } else if (REG_MULTI) {
           col = t->subs.norm.list.multi[0].start_col;
         } else {
-          col = (int)(t->subs.norm.list.line[0].start - rex.line);
+          col = (int)(t->subs.norm.list.line[0].start - rex->line);
         }
         nfa_set_code(t->state->c);
         fprintf(log_fd, "(%d) char %d %s (start col %d)%s... \n",
                 abs(t->state->id), (int)t->state->c, code, col,
-                pim_info(&t->pim));
+                pim_info(rex, &t->pim));
       }
 #endif
 
@@ -6062,24 +6654,24 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       switch (t->state->c) {
       case NFA_MATCH:
         // If the match is not at the start of the line, ends before a
-        // composing characters and rex.reg_icombine is not set, that
+        // composing characters and rex->reg_icombine is not set, that
         // is not really a match.
-        if (!rex.reg_icombine
-            && rex.input != rex.line
+        if (!rex->reg_icombine
+            && rex->input != rex->line
             && utf_iscomposing(curc)) {
           break;
         }
-        nfa_match = true;
-        copy_sub(&submatch->norm, &t->subs.norm);
-        if (rex.nfa_has_zsubexpr) {
-          copy_sub(&submatch->synt, &t->subs.synt);
+        rex->nfa_match = true;
+        copy_sub(rex, &submatch->norm, &t->subs.norm);
+        if (rex->nfa_has_zsubexpr) {
+          copy_sub(rex, &submatch->synt, &t->subs.synt);
         }
 #ifdef REGEXP_DEBUG
-        log_subsexpr(&t->subs);
+        log_subsexpr(rex, &t->subs);
 #endif
         // Found the left-most longest match, do not look at any other
         // states at this position.  When the list of states is going
-        // to be empty quit without advancing, so that "rex.input" is
+        // to be empty quit without advancing, so that "rex->input" is
         // correct.
         if (nextlist->n == 0) {
           clen = 0;
@@ -6099,43 +6691,43 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         // in the position in "nfa_endp".
         // Submatches are stored in *m, and used in the parent call.
 #ifdef REGEXP_DEBUG
-        if (nfa_endp != NULL) {
+        if (rex->nfa_endp != NULL) {
           if (REG_MULTI) {
             fprintf(log_fd,
                     "Current lnum: %d, endp lnum: %d;"
                     " current col: %d, endp col: %d\n",
-                    (int)rex.lnum,
-                    (int)nfa_endp->se_u.pos.lnum,
-                    (int)(rex.input - rex.line),
-                    nfa_endp->se_u.pos.col);
+                    (int)rex->lnum,
+                    (int)rex->nfa_endp->se_u.pos.lnum,
+                    (int)(rex->input - rex->line),
+                    rex->nfa_endp->se_u.pos.col);
           } else {
             fprintf(log_fd, "Current col: %d, endp col: %d\n",
-                    (int)(rex.input - rex.line),
-                    (int)(nfa_endp->se_u.ptr - rex.input));
+                    (int)(rex->input - rex->line),
+                    (int)(rex->nfa_endp->se_u.ptr - rex->input));
           }
         }
 #endif
         // If "nfa_endp" is set it's only a match if it ends at
         // "nfa_endp"
-        if (nfa_endp != NULL
+        if (rex->nfa_endp != NULL
             && (REG_MULTI
-                ? (rex.lnum != nfa_endp->se_u.pos.lnum
-                   || (int)(rex.input - rex.line) != nfa_endp->se_u.pos.col)
-                : rex.input != nfa_endp->se_u.ptr)) {
+                ? (rex->lnum != rex->nfa_endp->se_u.pos.lnum
+                   || (int)(rex->input - rex->line) != rex->nfa_endp->se_u.pos.col)
+                : rex->input != rex->nfa_endp->se_u.ptr)) {
           break;
         }
         // do not set submatches for \@!
         if (t->state->c != NFA_END_INVISIBLE_NEG) {
-          copy_sub(&m->norm, &t->subs.norm);
-          if (rex.nfa_has_zsubexpr) {
-            copy_sub(&m->synt, &t->subs.synt);
+          copy_sub(rex, &m->norm, &t->subs.norm);
+          if (rex->nfa_has_zsubexpr) {
+            copy_sub(rex, &m->synt, &t->subs.synt);
           }
         }
 #ifdef REGEXP_DEBUG
         fprintf(log_fd, "Match found:\n");
-        log_subsexpr(m);
+        log_subsexpr(rex, m);
 #endif
-        nfa_match = true;
+        rex->nfa_match = true;
         // See comment above at "goto nextchar".
         if (nextlist->n == 0) {
           clen = 0;
@@ -6166,16 +6758,16 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
           // Copy submatch info for the recursive call, opposite
           // of what happens on success below.
-          copy_sub_off(&m->norm, &t->subs.norm);
-          if (rex.nfa_has_zsubexpr) {
-            copy_sub_off(&m->synt, &t->subs.synt);
+          copy_sub_off(rex, &m->norm, &t->subs.norm);
+          if (rex->nfa_has_zsubexpr) {
+            copy_sub_off(rex, &m->synt, &t->subs.synt);
           }
           // First try matching the invisible match, then what
           // follows.
-          result = recursive_regmatch(t->state, NULL, prog, submatch, m,
+          result = recursive_regmatch(rex, t->state, NULL, prog, submatch, m,
                                       &listids, &listids_len);
           if (result == NFA_TOO_EXPENSIVE) {
-            nfa_match = result;
+            rex->nfa_match = result;
             goto theend;
           }
 
@@ -6188,13 +6780,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
                          || t->state->c
                          == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
             // Copy submatch info from the recursive call
-            copy_sub_off(&t->subs.norm, &m->norm);
-            if (rex.nfa_has_zsubexpr) {
-              copy_sub_off(&t->subs.synt, &m->synt);
+            copy_sub_off(rex, &t->subs.norm, &m->norm);
+            if (rex->nfa_has_zsubexpr) {
+              copy_sub_off(rex, &t->subs.synt, &m->synt);
             }
             // If the pattern has \ze and it matched in the
             // sub pattern, use it.
-            copy_ze_off(&t->subs.norm, &m->norm);
+            copy_ze_off(rex, &t->subs.norm, &m->norm);
 
             // t->state->out1 is the corresponding
             // END_INVISIBLE node; Add its out to the current
@@ -6215,17 +6807,17 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           pim.subs.norm.in_use = 0;
           pim.subs.synt.in_use = 0;
           if (REG_MULTI) {
-            pim.end.pos.col = (int)(rex.input - rex.line);
-            pim.end.pos.lnum = rex.lnum;
+            pim.end.pos.col = (int)(rex->input - rex->line);
+            pim.end.pos.lnum = rex->lnum;
           } else {
-            pim.end.ptr = rex.input;
+            pim.end.ptr = rex->input;
           }
           // t->state->out1 is the corresponding END_INVISIBLE
           // node; Add its out to the current list (zero-width
           // match).
-          if (addstate_here(thislist, t->state->out1->out, &t->subs,
+          if (addstate_here(rex, thislist, t->state->out1->out, &t->subs,
                             &pim, &listidx) == NULL) {
-            nfa_match = NFA_TOO_EXPENSIVE;
+            rex->nfa_match = NFA_TOO_EXPENSIVE;
             goto theend;
           }
         }
@@ -6239,18 +6831,18 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
         // There is no point in trying to match the pattern if the
         // output state is not going to be added to the list.
-        if (state_in_list(nextlist, t->state->out1->out, &t->subs)) {
+        if (state_in_list(rex, nextlist, t->state->out1->out, &t->subs)) {
           skip = t->state->out1->out;
 #ifdef REGEXP_DEBUG
           skip_lid = nextlist->id;
 #endif
-        } else if (state_in_list(nextlist,
+        } else if (state_in_list(rex, nextlist,
                                  t->state->out1->out->out, &t->subs)) {
           skip = t->state->out1->out->out;
 #ifdef REGEXP_DEBUG
           skip_lid = nextlist->id;
 #endif
-        } else if (state_in_list(thislist,
+        } else if (state_in_list(rex, thislist,
                                  t->state->out1->out->out, &t->subs)) {
           skip = t->state->out1->out->out;
 #ifdef REGEXP_DEBUG
@@ -6268,16 +6860,16 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         }
         // Copy submatch info to the recursive call, opposite of what
         // happens afterwards.
-        copy_sub_off(&m->norm, &t->subs.norm);
-        if (rex.nfa_has_zsubexpr) {
-          copy_sub_off(&m->synt, &t->subs.synt);
+        copy_sub_off(rex, &m->norm, &t->subs.norm);
+        if (rex->nfa_has_zsubexpr) {
+          copy_sub_off(rex, &m->synt, &t->subs.synt);
         }
 
         // First try matching the pattern.
-        result = recursive_regmatch(t->state, NULL, prog, submatch, m,
+        result = recursive_regmatch(rex, t->state, NULL, prog, submatch, m,
                                     &listids, &listids_len);
         if (result == NFA_TOO_EXPENSIVE) {
-          nfa_match = result;
+          rex->nfa_match = result;
           goto theend;
         }
         if (result) {
@@ -6285,21 +6877,21 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
 #ifdef REGEXP_DEBUG
           fprintf(log_fd, "NFA_START_PATTERN matches:\n");
-          log_subsexpr(m);
+          log_subsexpr(rex, m);
 #endif
           // Copy submatch info from the recursive call
-          copy_sub_off(&t->subs.norm, &m->norm);
-          if (rex.nfa_has_zsubexpr) {
-            copy_sub_off(&t->subs.synt, &m->synt);
+          copy_sub_off(rex, &t->subs.norm, &m->norm);
+          if (rex->nfa_has_zsubexpr) {
+            copy_sub_off(rex, &t->subs.synt, &m->synt);
           }
           // Now we need to skip over the matched text and then
           // continue with what follows.
           if (REG_MULTI) {
             // TODO(RE): multi-line match
             bytelen = m->norm.list.multi[0].end_col
-                      - (int)(rex.input - rex.line);
+                      - (int)(rex->input - rex->line);
           } else {
-            bytelen = (int)(m->norm.list.line[0].end - rex.input);
+            bytelen = (int)(m->norm.list.line[0].end - rex->input);
           }
 
 #ifdef REGEXP_DEBUG
@@ -6328,7 +6920,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       }
 
       case NFA_BOL:
-        if (rex.input == rex.line) {
+        if (rex->input == rex->line) {
           add_here = true;
           add_state = t->state->out;
         }
@@ -6350,10 +6942,10 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           int this_class;
 
           // Get class of current and previous char (if it exists).
-          this_class = mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
+          this_class = mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
           if (this_class <= 1) {
             result = false;
-          } else if (reg_prev_class() == this_class) {
+          } else if (reg_prev_class(rex) == this_class) {
             result = false;
           }
         }
@@ -6365,14 +6957,14 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
       case NFA_EOW:
         result = true;
-        if (rex.input == rex.line) {
+        if (rex->input == rex->line) {
           result = false;
         } else {
           int this_class, prev_class;
 
           // Get class of current and previous char (if it exists).
-          this_class = mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
-          prev_class = reg_prev_class();
+          this_class = mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
+          prev_class = reg_prev_class(rex);
           if (this_class == prev_class
               || prev_class == 0 || prev_class == 1) {
             result = false;
@@ -6385,15 +6977,15 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_BOF:
-        if (rex.lnum == 0 && rex.input == rex.line
-            && (!REG_MULTI || rex.reg_firstlnum == 1)) {
+        if (rex->lnum == 0 && rex->input == rex->line
+            && (!REG_MULTI || rex->reg_firstlnum == 1)) {
           add_here = true;
           add_state = t->state->out;
         }
         break;
 
       case NFA_EOF:
-        if (rex.lnum == rex.reg_maxline && curc == NUL) {
+        if (rex->lnum == rex->reg_maxline && curc == NUL) {
           add_here = true;
           add_state = t->state->out;
         }
@@ -6416,7 +7008,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           // (no preceding character).
           len += utf_char2len(mc);
         }
-        if (rex.reg_icombine && len == 0) {
+        if (rex->reg_icombine && len == 0) {
           // If \Z was present, then ignore composing characters.
           // When ignoring the base character this always matches.
           if (sta->c != curc) {
@@ -6437,7 +7029,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           // We don't care about the order of composing characters.
           // Get them into cchars[] first.
           while (len < clen) {
-            mc = utf_ptr2char((char *)rex.input + len);
+            mc = utf_ptr2char((char *)rex->input + len);
             cchars[ccount++] = mc;
             len += utf_char2len(mc);
             if (ccount == MAX_MCO) {
@@ -6471,14 +7063,14 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       }
 
       case NFA_NEWL:
-        if (curc == NUL && !rex.reg_line_lbr && REG_MULTI
-            && rex.lnum <= rex.reg_maxline) {
+        if (curc == NUL && !rex->reg_line_lbr && REG_MULTI
+            && rex->lnum <= rex->reg_maxline) {
           go_to_nextline = true;
           // Pass -1 for the offset, which means taking the position
           // at the start of the next line.
           add_state = t->state->out;
           add_off = -1;
-        } else if (curc == '\n' && rex.reg_line_lbr) {
+        } else if (curc == '\n' && rex->reg_line_lbr) {
           // match \n as if it is an ordinary character
           add_state = t->state->out;
           add_off = 1;
@@ -6486,70 +7078,20 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_START_COLL:
-      case NFA_START_NEG_COLL: {
-        // What follows is a list of characters, until NFA_END_COLL.
-        // One of them must match or none of them must match.
-        nfa_state_T *state;
-        int result_if_matched;
-        int c1, c2;
-
+      case NFA_START_NEG_COLL:
         // Never match EOL. If it's part of the collection it is added
         // as a separate state with an OR.
         if (curc == NUL) {
           break;
         }
 
-        state = t->state->out;
-        result_if_matched = (t->state->c == NFA_START_COLL);
-        for (;;) {
-          if (state->c == NFA_END_COLL) {
-            result = !result_if_matched;
-            break;
-          }
-          if (state->c == NFA_RANGE_MIN) {
-            c1 = state->val;
-            state = state->out;             // advance to NFA_RANGE_MAX
-            c2 = state->val;
-#ifdef REGEXP_DEBUG
-            fprintf(log_fd, "NFA_RANGE_MIN curc=%d c1=%d c2=%d\n",
-                    curc, c1, c2);
-#endif
-            if (curc >= c1 && curc <= c2) {
-              result = result_if_matched;
-              break;
-            }
-            if (rex.reg_ic) {
-              int curc_low = utf_fold(curc);
-              int done = false;
-
-              for (; c1 <= c2; c1++) {
-                if (utf_fold(c1) == curc_low) {
-                  result = result_if_matched;
-                  done = true;
-                  break;
-                }
-              }
-              if (done) {
-                break;
-              }
-            }
-          } else if (state->c < 0 ? check_char_class(state->c, curc)
-                     : (curc == state->c
-                        || (rex.reg_ic
-                            && utf_fold(curc) == utf_fold(state->c)))) {
-            result = result_if_matched;
-            break;
-          }
-          state = state->out;
-        }
-        if (result) {
+        if (match_collection(rex, t->state, curc)) {
           // next state is in out of the NFA_END_COLL, out1 of
           // START points to the END state
           add_state = t->state->out1->out;
           add_off = clen;
         }
         break;
-      }
 
       case NFA_ANY:
         // Any char except '\0', (end of input) does not match.
@@ -6583,13 +7125,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_KWORD:           //  \k
-        result = vim_iswordp_buf((char *)rex.input, rex.reg_buf);
+        result = vim_iswordp_buf((char *)rex->input, rex->reg_buf);
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_SKWORD:          //  \K
         result = !ascii_isdigit(curc)
-                 && vim_iswordp_buf((char *)rex.input, rex.reg_buf);
+                 && vim_iswordp_buf((char *)rex->input, rex->reg_buf);
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -6604,12 +7146,12 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_PRINT:           //  \p
-        result = vim_isprintc(utf_ptr2char((char *)rex.input));
+        result = vim_isprintc(utf_ptr2char((char *)rex->input));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_SPRINT:          //  \P
-        result = !ascii_isdigit(curc) && vim_isprintc(utf_ptr2char((char *)rex.input));
+        result = !ascii_isdigit(curc) && vim_isprintc(utf_ptr2char((char *)rex->input));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -6704,24 +7246,24 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_LOWER_IC:        // [a-z]
-        result = ri_lower(curc) || (rex.reg_ic && ri_upper(curc));
+        result = ri_lower(curc) || (rex->reg_ic && ri_upper(curc));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_NLOWER_IC:       // [^a-z]
         result = curc != NUL
-                 && !(ri_lower(curc) || (rex.reg_ic && ri_upper(curc)));
+                 && !(ri_lower(curc) || (rex->reg_ic && ri_upper(curc)));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_UPPER_IC:        // [A-Z]
-        result = ri_upper(curc) || (rex.reg_ic && ri_lower(curc));
+        result = ri_upper(curc) || (rex->reg_ic && ri_lower(curc));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_NUPPER_IC:       // [^A-Z]
         result = curc != NUL
-                 && !(ri_upper(curc) || (rex.reg_ic && ri_lower(curc)));
+                 && !(ri_upper(curc) || (rex->reg_ic && ri_lower(curc)));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -6750,10 +7292,10 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
         if (t->state->c <= NFA_BACKREF9) {
           subidx = t->state->c - NFA_BACKREF1 + 1;
-          result = match_backref(&t->subs.norm, subidx, &bytelen);
+          result = match_backref(rex, &t->subs.norm, subidx, &bytelen);
         } else {
           subidx = t->state->c - NFA_ZREF1 + 1;
-          result = match_zref(subidx, &bytelen);
+          result = match_zref(rex, subidx, &bytelen);
         }
 
         if (result) {
@@ -6795,15 +7337,15 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_LNUM_GT:
       case NFA_LNUM_LT:
         assert(t->state->val >= 0
-               && !((rex.reg_firstlnum > 0
-                     && rex.lnum > LONG_MAX - rex.reg_firstlnum)
-                    || (rex.reg_firstlnum < 0
-                        && rex.lnum < LONG_MIN + rex.reg_firstlnum))
-               && rex.lnum + rex.reg_firstlnum >= 0);
+               && !((rex->reg_firstlnum > 0
+                     && rex->lnum > LONG_MAX - rex->reg_firstlnum)
+                    || (rex->reg_firstlnum < 0
+                        && rex->lnum < LONG_MIN + rex->reg_firstlnum))
+               && rex->lnum + rex->reg_firstlnum >= 0);
         result = (REG_MULTI
                   && nfa_re_num_cmp((uintmax_t)t->state->val,
                                     t->state->c - NFA_LNUM,
-                                    (uintmax_t)(rex.lnum + rex.reg_firstlnum)));
+                                    (uintmax_t)(rex->lnum + rex->reg_firstlnum)));
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -6814,11 +7356,11 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_COL_GT:
       case NFA_COL_LT:
         assert(t->state->val >= 0
-               && rex.input >= rex.line
-               && (uintmax_t)(rex.input - rex.line) <= UINTMAX_MAX - 1);
+               && rex->input >= rex->line
+               && (uintmax_t)(rex->input - rex->line) <= UINTMAX_MAX - 1);
         result = nfa_re_num_cmp((uintmax_t)t->state->val,
                                 t->state->c - NFA_COL,
-                                (uintmax_t)(rex.input - rex.line + 1));
+                                (uintmax_t)(rex->input - rex->line + 1));
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -6829,7 +7371,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_VCOL_GT:
       case NFA_VCOL_LT: {
         int op = t->state->c - NFA_VCOL;
-        colnr_T col = (colnr_T)(rex.input - rex.line);
+        colnr_T col = (colnr_T)(rex->input - rex->line);
 
         // Bail out quickly when there can't be a match, avoid the overhead of
         // win_linetabsize() on long lines.
@@ -6838,7 +7380,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         }
 
         result = false;
-        win_T *wp = rex.reg_win == NULL ? curwin : rex.reg_win;
+        win_T *wp = rex->reg_win == NULL ? curwin : rex->reg_win;
         if (op == 1 && col - 1 > t->state->val && col > 100) {
           long ts = wp->w_buffer->b_p_ts;
 
@@ -6850,7 +7392,8 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           result = col > t->state->val * ts;
         }
         if (!result) {
-          uintmax_t lts = win_linetabsize(wp, rex.reg_firstlnum + rex.lnum, (char *)rex.line, col);
+          uintmax_t lts = win_linetabsize(wp, rex->reg_firstlnum + rex->lnum, (char *)rex->line,
+                                          col);
           assert(t->state->val >= 0);
           result = nfa_re_num_cmp((uintmax_t)t->state->val, op, lts + 1);
         }
@@ -6864,31 +7407,34 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_MARK:
       case NFA_MARK_GT:
       case NFA_MARK_LT: {
-        size_t col = REG_MULTI ? (size_t)(rex.input - rex.line) : 0;
-        fmark_T *fm = mark_get(rex.reg_buf, curwin, NULL, kMarkBufLocal, t->state->val);
+        size_t col = REG_MULTI ? (size_t)(rex->input - rex->line) : 0;
+        // Lines from a provider have no marks.
+        fmark_T *fm = rex->reg_getline_fn != NULL
+                      ? NULL
+                      : mark_get(rex->reg_buf, curwin, NULL, kMarkBufLocal, t->state->val);
 
         // Line may have been freed, get it again.
         if (REG_MULTI) {
-          rex.line = (uint8_t *)reg_getline(rex.lnum);
-          rex.input = rex.line + col;
+          rex->line = (uint8_t *)reg_getline(rex, rex->lnum);
+          rex->input = rex->line + col;
         }
 
         // Compare the mark position to the match position, if the mark
         // exists and mark is set in reg_buf.
         if (fm != NULL && fm->mark.lnum > 0) {
           pos_T *pos = &fm->mark;
-          const colnr_T pos_col = pos->lnum == rex.lnum + rex.reg_firstlnum
+          const colnr_T pos_col = pos->lnum == rex->lnum + rex->reg_firstlnum
                                   && pos->col == MAXCOL
-            ? (colnr_T)strlen((char *)reg_getline(pos->lnum - rex.reg_firstlnum))
+            ? (colnr_T)strlen((char *)reg_getline(rex, pos->lnum - rex->reg_firstlnum))
             : pos->col;
 
-          result = pos->lnum == rex.lnum + rex.reg_firstlnum
-            ? (pos_col == (colnr_T)(rex.input - rex.line)
+          result = pos->lnum == rex->lnum + rex->reg_firstlnum
+            ? (pos_col == (colnr_T)(rex->input - rex->line)
                ? t->state->c == NFA_MARK
-               : (pos_col < (colnr_T)(rex.input - rex.line)
+               : (pos_col < (colnr_T)(rex->input - rex->line)
                   ? t->state->c == NFA_MARK_GT
                   : t->state->c == NFA_MARK_LT))
-            : (pos->lnum < rex.lnum + rex.reg_firstlnum
+            : (pos->lnum < rex->lnum + rex->reg_firstlnum
                ? t->state->c == NFA_MARK_GT
                : t->state->c == NFA_MARK_LT);
           if (result) {
@@ -6900,9 +7446,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       }
 
       case NFA_CURSOR:
-        result = rex.reg_win != NULL
-                 && (rex.lnum + rex.reg_firstlnum == rex.reg_win->w_cursor.lnum)
-                 && ((colnr_T)(rex.input - rex.line) == rex.reg_win->w_cursor.col);
+        result = rex->reg_win != NULL
+                 && (rex->lnum + rex->reg_firstlnum == rex->reg_win->w_cursor.lnum)
+                 && ((colnr_T)(rex->input - rex->line) == rex->reg_win->w_cursor.col);
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -6910,7 +7456,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_VISUAL:
-        result = reg_match_visual();
+        result = reg_match_visual(rex);
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -6953,14 +7499,14 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #endif
         result = (c == curc);
 
-        if (!result && rex.reg_ic) {
+        if (!result && rex->reg_ic) {
           result = utf_fold(c) == utf_fold(curc);
         }
 
-        // If rex.reg_icombine is not set only skip over the character
+        // If rex->reg_icombine is not set only skip over the character
         // itself.  When it is set skip over composing characters.
-        if (result && !rex.reg_icombine) {
-          clen = utf_ptr2len((char *)rex.input);
+        if (result && !rex->reg_icombine) {
+          clen = utf_ptr2len((char *)rex->input);
         }
 
         ADD_STATE_IF_MATCH(t->state);
@@ -6988,7 +7534,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
             fprintf(log_fd, "Postponed recursive nfa_regmatch()\n");
             fprintf(log_fd, "\n");
 #endif
-            result = recursive_regmatch(pim->state, pim, prog, submatch, m,
+            result = recursive_regmatch(rex, pim->state, pim, prog, submatch, m,
                                         &listids, &listids_len);
             pim->result = result ? NFA_PIM_MATCH : NFA_PIM_NOMATCH;
             // for \@! and \@<! it is a match when the result is
@@ -7000,9 +7546,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
                            || pim->state->c
                            == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
               // Copy submatch info from the recursive call
-              copy_sub_off(&pim->subs.norm, &m->norm);
-              if (rex.nfa_has_zsubexpr) {
-                copy_sub_off(&pim->subs.synt, &m->synt);
+              copy_sub_off(rex, &pim->subs.norm, &m->norm);
+              if (rex->nfa_has_zsubexpr) {
+                copy_sub_off(rex, &pim->subs.synt, &m->synt);
               }
             }
           } else {
@@ -7025,9 +7571,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
                          || pim->state->c
                          == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
             // Copy submatch info from the recursive call
-            copy_sub_off(&t->subs.norm, &pim->subs.norm);
-            if (rex.nfa_has_zsubexpr) {
-              copy_sub_off(&t->subs.synt, &pim->subs.synt);
+            copy_sub_off(rex, &t->subs.norm, &pim->subs.norm);
+            if (rex->nfa_has_zsubexpr) {
+              copy_sub_off(rex, &t->subs.synt, &pim->subs.synt);
             }
           } else {
             // look-behind match failed, don't add the state
@@ -7043,20 +7589,20 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         // adding the state causes the list to be reallocated.  Make a
         // local copy to avoid that.
         if (pim == &t->pim) {
-          copy_pim(&pim_copy, pim);
+          copy_pim(rex, &pim_copy, pim);
           pim = &pim_copy;
         }
 
         if (add_here) {
-          r = addstate_here(thislist, add_state, &t->subs, pim, &listidx);
+          r = addstate_here(rex, thislist, add_state, &t->subs, pim, &listidx);
         } else {
-          r = addstate(nextlist, add_state, &t->subs, pim, add_off);
+          r = addstate(rex, nextlist, add_state, &t->subs, pim, add_off);
           if (add_count > 0) {
             nextlist->t[nextlist->n - 1].count = add_count;
           }
         }
         if (r == NULL) {
-          nfa_match = NFA_TOO_EXPENSIVE;
+          rex->nfa_match = NFA_TOO_EXPENSIVE;
           goto theend;
         }
       }
@@ -7070,19 +7616,19 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     // because recursive calls should only start in the first position.
     // Unless "nfa_endp" is not NULL, then we match the end position.
     // Also don't start a match past the first line.
-    if (!nfa_match
+    if (!rex->nfa_match
         && ((toplevel
-             && rex.lnum == 0
+             && rex->lnum == 0
              && clen != 0
-             && (rex.reg_maxcol == 0
-                 || (colnr_T)(rex.input - rex.line) < rex.reg_maxcol))
-            || (nfa_endp != NULL
+             && (rex->reg_maxcol == 0
+                 || (colnr_T)(rex->input - rex->line) < rex->reg_maxcol))
+            || (rex->nfa_endp != NULL
                 && (REG_MULTI
-                    ? (rex.lnum < nfa_endp->se_u.pos.lnum
-                       || (rex.lnum == nfa_endp->se_u.pos.lnum
-                           && (int)(rex.input - rex.line)
-                           < nfa_endp->se_u.pos.col))
-                    : rex.input < nfa_endp->se_u.ptr)))) {
+                    ? (rex->lnum < rex->nfa_endp->se_u.pos.lnum
+                       || (rex->lnum == rex->nfa_endp->se_u.pos.lnum
+                           && (int)(rex->input - rex->line)
+                           < rex->nfa_endp->se_u.pos.col))
+                    : rex->input < rex->nfa_endp->se_u.ptr)))) {
 #ifdef REGEXP_DEBUG
       fprintf(log_fd, "(---) STARTSTATE\n");
 #endif
@@ -7093,24 +7639,24 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
         if (prog->regstart != NUL && clen != 0) {
           if (nextlist->n == 0) {
-            colnr_T col = (colnr_T)(rex.input - rex.line) + clen;
+            colnr_T col = (colnr_T)(rex->input - rex->line) + clen;
 
             // Nextlist is empty, we can skip ahead to the
             // character that must appear at the start.
-            if (skip_to_start(prog->regstart, &col) == FAIL) {
+            if (skip_to_start(rex, prog->regstart, &col) == FAIL) {
               break;
             }
 #ifdef REGEXP_DEBUG
             fprintf(log_fd, "  Skipping ahead %d bytes to regstart\n",
-                    col - ((colnr_T)(rex.input - rex.line) + clen));
+                    col - ((colnr_T)(rex->input - rex->line) + clen));
 #endif
-            rex.input = rex.line + col - clen;
+            rex->input = rex->line + col - clen;
           } else {
             // Checking if the required start character matches is
             // cheaper than adding a state that won't match.
-            const int c = utf_ptr2char((char *)rex.input + clen);
+            const int c = utf_ptr2char((char *)rex->input + clen);
             if (c != prog->regstart
-                && (!rex.reg_ic
+                && (!rex->reg_ic
                     || utf_fold(c) != utf_fold(prog->regstart))) {
 #ifdef REGEXP_DEBUG
               fprintf(log_fd,
@@ -7119,25 +7665,38 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
               add = false;
             }
           }
+        } else if (clen != 0 && use_startset(rex, prog)) {
+          if (nextlist->n == 0) {
+            colnr_T col = (colnr_T)(rex->input - rex->line) + clen;
+
+            // Nextlist is empty, we can skip ahead to a byte that may
+            // appear at the start.
+            if (skip_to_startset(rex, prog, &col) == FAIL) {
+              break;
+            }
+            rex->input = rex->line + col - clen;
+          } else if (!startset_has(rex, prog, rex->input[clen])) {
+            add = false;
+          }
         }
 
         if (add) {
           if (REG_MULTI) {
             m->norm.list.multi[0].start_col =
-              (colnr_T)(rex.input - rex.line) + clen;
+              (colnr_T)(rex->input - rex->line) + clen;
             m->norm.orig_start_col =
               m->norm.list.multi[0].start_col;
           } else {
-            m->norm.list.line[0].start = rex.input + clen;
+            m->norm.list.line[0].start = rex->input + clen;
           }
-          if (addstate(nextlist, start->out, m, NULL, clen) == NULL) {
-            nfa_match = NFA_TOO_EXPENSIVE;
+          if (addstate(rex, nextlist, start->out, m, NULL, clen) == NULL) {
+            rex->nfa_match = NFA_TOO_EXPENSIVE;
             goto theend;
           }
         }
       } else {
-        if (addstate(nextlist, start, m, NULL, clen) == NULL) {
-          nfa_match = NFA_TOO_EXPENSIVE;
+        if (addstate(rex, nextlist, start, m, NULL, clen) == NULL) {
+          rex->nfa_match = NFA_TOO_EXPENSIVE;
           goto theend;
         }
       }
@@ -7159,23 +7718,23 @@ nextchar:
     // Advance to the next character, or advance to the next line, or
     // finish.
     if (clen != 0) {
-      rex.input += clen;
-    } else if (go_to_nextline || (nfa_endp != NULL && REG_MULTI
-                                  && rex.lnum < nfa_endp->se_u.pos.lnum)) {
-      reg_nextline();
+      rex->input += clen;
+    } else if (go_to_nextline || (rex->nfa_endp != NULL && REG_MULTI
+                                  && rex->lnum < rex->nfa_endp->se_u.pos.lnum)) {
+      reg_nextline(rex);
     } else {
       break;
     }
 
     // Allow interrupting with CTRL-C.
-    reg_breakcheck();
+    reg_breakcheck(rex);
     if (got_int) {
       break;
     }
     // Check for timeout once every twenty times to avoid overhead.
-    if (nfa_time_limit != NULL && ++nfa_time_count == 20) {
-      nfa_time_count = 0;
-      if (nfa_did_time_out()) {
+    if (rex->nfa_time_limit != NULL && ++rex->nfa_time_count == 20) {
+      rex->nfa_time_count = 0;
+      if (nfa_did_time_out(rex)) {
         break;
       }
     }
@@ -7198,7 +7757,7 @@ theend:
   fclose(debug);
 #endif
 
-  return nfa_match;
+  return rex->nfa_match;
 }
 
 /// Try match of "prog" with at rex.line["col"].
@@ -7207,7 +7766,8 @@ theend:
 /// @param timed_out  flag set on timeout or NULL
 ///
 /// @return  <= 0 for failure, number of lines contained in the match otherwise.
-static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_out)
+static long nfa_regtry(regexec_T *rex, nfa_regprog_T *prog, colnr_T col, proftime_T *tm,
+                       int *timed_out)
 {
   int i;
   regsubs_T subs, m;
@@ -7216,10 +7776,10 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
   FILE *f;
 #endif
 
-  rex.input = rex.line + col;
-  nfa_time_limit = tm;
-  nfa_timed_out = timed_out;
-  nfa_time_count = 0;
+  rex->input = rex->line + col;
+  rex->nfa_time_limit = tm;
+  rex->nfa_timed_out = timed_out;
+  rex->nfa_time_count = 0;
 
 #ifdef REGEXP_DEBUG
   f = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -7229,7 +7789,7 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
 # ifdef REGEXP_DEBUG
     fprintf(f, "\tRegexp is \"%s\"\n", nfa_regengine.expr);
 # endif
-    fprintf(f, "\tInput text is \"%s\" \n", rex.input);
+    fprintf(f, "\tInput text is \"%s\" \n", rex->input);
     fprintf(f, "\t=======================================================\n\n");
     nfa_print_state(f, start);
     fprintf(f, "\n\n");
@@ -7239,54 +7799,54 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
   }
 #endif
 
-  clear_sub(&subs.norm);
-  clear_sub(&m.norm);
-  clear_sub(&subs.synt);
-  clear_sub(&m.synt);
+  clear_sub(rex, &subs.norm);
+  clear_sub(rex, &m.norm);
+  clear_sub(rex, &subs.synt);
+  clear_sub(rex, &m.synt);
 
-  int result = nfa_regmatch(prog, start, &subs, &m);
+  int result = nfa_regmatch(rex, prog, start, &subs, &m);
   if (!result) {
     return 0;
   } else if (result == NFA_TOO_EXPENSIVE) {
     return result;
   }
 
-  cleanup_subexpr();
+  cleanup_subexpr(rex);
   if (REG_MULTI) {
     for (i = 0; i < subs.norm.in_use; i++) {
-      rex.reg_startpos[i].lnum = subs.norm.list.multi[i].start_lnum;
-      rex.reg_startpos[i].col = subs.norm.list.multi[i].start_col;
+      rex->reg_startpos[i].lnum = subs.norm.list.multi[i].start_lnum;
+      rex->reg_startpos[i].col = subs.norm.list.multi[i].start_col;
 
-      rex.reg_endpos[i].lnum = subs.norm.list.multi[i].end_lnum;
-      rex.reg_endpos[i].col = subs.norm.list.multi[i].end_col;
+      rex->reg_endpos[i].lnum = subs.norm.list.multi[i].end_lnum;
+      rex->reg_endpos[i].col = subs.norm.list.multi[i].end_col;
     }
-    if (rex.reg_mmatch != NULL) {
-      rex.reg_mmatch->rmm_matchcol = subs.norm.orig_start_col;
+    if (rex->reg_mmatch != NULL) {
+      rex->reg_mmatch->rmm_matchcol = subs.norm.orig_start_col;
     }
 
-    if (rex.reg_startpos[0].lnum < 0) {
-      rex.reg_startpos[0].lnum = 0;
-      rex.reg_startpos[0].col = col;
+    if (rex->reg_startpos[0].lnum < 0) {
+      rex->reg_startpos[0].lnum = 0;
+      rex->reg_startpos[0].col = col;
     }
-    if (rex.reg_endpos[0].lnum < 0) {
+    if (rex->reg_endpos[0].lnum < 0) {
       // pattern has a \ze but it didn't match, use current end
-      rex.reg_endpos[0].lnum = rex.lnum;
-      rex.reg_endpos[0].col = (int)(rex.input - rex.line);
+      rex->reg_endpos[0].lnum = rex->lnum;
+      rex->reg_endpos[0].col = (int)(rex->input - rex->line);
     } else {
       // Use line number of "\ze".
-      rex.lnum = rex.reg_endpos[0].lnum;
+      rex->lnum = rex->reg_endpos[0].lnum;
     }
   } else {
     for (i = 0; i < subs.norm.in_use; i++) {
-      rex.reg_startp[i] = subs.norm.list.line[i].start;
-      rex.reg_endp[i] = subs.norm.list.line[i].end;
+      rex->reg_startp[i] = subs.norm.list.line[i].start;
+      rex->reg_endp[i] = subs.norm.list.line[i].end;
     }
 
-    if (rex.reg_startp[0] == NULL) {
-      rex.reg_startp[0] = rex.line + col;
+    if (rex->reg_startp[0] == NULL) {
+      rex->reg_startp[0] = rex->line + col;
     }
-    if (rex.reg_endp[0] == NULL) {
-      rex.reg_endp[0] = rex.input;
+    if (rex->reg_endp[0] == NULL) {
+      rex->reg_endp[0] = rex->input;
     }
   }
 
@@ -7295,7 +7855,7 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
   re_extmatch_out = NULL;
 
   if (prog->reghasz == REX_SET) {
-    cleanup_zsubexpr();
+    cleanup_zsubexpr(rex);
     re_extmatch_out = make_extmatch();
     // Loop over \z1, \z2, etc.  There is no \z0.
     for (i = 1; i < subs.synt.in_use; i++) {
@@ -7307,7 +7867,7 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
             && mpos->start_lnum == mpos->end_lnum
             && mpos->end_col >= mpos->start_col) {
           re_extmatch_out->matches[i] =
-            (uint8_t *)xstrnsave((char *)reg_getline(mpos->start_lnum) + mpos->start_col,
+            (uint8_t *)xstrnsave((char *)reg_getline(rex, mpos->start_lnum) + mpos->start_col,
                                  (size_t)(mpos->end_col - mpos->start_col));
         }
       } else {
@@ -7321,7 +7881,7 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
     }
   }
 
-  return 1 + rex.lnum;
+  return 1 + rex->lnum;
 }
 
 /// Match a regexp against a string ("line" points to the string) or multiple
@@ -7334,49 +7894,50 @@ static long nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *ti
 ///
 /// @return <= 0 if there is no match and number of lines contained in the
 /// match otherwise.
-static long nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int *timed_out)
+static long nfa_regexec_both(regexec_T *rex, uint8_t *line, colnr_T startcol, proftime_T *tm,
+                             int *timed_out)
 {
   nfa_regprog_T *prog;
   long retval = 0L;
   colnr_T col = startcol;
 
   if (REG_MULTI) {
-    prog = (nfa_regprog_T *)rex.reg_mmatch->regprog;
-    line = (uint8_t *)reg_getline((linenr_T)0);  // relative to the cursor
-    rex.reg_startpos = rex.reg_mmatch->startpos;
-    rex.reg_endpos = rex.reg_mmatch->endpos;
+    prog = (nfa_regprog_T *)rex->reg_mmatch->regprog;
+    line = (uint8_t *)reg_getline(rex, (linenr_T)0);  // relative to the cursor
+    rex->reg_startpos = rex->reg_mmatch->startpos;
+    rex->reg_endpos = rex->reg_mmatch->endpos;
   } else {
-    prog = (nfa_regprog_T *)rex.reg_match->regprog;
-    rex.reg_startp = (uint8_t **)rex.reg_match->startp;
-    rex.reg_endp = (uint8_t **)rex.reg_match->endp;
+    prog = (nfa_regprog_T *)rex->reg_match->regprog;
+    rex->reg_startp = (uint8_t **)rex->reg_match->startp;
+    rex->reg_endp = (uint8_t **)rex->reg_match->endp;
   }
 
   // Be paranoid...
   if (prog == NULL || line == NULL) {
-    iemsg(_(e_null));
+    reg_iemsg(rex, _(e_null));
     goto theend;
   }
 
-  // If pattern contains "\c" or "\C": overrule value of rex.reg_ic
+  // If pattern contains "\c" or "\C": overrule value of rex->reg_ic
   if (prog->regflags & RF_ICASE) {
-    rex.reg_ic = true;
+    rex->reg_ic = true;
   } else if (prog->regflags & RF_NOICASE) {
-    rex.reg_ic = false;
+    rex->reg_ic = false;
   }
 
-  // If pattern contains "\Z" overrule value of rex.reg_icombine
+  // If pattern contains "\Z" overrule value of rex->reg_icombine
   if (prog->regflags & RF_ICOMBINE) {
-    rex.reg_icombine = true;
+    rex->reg_icombine = true;
   }
 
-  rex.line = line;
-  rex.lnum = 0;  // relative to line
+  rex->line = line;
+  rex->lnum = 0;  // relative to line
 
-  rex.nfa_has_zend = prog->has_zend;
-  rex.nfa_has_backref = prog->has_backref;
-  rex.nfa_nsubexpr = prog->nsubexp;
-  rex.nfa_listid = 1;
-  rex.nfa_alt_listid = 2;
+  rex->nfa_has_zend = prog->has_zend;
+  rex->nfa_has_backref = prog->has_backref;
+  rex->nfa_nsubexpr = prog->nsubexp;
+  rex->nfa_listid = 1;
+  rex->nfa_alt_listid = 2;
 #ifdef REGEXP_DEBUG
   nfa_regengine.expr = prog->pattern;
 #endif
@@ -7385,51 +7946,61 @@ static long nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, in
     return 0L;
   }
 
-  rex.need_clear_subexpr = true;
+  rex->need_clear_subexpr = true;
   // Clear the external match subpointers if necessary.
   if (prog->reghasz == REX_SET) {
-    rex.nfa_has_zsubexpr = true;
-    rex.need_clear_zsubexpr = true;
+    rex->nfa_has_zsubexpr = true;
+    rex->need_clear_zsubexpr = true;
   } else {
-    rex.nfa_has_zsubexpr = false;
-    rex.need_clear_zsubexpr = false;
+    rex->nfa_has_zsubexpr = false;
+    rex->need_clear_zsubexpr = false;
   }
 
   if (prog->regstart != NUL) {
     // Skip ahead until a character we know the match must start with.
     // When there is none there is no match.
-    if (skip_to_start(prog->regstart, &col) == FAIL) {
+    if (skip_to_start(rex, prog->regstart, &col) == FAIL) {
       return 0L;
     }
 
     // If match_text is set it contains the full text that must match.
     // Nothing else to try. Doesn't handle combining chars well.
-    if (prog->match_text != NULL && !rex.reg_icombine) {
-      retval = find_match_text(&col, prog->regstart, prog->match_text);
+    if (prog->match_text != NULL && !rex->reg_icombine) {
+      retval = find_match_text(rex, &col, prog->regstart, prog->match_text);
       if (REG_MULTI) {
-        rex.reg_mmatch->rmm_matchcol = col;
+        rex->reg_mmatch->rmm_matchcol = col;
       } else {
-        rex.reg_match->rm_matchcol = col;
+        rex->reg_match->rm_matchcol = col;
       }
       return retval;
     }
+  } else if (use_startset(rex, prog)) {
+    // Skip ahead until a byte the match may start with.
+    if (skip_to_startset(rex, prog, &col) == FAIL) {
+      return 0L;
+    }
   }
 
   // If the start column is past the maximum column: no need to try.
-  if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol) {
+  if (rex->reg_maxcol > 0 && col >= rex->reg_maxcol) {
     goto theend;
   }
 
-  // Set the "nstate" used by nfa_regcomp() to zero to trigger an error when
-  // it's accidentally used during execution.
-  nstate = 0;
-  for (int i = 0; i < prog->nstate; i++) {
-    prog->state[i].id = i;
-    prog->state[i].lastlist[0] = 0;
-    prog->state[i].lastlist[1] = 0;
+  // Quickly find out when there is no match in this line.
+  if (!nfa_dfa_may_match(rex, prog, col)) {
+    goto theend;
   }
 
-  retval = nfa_regtry(prog, col, tm, timed_out);
+  // The program is not changed while matching, the list IDs of the states
+  // are kept in the workspace and reused for the next match.
+  regwork_T *const work = rex->work;
+  if (work->nfa_lastlist_len < prog->nstate) {
+    xfree(work->nfa_lastlist);
+    work->nfa_lastlist = xmalloc((size_t)prog->nstate * sizeof(*work->nfa_lastlist));
+    work->nfa_lastlist_len = prog->nstate;
+  }
+  memset(work->nfa_lastlist, 0, (size_t)prog->nstate * sizeof(*work->nfa_lastlist));
+  retval = nfa_regtry(rex, prog, col, tm, timed_out);
 
 #ifdef REGEXP_DEBUG
   nfa_regengine.expr = NULL;
@@ -7440,21 +8011,21 @@ theend:
     // Make sure the end is never before the start.  Can happen when \zs and
     // \ze are used.
     if (REG_MULTI) {
-      const lpos_T *const start = &rex.reg_mmatch->startpos[0];
-      const lpos_T *const end = &rex.reg_mmatch->endpos[0];
+      const lpos_T *const start = &rex->reg_mmatch->startpos[0];
+      const lpos_T *const end = &rex->reg_mmatch->endpos[0];
 
       if (end->lnum < start->lnum
           || (end->lnum == start->lnum && end->col < start->col)) {
-        rex.reg_mmatch->endpos[0] = rex.reg_mmatch->startpos[0];
+        rex->reg_mmatch->endpos[0] = rex->reg_mmatch->startpos[0];
       }
     } else {
-      if (rex.reg_match->endp[0] < rex.reg_match->startp[0]) {
-        rex.reg_match->endp[0] = rex.reg_match->startp[0];
+      if (rex->reg_match->endp[0] < rex->reg_match->startp[0]) {
+        rex->reg_match->endp[0] = rex->reg_match->startp[0];
       }
 
       // startpos[0] may be set by "\zs", also return the column where
       // the whole pattern matched.
-      rex.reg_match->rm_matchcol = col;
+      rex->reg_match->rm_matchcol = col;
     }
   }
 
@@ -7513,7 +8084,6 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   size_t prog_size = offsetof(nfa_regprog_T, state) + sizeof(nfa_state_T) * (size_t)nstate;
   prog = xmalloc(prog_size);
   state_ptr = prog->state;
-  prog->re_in_use = false;
 
   // PASS 2
   // Build the NFA
@@ -7524,8 +8094,8 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   prog->regflags = regflags;
   prog->engine = &nfa_regengine;
   prog->nstate = nstate;
-  prog->has_zend = rex.nfa_has_zend;
-  prog->has_backref = rex.nfa_has_backref;
+  prog->has_zend = nfa_has_zend;
+  prog->has_backref = nfa_has_backref;
   prog->nsubexp = regnpar;
 
   nfa_postprocess(prog);
@@ -7533,6 +8103,26 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   prog->reganch = nfa_get_reganch(prog->start, 0);
   prog->regstart = nfa_get_regstart(prog->start, 0);
   prog->match_text = nfa_get_match_text(prog->start);
+  prog->startset = NULL;
+  prog->id = ++nfa_prog_id;
+  if (prog->regstart == NUL && !prog->reganch) {
+    // No single start character, but there may be a few possible ones,
+    // e.g. for "\(foo\|bar\)".
+    uint8_t *set = xcalloc(256, 1);
+    int budget = 200;
+    if (nfa_get_startset(prog->start, set, &budget)) {
+      prog->startset = set;
+      prog->startset_ascii = true;
+      for (int i = 0x80; i < 256; i++) {
+        if (set[i]) {
+          prog->startset_ascii = false;
+          break;
+        }
+      }
+    } else {
+      xfree(set);
+    }
+  }
 
 #ifdef REGEXP_DEBUG
   nfa_postfix_dump(expr, OK);
@@ -7541,6 +8131,10 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   // Remember whether this pattern has any \z specials in it.
   prog->reghasz = re_has_z;
   prog->pattern = xstrdup((char *)expr);
+  // Number the states, for "nfa_lastlist" when matching.
+  for (int i = 0; i < prog->nstate; i++) {
+    prog->state[i].id = i;
+  }
 #ifdef REGEXP_DEBUG
   nfa_regengine.expr = NULL;
 #endif
@@ -7549,6 +8143,9 @@ out:
   xfree(post_start);
   post_start = post_ptr = post_end = NULL;
   state_ptr = NULL;
+  // Set the "nstate" used by nfa_regcomp() to zero to trigger an error when
+  // it's accidentally used during execution.
+  nstate = 0;
   return (regprog_T *)prog;
 
 fail:
@@ -7568,6 +8165,8 @@ static void nfa_regfree(regprog_T *prog)
   }
 
   xfree(((nfa_regprog_T *)prog)->match_text);
+  xfree(((nfa_regprog_T *)prog)->startset);
+  nfa_dfa_free(map_del(uint64_t, ptr_t)(&reg_work.nfa_dfas, ((nfa_regprog_T *)prog)->id));
   xfree(((nfa_regprog_T *)prog)->pattern);
   xfree(prog);
 }
@@ -7581,19 +8180,20 @@ static void nfa_regfree(regprog_T *prog)
 /// @param col   column to start looking for match
 ///
 /// @return  <= 0 for failure, number of lines contained in the match otherwise.
-static int nfa_regexec_nl(regmatch_T *rmp, uint8_t *line, colnr_T col, bool line_lbr)
+static int nfa_regexec_nl(regexec_T *rex, regmatch_T *rmp, uint8_t *line, colnr_T col,
+                          bool line_lbr)
 {
-  rex.reg_match = rmp;
-  rex.reg_mmatch = NULL;
-  rex.reg_maxline = 0;
-  rex.reg_line_lbr = line_lbr;
-  rex.reg_buf = curbuf;
-  rex.reg_win = NULL;
-  rex.reg_ic = rmp->rm_ic;
-  rex.reg_icombine = false;
-  rex.reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
-  rex.reg_maxcol = 0;
-  return (int)nfa_regexec_both(line, col, NULL, NULL);
+  rex->reg_match = rmp;
+  rex->reg_mmatch = NULL;
+  rex->reg_maxline = 0;
+  rex->reg_line_lbr = line_lbr;
+  rex->reg_buf = curbuf;
+  rex->reg_win = NULL;
+  rex->reg_ic = rmp->rm_ic;
+  rex->reg_icombine = false;
+  rex->reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
+  rex->reg_maxcol = 0;
+  return (int)nfa_regexec_both(rex, line, col, NULL, NULL);
 }
 
 /// Matches a regexp against multiple lines.
@@ -7631,9 +8231,9 @@ static int nfa_regexec_nl(regmatch_T *rmp, uint8_t *line, colnr_T col, bool line
 ///
 /// @par
 /// FIXME if this behavior is not compatible.
-static long nfa_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, colnr_T col,
-                              proftime_T *tm, int *timed_out)
+static long nfa_regexec_multi(regexec_T *rex, regmmatch_T *rmp, win_T *win, buf_T *buf,
+                              linenr_T lnum, colnr_T col, proftime_T *tm, int *timed_out)
 {
-  init_regexec_multi(rmp, win, buf, lnum);
-  return nfa_regexec_both(NULL, col, tm, timed_out);
+  init_regexec_multi(rex, rmp, win, buf, lnum);
+  return nfa_regexec_both(rex, NULL, col, tm, timed_out);
 }
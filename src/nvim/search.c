@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/ascii.h"
 #include "nvim/autocmd.h"
 #include "nvim/buffer.h"
@@ -34,6 +35,7 @@
 #include "nvim/indent_c.h"
 #include "nvim/insexpand.h"
 #include "nvim/macros.h"
+#include "nvim/main.h"
 #include "nvim/mark.h"
 #include "nvim/mbyte.h"
 #include "nvim/memline.h"
@@ -109,6 +111,38 @@ static bool saved_spats_no_hlsearch = false;
 // allocated copy of pattern used by search_regcomp()
 static char *mr_pattern = NULL;
 
+// Number of lines searched by search_index_extend() between checks for the
+// time limit.
+#define SEARCH_INDEX_CHUNK 1000
+// Time in msec to extend the search index when the editor is idle.
+#define SEARCH_INDEX_SLICE 10
+
+typedef struct {
+  pos_T start;
+  pos_T end;
+} searchmatch_T;
+
+// Positions of matches of the last search pattern in a buffer, used for the
+// search count.  Continued in the background when the count was incomplete
+// because of the timeout.
+static struct {
+  handle_T buf;                      // buffer searched
+  varnumber_T changedtick;           // b:changedtick of "buf"
+  char *pat;                         // search pattern
+  bool magic;                        // magicness of "pat"
+  bool no_scs;                       // no smartcase for "pat"
+  int ic;                            // 'ignorecase'
+  int scs;                           // 'smartcase'
+  bool posdep;                       // "pat" depends on the cursor, marks,
+                                     // etc., the index is not kept
+  kvec_t(searchmatch_T) matches;     // matches found so far
+  pos_T next;                        // where to continue searching
+  bool complete;                     // all matches were found
+  int want;                          // number of matches for the background
+                                     // search to find, zero for all
+  bool scheduled;                    // background search was scheduled
+} search_index;
+
 // Type used by find_pattern_in_path() to remember which included files have
 // been searched already.
 typedef struct SearchedFile {
@@ -280,6 +314,8 @@ void free_search_patterns(void)
   CLEAR_FIELD(spats);
 
   XFREE_CLEAR(mr_pattern);
+  XFREE_CLEAR(search_index.pat);
+  kv_destroy(search_index.matches);
 }
 
 #endif
@@ -2704,38 +2740,37 @@ static void update_search_stat(int dirc, pos_T *pos, pos_T *cursor_pos, searchst
     cur += dirc == 0 ? 0 : dirc == '/' ? 1 : -1;
   } else {
     proftime_T start;
-    bool done_search = false;
-    pos_T endpos = { 0, 0, 0 };
-    p_ws = false;
     if (timeout > 0) {
-      start  = profile_setlimit(timeout);
+      start = profile_setlimit(timeout);
     }
-    while (!got_int && searchit(curwin, curbuf, &lastpos, &endpos,
-                                FORWARD, NULL, 1, SEARCH_KEEP, RE_LAST,
-                                NULL) != FAIL) {
-      done_search = true;
-      // Stop after passing the time limit.
-      if (timeout > 0 && profile_passed_limit(start)) {
-        incomplete = 1;
-        break;
-      }
+    // Find the matches, or use those found before.
+    const int want = maxcount > 0 ? maxcount + 1 : 0;
+    search_index_check();
+    const bool timed_out = !search_index_extend(want, timeout > 0 ? &start : NULL);
+
+    cur = 0;
+    cnt = 0;
+    exact_match = false;
+    incomplete = 0;
+    for (size_t i = 0; i < kv_size(search_index.matches) && (want == 0 || cnt < want); i++) {
       cnt++;
-      if (ltoreq(lastpos, p)) {
+      if (ltoreq(kv_A(search_index.matches, i).start, p)) {
         cur = cnt;
-        if (lt(p, endpos)) {
+        if (lt(p, kv_A(search_index.matches, i).end)) {
           exact_match = true;
         }
       }
-      fast_breakcheck();
-      if (maxcount > 0 && cnt > maxcount) {
-        incomplete = 2;    // max count exceeded
-        break;
-      }
+    }
+    if (maxcount > 0 && cnt > maxcount) {
+      incomplete = 2;    // max count exceeded
+    } else if (timed_out) {
+      incomplete = 1;
+      search_index_schedule(want);
     }
     if (got_int) {
       cur = -1;  // abort
     }
-    if (done_search) {
+    if (cnt > 0) {
       xfree(lastpat);
       lastpat = xstrdup(spats[last_idx].pat);
       chgtick = (int)buf_get_changedtick(curbuf);
@@ -2751,6 +2786,118 @@ static void update_search_stat(int dirc, pos_T *pos, pos_T *cursor_pos, searchst
   p_ws = save_ws;
 }
 
+/// Return true when the search index is for the last search pattern in the
+/// current buffer.
+static bool search_index_valid(void)
+{
+  const SearchPattern *spat = &spats[last_idx];
+  return search_index.buf == curbuf->handle
+         && search_index.changedtick == buf_get_changedtick(curbuf)
+         && search_index.pat != NULL
+         && spat->pat != NULL
+         && strcmp(search_index.pat, spat->pat) == 0
+         && search_index.magic == spat->magic
+         && search_index.no_scs == spat->no_scs
+         && search_index.ic == p_ic
+         && search_index.scs == p_scs
+         && !search_index.posdep;
+}
+
+/// Clear the search index when it is not valid.
+static void search_index_check(void)
+{
+  if (search_index_valid()) {
+    return;
+  }
+  const SearchPattern *spat = &spats[last_idx];
+  xfree(search_index.pat);
+  search_index.pat = xstrdup(spat->pat);
+  search_index.buf = curbuf->handle;
+  search_index.changedtick = buf_get_changedtick(curbuf);
+  search_index.magic = spat->magic;
+  search_index.no_scs = spat->no_scs;
+  search_index.ic = p_ic;
+  search_index.scs = p_scs;
+  // Matches of "\%#", "\%V", "\%'m" and the like move with the cursor,
+  // Visual area and marks, without the text changing.
+  emsg_off++;
+  regprog_T *prog = vim_regcomp(spat->pat, spat->magic ? RE_MAGIC : 0);
+  emsg_off--;
+  search_index.posdep = prog == NULL || re_position_dependent(prog);
+  vim_regfree(prog);
+  kv_size(search_index.matches) = 0;
+  search_index.next = (pos_T){ 0, 0, 0 };
+  search_index.complete = false;
+}
+
+/// Find more matches for the search index, until there are "want" of them
+/// (all when zero) or there are no more.
+///
+/// @param tm  time limit or NULL
+///
+/// @return  false when stopped because of the time limit.
+static bool search_index_extend(int want, proftime_T *tm)
+{
+  const int save_ws = p_ws;
+  p_ws = false;
+  bool timed_out = false;
+  while (!search_index.complete && !got_int
+         && (want == 0 || (int)kv_size(search_index.matches) < want)) {
+    if (tm != NULL && profile_passed_limit(*tm)) {
+      timed_out = true;
+      break;
+    }
+    // Search a limited number of lines at a time, so that the time limit is
+    // checked also when matches are far apart.
+    const linenr_T first = MAX(search_index.next.lnum, 1);
+    const linenr_T stop = first + SEARCH_INDEX_CHUNK < curbuf->b_ml.ml_line_count
+                          ? first + SEARCH_INDEX_CHUNK : 0;
+    searchit_arg_T sia = { .sa_stop_lnum = stop };
+    pos_T pos = search_index.next;
+    pos_T endpos = { 0, 0, 0 };
+    if (searchit(curwin, curbuf, &pos, &endpos, FORWARD, NULL, 1, SEARCH_KEEP, RE_LAST,
+                 &sia) == FAIL) {
+      if (got_int) {
+        break;
+      }
+      if (stop == 0) {
+        search_index.complete = true;
+      } else {
+        // Continue after the last searched line.
+        search_index.next = (pos_T){ stop, MAXCOL, 0 };
+      }
+      continue;
+    }
+    kv_push(search_index.matches, ((searchmatch_T){ pos, endpos }));
+    search_index.next = pos;
+    fast_breakcheck();
+  }
+  p_ws = save_ws;
+  return !timed_out;
+}
+
+/// Continue finding matches for the search index when the editor is idle.
+static void search_index_schedule(int want)
+{
+  search_index.want = want;
+  if (!search_index.scheduled) {
+    search_index.scheduled = true;
+    multiqueue_put(main_loop.events, search_index_event, 0);
+  }
+}
+
+static void search_index_event(void **argv)
+{
+  search_index.scheduled = false;
+  if (!search_index_valid()) {
+    return;
+  }
+  proftime_T tm = profile_setlimit(SEARCH_INDEX_SLICE);
+  if (!search_index_extend(search_index.want, &tm)) {
+    search_index_schedule(search_index.want);
+  }
+}
+
 // "searchcount()" function
 void f_searchcount(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
 {
@@ -19,7 +19,9 @@
 // When a line becomes invisible due to a decrease in screen height or because
 // a line was pushed up during normal terminal output, we store the line
 // information in the scrollback buffer, which is mirrored in the nvim buffer
-// by appending lines just above the visible part of the buffer.
+// by appending lines just above the visible part of the buffer. Scrollback
+// lines are kept in a ring, each one stored as the text of its buffer line
+// plus runs of cells sharing the same attributes.
 //
 // When the screen height increases, libvterm will ask for a row in the
 // scrollback buffer, which is mirrored in the nvim buffer displaying lines
@@ -48,6 +50,7 @@
 
 #include "nvim/api/private/defs.h"
 #include "nvim/api/private/helpers.h"
+#include "klib/kvec.h"
 #include "nvim/ascii.h"
 #include "nvim/autocmd.h"
 #include "nvim/buffer.h"
@@ -81,8 +84,10 @@
 #include "nvim/normal.h"
 #include "nvim/option.h"
 #include "nvim/optionstr.h"
+#include "nvim/os/time.h"
 #include "nvim/pos.h"
 #include "nvim/state.h"
+#include "nvim/strings.h"
 #include "nvim/terminal.h"
 #include "nvim/types.h"
 #include "nvim/ui.h"
@@ -104,15 +109,41 @@ typedef struct terminal_state {
 // Delay for refreshing the terminal buffer after receiving updates from
 // libvterm. Improves performance when receiving large bursts of data.
 #define REFRESH_DELAY 10
+// While a terminal has a backlog of output, its buffer is refreshed at most
+// once in this many milliseconds: intermediate screen states are skipped.
+#define BUSY_REFRESH_DELAY 100
+
+// Output is fed to libvterm in slices of this many bytes, for at most
+// INPUT_BUDGET milliseconds per event. The rest is kept as a backlog and fed
+// by later events, so that keys typed by the user are handled in between.
+#define INPUT_SLICE 4096
+#define INPUT_BUDGET 5
+// Size of the backlog at which the process output is paused.
+#define INPUT_BACKLOG_MAX (4 * 1024 * 1024)
 
 static TimeWatcher refresh_timer;
 static bool refresh_pending = false;
 
+// Consecutive cells of a scrollback line with the same attributes and width.
+typedef struct {
+  VTermScreenCellAttrs attrs;
+  VTermColor fg, bg;
+  uint32_t cells;  // number of cells, continuation cells of wide chars excluded
+  uint8_t width;   // width of each cell
+} ScrollbackRun;
+
+// Scrollback line. The text is stored after the runs, in the same format as
+// the line of the terminal buffer: one character per cell, empty cells as
+// spaces, trailing empty cells removed.
 typedef struct {
   size_t cols;
-  VTermScreenCell cells[];
+  size_t nruns;
+  size_t len;  // length of the text
+  ScrollbackRun runs[];
 } ScrollbackLine;
 
+#define SB_TEXT(sbrow) ((char *)((sbrow)->runs + (sbrow)->nruns))
+
 struct terminal {
   TerminalOptions opts;  // options passed to terminal_open
   VTerm *vt;
@@ -122,9 +153,10 @@ struct terminal {
   //  - receive data from libvterm as a result of key presses.
   char textbuf[0x1fff];
 
-  ScrollbackLine **sb_buffer;       // Scrollback storage.
+  ScrollbackLine **sb_buffer;       // Scrollback storage (ring).
   size_t sb_current;                // Lines stored in sb_buffer.
   size_t sb_size;                   // Capacity of sb_buffer.
+  size_t sb_head;                   // Slot of sb_buffer for the next pushed line.
   // "virtual index" that points to the first sb_buffer row that we need to
   // push to the terminal buffer when refreshing the scrollback. When negative,
   // it actually points to entries that are no longer in sb_buffer (because the
@@ -156,6 +188,11 @@ struct terminal {
 
   bool color_set[16];
 
+  StringBuilder input;              // output not fed to libvterm yet
+  size_t input_pos;                 // start of the backlog in "input"
+  bool input_paused;                // flow_cb was called to pause the output
+  uint64_t last_refresh;            // time of the last refresh (os_hrtime)
+
   size_t refcount;                  // reference count
 };
 
@@ -170,6 +207,9 @@ static VTermScreenCallbacks vterm_screen_callbacks = {
 };
 
 static PMap(ptr_t) invalidated_terminals = MAP_INIT;
+// Terminals with a backlog of output.
+static PMap(ptr_t) busy_terminals = MAP_INIT;
+static bool input_scheduled = false;
 
 void terminal_init(void)
 {
@@ -184,9 +224,11 @@ void terminal_teardown(void)
   multiqueue_free(refresh_timer.events);
   time_watcher_close(&refresh_timer, NULL);
   pmap_destroy(ptr_t)(&invalidated_terminals);
+  pmap_destroy(ptr_t)(&busy_terminals);
   // terminal_destroy might be called after terminal_teardown is invoked
   // make sure it is in an empty, valid state
   pmap_init(ptr_t, &invalidated_terminals);
+  pmap_init(ptr_t, &busy_terminals);
 }
 
 static void term_output_callback(const char *s, size_t len, void *user_data)
@@ -314,6 +356,13 @@ void terminal_close(Terminal **termpp, int status)
 
   bool only_destroy = false;
 
+  if (status == -1 || exiting) {
+    // The terminal is going away, its backlog would not be seen.
+    drop_input(term);
+  }
+  // Otherwise the backlog is still fed under the time budget by input_event(),
+  // followed by the exit message below.
+
   if (term->closed) {
     // If called from close_buffer() after the process has already exited, we
     // only need to call the close callback to clean up the terminal object.
@@ -652,6 +701,8 @@ void terminal_destroy(Terminal **termpp)
   }
 
   if (!term->refcount) {
+    pmap_del(ptr_t)(&busy_terminals, term);
+    kv_destroy(term->input);
     if (pmap_has(ptr_t)(&invalidated_terminals, term)) {
       // flush any pending changes to the buffer
       block_autocmds();
@@ -660,7 +711,7 @@ void terminal_destroy(Terminal **termpp)
       pmap_del(ptr_t)(&invalidated_terminals, term);
     }
     for (size_t i = 0; i < term->sb_current; i++) {
-      xfree(term->sb_buffer[i]);
+      xfree(sb_line(term, i));
     }
     xfree(term->sb_buffer);
     xfree(term->title);
@@ -776,8 +827,111 @@ void terminal_receive(Terminal *term, char *data, size_t len)
     return;
   }
 
-  vterm_input_write(term->vt, data, len);
+  g_stats.term_received += (int64_t)len;
+  size_t fed = 0;
+  if (!pmap_has(ptr_t)(&busy_terminals, term)) {
+    fed = feed_input(term, data, len);
+    if (fed == len) {
+      return;
+    }
+    pmap_put(ptr_t)(&busy_terminals, term, NULL);
+    schedule_input();
+  }
+
+  // Keep the rest as a backlog, after any older one.
+  kv_concat_len(term->input, data + fed, len - fed);
+  if (!term->input_paused && term->opts.flow_cb
+      && kv_size(term->input) - term->input_pos >= INPUT_BACKLOG_MAX) {
+    term->input_paused = true;
+    g_stats.term_paused++;
+    term->opts.flow_cb(true, term->opts.data);
+  }
+}
+
+/// Feeds output to libvterm in slices, until all of it was fed or the time
+/// budget is exhausted.
+///
+/// @return number of bytes fed.
+static size_t feed_input(Terminal *term, const char *data, size_t len)
+{
+  const uint64_t start = os_hrtime();
+  size_t fed = 0;
+  while (fed < len) {
+    size_t n = MIN(len - fed, INPUT_SLICE);
+    vterm_input_write(term->vt, data + fed, n);
+    fed += n;
+    if (os_hrtime() - start >= INPUT_BUDGET * 1000000) {
+      break;
+    }
+  }
   vterm_screen_flush_damage(term->vts);
+  return fed;
+}
+
+/// Feeds part of the backlog of a terminal.
+///
+/// @return true if the backlog is empty.
+static bool process_input(Terminal *term)
+{
+  const char *data = term->input.items + term->input_pos;
+  term->input_pos += feed_input(term, data, kv_size(term->input) - term->input_pos);
+
+  size_t left = kv_size(term->input) - term->input_pos;
+  if (left == 0) {
+    kv_size(term->input) = 0;
+    term->input_pos = 0;
+  } else if (term->input_pos >= left) {
+    // Move the backlog to the start, instead of growing the buffer.
+    memmove(term->input.items, term->input.items + term->input_pos, left);
+    kv_size(term->input) = left;
+    term->input_pos = 0;
+  }
+
+  if (term->input_paused && left < INPUT_BACKLOG_MAX / 2) {
+    term->input_paused = false;
+    g_stats.term_resumed++;
+    term->opts.flow_cb(false, term->opts.data);
+  }
+  return left == 0;
+}
+
+/// Discards the backlog of a terminal.
+static void drop_input(Terminal *term)
+{
+  pmap_del(ptr_t)(&busy_terminals, term);
+  kv_size(term->input) = 0;
+  term->input_pos = 0;
+}
+
+static void schedule_input(void)
+{
+  if (!input_scheduled) {
+    // Queued after the pending events, including input from the user.
+    multiqueue_put(main_loop.events, input_event, 0);
+    input_scheduled = true;
+  }
+}
+
+/// Feeds part of the backlog of all busy_terminals.
+static void input_event(void **argv)
+{
+  input_scheduled = false;
+  Terminal *term;
+  void *stub; (void)(stub);
+  kvec_t(Terminal *) done = KV_INITIAL_VALUE;
+  map_foreach(&busy_terminals, term, stub, {
+    if (process_input(term)) {
+      kv_push(done, term);
+    }
+  });
+  for (size_t i = 0; i < kv_size(done); i++) {
+    pmap_del(ptr_t)(&busy_terminals, kv_A(done, i));
+  }
+  kv_destroy(done);
+
+  if (map_size(&busy_terminals)) {
+    schedule_input();
+  }
 }
 
 static int get_rgb(VTermState *state, VTermColor color)
@@ -979,6 +1133,30 @@ static int term_bell(void *data)
   return 1;
 }
 
+/// Gets a scrollback line, 0 being the most recently pushed.
+static ScrollbackLine *sb_line(Terminal *term, size_t idx)
+{
+  assert(idx < term->sb_current);
+  return term->sb_buffer[(term->sb_head + term->sb_size - 1 - idx) % term->sb_size];
+}
+
+static bool sb_run_matches(const ScrollbackRun *run, const VTermScreenCell *cell)
+{
+  return run->width == cell->width
+         && memcmp(&run->attrs, &cell->attrs, sizeof(run->attrs)) == 0
+         && vterm_color_is_equal(&run->fg, &cell->fg)
+         && vterm_color_is_equal(&run->bg, &cell->bg);
+}
+
+static void sb_run_init(ScrollbackRun *run, const VTermScreenCell *cell)
+{
+  memcpy(&run->attrs, &cell->attrs, sizeof(run->attrs));
+  run->fg = cell->fg;
+  run->bg = cell->bg;
+  run->cells = 1;
+  run->width = (uint8_t)cell->width;
+}
+
 /// Scrollback push handler: called just before a line goes offscreen (and libvterm will forget it),
 /// giving us a chance to store it.
 ///
@@ -991,42 +1169,55 @@ static int term_sb_push(int cols, const VTermScreenCell *cells, void *data)
     return 0;
   }
 
-  // copy vterm cells into sb_buffer
-  size_t c = (size_t)cols;
-  ScrollbackLine *sbrow = NULL;
-  if (term->sb_current == term->sb_size) {
-    if (term->sb_buffer[term->sb_current - 1]->cols == c) {
-      // Recycle old row if it's the right size
-      sbrow = term->sb_buffer[term->sb_current - 1];
+  // Convert the cells into the text of the buffer line, and count the runs.
+  size_t line_len = 0;
+  size_t nruns = 0;
+  char *ptr = term->textbuf;
+  ScrollbackRun run = { 0 };
+  for (int col = 0; col < cols; col += cells[col].width) {
+    size_t cell_len = cell_to_utf8(&cells[col], ptr);
+    if (cell_len) {
+      ptr += cell_len;
+      line_len = (size_t)(ptr - term->textbuf);
     } else {
-      xfree(term->sb_buffer[term->sb_current - 1]);
+      *ptr++ = ' ';
+    }
+    if (nruns == 0 || !sb_run_matches(&run, &cells[col])) {
+      sb_run_init(&run, &cells[col]);
+      nruns++;
     }
-
-    // Make room at the start by shifting to the right.
-    memmove(term->sb_buffer + 1, term->sb_buffer,
-            sizeof(term->sb_buffer[0]) * (term->sb_current - 1));
-  } else if (term->sb_current > 0) {
-    // Make room at the start by shifting to the right.
-    memmove(term->sb_buffer + 1, term->sb_buffer,
-            sizeof(term->sb_buffer[0]) * term->sb_current);
-  }
-
-  if (!sbrow) {
-    sbrow = xmalloc(sizeof(ScrollbackLine) + c * sizeof(sbrow->cells[0]));
-    sbrow->cols = c;
   }
 
-  // New row is added at the start of the storage buffer.
-  term->sb_buffer[0] = sbrow;
-  if (term->sb_current < term->sb_size) {
+  size_t size = sizeof(ScrollbackLine) + nruns * sizeof(ScrollbackRun) + line_len + 1;
+  ScrollbackLine *sbrow;
+  if (term->sb_current == term->sb_size) {
+    // Full: the oldest line is dropped, reuse its memory.
+    sbrow = xrealloc(term->sb_buffer[term->sb_head], size);
+  } else {
+    sbrow = xmalloc(size);
     term->sb_current++;
   }
+  term->sb_buffer[term->sb_head] = sbrow;
+  term->sb_head = (term->sb_head + 1) % term->sb_size;
 
   if (term->sb_pending < (int)term->sb_size) {
     term->sb_pending++;
   }
 
-  memcpy(sbrow->cells, cells, sizeof(cells[0]) * c);
+  sbrow->cols = (size_t)cols;
+  sbrow->nruns = nruns;
+  sbrow->len = line_len;
+  ScrollbackRun *cur = NULL;
+  for (int col = 0; col < cols; col += cells[col].width) {
+    if (cur && sb_run_matches(cur, &cells[col])) {
+      cur->cells++;
+    } else {
+      cur = cur ? cur + 1 : sbrow->runs;
+      sb_run_init(cur, &cells[col]);
+    }
+  }
+  memcpy(SB_TEXT(sbrow), term->textbuf, line_len);
+  SB_TEXT(sbrow)[line_len] = NUL;
   pmap_put(ptr_t)(&invalidated_terminals, term, NULL);
 
   return 1;
@@ -1049,20 +1240,44 @@ static int term_sb_pop(int cols, VTermScreenCell *cells, void *data)
     term->sb_pending--;
   }
 
-  ScrollbackLine *sbrow = term->sb_buffer[0];
+  ScrollbackLine *sbrow = sb_line(term, 0);
   term->sb_current--;
-  // Forget the "popped" row by shifting the rest onto it.
-  memmove(term->sb_buffer, term->sb_buffer + 1,
-          sizeof(term->sb_buffer[0]) * (term->sb_current));
+  term->sb_head = (term->sb_head + term->sb_size - 1) % term->sb_size;
 
-  size_t cols_to_copy = (size_t)cols;
-  if (cols_to_copy > sbrow->cols) {
-    cols_to_copy = sbrow->cols;
+  // Rebuild the cells from the text and the runs.
+  const char *p = SB_TEXT(sbrow);
+  int col = 0;
+  for (size_t i = 0; i < sbrow->nruns; i++) {
+    const ScrollbackRun *run = &sbrow->runs[i];
+    for (uint32_t n = 0; n < run->cells && col < cols; n++) {
+      VTermScreenCell *cell = &cells[col];
+      CLEAR_POINTER(cell);
+      int ci = 0;
+      if (*p != NUL) {
+        const char *const cell_end = p + utfc_ptr2len(p);
+        while (p < cell_end) {
+          if (ci < VTERM_MAX_CHARS_PER_CELL) {
+            cell->chars[ci++] = (uint32_t)utf_ptr2char(p);
+          }
+          p += utf_ptr2len(p);
+        }
+      }
+      cell->width = (char)run->width;
+      cell->attrs = run->attrs;
+      cell->fg = run->fg;
+      cell->bg = run->bg;
+      col++;
+      if (run->width == 2 && col < cols) {
+        // Continuation cell of a wide character.
+        cells[col] = *cell;
+        cells[col].chars[0] = (uint32_t)-1;
+        cells[col].chars[1] = 0;
+        cells[col].width = 1;
+        col++;
+      }
+    }
   }
-
-  // copy to vterm state
-  memcpy(cells, sbrow->cells, sizeof(cells[0]) * cols_to_copy);
-  for (size_t col = cols_to_copy; col < (size_t)cols; col++) {
+  for (; col < cols; col++) {
     cells[col].chars[0] = 0;
     cells[col].width = 1;
   }
@@ -1469,20 +1684,49 @@ end:
 // }}}
 // terminal buffer refresh & misc {{{
 
+/// Writes the characters of a cell as UTF-8.
+///
+/// @return number of bytes written, 0 for an empty cell.
+static size_t cell_to_utf8(const VTermScreenCell *cell, char *buf)
+{
+  size_t len = 0;
+  for (int i = 0; i < VTERM_MAX_CHARS_PER_CELL && cell->chars[i]; i++) {
+    len += (size_t)utf_char2bytes((int)cell->chars[i], buf + len);
+  }
+  return len;
+}
+
 static void fetch_row(Terminal *term, int row, int end_col)
 {
   int col = 0;
   size_t line_len = 0;
-  char *ptr = term->textbuf;
 
+  if (row < 0) {
+    // The scrollback line already holds the text, only cut it at "end_col".
+    ScrollbackLine *sbrow = sb_line(term, (size_t)(-row - 1));
+    const char *text = SB_TEXT(sbrow);
+    line_len = sbrow->len;
+    if ((size_t)end_col < sbrow->cols) {
+      const char *p = text;
+      for (size_t i = 0; i < sbrow->nruns && *p != NUL && col < end_col; i++) {
+        for (uint32_t n = 0; n < sbrow->runs[i].cells && *p != NUL && col < end_col; n++) {
+          p += utfc_ptr2len(p);
+          col += sbrow->runs[i].width;
+        }
+      }
+      line_len = (size_t)(p - text);
+    }
+    memcpy(term->textbuf, text, line_len);
+    term->textbuf[line_len] = NUL;
+    return;
+  }
+
+  char *ptr = term->textbuf;
   while (col < end_col) {
     VTermScreenCell cell;
     fetch_cell(term, row, col, &cell);
-    if (cell.chars[0]) {
-      int cell_len = 0;
-      for (int i = 0; i < VTERM_MAX_CHARS_PER_CELL && cell.chars[i]; i++) {
-        cell_len += utf_char2bytes((int)cell.chars[i], ptr + cell_len);
-      }
+    size_t cell_len = cell_to_utf8(&cell, ptr);
+    if (cell_len) {
       ptr += cell_len;
       line_len = (size_t)(ptr - term->textbuf);
     } else {
@@ -1495,12 +1739,31 @@ static void fetch_row(Terminal *term, int row, int end_col)
   term->textbuf[line_len] = NUL;
 }
 
+/// Gets a cell of the screen or the scrollback. For a scrollback row only the
+/// width and attributes of the cell are filled in.
 static bool fetch_cell(Terminal *term, int row, int col, VTermScreenCell *cell)
 {
   if (row < 0) {
-    ScrollbackLine *sbrow = term->sb_buffer[-row - 1];
+    ScrollbackLine *sbrow = sb_line(term, (size_t)(-row - 1));
+    const ScrollbackRun *run = NULL;
     if ((size_t)col < sbrow->cols) {
-      *cell = sbrow->cells[col];
+      int run_col = 0;
+      for (size_t i = 0; i < sbrow->nruns; i++) {
+        run_col += (int)(sbrow->runs[i].cells * sbrow->runs[i].width);
+        if (col < run_col) {
+          run = &sbrow->runs[i];
+          break;
+        }
+      }
+    }
+    if (run) {
+      *cell = (VTermScreenCell) {
+        .chars = { 0 },
+        .width = (char)run->width,
+        .attrs = run->attrs,
+        .fg = run->fg,
+        .bg = run->bg,
+      };
     } else {
       // fill the pointer with an empty cell
       *cell = (VTermScreenCell) {
@@ -1554,6 +1817,7 @@ static void refresh_terminal(Terminal *term)
 
   long ml_added = buf->b_ml.ml_line_count - ml_before;
   adjust_topline(term, buf, ml_added);
+  term->last_refresh = os_hrtime();
 }
 
 /// Calls refresh_terminal() on all invalidated_terminals.
@@ -1565,13 +1829,30 @@ static void refresh_timer_cb(TimeWatcher *watcher, void *data)
   }
   Terminal *term;
   void *stub; (void)(stub);
+  const uint64_t now = os_hrtime();
+  kvec_t(Terminal *) busy = KV_INITIAL_VALUE;
   // don't process autocommands while updating terminal buffers
   block_autocmds();
   map_foreach(&invalidated_terminals, term, stub, {
-    refresh_terminal(term);
+    if (pmap_has(ptr_t)(&busy_terminals, term)
+        && now - term->last_refresh < BUSY_REFRESH_DELAY * 1000000) {
+      // More output is coming: skip this state of the screen.
+      kv_push(busy, term);
+    } else {
+      refresh_terminal(term);
+    }
   });
   pmap_clear(ptr_t)(&invalidated_terminals);
   unblock_autocmds();
+
+  if (kv_size(busy)) {
+    for (size_t i = 0; i < kv_size(busy); i++) {
+      pmap_put(ptr_t)(&invalidated_terminals, kv_A(busy, i), NULL);
+    }
+    time_watcher_start(&refresh_timer, refresh_timer_cb, REFRESH_DELAY, 0);
+    refresh_pending = true;
+  }
+  kv_destroy(busy);
 }
 
 static void refresh_size(Terminal *term, buf_T *buf)
@@ -1613,16 +1894,21 @@ static void adjust_scrollback(Terminal *term, buf_T *buf)
     size_t diff = term->sb_current - scbk;
     for (size_t i = 0; i < diff; i++) {
       ml_delete(1, false);
+      xfree(sb_line(term, term->sb_current - 1));
       term->sb_current--;
-      xfree(term->sb_buffer[term->sb_current]);
     }
     deleted_lines(1, (linenr_T)diff);
   }
 
-  // Resize the scrollback storage.
-  size_t sb_region = sizeof(ScrollbackLine *) * scbk;
+  // Resize the scrollback storage, moving the lines to the start of the ring.
   if (scbk != term->sb_size) {
-    term->sb_buffer = xrealloc(term->sb_buffer, sb_region);
+    ScrollbackLine **sb_buffer = xmalloc(sizeof(ScrollbackLine *) * scbk);
+    for (size_t i = 0; i < term->sb_current; i++) {
+      sb_buffer[i] = sb_line(term, term->sb_current - 1 - i);
+    }
+    xfree(term->sb_buffer);
+    term->sb_buffer = sb_buffer;
+    term->sb_head = term->sb_current % scbk;
   }
 
   term->sb_size = scbk;
@@ -9,6 +9,7 @@ typedef struct terminal Terminal;
 typedef void (*terminal_write_cb)(char *buffer, size_t size, void *data);
 typedef void (*terminal_resize_cb)(uint16_t width, uint16_t height, void *data);
 typedef void (*terminal_close_cb)(void *data);
+typedef void (*terminal_flow_cb)(bool pause, void *data);
 
 #include "nvim/buffer_defs.h"
 
@@ -18,6 +19,7 @@ typedef struct {
   terminal_write_cb write_cb;
   terminal_resize_cb resize_cb;
   terminal_close_cb close_cb;
+  terminal_flow_cb flow_cb;  // pause/resume the output, NULL if not supported
 } TerminalOptions;
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
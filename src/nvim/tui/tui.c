@@ -4,8 +4,10 @@
 // Terminal UI functions. Invoked (by ui_client.c) on the UI process.
 
 #include <assert.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +26,7 @@
 #include "nvim/event/signal.h"
 #include "nvim/event/stream.h"
 #include "nvim/globals.h"
+#include "nvim/grid.h"
 #include "nvim/grid_defs.h"
 #include "nvim/highlight_defs.h"
 #include "nvim/log.h"
@@ -34,6 +37,7 @@
 #include "nvim/msgpack_rpc/channel.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
+#include "nvim/os/time.h"
 #include "nvim/tui/input.h"
 #include "nvim/tui/terminfo.h"
 #include "nvim/tui/tui.h"
@@ -50,6 +54,17 @@
 // when flushing. No existing terminal will require 32 bytes to do that.
 #define CNORM_COMMAND_MAX_SIZE 32
 #define OUTBUF_SIZE 0xffff
+// Space reserved for the sequences beginning and ending a synchronized update.
+#define SYNC_COMMAND_MAX_SIZE 16
+
+// Flushes arriving within the frame budget after the previous frame are
+// coalesced into a single frame. The budget adapts to the time the terminal
+// takes to accept a frame, between these bounds (in milliseconds).
+#define FRAME_BUDGET_MIN 4
+#define FRAME_BUDGET_MAX 100
+// A flush coming this long (in milliseconds) after the previous one is not part
+// of a burst, e.g. the echo of a single keystroke, and is written at once.
+#define FRAME_IDLE 16
 
 #define TOO_MANY_EVENTS 1000000
 #define STARTS_WITH(str, prefix) \
@@ -81,6 +96,9 @@ struct TUIData {
   char norm[CNORM_COMMAND_MAX_SIZE];
   char invis[CNORM_COMMAND_MAX_SIZE];
   size_t normlen, invislen;
+  char sync_begin[SYNC_COMMAND_MAX_SIZE];
+  char sync_end[SYNC_COMMAND_MAX_SIZE];
+  size_t sync_beginlen, sync_endlen;
   TermInput input;
   uv_loop_t write_loop;
   unibi_term *ut;
@@ -92,6 +110,7 @@ struct TUIData {
   bool out_isatty;
   SignalWatcher winch_handle;
   uv_timer_t startup_delay_timer;
+  uv_timer_t frame_timer;
   UGrid grid;
   kvec_t(Rect) invalid_regions;
   int row, col;
@@ -109,6 +128,16 @@ struct TUIData {
   bool title_enabled;
   bool busy, is_invisible, want_invisible;
   bool cork, overflow;
+  bool sync_output;  // terminal supports synchronized output (DEC mode 2026)
+  bool in_sync;  // a synchronized update was begun but not ended yet
+  bool frame_pending;  // a frame is waiting for frame_timer
+  uint64_t last_frame;  // time when the last frame was written (ns)
+  uint64_t last_flush;  // time of the last flush request (ns)
+  uint64_t frame_write_time;  // time spent writing the current frame (ns)
+  uint64_t write_time;  // smoothed time to write a frame (ns)
+  uint64_t frame_budget;  // see FRAME_BUDGET_MIN (ms)
+  bool pacing;  // coalesce frames, see defer_frame()
+  TUIStats stats;
   bool set_cursor_color_as_str;
   bool cursor_color_changed;
   bool is_starting;
@@ -141,6 +170,7 @@ struct TUIData {
     int set_underline_color;
     int enable_extended_keys, disable_extended_keys;
     int get_extkeys;
+    int sync;
   } unibi_ext;
   char *space_buf;
   bool stopped;
@@ -159,6 +189,7 @@ void tui_start(TUIData **tui_p, int *width, int *height, char **term)
 {
   TUIData *tui = xcalloc(1, sizeof(TUIData));
   tui->is_starting = true;
+  tui->pacing = true;
   tui->screenshot = NULL;
   tui->stopped = false;
   tui->loop = &main_loop;
@@ -177,6 +208,8 @@ void tui_start(TUIData **tui_p, int *width, int *height, char **term)
   tui->startup_delay_timer.data = tui;
   uv_timer_start(&tui->startup_delay_timer, after_startup_cb,
                  100, 0);
+  uv_timer_init(&tui->loop->uv, &tui->frame_timer);
+  tui->frame_timer.data = tui;
 
   *tui_p = tui;
   loop_poll_events(&main_loop, 1);
@@ -230,6 +263,13 @@ static void terminfo_start(TUIData *tui)
   tui->busy = false;
   tui->cork = false;
   tui->overflow = false;
+  tui->in_sync = false;
+  tui->frame_pending = false;
+  tui->last_frame = 0;
+  tui->last_flush = 0;
+  tui->frame_write_time = 0;
+  tui->write_time = 0;
+  tui->frame_budget = FRAME_BUDGET_MIN;
   tui->set_cursor_color_as_str = false;
   tui->cursor_color_changed = false;
   tui->showing_mode = SHAPE_IDX_N;
@@ -256,6 +296,7 @@ static void terminfo_start(TUIData *tui)
   tui->unibi_ext.enable_extended_keys = -1;
   tui->unibi_ext.disable_extended_keys = -1;
   tui->unibi_ext.get_extkeys = -1;
+  tui->unibi_ext.sync = -1;
   tui->out_fd = STDOUT_FILENO;
   tui->out_isatty = os_isatty(tui->out_fd);
   tui->input.tui_data = tui;
@@ -321,6 +362,15 @@ static void terminfo_start(TUIData *tui)
                                    tui->norm, sizeof tui->norm);
   tui->invislen = unibi_pre_fmt_str(tui, unibi_cursor_invisible,
                                     tui->invis, sizeof tui->invis);
+  if (tui->unibi_ext.sync != -1) {
+    const char *sync = unibi_get_ext_str(tui->ut, (unsigned)tui->unibi_ext.sync);
+    UNIBI_SET_NUM_VAR(tui->params[0], 1);
+    tui->sync_beginlen = unibi_run(sync, tui->params, tui->sync_begin, sizeof tui->sync_begin);
+    UNIBI_SET_NUM_VAR(tui->params[0], 2);
+    tui->sync_endlen = unibi_run(sync, tui->params, tui->sync_end, sizeof tui->sync_end);
+    tui->sync_output = tui->sync_beginlen > 0 && tui->sync_beginlen <= sizeof tui->sync_begin
+                       && tui->sync_endlen > 0 && tui->sync_endlen <= sizeof tui->sync_end;
+  }
   // Set 't_Co' from the result of unibilium & fix_terminfo.
   t_colors = unibi_get_num(tui->ut, unibi_max_colors);
   // Enter alternate screen, save title, and clear.
@@ -437,6 +487,9 @@ static void tui_terminal_stop(TUIData *tui)
   }
   tinput_stop(&tui->input);
   signal_watcher_stop(&tui->winch_handle);
+  // a pending frame is written by terminfo_stop()
+  uv_timer_stop(&tui->frame_timer);
+  tui->frame_pending = false;
   // Position the cursor on the last screen line, below all the text
   cursor_goto(tui, tui->height - 1, 0);
   terminfo_stop(tui);
@@ -450,6 +503,27 @@ void tui_stop(TUIData *tui)
   tui->stopped = true;
   signal_watcher_close(&tui->winch_handle, NULL);
   uv_close((uv_handle_t *)&tui->startup_delay_timer, NULL);
+  uv_close((uv_handle_t *)&tui->frame_timer, NULL);
+
+  ILOG("TUI output: %" PRIu64 " bytes, %" PRIu64 " frames, %" PRIu64 " coalesced flushes, %"
+       PRIu64 " idle frames", tui->stats.bytes, tui->stats.frames,
+       tui->stats.coalesced_flushes, tui->stats.idle_frames);
+  if (time_fd != NULL) {
+    fprintf(time_fd, "\nTUI output: %" PRIu64 " bytes, %" PRIu64 " frames, %" PRIu64
+            " coalesced flushes, %" PRIu64 " idle frames\n", tui->stats.bytes,
+            tui->stats.frames, tui->stats.coalesced_flushes, tui->stats.idle_frames);
+  }
+}
+
+/// Disables frame pacing, so that every flush is written as its own frame.
+void tui_disable_pacing(TUIData *tui)
+{
+  tui->pacing = false;
+}
+
+TUIStats tui_get_stats(TUIData *tui)
+{
+  return tui->stats;
 }
 
 /// Returns true if UI `ui` is stopped.
@@ -512,6 +586,7 @@ static void update_attrs(TUIData *tui, int attr_id)
     return;
   }
   tui->print_attr_id = attr_id;
+  tui->stats.attr_changes++;
   HlAttrs attrs = kv_A(tui->attrs, (size_t)attr_id);
   int attr = tui->rgb ? attrs.rgb_ae_attr : attrs.cterm_ae_attr;
 
@@ -683,7 +758,9 @@ static void print_cell(TUIData *tui, UCell *ptr)
     final_column_wrap(tui);
   }
   update_attrs(tui, ptr->attr);
-  out(tui, ptr->data, strlen(ptr->data));
+  char buf[MAX_SCHAR_SIZE];
+  size_t len = schar_get(buf, ptr->data);
+  out(tui, buf, len);
   grid->col++;
   if (tui->immediate_wrap_after_last_column) {
     // Printing at the right margin immediately advances the cursor.
@@ -703,7 +780,8 @@ static bool cheap_to_print(TUIData *tui, int row, int col, int next)
         return false;
       }
     }
-    if (strlen(cell->data) > 1) {
+    char buf[MAX_SCHAR_SIZE];
+    if (schar_get(buf, cell->data) > 1) {
       return false;
     }
     cell++;
@@ -726,6 +804,7 @@ static void cursor_goto(TUIData *tui, int row, int col)
   if (row == grid->row && col == grid->col) {
     return;
   }
+  tui->stats.cursor_motions++;
   if (0 == row && 0 == col) {
     unibi_out(tui, unibi_cursor_home);
     ugrid_goto(grid, row, col);
@@ -831,14 +910,16 @@ static void print_cell_at_pos(TUIData *tui, int row, int col, UCell *cell, bool
 {
   UGrid *grid = &tui->grid;
 
-  if (grid->row == -1 && cell->data[0] == NUL) {
+  if (grid->row == -1 && cell->data == 0) {
     // If cursor needs to repositioned and there is nothing to print, don't move cursor.
     return;
   }
 
   cursor_goto(tui, row, col);
 
-  bool is_ambiwidth = utf_ambiguous_width(utf_ptr2char(cell->data));
+  char buf[MAX_SCHAR_SIZE];
+  schar_get(buf, cell->data);
+  bool is_ambiwidth = utf_ambiguous_width(utf_ptr2char(buf));
   if (is_ambiwidth && is_doublewidth) {
     // Clear the two screen cells.
     // If the character is single-width in the host terminal it won't change the second cell.
@@ -1273,15 +1354,14 @@ void tui_flush(TUIData *tui)
       int clear_col;
       for (clear_col = r.right; clear_col > 0; clear_col--) {
         UCell *cell = &grid->cells[row][clear_col - 1];
-        if (!(cell->data[0] == ' ' && cell->data[1] == NUL
-              && cell->attr == clear_attr)) {
+        if (!(cell->data == schar_from_ascii(' ') && cell->attr == clear_attr)) {
           break;
         }
       }
 
       UGRID_FOREACH_CELL(grid, row, r.left, clear_col, {
         print_cell_at_pos(tui, row, curcol, cell,
-                          curcol < clear_col - 1 && (cell + 1)->data[0] == NUL);
+                          curcol < clear_col - 1 && (cell + 1)->data == 0);
       });
       if (clear_col < r.right) {
         clear_region(tui, row, row + 1, clear_col, r.right, clear_attr);
@@ -1291,9 +1371,53 @@ void tui_flush(TUIData *tui)
 
   cursor_goto(tui, tui->row, tui->col);
 
+  if (defer_frame(tui)) {
+    return;
+  }
   flush_buf(tui);
 }
 
+/// Coalesces the frame with the following ones if it comes sooner than the
+/// frame budget after the previous one. The accumulated output is then written
+/// when frame_timer expires, as a single frame with the flushes in between.
+/// The first flush after an idle period (see FRAME_IDLE) is written at once, so
+/// that a lone keystroke is echoed without delay; only bursts are coalesced.
+///
+/// @return true if the frame was deferred.
+static bool defer_frame(TUIData *tui)
+{
+  uint64_t now = os_hrtime();
+  bool idle = (now - tui->last_flush) / 1000000 >= FRAME_IDLE;
+  tui->last_flush = now;
+  if (tui->frame_pending && !idle) {
+    tui->stats.coalesced_flushes++;
+    return true;
+  }
+  uint64_t elapsed = (now - tui->last_frame) / 1000000;
+  if (!tui->pacing || tui->screenshot || tui->stopped || idle || elapsed >= tui->frame_budget) {
+    if (tui->frame_pending) {
+      uv_timer_stop(&tui->frame_timer);
+      tui->frame_pending = false;
+    }
+    if (idle) {
+      tui->stats.idle_frames++;
+    }
+    return false;
+  }
+  tui->frame_pending = true;
+  uv_timer_start(&tui->frame_timer, frame_timer_cb, tui->frame_budget - elapsed, 0);
+  return true;
+}
+
+static void frame_timer_cb(uv_timer_t *handle)
+{
+  TUIData *tui = handle->data;
+  if (tui->frame_pending) {
+    tui->frame_pending = false;
+    flush_buf(tui);
+  }
+}
+
 /// Dumps termcap info to the messages area, if 'verbose' >= 3.
 static void show_verbose_terminfo(TUIData *tui)
 {
@@ -1445,13 +1569,13 @@ void tui_raw_line(TUIData *tui, Integer g, Integer linerow, Integer startcol, In
 {
   UGrid *grid = &tui->grid;
   for (Integer c = startcol; c < endcol; c++) {
-    memcpy(grid->cells[linerow][c].data, chunk[c - startcol], sizeof(schar_T));
+    grid->cells[linerow][c].data = chunk[c - startcol];
     assert((size_t)attrs[c - startcol] < kv_size(tui->attrs));
     grid->cells[linerow][c].attr = attrs[c - startcol];
   }
   UGRID_FOREACH_CELL(grid, (int)linerow, (int)startcol, (int)endcol, {
     print_cell_at_pos(tui, (int)linerow, curcol, cell,
-                      curcol < endcol - 1 && (cell + 1)->data[0] == NUL);
+                      curcol < endcol - 1 && (cell + 1)->data == 0);
   });
 
   if (clearcol > endcol) {
@@ -1468,7 +1592,7 @@ void tui_raw_line(TUIData *tui, Integer g, Integer linerow, Integer startcol, In
 
     if (endcol != grid->width) {
       // Print the last char of the row, if we haven't already done so.
-      int size = grid->cells[linerow][grid->width - 1].data[0] == NUL ? 2 : 1;
+      int size = grid->cells[linerow][grid->width - 1].data == 0 ? 2 : 1;
       print_cell_at_pos(tui, (int)linerow, grid->width - size,
                         &grid->cells[linerow][grid->width - size], size == 2);
     }
@@ -1570,7 +1694,7 @@ retry: \
       unibi_format(vars, vars + 26, str, params, out, tui, pad, tui); \
       if (tui->overflow) { \
         tui->bufpos = orig_pos; \
-        flush_buf(tui); \
+        write_buf(tui, false); \
         goto retry; \
       } \
       tui->cork = false; \
@@ -1601,7 +1725,7 @@ static void out(void *ctx, const char *str, size_t len)
       tui->overflow = true;
       return;
     }
-    flush_buf(tui);
+    write_buf(tui, false);
   }
 
   memcpy(tui->buf + tui->bufpos, str, len);
@@ -2165,16 +2289,39 @@ static void augment_terminfo(TUIData *tui, const char *term, long vte_version, l
                                                                 "\x1b[58:2::%p1%d:%p2%d:%p3%dm");
   }
 
+  // Synchronized output (DEC private mode 2026). "Sync" is the terminfo
+  // extension used for it by tmux and kitty.
+  tui->unibi_ext.sync = unibi_find_ext_str(ut, "Sync");
+  if (tui->unibi_ext.sync == -1
+      && (kitty
+          || terminfo_is_term_family(term, "foot")
+          || terminfo_is_term_family(term, "wezterm")
+          || terminfo_is_term_family(term, "contour"))) {
+    tui->unibi_ext.sync = (int)unibi_add_ext_str(ut, "Sync",
+                                                 "\x1b[?2026%?%p1%{1}%-%tl%eh%;");
+  }
+
   if (!kitty && (vte_version == 0 || vte_version >= 5400)) {
     // Fallback to Xterm's modifyOtherKeys if terminal does not support CSI u
     tui->input.extkeys_type = kExtkeysXterm;
   }
 }
 
+/// Writes the output buffer, ending the current frame.
 static void flush_buf(TUIData *tui)
+{
+  write_buf(tui, true);
+}
+
+/// Writes the output buffer.
+///
+/// @param frame_end  false when the buffer is full halfway a frame: the cursor
+///                   is kept invisible and the synchronized update is not
+///                   ended, so that the terminal doesn't show a partial frame.
+static void write_buf(TUIData *tui, bool frame_end)
 {
   uv_write_t req;
-  uv_buf_t bufs[3];
+  uv_buf_t bufs[5];
   uv_buf_t *bufp = &bufs[0];
 
   // The content of the output for each condition is shown in the following
@@ -2194,9 +2341,19 @@ static void flush_buf(TUIData *tui)
       && ((tui->is_invisible && tui->busy)
           || (tui->is_invisible && !tui->busy && tui->want_invisible)
           || (!tui->is_invisible && !tui->busy && !tui->want_invisible))) {
+    if (frame_end && tui->in_sync) {
+      goto end_sync;
+    }
     return;
   }
 
+  if (tui->sync_output && !tui->in_sync && !tui->screenshot) {
+    bufp->base = tui->sync_begin;
+    bufp->len = UV_BUF_LEN(tui->sync_beginlen);
+    bufp++;
+    tui->in_sync = true;
+  }
+
   if (!tui->is_invisible) {
     // cursor is visible. Write a "cursor invisible" command before writing the
     // buffer.
@@ -2212,7 +2369,7 @@ static void flush_buf(TUIData *tui)
     bufp++;
   }
 
-  if (!tui->busy) {
+  if (!tui->busy && frame_end) {
     assert(tui->is_invisible);
     // not busy and the cursor is invisible. Write a "cursor normal" command
     // after writing the buffer.
@@ -2224,22 +2381,51 @@ static void flush_buf(TUIData *tui)
     }
   }
 
+end_sync:
+  if (frame_end && tui->in_sync) {
+    bufp->base = tui->sync_end;
+    bufp->len = UV_BUF_LEN(tui->sync_endlen);
+    bufp++;
+    tui->in_sync = false;
+  }
+
   if (tui->screenshot) {
     for (size_t i = 0; i < (size_t)(bufp - bufs); i++) {
       fwrite(bufs[i].base, bufs[i].len, 1, tui->screenshot);
     }
   } else {
+    uint64_t start = os_hrtime();
     int ret = uv_write(&req, STRUCT_CAST(uv_stream_t, &tui->output_handle),
                        bufs, (unsigned)(bufp - bufs), NULL);
     if (ret) {
       ELOG("uv_write failed: %s", uv_strerror(ret));
     }
     uv_run(&tui->write_loop, UV_RUN_DEFAULT);
+    tui->frame_write_time += os_hrtime() - start;
+    for (size_t i = 0; i < (size_t)(bufp - bufs); i++) {
+      tui->stats.bytes += bufs[i].len;
+    }
+    if (frame_end) {
+      end_frame(tui);
+    }
   }
   tui->bufpos = 0;
   tui->overflow = false;
 }
 
+/// Adapts the frame budget to the time the terminal took to accept the frame:
+/// when it can't keep up (e.g. over a slow connection), more flushes are
+/// combined into one frame rather than queued.
+static void end_frame(TUIData *tui)
+{
+  tui->stats.frames++;
+  tui->write_time = (3 * tui->write_time + tui->frame_write_time) / 4;
+  tui->frame_write_time = 0;
+  tui->frame_budget = MIN(MAX(2 * tui->write_time / 1000000, FRAME_BUDGET_MIN),
+                          FRAME_BUDGET_MAX);
+  tui->last_frame = os_hrtime();
+}
+
 /// Try to get "kbs" code from stty because "the terminfo kbs entry is extremely
 /// unreliable." (Vim, Bash, and tmux also do this.)
 ///
@@ -1,11 +1,23 @@
 #ifndef NVIM_TUI_TUI_H
 #define NVIM_TUI_TUI_H
 
+#include <stdint.h>
+
 #include "nvim/cursor_shape.h"
 #include "nvim/ui.h"
 
 typedef struct TUIData TUIData;
 
+/// Output statistics of the TUI, see tui_get_stats().
+typedef struct {
+  uint64_t bytes;  ///< bytes written to the terminal
+  uint64_t frames;  ///< frames written
+  uint64_t coalesced_flushes;  ///< flushes combined into a later frame
+  uint64_t idle_frames;  ///< frames written at once after an idle period
+  uint64_t cursor_motions;  ///< cursor movements emitted
+  uint64_t attr_changes;  ///< highlight attribute changes emitted
+} TUIStats;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "tui/tui.h.generated.h"
 #endif
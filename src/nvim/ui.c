@@ -94,12 +94,14 @@ static void ui_log(const char *funname)
 // UI_CALL invokes a function on all registered UI instances.
 // This is called by code generated by generators/gen_api_ui_events.lua
 // C code should use ui_call_{funname} instead.
+// UIs sharing the redraw stream of another UI are skipped, the leader of the
+// group packs the event for them.
 #define UI_CALL(cond, funname, ...) \
   do { \
     bool any_call = false; \
     for (size_t i = 0; i < ui_count; i++) { \
       UI *ui = uis[i]; \
-      if ((cond)) { \
+      if ((cond) && !ui->data->leader) { \
         remote_ui_##funname(__VA_ARGS__); \
         any_call = true; \
       } \
@@ -347,6 +349,16 @@ void ui_attach_impl(UI *ui, uint64_t chanid)
   }
 
   uis[ui_count++] = ui;
+  ui_resync(ui);
+
+  do_autocmd_uienter(chanid, true);
+}
+
+/// Sends the complete UI state to `ui`, and redraws the screen.
+///
+/// Used when `ui` attaches, and after redraw events to it had to be dropped.
+void ui_resync(UI *ui)
+{
   ui_refresh_options();
   resettitle();
 
@@ -362,8 +374,6 @@ void ui_attach_impl(UI *ui, uint64_t chanid)
     ui_send_all_hls(ui);
   }
   ui_refresh();
-
-  do_autocmd_uienter(chanid, true);
 }
 
 void ui_detach_impl(UI *ui, uint64_t chanid)
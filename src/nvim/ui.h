@@ -26,6 +26,7 @@ typedef enum {
   kUIMultigrid,
   kUIHlState,
   kUITermColors,
+  kUILineRuns,
   kUIFloatDebug,
   kUIExtCount,
 } UIExtension;
@@ -40,6 +41,7 @@ EXTERN const char *ui_ext_names[] INIT(= {
   "ext_multigrid",
   "ext_hlstate",
   "ext_termcolors",
+  "ext_lineruns",
   "_debug_float",
 });
 
@@ -87,6 +89,11 @@ typedef struct {
   // Position of legacy cursor, used both for drawing and visible user cursor.
   Integer client_row, client_col;
   bool wildmenu_active;
+
+  // UIs which negotiated the same options receive the same redraw stream.
+  // One of them (the leader) packs the events, and the buffer is written to
+  // all UIs of the group. See remote_ui_regroup().
+  struct ui_t *leader;  ///< UI packing events for this one, or NULL
 } UIData;
 
 struct ui_t {
@@ -3,10 +3,13 @@
 
 /// Nvim's own UI client, which attaches to a child or remote Nvim server.
 
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
+#include "klib/kvec.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/channel.h"
 #include "nvim/eval.h"
@@ -19,7 +22,10 @@
 #include "nvim/memory.h"
 #include "nvim/msgpack_rpc/channel.h"
 #include "nvim/msgpack_rpc/channel_defs.h"
+#include "nvim/msgpack_rpc/unpacker.h"
+#include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
+#include "nvim/os/time.h"
 #include "nvim/tui/tui.h"
 #include "nvim/ui.h"
 #include "nvim/ui_client.h"
@@ -31,6 +37,9 @@
 static TUIData *tui = NULL;
 static bool ui_client_is_remote = false;
 
+// Receives the redraw stream from the server when $NVIM_UI_RECORD is set.
+static FILE *record_file = NULL;
+
 // uncrustify:off
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "ui_client.c.generated.h"
@@ -38,8 +47,27 @@ static bool ui_client_is_remote = false;
 #endif
 // uncrustify:on
 
+/// Opens the file named by $NVIM_UI_RECORD, if set.  The variable is removed from
+/// the environment, so that the embedded server and any nvim started from it
+/// don't open the same file and overwrite the recording.
+static void ui_client_record_open(void)
+{
+  const char *env = os_getenv("NVIM_UI_RECORD");
+  if (env == NULL) {
+    return;
+  }
+  char *record = xstrdup(env);
+  os_unsetenv("NVIM_UI_RECORD");
+  if (!(record_file = os_fopen(record, "wb"))) {
+    ELOG("cannot open UI recording: %s", record);
+  }
+  xfree(record);
+}
+
 uint64_t ui_client_start_server(int argc, char **argv)
 {
+  ui_client_record_open();
+
   varnumber_T exit_status;
   char **args = xmalloc(((size_t)(2 + argc)) * sizeof(char *));
   int args_idx = 0;
@@ -78,9 +106,10 @@ void ui_client_attach(int width, int height, char *term)
   ADD_C(args, INTEGER_OBJ(width));
   ADD_C(args, INTEGER_OBJ(height));
 
-  MAXSIZE_TEMP_DICT(opts, 9);
+  MAXSIZE_TEMP_DICT(opts, 10);
   PUT_C(opts, "rgb", BOOLEAN_OBJ(true));
   PUT_C(opts, "ext_linegrid", BOOLEAN_OBJ(true));
+  PUT_C(opts, "ext_lineruns", BOOLEAN_OBJ(true));
   PUT_C(opts, "ext_termcolors", BOOLEAN_OBJ(true));
   if (term) {
     PUT_C(opts, "term_name", STRING_OBJ(cstr_as_string(term)));
@@ -114,6 +143,9 @@ void ui_client_run(bool remote_ui)
   FUNC_ATTR_NORETURN
 {
   ui_client_is_remote = remote_ui;
+  if (remote_ui) {
+    ui_client_record_open();
+  }
   int width, height;
   char *term;
   tui_start(&tui, &width, &height, &term);
@@ -131,6 +163,87 @@ void ui_client_stop(void)
   if (!tui_is_stopped(tui)) {
     tui_stop(tui);
   }
+  if (record_file) {
+    fclose(record_file);
+    record_file = NULL;
+  }
+}
+
+/// Appends data received from the server to the recording, if any.
+void ui_client_record(const char *data, size_t size)
+{
+  if (record_file && size) {
+    fwrite(data, size, 1, record_file);
+  }
+}
+
+/// Replays a redraw stream recorded with $NVIM_UI_RECORD through the TUI,
+/// without a server. Used for benchmarking: the time per frame, and the
+/// amount of output the TUI produced, is reported on stderr.
+void ui_client_replay(const char *fname)
+  FUNC_ATTR_NORETURN
+{
+  FILE *f = os_fopen(fname, "rb");
+  if (!f) {
+    os_errmsg("Cannot open UI recording: ");
+    os_errmsg(fname);
+    os_errmsg("\n");
+    os_exit(1);
+  }
+  kvec_t(char) data = KV_INITIAL_VALUE;
+  char readbuf[8192];
+  size_t nread;
+  while ((nread = fread(readbuf, 1, sizeof(readbuf), f)) > 0) {
+    kv_concat_len(data, readbuf, nread);
+  }
+  fclose(f);
+
+  int width, height;
+  char *term;
+  tui_start(&tui, &width, &height, &term);
+  tui_disable_pacing(tui);
+
+  Unpacker *p = xcalloc(1, sizeof(*p));
+  unpacker_init(p);
+  p->read_ptr = data.items;
+  p->read_size = kv_size(data);
+
+  uint64_t frames = 0, max_frame = 0;
+  uint64_t start = os_hrtime();
+  uint64_t frame_start = start;
+  while (unpacker_advance(p)) {
+    if (p->type == kMessageTypeRedrawEvent) {
+      if (p->grid_line_event) {
+        ui_client_event_raw_line(p->grid_line_event);
+      } else if (p->ui_handler.fn != NULL && p->result.type == kObjectTypeArray) {
+        p->ui_handler.fn(p->result.data.array);
+        if (strequal(p->ui_handler.name, "flush")) {
+          uint64_t now = os_hrtime();
+          max_frame = MAX(max_frame, now - frame_start);
+          frame_start = now;
+          frames++;
+        }
+      }
+    }
+    arena_mem_free(arena_finish(&p->arena));
+  }
+  uint64_t total = os_hrtime() - start;
+  bool malformed = unpacker_closed(p);
+
+  TUIStats stats = tui_get_stats(tui);
+  ui_client_stop();
+  unpacker_teardown(p);
+  xfree(p);
+  kv_destroy(data);
+
+  if (malformed) {
+    os_errmsg("Malformed UI recording\n");
+  }
+  fprintf(stderr, "frames: %" PRIu64 ", time/frame: %.3f ms (max %.3f ms), "
+          "bytes: %" PRIu64 ", cursor motions: %" PRIu64 ", attribute changes: %" PRIu64 "\n",
+          frames, frames ? (double)total / (double)frames / 1.0E6 : 0.0,
+          (double)max_frame / 1.0E6, stats.bytes, stats.cursor_motions, stats.attr_changes);
+  os_exit(malformed ? 1 : 0);
 }
 
 void ui_client_set_size(int width, int height)
@@ -205,6 +318,12 @@ void ui_client_event_grid_line(Array args)
   abort();  // unreachable
 }
 
+void ui_client_event_grid_line_runs(Array args)
+  FUNC_ATTR_NORETURN
+{
+  abort();  // unreachable
+}
+
 void ui_client_event_raw_line(GridLineEvent *g)
 {
   int grid = g->args[0], row = g->args[1], startcol = g->args[2];
@@ -44,6 +44,14 @@ static size_t bufsize = 0;
 static schar_T *linebuf;
 static sattr_T *attrbuf;
 
+// Occlusion map of a screen row, see compose_occlusion().
+enum {
+  kOccVisible = 0,  ///< not covered by a layer above
+  kOccBlended = 1,  ///< covered by a layer above which is blended with it
+  kOccHidden = 2,  ///< covered by an opaque layer above
+};
+static uint8_t *occbuf;
+
 #ifndef NDEBUG
 static int chk_width = 0, chk_height = 0;
 #endif
@@ -55,7 +63,7 @@ static int msg_current_row = INT_MAX;
 static bool msg_was_scrolled = false;
 
 static int msg_sep_row = -1;
-static schar_T msg_sep_char = { ' ', NUL };
+static schar_T msg_sep_char = 0;  // set by ui_comp_init()
 
 static int dbghl_normal, dbghl_clear, dbghl_composed, dbghl_recompose;
 
@@ -63,6 +71,7 @@ void ui_comp_init(void)
 {
   kv_push(layers, &default_grid);
   curgrid = &default_grid;
+  msg_sep_char = schar_from_ascii(' ');
 }
 
 void ui_comp_syn_init(void)
@@ -85,6 +94,7 @@ void ui_comp_detach(UI *ui)
   if (composed_uis == 0) {
     XFREE_CLEAR(linebuf);
     XFREE_CLEAR(attrbuf);
+    XFREE_CLEAR(occbuf);
     bufsize = 0;
   }
   ui->composed = false;
@@ -112,23 +122,24 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
     moved = (row != grid->comp_row) || (col != grid->comp_col);
     if (ui_comp_should_draw()) {
       // Redraw the area covered by the old position, and is not covered
-      // by the new position. Disable the grid so that compose_area() will not
-      // use it.
+      // by the new position, except where a layer above the grid hides it.
+      // Disable the grid so that compose_area_above() will not use it.
       grid->comp_disabled = true;
-      compose_area(grid->comp_row, row,
-                   grid->comp_col, grid->comp_col + grid->cols);
+      size_t index = grid->comp_index;
+      compose_area_above(grid->comp_row, row,
+                         grid->comp_col, grid->comp_col + grid->cols, index);
       if (grid->comp_col < col) {
-        compose_area(MAX(row, grid->comp_row),
-                     MIN(row + height, grid->comp_row + grid->rows),
-                     grid->comp_col, col);
+        compose_area_above(MAX(row, grid->comp_row),
+                           MIN(row + height, grid->comp_row + grid->rows),
+                           grid->comp_col, col, index);
       }
       if (col + width < grid->comp_col + grid->cols) {
-        compose_area(MAX(row, grid->comp_row),
-                     MIN(row + height, grid->comp_row + grid->rows),
-                     col + width, grid->comp_col + grid->cols);
+        compose_area_above(MAX(row, grid->comp_row),
+                           MIN(row + height, grid->comp_row + grid->rows),
+                           col + width, grid->comp_col + grid->cols, index);
       }
-      compose_area(row + height, grid->comp_row + grid->rows,
-                   grid->comp_col, grid->comp_col + grid->cols);
+      compose_area_above(row + height, grid->comp_row + grid->rows,
+                         grid->comp_col, grid->comp_col + grid->cols, index);
       grid->comp_disabled = false;
     }
     grid->comp_row = row;
@@ -166,8 +177,8 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
     grid->comp_index = insert_at;
   }
   if (moved && valid && ui_comp_should_draw()) {
-    compose_area(grid->comp_row, grid->comp_row + grid->rows,
-                 grid->comp_col, grid->comp_col + grid->cols);
+    compose_area_above(grid->comp_row, grid->comp_row + grid->rows,
+                       grid->comp_col, grid->comp_col + grid->cols, grid->comp_index);
   }
   return moved;
 }
@@ -184,16 +195,20 @@ void ui_comp_remove_grid(ScreenGrid *grid)
     curgrid = &default_grid;
   }
 
-  for (size_t i = grid->comp_index; i < kv_size(layers) - 1; i++) {
+  size_t index = grid->comp_index;
+  for (size_t i = index; i < kv_size(layers) - 1; i++) {
     kv_A(layers, i) = kv_A(layers, i + 1);
     kv_A(layers, i)->comp_index = i;
   }
   (void)kv_pop(layers);
   grid->comp_index = 0;
 
-  // recompose the area under the grid
-  // inefficient when being overlapped: only draw up to grid->comp_index
-  ui_comp_compose_grid(grid);
+  // recompose the area under the grid, except where the layers which were
+  // above it (now from `index`) still hide it.
+  if (ui_comp_should_draw()) {
+    compose_area_above(grid->comp_row, grid->comp_row + grid->rows,
+                       grid->comp_col, grid->comp_col + grid->cols, index - 1);
+  }
 }
 
 bool ui_comp_set_grid(handle_T handle)
@@ -229,9 +244,9 @@ void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
     int startcol = MAX(grid->comp_col, grid2->comp_col);
     int endcol = MIN(grid->comp_col + grid->cols,
                      grid2->comp_col + grid2->cols);
-    compose_area(MAX(grid->comp_row, grid2->comp_row),
-                 MIN(grid->comp_row + grid->rows, grid2->comp_row + grid2->rows),
-                 startcol, endcol);
+    compose_area_above(MAX(grid->comp_row, grid2->comp_row),
+                       MIN(grid->comp_row + grid->rows, grid2->comp_row + grid2->rows),
+                       startcol, endcol, new_index);
   }
 }
 
@@ -354,7 +369,7 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
       grid = &msg_grid;
       sattr_T msg_sep_attr = (sattr_T)HL_ATTR(HLF_MSGSEP);
       for (int i = col; i < until; i++) {
-        memcpy(linebuf[i - startcol], msg_sep_char, sizeof(*linebuf));
+        linebuf[i - startcol] = msg_sep_char;
         attrbuf[i - startcol] = msg_sep_attr;
       }
     } else {
@@ -363,9 +378,8 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
       memcpy(linebuf + (col - startcol), grid->chars + off, n * sizeof(*linebuf));
       memcpy(attrbuf + (col - startcol), grid->attrs + off, n * sizeof(*attrbuf));
       if (grid->comp_col + grid->cols > until
-          && grid->chars[off + n][0] == NUL) {
-        linebuf[until - 1 - startcol][0] = ' ';
-        linebuf[until - 1 - startcol][1] = '\0';
+          && grid->chars[off + n] == 0) {
+        linebuf[until - 1 - startcol] = schar_from_ascii(' ');
         if (col == startcol && n == 1) {
           skipstart = 0;
         }
@@ -378,10 +392,10 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
       for (int i = col - (int)startcol; i < until - startcol; i += width) {
         width = 1;
         // negative space
-        bool thru = strequal((char *)linebuf[i], " ") && bg_line[i][0] != NUL;
-        if (i + 1 < endcol - startcol && bg_line[i + 1][0] == NUL) {
+        bool thru = linebuf[i] == schar_from_ascii(' ') && bg_line[i] != 0;
+        if (i + 1 < endcol - startcol && bg_line[i + 1] == 0) {
           width = 2;
-          thru &= strequal((char *)linebuf[i + 1], " ");
+          thru &= linebuf[i + 1] == schar_from_ascii(' ');
         }
         attrbuf[i] = (sattr_T)hl_blend_attrs(bg_attrs[i], attrbuf[i], &thru);
         if (width == 2) {
@@ -396,19 +410,18 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
 
     // Tricky: if overlap caused a doublewidth char to get cut-off, must
     // replace the visible half with a space.
-    if (linebuf[col - startcol][0] == NUL) {
-      linebuf[col - startcol][0] = ' ';
-      linebuf[col - startcol][1] = NUL;
+    if (linebuf[col - startcol] == 0) {
+      linebuf[col - startcol] = schar_from_ascii(' ');
       if (col == endcol - 1) {
         skipend = 0;
       }
-    } else if (n > 1 && linebuf[col - startcol + 1][0] == NUL) {
+    } else if (n > 1 && linebuf[col - startcol + 1] == 0) {
       skipstart = 0;
     }
 
     col = until;
   }
-  if (linebuf[endcol - startcol - 1][0] == NUL) {
+  if (linebuf[endcol - startcol - 1] == 0) {
     skipend = 0;
   }
 
@@ -470,6 +483,107 @@ static void debug_delay(Integer lines)
   os_microdelay(factor * wd * 1000U, true);
 }
 
+/// Compute the occlusion map of a screen row: which of the cells in
+/// [startcol, endcol) are covered by the layers above the layer `index`.
+/// Layers with 'winblend' don't hide the cells below them, but must still be
+/// recomposed when they change.
+///
+/// @return true if any of the cells is covered.
+static bool compose_occlusion(int row, int startcol, int endcol, size_t index)
+{
+  memset(occbuf + startcol, kOccVisible, (size_t)(endcol - startcol));
+  if (row == msg_sep_row && msg_grid.comp_index > index) {
+    // see compose_line(): the separator is drawn over all layers below msg_grid
+    memset(occbuf + startcol, msg_grid.blending ? kOccBlended : kOccHidden,
+           (size_t)(endcol - startcol));
+    return true;
+  }
+
+  bool covered = false;
+  for (size_t i = index + 1; i < kv_size(layers); i++) {
+    ScreenGrid *g = kv_A(layers, i);
+    int grid_width = MIN(g->cols, g->comp_width);
+    int grid_height = MIN(g->rows, g->comp_height);
+    if (g->comp_disabled || row < g->comp_row || row >= g->comp_row + grid_height) {
+      continue;
+    }
+    int start = MAX(g->comp_col, startcol);
+    int end = MIN(g->comp_col + grid_width, endcol);
+    for (int col = start; col < end; col++) {
+      if (!g->blending) {
+        occbuf[col] = kOccHidden;
+      } else if (occbuf[col] == kOccVisible) {
+        occbuf[col] = kOccBlended;
+      }
+      covered = true;
+    }
+  }
+  return covered;
+}
+
+/// Whether any layer above the layer `index` overlaps the given screen area.
+static bool compose_area_covered(int startrow, int endrow, int startcol, int endcol, size_t index)
+{
+  if (msg_sep_row >= startrow && msg_sep_row < endrow && msg_grid.comp_index > index) {
+    return true;
+  }
+  for (size_t i = index + 1; i < kv_size(layers); i++) {
+    ScreenGrid *g = kv_A(layers, i);
+    int grid_width = MIN(g->cols, g->comp_width);
+    int grid_height = MIN(g->rows, g->comp_height);
+    if (!g->comp_disabled
+        && g->comp_row < endrow && startrow < g->comp_row + grid_height
+        && g->comp_col < endcol && startcol < g->comp_col + grid_width) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Recompose the cells of [startcol, endcol) on "row" whose top-most visible
+/// layer could have changed, i.e. which aren't hidden below an opaque layer
+/// above the layer `index`.
+static void compose_visible(int row, int startcol, int endcol, size_t index, LineFlags flags)
+{
+  if (!compose_occlusion(row, startcol, endcol, index)) {
+    compose_line(row, startcol, endcol, flags);
+    return;
+  }
+
+  // The line is split up, so it can't be marked as wrapping.
+  flags &= ~kLineFlagWrap;
+  int col = startcol;
+  while (col < endcol) {
+    while (col < endcol && occbuf[col] == kOccHidden) {
+      col++;
+    }
+    int start = col;
+    while (col < endcol && occbuf[col] != kOccHidden) {
+      col++;
+    }
+    if (col > start) {
+      compose_line(row, start, col, flags);
+    }
+  }
+}
+
+/// Recompose an area whose content changed for the layer `index` and those
+/// below it. The cells hidden by an opaque layer above are skipped.
+static void compose_area_above(Integer startrow, Integer endrow, Integer startcol, Integer endcol,
+                               size_t index)
+{
+  compose_debug(startrow, endrow, startcol, endcol, dbghl_recompose, true);
+  endrow = MIN(endrow, default_grid.rows);
+  endcol = MIN(endcol, default_grid.cols);
+  startcol = MAX(startcol, 0);
+  if (endcol <= startcol) {
+    return;
+  }
+  for (int r = (int)MAX(startrow, 0); r < endrow; r++) {
+    compose_visible(r, (int)startcol, (int)endcol, index, kLineFlagInvalid);
+  }
+}
+
 static void compose_area(Integer startrow, Integer endrow, Integer startcol, Integer endcol)
 {
   compose_debug(startrow, endrow, startcol, endcol, dbghl_recompose, true);
@@ -530,12 +644,16 @@ void ui_comp_raw_line(Integer grid, Integer row, Integer startcol, Integer endco
     endcol = MIN(endcol, clearcol);
   }
 
-  bool covered = curgrid_covered_above((int)row);
   // TODO(bfredl): eventually should just fix compose_line to respect clearing
   // and optimize it for uncovered lines.
-  if (flags & kLineFlagInvalid || covered || curgrid->blending) {
+  if (flags & kLineFlagInvalid || curgrid->blending) {
     compose_debug(row, row + 1, startcol, clearcol, dbghl_composed, true);
     compose_line(row, startcol, clearcol, flags);
+  } else if (compose_area_covered((int)row, (int)row + 1, (int)MAX(startcol, 0), (int)clearcol,
+                                  curgrid->comp_index)) {
+    // Only the cells not hidden by a layer above are sent.
+    compose_debug(row, row + 1, startcol, clearcol, dbghl_composed, true);
+    compose_visible((int)row, (int)MAX(startcol, 0), (int)clearcol, curgrid->comp_index, flags);
   } else {
     compose_debug(row, row + 1, startcol, endcol, dbghl_normal, false);
     compose_debug(row, row + 1, endcol, clearcol, dbghl_clear, true);
@@ -568,7 +686,7 @@ void ui_comp_msg_set_pos(Integer grid, Integer row, Boolean scrolled, String sep
   if (scrolled && row > 0) {
     msg_sep_row = (int)row - 1;
     if (sep_char.data) {
-      xstrlcpy(msg_sep_char, sep_char.data, sizeof(msg_sep_char));
+      msg_sep_char = schar_from_buf(sep_char.data, MIN(sep_char.size, MAX_SCHAR_SIZE - 1));
     }
   } else {
     msg_sep_row = -1;
@@ -596,16 +714,6 @@ void ui_comp_msg_set_pos(Integer grid, Integer row, Boolean scrolled, String sep
   msg_was_scrolled = scrolled;
 }
 
-/// check if curgrid is covered on row or above
-///
-/// TODO(bfredl): currently this only handles message row
-static bool curgrid_covered_above(int row)
-{
-  bool above_msg = (kv_A(layers, kv_size(layers) - 1) == &msg_grid
-                    && row < msg_current_row - (msg_was_scrolled?1:0));
-  return kv_size(layers) - (above_msg?1:0) > curgrid->comp_index + 1;
-}
-
 void ui_comp_grid_scroll(Integer grid, Integer top, Integer bot, Integer left, Integer right,
                          Integer rows, Integer cols)
 {
@@ -616,7 +724,8 @@ void ui_comp_grid_scroll(Integer grid, Integer top, Integer bot, Integer left, I
   bot += curgrid->comp_row;
   left += curgrid->comp_col;
   right += curgrid->comp_col;
-  bool covered = curgrid_covered_above((int)(bot - MAX(rows, 0)));
+  bool covered = compose_area_covered((int)top, (int)bot, (int)left, (int)right,
+                                      curgrid->comp_index);
 
   if (covered || curgrid->blending) {
     // TODO(bfredl):
@@ -630,7 +739,7 @@ void ui_comp_grid_scroll(Integer grid, Integer top, Integer bot, Integer left, I
       // the invalid space.
       if (curgrid->attrs[curgrid->line_offset[r - curgrid->comp_row]
                          + (size_t)left - (size_t)curgrid->comp_col] >= 0) {
-        compose_line(r, left, right, 0);
+        compose_visible(r, (int)left, (int)right, curgrid->comp_index, 0);
       }
     }
   } else {
@@ -653,8 +762,10 @@ void ui_comp_grid_resize(Integer grid, Integer width, Integer height)
     if (bufsize != new_bufsize) {
       xfree(linebuf);
       xfree(attrbuf);
+      xfree(occbuf);
       linebuf = xmalloc(new_bufsize * sizeof(*linebuf));
       attrbuf = xmalloc(new_bufsize * sizeof(*attrbuf));
+      occbuf = xmalloc(new_bufsize * sizeof(*occbuf));
       bufsize = new_bufsize;
     }
   }
@@ -73,6 +73,10 @@
 #define UH_MAGIC 0x18dade       // value for uh_magic when in use
 #define UE_MAGIC 0xabc123       // value for ue_magic when in use
 
+// Maximum number of unchanged lines saved to extend an entry, see
+// u_savesub_extend().
+#define U_SAVESUB_GAP 4
+
 #include <assert.h>
 #include <fcntl.h>
 #include <inttypes.h>
@@ -258,9 +262,44 @@ int u_save(linenr_T top, linenr_T bot)
 /// Returns FAIL when lines could not be saved, OK otherwise.
 int u_savesub(linenr_T lnum)
 {
+  if (u_savesub_extend(curbuf, lnum)) {
+    return OK;
+  }
   return u_savecommon(curbuf, lnum - 1, lnum + 1, lnum + 1, false);
 }
 
+/// When the lines saved last in the current undo step end at most
+/// U_SAVESUB_GAP lines above "lnum", and the number of lines did not change,
+/// extend that entry up to and including "lnum".  Then ":s" on many lines
+/// results in a few entries instead of one for each line.
+///
+/// @return  true when the entry was extended.
+static bool u_savesub_extend(buf_T *buf, linenr_T lnum)
+{
+  if (buf->b_u_synced || get_undolevel(buf) < 0 || buf->b_u_newhead == NULL
+      || buf->b_u_newhead->uh_getbot_entry != NULL || !undo_allowed(buf)) {
+    return false;
+  }
+
+  u_entry_T *uep = buf->b_u_newhead->uh_entry;
+  if (uep == NULL || uep->ue_size <= 0 || uep->ue_bot != uep->ue_top + uep->ue_size + 1
+      || lnum < uep->ue_bot || lnum - uep->ue_bot > U_SAVESUB_GAP
+      || lnum > buf->b_ml.ml_line_count) {
+    return false;
+  }
+
+  long size = lnum - uep->ue_top;
+  if (size > MAX(uep->ue_alloc, uep->ue_size)) {
+    uep->ue_alloc = MAX(size, uep->ue_size * 2);
+    uep->ue_array = xrealloc(uep->ue_array, sizeof(char *) * (size_t)uep->ue_alloc);
+  }
+  for (linenr_T l = uep->ue_bot; l <= lnum; l++) {
+    uep->ue_array[uep->ue_size++] = u_save_line_buf(buf, l);
+  }
+  uep->ue_bot = lnum + 1;
+  return true;
+}
+
 /// A new line is inserted before line "lnum" (used by :s command).
 /// The line is inserted, so the new bottom line is lnum + 1.
 /// Careful: may trigger autocommands that reload the buffer.
@@ -2380,6 +2419,7 @@ static void u_undoredo(int undo, bool do_buf_event)
     u_newcount += newsize;
     u_oldcount += oldsize;
     uep->ue_size = oldsize;
+    uep->ue_alloc = 0;
     uep->ue_array = newarray;
     uep->ue_bot = top + newsize + 1;
 
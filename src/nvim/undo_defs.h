@@ -27,6 +27,8 @@ struct u_entry {
   linenr_T ue_lcount;           // linecount when u_save called
   char **ue_array;              // array of lines in undo block
   long ue_size;                 // number of lines in ue_array
+  long ue_alloc;                // allocated size of ue_array when it was
+                                // extended, zero when it is ue_size
 #ifdef U_DEBUG
   int ue_magic;                 // magic number to check allocation
 #endif
@@ -829,7 +829,7 @@ void win_config_float(win_T *wp, FloatConfig fconfig)
 
   bool has_border = wp->w_floating && wp->w_float_config.border;
   for (int i = 0; i < 4; i++) {
-    int new_adj = has_border && wp->w_float_config.border_chars[2 * i + 1][0];
+    int new_adj = has_border && wp->w_float_config.border_chars[2 * i + 1];
     if (new_adj != wp->w_border_adj[i]) {
       change_border = true;
       wp->w_border_adj[i] = new_adj;
@@ -5106,6 +5106,8 @@ static void win_free(win_T *wp, tabpage_T *tp)
   }
 
   xfree(wp->w_lines);
+  win_line_cache_free(wp);
+  plines_cache_free(wp);
 
   for (int i = 0; i < wp->w_tagstacklen; i++) {
     xfree(wp->w_tagstack[i].tagname);
@@ -0,0 +1,45 @@
+-- Benchmark of the TUI: records the redraw stream of a scrolling session, and
+-- replays it through the TUI ($NVIM_UI_REPLAY), which reports the time per
+-- frame and the amount of terminal output.
+
+local helpers = require('test.functional.helpers')(after_each)
+local clear, exec_lua = helpers.clear, helpers.exec_lua
+
+-- Runs the TUI in a pty until it exits, returns its output.
+local function run_tui(env, input)
+  return exec_lua([[
+    local prog, env, input = ...
+    local out = {}
+    local job = vim.fn.jobstart({prog, '-u', 'NONE', '-i', 'NONE', '-n',
+                                 '--cmd', 'set number cursorline', 'src/nvim/tui/tui.c'}, {
+      pty = true, width = 120, height = 40, env = env,
+      on_stdout = function(_, data) vim.list_extend(out, data) end,
+    })
+    if input then
+      vim.fn.chansend(job, input)
+    end
+    vim.fn.jobwait({job}, 60000)
+    return table.concat(out, '\n')
+  ]], helpers.nvim_prog, env, input)
+end
+
+describe('TUI redraw replay', function()
+  local recording = 'Xredraw_recording'
+
+  before_each(function()
+    clear()
+  end)
+
+  after_each(function()
+    os.remove(recording)
+  end)
+
+  it('scrolling', function()
+    -- <C-F> to scroll, then quit.
+    run_tui({NVIM_UI_RECORD = recording}, string.rep('\6', 100) .. '\27:qa!\r')
+    for _ = 1, 3 do
+      local out = run_tui({NVIM_UI_REPLAY = recording})
+      print('\n' .. (out:match('frames: [^\r\n]*') or 'replay failed'))
+    end
+  end)
+end)
@@ -105,6 +105,20 @@ describe('api/buf', function()
       -- it's impossible to get out-of-bounds errors for an unloaded buffer
       eq({}, buffer('get_lines', bufnr, 8888, 9999, 1))
     end)
+
+    it('works with large requests', function()
+      -- large enough to be partially decoded off the main thread
+      local lines = {}
+      for i = 1, 40000 do
+        lines[i] = ('%05d'):format(i)..('x'):rep(75)
+      end
+      request('nvim_buf_set_lines', 0, 0, -1, true, lines)
+      eq(40000, request('nvim_buf_line_count', 0))
+      eq(lines[20000], request('nvim_buf_get_lines', 0, 19999, 20000, true)[1])
+      -- small requests after the large one still work
+      request('nvim_buf_set_lines', 0, 0, 1, true, {'first'})
+      eq({'first', lines[2]}, buffer('get_lines', 0, 0, 2, true))
+    end)
   end)
 
   describe('deprecated: {get,set,del}_line', function()
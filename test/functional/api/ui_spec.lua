@@ -6,6 +6,7 @@ local eval = helpers.eval
 local meths = helpers.meths
 local request = helpers.request
 local pcall_err = helpers.pcall_err
+local feed = helpers.feed
 
 describe('nvim_ui_attach()', function()
   before_each(function()
@@ -54,6 +55,43 @@ describe('nvim_ui_attach()', function()
     eq('UI already attached to channel: 1',
       pcall_err(request, 'nvim_ui_attach', 40, 10, { rgb=false }))
   end)
+
+  it('UIs with the same options share redraws', function()
+    local screen = Screen.new(20, 4)
+    screen:attach()
+    local session2 = helpers.connect(eval('v:servername'))
+    local screen2 = Screen.new(20, 4)
+    screen2:attach(nil, session2)
+    -- a third UI with other options packs its own events
+    local session3 = helpers.connect(eval('v:servername'))
+    local screen3 = Screen.new(20, 4)
+    screen3:attach({ext_cmdline=true}, session3)
+
+    feed('ihello<esc>')
+    local expected = [[
+      hell^o              |
+      {1:~                   }|
+      {1:~                   }|
+                          |
+    ]]
+    local attrs = {[1] = {bold=true, foreground=Screen.colors.Blue1}}
+    screen:set_default_attr_ids(attrs)
+    screen2:set_default_attr_ids(attrs)
+    screen:expect(expected)
+    screen2:expect(expected)
+    screen3:set_default_attr_ids(attrs)
+    screen3:expect(expected)
+
+    -- The remaining UI still gets all events when the first one detaches.
+    screen:detach()
+    feed('o world<esc>')
+    screen2:expect([[
+      hello               |
+       worl^d              |
+      {1:~                   }|
+                          |
+    ]])
+  end)
 end)
 
 it('autocmds UIEnter/UILeave', function()
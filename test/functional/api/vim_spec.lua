@@ -2332,6 +2332,22 @@ describe('API', function()
       eq({{NIL, NIL, true, 'string'}, NIL}, meths.call_atomic(req))
     end)
 
+    it('works with large batches', function()
+      local lines = {}
+      for i = 1, 100 do
+        lines[i] = ('line %d '):format(i)..('x'):rep(100)
+      end
+      meths.buf_set_lines(0, 0, -1, true, lines)
+      local req, expected = {}, {}
+      for i = 1, 100 do
+        table.insert(req, {'nvim_buf_get_lines', {0, i - 1, i, true}})
+        table.insert(req, {'nvim_get_current_line', {}})
+        table.insert(expected, {lines[i]})
+        table.insert(expected, lines[1])
+      end
+      eq({expected, NIL}, meths.call_atomic(req))
+    end)
+
     it('is aborted by errors in call', function()
       local error_types = meths.get_api_info()[2].error_types
       local req = {
@@ -2396,6 +2412,109 @@ describe('API', function()
     end)
   end)
 
+  describe('nvim__rpc_stats', function()
+    it('counts requests per method', function()
+      request('nvim__rpc_stats', 0, true)
+      meths.set_var('avar', 1)
+      meths.set_var('avar', 2)
+      eq(2, meths.get_var('avar'))
+      pcall(meths.get_var, 'nosuchvar')
+
+      local stats = request('nvim__rpc_stats', 0, false)
+      eq(2, stats.nvim_set_var.calls)
+      eq(0, stats.nvim_set_var.errors)
+      eq(2, stats.nvim_get_var.calls)
+      eq(1, stats.nvim_get_var.errors)
+      ok(stats.nvim_set_var.bytes_in > 0)
+      ok(stats.nvim_get_var.bytes_out > 0)
+      local total = 0
+      for _, n in ipairs(stats.nvim_set_var.exec_hist) do
+        total = total + n
+      end
+      eq(2, total)
+      ok(stats.nvim_set_var.exec_max <= stats.nvim_set_var.exec_total)
+      local chan = meths.get_api_info()[1]
+      eq(2, request('nvim__rpc_stats', chan, false).nvim_set_var.calls)
+    end)
+
+    it('can be reset', function()
+      meths.set_var('avar', 1)
+      request('nvim__rpc_stats', 0, true)
+      local stats = request('nvim__rpc_stats', 0, false)
+      eq(nil, stats.nvim_set_var)
+      eq(1, stats.nvim__rpc_stats.calls)
+    end)
+
+    it('validation', function()
+      eq("Invalid 'chan': -1", pcall_err(request, 'nvim__rpc_stats', -1, false))
+      eq('Invalid channel: 999', pcall_err(request, 'nvim__rpc_stats', 999, false))
+    end)
+  end)
+
+  describe('nvim__rpc_flow', function()
+    it('reports and sets watermarks', function()
+      local chan = meths.get_api_info()[1]
+      eq({ high = 16777216, low = 1048576, queued = 0, congested = false,
+           congestions = 0, dropped_events = 0, dropped_redraws = 0 },
+         request('nvim__rpc_flow', chan, {}))
+      local flow = request('nvim__rpc_flow', chan, { high = 4096, low = 1024 })
+      eq(4096, flow.high)
+      eq(1024, flow.low)
+      eq(4096, request('nvim__rpc_flow', chan, {}).high)
+    end)
+
+    it('refreshes a UI in full after dropping redraws to it', function()
+      local screen = Screen.new(40, 6)
+      screen:attach()
+      screen:set_default_attr_ids({
+        [0] = {bold=true, foreground=Screen.colors.Blue},
+        [1] = {foreground=Screen.colors.Brown},
+      })
+      local chan = meths.get_api_info()[1]
+      request('nvim__rpc_flow', chan, { high = 1, low = 0 })
+      -- Nothing is read from the channel while Nvim is busy, like with a
+      -- stalled client: the writes queue up and later redraws are dropped.
+      exec_lua([[
+        for i = 1, 20 do
+          vim.api.nvim_buf_set_lines(0, 0, -1, true, {'line ' .. i})
+          vim.cmd('redraw')
+        end
+        vim.wo.number = true
+        vim.cmd('redraw')
+      ]])
+      screen:expect{grid=[[
+        {1:  1 }^line 20                             |
+        {0:~                                       }|
+        {0:~                                       }|
+        {0:~                                       }|
+        {0:~                                       }|
+                                                |
+      ]]}
+      ok(request('nvim__rpc_flow', chan, {}).dropped_redraws > 0)
+      request('nvim__rpc_flow', chan, { high = 16777216, low = 1048576 })
+      feed('oline 21<Esc>')
+      screen:expect{grid=[[
+        {1:  1 }line 20                             |
+        {1:  2 }line 2^1                             |
+        {0:~                                       }|
+        {0:~                                       }|
+        {0:~                                       }|
+                                                |
+      ]]}
+    end)
+
+    it('validation', function()
+      local chan = meths.get_api_info()[1]
+      eq("Invalid 'chan': 0", pcall_err(request, 'nvim__rpc_flow', 0, {}))
+      eq('Invalid channel: 999', pcall_err(request, 'nvim__rpc_flow', 999, {}))
+      eq("Invalid 'high': -1", pcall_err(request, 'nvim__rpc_flow', chan, { high = -1 }))
+      eq("Invalid 'low': expected Integer, got String",
+         pcall_err(request, 'nvim__rpc_flow', chan, { low = 'a' }))
+      eq("'low' must not exceed 'high'",
+         pcall_err(request, 'nvim__rpc_flow', chan, { high = 10, low = 20 }))
+    end)
+  end)
+
   describe('nvim_list_runtime_paths', function()
     setup(function()
       local pathsep = helpers.get_pathsep()
@@ -2677,6 +2796,7 @@ describe('API', function()
           ext_cmdline = false,
           ext_hlstate = false,
           ext_linegrid = screen._options.ext_linegrid or false,
+          ext_lineruns = false,
           ext_messages = false,
           ext_multigrid = false,
           ext_popupmenu = false,
@@ -0,0 +1,55 @@
+local helpers = require('test.functional.helpers')(after_each)
+
+local clear = helpers.clear
+local command = helpers.command
+local eq = helpers.eq
+local funcs = helpers.funcs
+local neq = helpers.neq
+
+describe('long lines', function()
+  before_each(clear)
+
+  it('keep their virtual columns after an operator resets \'linebreak\'', function()
+    local line = string.rep('abcdefghij ', 400)
+    funcs.setline(1, {line, line})
+    command('set nolinebreak')
+    local nolbr = funcs.virtcol({1, 3000})
+    command('set linebreak')
+    local lbr = funcs.virtcol({1, 3000})
+    neq(nolbr, lbr)
+
+    -- A Visual operator switches off 'linebreak' while it works.
+    funcs.cursor(2, 3000)
+    command('exe "normal! \\<C-V>y"')
+    eq(lbr, funcs.virtcol({2, 3000}))
+    funcs.cursor(1, 3000)
+    command('normal! j')
+    eq({2, 3000}, {funcs.line('.'), funcs.col('.')})
+    eq(lbr, funcs.virtcol('.'))
+  end)
+
+  it('have their screen lines counted again after edits, options and resizing', function()
+    funcs.setline(1, {'short', string.rep('x', 200), 'short'})
+    funcs.cursor(3, 1)
+    eq(5, funcs.winline())
+    funcs.setline(2, string.rep('x', 158))
+    eq(4, funcs.winline())
+    command('set number')
+    eq(5, funcs.winline())
+    command('set nonumber')
+    eq(4, funcs.winline())
+
+    funcs.setline(2, string.rep('\t', 20))
+    eq(4, funcs.winline())
+    command('set tabstop=4')
+    eq(3, funcs.winline())
+    command('set tabstop=8')
+    eq(4, funcs.winline())
+
+    command('vsplit')
+    eq(40, funcs.winwidth(0))
+    eq(6, funcs.winline())
+    command('vertical resize 60')
+    eq(5, funcs.winline())
+  end)
+end)
@@ -2,7 +2,9 @@ local helpers = require('test.functional.helpers')(after_each)
 local clear = helpers.clear
 local command = helpers.command
 local eq = helpers.eq
+local funcs = helpers.funcs
 local pcall_err = helpers.pcall_err
+local request = helpers.request
 
 describe('search (/)', function()
   before_each(clear)
@@ -13,5 +15,100 @@ describe('search (/)', function()
     eq([[Vim:E951: \% value too large]],
       pcall_err(command, "/\\v%2147483648c"))
   end)
-end)
 
+  it('finds a match starting with one of several characters', function()
+    command('set regexpengine=2')
+    eq({'bar12baz', 4, 12}, funcs.matchstrpos('xx foo bar12baz', [[\v(foo|bar)\d+baz]]))
+    eq({' 42', 1, 4}, funcs.matchstrpos('a 42', [[\v(\d|\s)+\d]]))
+    eq({'', -1, -1}, funcs.matchstrpos('xx foo baz', [[\v(foo|bar)\d+baz]]))
+    eq({'BAR1baz', 3, 10}, funcs.matchstrpos('xx BAR1baz', [[\c\v(foo|bar)\d+baz]]))
+    -- KELVIN SIGN folds to "k"
+    eq({'\226\132\170ey', 1, 6}, funcs.matchstrpos('x\226\132\170ey', [[\c\v(key|foo)]]))
+  end)
+
+  it('finds matches in lines with and without a match', function()
+    command('set regexpengine=2')
+    funcs.setline(1, {'foo', 'xx bar12', 'bar12 yy', 'FOO1', 'a\204\128bc1'})
+    eq(3, funcs.search([[\v^(foo|bar)\d+]]))
+    eq(2, funcs.search([[\v(foo|bar)\d+$]], 'w'))
+    eq(0, funcs.search([[\v^(foo|bar)\d+$]], 'w'))
+    eq(4, funcs.search([[\c\v^(foo|bar)\d+$]], 'w'))
+    eq(5, funcs.search([[[[:alpha:]]\{3}\d]], 'w'))
+    eq(0, funcs.search([[[^[:alpha:]]\{3}\d]], 'w'))
+    eq({'', 0, 0}, funcs.matchstrpos('', [[^$]]))
+    eq({'', -1, -1}, funcs.matchstrpos('x', [[^$]]))
+  end)
+
+  it('counts matches again after the buffer changed', function()
+    funcs.setline(1, {'foo', 'bar', 'foo', 'foo'})
+    command('let @/ = "foo"')
+    eq({current = 2, total = 3, exact_match = 1, incomplete = 0, maxcount = 99},
+       funcs.searchcount({pos = {3, 1, 0}}))
+    eq({current = 1, total = 3, exact_match = 0, incomplete = 0, maxcount = 99},
+       funcs.searchcount({pos = {2, 1, 0}}))
+    funcs.setline(2, 'foo')
+    eq({current = 2, total = 4, exact_match = 1, incomplete = 0, maxcount = 99},
+       funcs.searchcount({pos = {2, 1, 0}}))
+    eq({current = 2, total = 2, exact_match = 1, incomplete = 2, maxcount = 1},
+       funcs.searchcount({pos = {2, 1, 0}, maxcount = 1}))
+  end)
+
+  it('counts matches again when they depend on the cursor or Visual area', function()
+    funcs.setline(1, {'foo', 'foo', 'foo'})
+    command([[let @/ = '\%<.lfoo']])
+    funcs.cursor(3, 1)
+    eq(2, funcs.searchcount().total)
+    funcs.cursor(2, 1)
+    eq(1, funcs.searchcount().total)
+    command([[let @/ = '\%Vfoo']])
+    command('normal! 1GVj\27')
+    eq(2, funcs.searchcount().total)
+    command('normal! 3GV\27')
+    eq(1, funcs.searchcount().total)
+  end)
+
+  it('reuses compiled patterns', function()
+    local before = request('nvim__stats')
+    eq('b2', funcs.matchstr('ab2', [[\v[b-d]\d]]))
+    eq('c3', funcs.matchstr('ac3', [[\v[b-d]\d]]))
+    local after = request('nvim__stats')
+    eq(1, after.regprog_cache_hit - before.regprog_cache_hit)
+    -- Depends on the cursor position, cannot be reused.
+    funcs.setline(1, {'a', 'a'})
+    eq(1, funcs.search([[\%.la]], 'nc'))
+    funcs.cursor(2, 1)
+    eq(2, funcs.search([[\%.la]], 'nc'))
+  end)
+
+  for _, engine in ipairs({1, 2}) do
+    it(('does not reuse patterns compiled for another cursor, regexpengine=%d'):format(engine),
+    function()
+      command('set regexpengine=' .. engine)
+      funcs.setline(1, {'aaa', 'aaa', 'aaa'})
+      -- pattern, flags, then two cursor positions with the match found from there
+      for _, t in ipairs({
+        {[[\%<.la]], 'nb', {3, 1}, {2, 3}, {2, 1}, {1, 3}},
+        {[[\%>.la]], 'n', {1, 1}, {2, 1}, {2, 1}, {3, 1}},
+        {[[\%<.ca]], 'nb', {1, 3}, {1, 2}, {1, 2}, {1, 1}},
+        {[[\%>.ca]], 'n', {1, 1}, {1, 2}, {1, 2}, {1, 3}},
+        {[[\%<.va]], 'nb', {1, 3}, {1, 2}, {1, 2}, {1, 1}},
+        {[[\%>.va]], 'n', {1, 1}, {1, 2}, {1, 2}, {1, 3}},
+      }) do
+        funcs.cursor(t[3])
+        eq(t[4], funcs.searchpos(t[1], t[2]), t[1])
+        funcs.cursor(t[5])
+        eq(t[6], funcs.searchpos(t[1], t[2]), t[1])
+      end
+    end)
+  end
+
+  it('does not reuse patterns compiled with other character classes', function()
+    command('set regexpengine=1')
+    eq('', funcs.matchstr('#', '[[:ident:]]'))
+    command('set isident+=#')
+    eq('#', funcs.matchstr('#', '[[:ident:]]'))
+    eq('', funcs.matchstr(':', '[[:fname:]]'))
+    command('set isfname+=:')
+    eq(':', funcs.matchstr(':', '[[:fname:]]'))
+  end)
+end)
@@ -201,3 +201,26 @@ describe(':undo! command', function()
     eq('E5767: Cannot use :undo! to redo or move to a different undo branch', eval('v:errmsg'))
   end)
 end)
+
+describe('undo of :substitute', function()
+  before_each(clear)
+
+  it('restores lines changed with gaps and line breaks', function()
+    local lines = {}
+    for i = 1, 40 do
+      lines[i] = ((i % 3 == 0 or i % 7 == 0) and 'a' or 'b') .. i
+    end
+    funcs.setline(1, lines)
+    feed_command('%s/a/x/g')
+    local changed = funcs.getline(1, '$')
+    feed_command([[%s/^b1/b\rc/]])
+    local split = funcs.getline(1, '$')
+    eq(47, #split)
+    feed('u')
+    eq(changed, funcs.getline(1, '$'))
+    feed('u')
+    eq(lines, funcs.getline(1, '$'))
+    feed('<C-R><C-R>')
+    eq(split, funcs.getline(1, '$'))
+  end)
+end)
@@ -126,6 +126,117 @@ describe('quickfix', function()
   end)
 end)
 
+describe(':vimgrep', function()
+  local files = {file_base .. '_unix', file_base .. '_dos', file_base .. '_empty'}
+
+  before_each(function()
+    write_file(files[1], 'foo bar\n\nbar foo foo\n')
+    write_file(files[2], 'foo bar\r\n\r\nbar foo foo\r\n')
+    write_file(files[3], '')
+  end)
+
+  after_each(function()
+    for _, file in ipairs(files) do
+      os.remove(file)
+    end
+  end)
+
+  local function matches()
+    local items = {}
+    for _, item in ipairs(funcs.getqflist()) do
+      table.insert(items, {funcs.bufname(item.bufnr), item.lnum, item.col, item.text})
+    end
+    return items
+  end
+
+  local expected = {
+    {files[1], 1, 1, 'foo bar'},
+    {files[1], 3, 5, 'bar foo foo'},
+    {files[1], 3, 9, 'bar foo foo'},
+    {files[2], 1, 1, 'foo bar'},
+    {files[2], 3, 5, 'bar foo foo'},
+    {files[2], 3, 9, 'bar foo foo'},
+  }
+
+  it('finds the same matches with and without autocommands', function()
+    command('vimgrep /foo/gj ' .. table.concat(files, ' '))
+    eq(expected, matches())
+    command('autocmd BufReadPost * let g:did_read = 1')
+    command('vimgrep /foo/gj ' .. table.concat(files, ' '))
+    eq(expected, matches())
+    eq(1, funcs.eval('g:did_read'))
+  end)
+
+  it('matches an empty line in an empty file', function()
+    command('vimgrep /^$/j ' .. files[3])
+    eq({{files[3], 1, 1, ''}}, matches())
+  end)
+
+  it('reads files directly when autocommands are for other files or detect filetypes', function()
+    command('autocmd BufReadPost *.gz let g:did_read = 1')
+    command('augroup filetypedetect | autocmd BufRead * let g:did_detect = 1 | augroup END')
+    command('vimgrep /foo/gj ' .. table.concat(files, ' '))
+    eq(expected, matches())
+    eq(0, funcs.exists('g:did_read'))
+    eq(0, funcs.exists('g:did_detect'))
+  end)
+
+  it("uses the 'iskeyword' of a new buffer", function()
+    write_file(files[3], 'foo-bar\n')
+    command('setlocal iskeyword+=-')
+    command([[vimgrep /\<bar/j ]] .. files[3])
+    eq({{files[3], 1, 5, 'foo-bar'}}, matches())
+  end)
+
+  for _, engine in ipairs({1, 2}) do
+    it(('reports matches spanning lines with regexpengine=%d'):format(engine), function()
+      command('set regexpengine=' .. engine)
+      command([[vimgrep /bar\n\nbar/gj ]] .. table.concat(files, ' '))
+      eq({{files[1], 1, 5, 'foo bar'}, {files[2], 1, 5, 'foo bar'}}, matches())
+    end)
+
+    it(('matches a line break at the last line with regexpengine=%d'):format(engine), function()
+      command('set regexpengine=' .. engine)
+      command([[vimgrep /foo\n/gj ]] .. table.concat(files, ' '))
+      eq({{files[1], 3, 9, 'bar foo foo'}, {files[2], 3, 9, 'bar foo foo'}}, matches())
+    end)
+  end
+
+  it('adds the matches of many files in the order of the files', function()
+    local many = {}
+    for i = 1, 30 do
+      local name = ('%s_%02d'):format(file_base, i)
+      write_file(name, string.rep('x\n', i) .. 'foo ' .. i .. '\n')
+      table.insert(many, name)
+    end
+    finally(function()
+      for _, name in ipairs(many) do
+        os.remove(name)
+      end
+    end)
+    local expected_many = {}
+    for i = 1, 30 do
+      table.insert(expected_many, {many[i], i + 1, 1, 'foo ' .. i})
+    end
+
+    command('vimgrep /foo/j ' .. table.concat(many, ' '))
+    eq(expected_many, matches())
+    command('5vimgrep /foo/j ' .. table.concat(many, ' '))
+    eq({unpack(expected_many, 1, 5)}, matches())
+    -- With line numbers the pattern is only used on the main thread.
+    command([[vimgrep /\%>2lfoo/j ]] .. table.concat(many, ' '))
+    eq({unpack(expected_many, 2)}, matches())
+
+    -- A file loaded in a buffer is searched there, between the others.
+    command('edit ' .. many[10])
+    funcs.setline(11, 'foo changed')
+    command('enew')
+    command('vimgrep /foo/j ' .. table.concat(many, ' '))
+    expected_many[10][4] = 'foo changed'
+    eq(expected_many, matches())
+  end)
+end)
+
 it(':vimgrep can specify Unicode pattern without delimiters', function()
   eq('Vim(vimgrep):E480: No match: →', exc_exec('vimgrep → test/functional/fixtures/tty-test.c'))
   local screen = Screen.new(40, 6)
@@ -710,4 +710,40 @@ describe(':sort', function()
       1.234
       123.456]])
   end)
+
+  it('numeric with negative and large numbers, keeping order of equal ones', function()
+    local lines = [[
+      x
+      -300 a
+      70000
+      5 b
+      -2
+      y
+      5 a
+      -300 b
+      256]]
+    insert(lines)
+    command([[sort n]])
+    expect([[
+      x
+      y
+      -300 a
+      -300 b
+      -2
+      5 b
+      5 a
+      256
+      70000]])
+    command([[sort! n]])
+    expect([[
+      70000
+      256
+      5 a
+      5 b
+      -2
+      -300 b
+      -300 a
+      y
+      x]])
+  end)
 end)
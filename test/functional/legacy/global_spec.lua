@@ -1,8 +1,10 @@
 local helpers = require('test.functional.helpers')(after_each)
 local Screen = require('test.functional.ui.screen')
 local clear = helpers.clear
+local eq = helpers.eq
 local exec = helpers.exec
 local feed = helpers.feed
+local funcs = helpers.funcs
 local poke_eventloop = helpers.poke_eventloop
 
 before_each(clear)
@@ -48,4 +50,58 @@ describe(':global', function()
       :^                                                                          |
     ]])
   end)
+
+  it('deletes runs of matching lines like one line at a time', function()
+    local lines, kept, deleted = {}, {}, {}
+    for i = 1, 30 do
+      if i % 5 == 0 then
+        table.insert(lines, 'k' .. i)
+        table.insert(kept, 'k' .. i)
+      else
+        table.insert(lines, 'x' .. i)
+        table.insert(deleted, 'x' .. i)
+      end
+    end
+    funcs.setline(1, lines)
+    exec([[
+      10mark a
+      20mark b
+      g/^x/d
+    ]])
+    eq(kept, funcs.getline(1, '$'))
+    for i = 1, 9 do
+      eq(deleted[#deleted - i + 1] .. '\n', funcs.getreg(tostring(i)))
+    end
+    eq(2, funcs.line("'a"))
+    eq(4, funcs.line("'b"))
+    eq(6, funcs.line('.'))
+    feed('u')
+    eq(lines, funcs.getline(1, '$'))
+    eq(10, funcs.line("'a"))
+
+    funcs.setreg('1', 'one')
+    exec('g/^x/d _')
+    eq(kept, funcs.getline(1, '$'))
+    eq('one', funcs.getreg('1'))
+    feed('u')
+    eq(lines, funcs.getline(1, '$'))
+
+    -- The command after a NL is executed once, after :global.
+    exec([[exe "g/^x/d _\nnormal! Ay"]])
+    local expected = {}
+    for _, line in ipairs(kept) do
+      table.insert(expected, line)
+    end
+    expected[#expected] = expected[#expected] .. 'y'
+    eq(expected, funcs.getline(1, '$'))
+    funcs.setline(1, lines)
+
+    -- The command after an escaped NL is executed for every line, it appends
+    -- to the line after each deleted one.
+    exec([[exe "g/^x/d _\\\nnormal! Ay"]])
+    for i, line in ipairs(kept) do
+      expected[i] = line .. 'y'
+    end
+    eq(expected, funcs.getline(1, '$'))
+  end)
 end)
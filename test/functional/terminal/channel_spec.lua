@@ -8,6 +8,12 @@ local pcall_err = helpers.pcall_err
 local feed = helpers.feed
 local poke_eventloop = helpers.poke_eventloop
 local is_os = helpers.is_os
+local skip = helpers.skip
+local funcs = helpers.funcs
+local request = helpers.request
+local retry = helpers.retry
+local exec_lua = helpers.exec_lua
+local ok = helpers.ok
 
 describe('terminal channel is closed and later released if', function()
   local screen
@@ -111,3 +117,60 @@ it('chansend sends lines to terminal channel in proper order', function()
     }
   end
 end)
+
+describe('terminal output of a job', function()
+  -- Scrolling the screen for every few bytes makes libvterm slower than the
+  -- job, so a backlog of output builds up.
+  local heavy = string.rep('\27[S', 1000)
+
+  before_each(function()
+    skip(is_os('win'))
+    clear()
+  end)
+
+  it('is paused when the backlog is too large and resumed when it drained', function()
+    local before = request('nvim__stats')
+    local job = funcs.termopen({'yes', heavy})
+    retry(nil, 30000, function()
+      local stats = request('nvim__stats')
+      ok(stats.term_paused - before.term_paused >= 2)
+      ok(stats.term_resumed - before.term_resumed >= 1)
+    end)
+    -- Still responsive.
+    eq(2, eval('1 + 1'))
+    funcs.jobstop(job)
+  end)
+
+  it('is read to the end when the job exits while paused', function()
+    local job = funcs.termopen({'yes', heavy})
+    local stats
+    retry(nil, 30000, function()
+      stats = request('nvim__stats')
+      ok(stats.term_paused > stats.term_resumed)
+    end)
+    -- The job is blocked on writing, the pty still holds its last output.
+    exec_lua([[vim.loop.kill(..., 'sigterm')]], funcs.jobpid(job))
+    eq({143}, funcs.jobwait({job}, 10000))
+    ok(request('nvim__stats').term_received > stats.term_received)
+  end)
+
+  it('is complete after a burst of output', function()
+    local job = funcs.termopen({'sh', '-c', 'yes "$1" | head -c 8000000; echo; echo END', 'sh', heavy})
+    eq({0}, funcs.jobwait({job}, 60000))
+    retry(nil, 10000, function()
+      ok(funcs.search('^END$', 'nw') > 0)
+    end)
+  end)
+
+  it('is still fed after the job exits, before the exit message', function()
+    local job = funcs.termopen({'sh', '-c', 'yes "$1" | head -c 8000000; echo; echo END', 'sh', heavy})
+    eq({0}, funcs.jobwait({job}, 60000))
+    -- Closing the terminal does not feed the whole backlog at once.
+    eq(2, eval('1 + 1'))
+    retry(nil, 10000, function()
+      local end_lnum = funcs.search('^END$', 'nw')
+      ok(end_lnum > 0)
+      ok(funcs.search([[^\[Process exited 0\]$]], 'nw') > end_lnum)
+    end)
+  end)
+end)
@@ -58,6 +58,123 @@ describe(':terminal scrollback', function()
     end)
   end)
 
+  describe('when the scrollback ring wraps around', function()
+    local function numbered(first, last)
+      local lines = {}
+      for i = first, last do
+        table.insert(lines, 'line'..tostring(i))
+      end
+      return lines
+    end
+
+    local function concat(...)
+      local rv = {}
+      for _, t in ipairs({...}) do
+        for _, line in ipairs(t) do
+          table.insert(rv, line)
+        end
+      end
+      return rv
+    end
+
+    before_each(function()
+      -- 26 lines are pushed to a scrollback of 10.
+      feed_data(concat(numbered(1, 30), {''}))
+      screen:expect([[
+        line26                        |
+        line27                        |
+        line28                        |
+        line29                        |
+        line30                        |
+        {1: }                             |
+        {3:-- TERMINAL --}                |
+      ]])
+    end)
+
+    it('keeps the newest lines in order', function()
+      eq(concat(numbered(16, 30), {''}), curbufmeths.get_lines(0, -1, true))
+      feed_data(concat(numbered(31, 47), {''}))
+      screen:expect([[
+        line43                        |
+        line44                        |
+        line45                        |
+        line46                        |
+        line47                        |
+        {1: }                             |
+        {3:-- TERMINAL --}                |
+      ]])
+      eq(concat(numbered(33, 47), {''}), curbufmeths.get_lines(0, -1, true))
+    end)
+
+    it("keeps the newest lines when 'scrollback' is decreased and increased", function()
+      curbufmeths.set_option('scrollback', 5)
+      eq(concat(numbered(21, 30), {''}), curbufmeths.get_lines(0, -1, true))
+      curbufmeths.set_option('scrollback', 20)
+      eq(concat(numbered(21, 30), {''}), curbufmeths.get_lines(0, -1, true))
+
+      feed_data(concat(numbered(31, 40), {''}))
+      screen:expect([[
+        line36                        |
+        line37                        |
+        line38                        |
+        line39                        |
+        line40                        |
+        {1: }                             |
+        {3:-- TERMINAL --}                |
+      ]])
+      eq(concat(numbered(21, 40), {''}), curbufmeths.get_lines(0, -1, true))
+
+      -- Wrap around the enlarged ring.
+      feed_data(concat(numbered(41, 60), {''}))
+      screen:expect([[
+        line56                        |
+        line57                        |
+        line58                        |
+        line59                        |
+        line60                        |
+        {1: }                             |
+        {3:-- TERMINAL --}                |
+      ]])
+      eq(concat(numbered(36, 60), {''}), curbufmeths.get_lines(0, -1, true))
+    end)
+
+    it('pops and pushes lines across the end of the ring on resize', function()
+      -- XXX: Can't test this reliably on Windows unless the cursor is _moved_
+      --      by the resize. See 'with 4 lines hidden in the scrollback'.
+      if skip(is_os('win')) then return end
+      screen:try_resize(screen._width, screen._height + 3)
+      screen:expect([[
+        line24                        |
+        line25                        |
+        line26                        |
+        line27                        |
+        line28                        |
+        line29                        |
+        line30                        |
+        rows: 9, cols: 30             |
+        {1: }                             |
+        {3:-- TERMINAL --}                |
+      ]])
+      eq(concat(numbered(16, 30), {'rows: 9, cols: 30', ''}), curbufmeths.get_lines(0, -1, true))
+
+      feed_data(concat(numbered(31, 40), {''}))
+      screen:expect([[
+        line33                        |
+        line34                        |
+        line35                        |
+        line36                        |
+        line37                        |
+        line38                        |
+        line39                        |
+        line40                        |
+        {1: }                             |
+        {3:-- TERMINAL --}                |
+      ]])
+      eq(concat(numbered(24, 30), {'rows: 9, cols: 30'}, numbered(31, 40), {''}),
+         curbufmeths.get_lines(0, -1, true))
+    end)
+  end)
+
   describe('with cursor at last row', function()
     before_each(function()
       feed_data({'line1', 'line2', 'line3', 'line4', ''})
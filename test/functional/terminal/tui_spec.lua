@@ -1457,6 +1457,7 @@ describe('TUI', function()
          ext_cmdline = false,
          ext_hlstate = false,
          ext_linegrid = true,
+         ext_lineruns = true,
          ext_messages = false,
          ext_multigrid = false,
          ext_popupmenu = false,
@@ -2325,6 +2326,54 @@ describe("TUI", function()
     end)
   end)
 
+  it('--startuptime reports output statistics', function()
+    local timefile = 'Xtest_tui_startuptime'
+    finally(function()
+      os.remove(timefile)
+    end)
+    nvim_tui('--startuptime '..timefile)
+    screen:expect({any = '%-%- TERMINAL %-%-'})
+    -- Redraws in quick succession are combined into fewer frames.
+    feed_data(':for i in range(100) | call setline(1, i) | redraw | endfor\r')
+    screen:expect({any = '99'})
+    feed_data(':qa!\r')
+    retry(nil, 3000, function()
+      local out = read_file(timefile) or ''
+      local bytes, frames, coalesced =
+        out:match('TUI output: (%d+) bytes, (%d+) frames, (%d+) coalesced flushes')
+      ok(tonumber(bytes) > 0)
+      ok(tonumber(frames) > 0)
+      ok(tonumber(coalesced) > 0)
+    end)
+  end)
+
+  it('writes a lone keystroke at once after an idle period', function()
+    local timefile = 'Xtest_tui_startuptime_idle'
+    finally(function()
+      os.remove(timefile)
+    end)
+    nvim_tui('--startuptime '..timefile)
+    screen:expect({any = '%-%- TERMINAL %-%-'})
+    feed_data('i')
+    screen:expect({any = '%-%- INSERT %-%-'})
+    -- Keystrokes typed with pauses in between are not held for a frame budget.
+    local typed = ''
+    for _, c in ipairs({'a', 'b', 'c', 'd', 'e'}) do
+      helpers.sleep(50)
+      feed_data(c)
+      typed = typed..c
+      screen:expect({any = typed})
+    end
+    feed_data('\027:qa!\r')
+    retry(nil, 3000, function()
+      local out = read_file(timefile) or ''
+      local frames, idle = out:match('TUI output: %d+ bytes, (%d+) frames, '
+                                     ..'%d+ coalesced flushes, (%d+) idle frames')
+      ok(tonumber(idle) >= 5)
+      ok(tonumber(frames) >= tonumber(idle))
+    end)
+  end)
+
 end)
 
 describe('TUI bg color', function()
@@ -673,6 +673,38 @@ end]]
     screen:expect_unchanged()
   end)
 
+  it('draws highlight added to an offscreen line when scrolled back', function()
+    meths.buf_set_lines(0, 0, -1, true, exec_lua([[
+      local lines = {}
+      for i = 1, 30 do
+        lines[i] = 'line ' .. i
+      end
+      return lines
+    ]]))
+    screen:expect({any = 'line 14'})
+    feed('10<C-E>')
+    screen:expect({any = 'line 24'})
+    meths.buf_set_extmark(0, ns, 2, 0, { end_col = 6, hl_group = 'ErrorMsg' })
+    feed('10<C-Y>')
+    screen:expect([[
+      line 1                                            |
+      line 2                                            |
+      {4:line 3}                                            |
+      line 4                                            |
+      line 5                                            |
+      line 6                                            |
+      line 7                                            |
+      line 8                                            |
+      line 9                                            |
+      line 10                                           |
+      ^line 11                                           |
+      line 12                                           |
+      line 13                                           |
+      line 14                                           |
+                                                        |
+    ]])
+  end)
+
   it('can have virtual text of overlay position', function()
     insert(example_text)
     feed 'gg'
@@ -9757,3 +9757,145 @@ describe('float window', function()
   end)
 end)
 
+
+describe('float window composition', function()
+  local screen
+  before_each(function()
+    clear()
+    screen = Screen.new(20,8)
+    screen:attach()
+    screen:set_default_attr_ids({
+      [1] = {background = Screen.colors.LightMagenta},
+      [2] = {foreground = Screen.colors.Grey0, background = tonumber('0xffcfff')},
+      [3] = {foreground = tonumber('0xb282b2'), background = tonumber('0xffcfff')},
+    })
+    meths.buf_set_lines(0, 0, -1, true, funcs['repeat']({string.rep('.', 20)}, 7))
+  end)
+
+  local function open_float(lines, config)
+    local buf = meths.create_buf(false, false)
+    meths.buf_set_lines(buf, 0, -1, true, lines)
+    config.relative = 'editor'
+    return buf, meths.open_win(buf, false, config)
+  end
+
+  local function open_lower()
+    return open_float({'aaaaaaaa', 'aaaaaaaa', 'aaaaaaaa'}, {width=8, height=3, row=2, col=2})
+  end
+
+  local function change_lower(buf)
+    meths.buf_set_lines(buf, 0, -1, true, {'cccccccc', 'cccccccc', 'cccccccc'})
+  end
+
+  it('skips a float fully covered by another and shows it when that is closed', function()
+    local buf = open_lower()
+    local _, win = open_float(funcs['repeat']({string.rep('b', 10)}, 5),
+                              {width=10, height=5, row=1, col=1})
+    screen:expect([[
+      ^....................|
+      .{1:bbbbbbbbbb}.........|
+      .{1:bbbbbbbbbb}.........|
+      .{1:bbbbbbbbbb}.........|
+      .{1:bbbbbbbbbb}.........|
+      .{1:bbbbbbbbbb}.........|
+      ....................|
+                          |
+    ]])
+
+    change_lower(buf)
+    screen:expect_unchanged()
+
+    meths.win_close(win, true)
+    screen:expect([[
+      ^....................|
+      ....................|
+      ..{1:cccccccc}..........|
+      ..{1:cccccccc}..........|
+      ..{1:cccccccc}..........|
+      ....................|
+      ....................|
+                          |
+    ]])
+  end)
+
+  it('updates the visible part of a partially covered float', function()
+    local buf = open_lower()
+    local _, win = open_float(funcs['repeat']({string.rep('b', 5)}, 5),
+                              {width=5, height=5, row=1, col=0})
+    screen:expect([[
+      ^....................|
+      {1:bbbbb}...............|
+      {1:bbbbbaaaaa}..........|
+      {1:bbbbbaaaaa}..........|
+      {1:bbbbbaaaaa}..........|
+      {1:bbbbb}...............|
+      ....................|
+                          |
+    ]])
+
+    change_lower(buf)
+    screen:expect([[
+      ^....................|
+      {1:bbbbb}...............|
+      {1:bbbbbccccc}..........|
+      {1:bbbbbccccc}..........|
+      {1:bbbbbccccc}..........|
+      {1:bbbbb}...............|
+      ....................|
+                          |
+    ]])
+
+    meths.win_close(win, true)
+    screen:expect([[
+      ^....................|
+      ....................|
+      ..{1:cccccccc}..........|
+      ..{1:cccccccc}..........|
+      ..{1:cccccccc}..........|
+      ....................|
+      ....................|
+                          |
+    ]])
+  end)
+
+  it("updates a float seen through a float with 'winblend'", function()
+    local buf, lower = open_lower()
+    meths.set_option_value('winhighlight', 'NormalFloat:Normal', {win = lower})
+    local _, win = open_float(funcs['repeat']({'bbbb'}, 5), {width=10, height=5, row=1, col=1})
+    meths.win_set_option(win, 'winblend', 30)
+    screen:expect([[
+      ^....................|
+      .{2:bbbb}{3:......}.........|
+      .{2:bbbb}{3:aaaaa.}.........|
+      .{2:bbbb}{3:aaaaa.}.........|
+      .{2:bbbb}{3:aaaaa.}.........|
+      .{2:bbbb}{3:......}.........|
+      ....................|
+                          |
+    ]])
+
+    change_lower(buf)
+    screen:expect([[
+      ^....................|
+      .{2:bbbb}{3:......}.........|
+      .{2:bbbb}{3:ccccc.}.........|
+      .{2:bbbb}{3:ccccc.}.........|
+      .{2:bbbb}{3:ccccc.}.........|
+      .{2:bbbb}{3:......}.........|
+      ....................|
+                          |
+    ]])
+
+    meths.win_close(win, true)
+    screen:expect([[
+      ^....................|
+      ....................|
+      ..cccccccc..........|
+      ..cccccccc..........|
+      ..cccccccc..........|
+      ....................|
+      ....................|
+                          |
+    ]])
+  end)
+end)
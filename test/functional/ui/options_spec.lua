@@ -30,6 +30,7 @@ describe('UI receives option updates', function()
       ext_tabline=false,
       ext_wildmenu=false,
       ext_linegrid=false,
+      ext_lineruns=false,
       ext_hlstate=false,
       ext_multigrid=false,
       ext_messages=false,
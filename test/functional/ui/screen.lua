@@ -965,6 +965,45 @@ function Screen:_handle_grid_line(grid, row, col, items)
   end
 end
 
+function Screen:_handle_grid_line_runs(grid, row, col, text, runs)
+  assert(self._options.ext_lineruns)
+  local line = self._grids[grid].rows[row+1]
+  local cells = {}
+  local i = 1
+  while i <= #text do
+    local count = 1
+    if text:byte(i) == 2 then
+      count = text:byte(i+1)
+      i = i + 2
+    end
+    local b, len = text:byte(i), 1
+    local cell
+    if b == 0 then
+      cell = ''
+    elseif b == 1 then
+      len = text:byte(i+1)
+      cell = text:sub(i+2, i+1+len)
+      len = len + 2
+    else
+      len = (b >= 0xf0 and 4) or (b >= 0xe0 and 3) or (b >= 0xc0 and 2) or 1
+      cell = text:sub(i, i+len-1)
+    end
+    i = i + len
+    for _ = 1, count do
+      table.insert(cells, cell)
+    end
+  end
+  local colpos = col+1
+  for r = 1, #runs, 2 do
+    for _ = 1, runs[r+1] do
+      local cell = line[colpos]
+      cell.text = cells[colpos-col] or ' '
+      cell.hl_id = runs[r]
+      colpos = colpos+1
+    end
+  end
+end
+
 function Screen:_handle_bell()
   self.bell = true
 end
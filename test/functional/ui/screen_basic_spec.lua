@@ -1111,3 +1111,26 @@ it("showcmd doesn't cause empty grid_line with redrawdebug=compositor #22593", f
                        d          |
   ]]}
 end)
+
+it('ext_lineruns receives grid_line_runs events', function()
+  clear()
+  local screen = Screen.new(30, 4)
+  screen:set_default_attr_ids({
+    [0] = {bold = true, foreground = Screen.colors.Blue},
+  })
+  screen:attach({ext_lineruns = true})
+  insert('abc 口 x̂ ------------ end')
+  screen:expect{grid=[[
+    abc 口 x̂ ------------ en^d     |
+    {0:~                             }|
+    {0:~                             }|
+                                  |
+  ]]}
+  feed('0D')
+  screen:expect{grid=[[
+    ^                              |
+    {0:~                             }|
+    {0:~                             }|
+                                  |
+  ]]}
+end)
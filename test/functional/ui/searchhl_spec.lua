@@ -251,6 +251,53 @@ describe('search highlighting', function()
     end)
   end)
 
+  it('updates matches after lines changed', function()
+    insert([[
+      foo bar
+      bar foo
+      baz]])
+    feed('gg/foo<cr>')
+    screen:expect([[
+      {2:foo} bar                                 |
+      bar {2:^foo}                                 |
+      baz                                     |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /foo                                    |
+    ]])
+    feed('ggO<esc>')
+    screen:expect([[
+      ^                                        |
+      {2:foo} bar                                 |
+      bar {2:foo}                                 |
+      baz                                     |
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+    feed('3Gdd')
+    screen:expect([[
+                                              |
+      {2:foo} bar                                 |
+      ^baz                                     |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+    feed('ccfoo baz<esc>')
+    screen:expect([[
+                                              |
+      {2:foo} bar                                 |
+      {2:foo} ba^z                                 |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+                                              |
+    ]])
+  end)
+
   it('highlights after EOL', function()
     insert("\n\n\n\n\n\n")
 